@@ -21,7 +21,11 @@ is NVstore, in case NVstore isn't enabled we'll use current infrastructure,
 for more details see main.cpp file)
 """
 
+import base64
+import binascii
+import struct
 import time
+import zlib
 from mbed_host_tests import BaseHostTest
 from mbed_host_tests.host_tests_runner.host_test_default import DefaultTestSelector
 
@@ -29,11 +33,93 @@ DEFAULT_CYCLE_PERIOD      = 1.0
 MSG_VALUE_DUMMY           = '0'
 MSG_TRNG_READY            = 'ready'
 MSG_TRNG_BUFFER           = 'buffer'
+MSG_TRNG_RESEND           = 'resend'
+MSG_TRNG_TRACE            = 'trace'
 MSG_TRNG_FINISH           = 'finish'
 MSG_TRNG_TEST_STEP1       = 'check_step1'
 MSG_TRNG_TEST_STEP2       = 'check_step2'
 MSG_KEY_SYNC              = '__sync'
 MSG_KEY_TEST_SUITE_ENDED  = 'Test suite ended'
+MSG_LINK_START            = 'link_start'
+MSG_LINK_FRAME            = 'link_frame'
+MSG_LINK_SYNC             = 'link_sync'
+MSG_LINK_ACK              = 'link_ack'
+MSG_LINK_END              = 'link_end'
+MSG_LINK_DONE             = 'link_done'
+
+# Frame header of trngcore/trng_link.h: magic, type, flags, sequence number, length, CRC-32
+LINK_HEADER               = struct.Struct('<HBBIII')
+LINK_MAGIC                = 0x4c54
+LINK_DATA                 = 1
+LINK_ACK                  = 2
+
+# Record of a trace site of trngcore/trng_trace.h: magic, site, buckets, clock rate, calls, units,
+# sum of the latencies, highest latency and the latency buckets
+TRACE_BUCKETS             = 16
+TRACE_RECORD              = struct.Struct('<HBBIIIQI%dI' % TRACE_BUCKETS)
+TRACE_MAGIC               = 0x5454
+TRACE_SITES               = ('trng_get_bytes', 'fill', 'lzf', 'base64', 'nvstore')
+
+def trace_summary(record):
+    """One line about the site of a trace record, None if the record is damaged
+    """
+    if len(record) != TRACE_RECORD.size:
+        return None
+    fields = TRACE_RECORD.unpack(record)
+    magic, site, buckets, hz, calls, units, ticks, longest = fields[:8]
+    if magic != TRACE_MAGIC or site >= len(TRACE_SITES) or buckets != TRACE_BUCKETS:
+        return None
+    line = 'trace %s: %d calls, %d units' % (TRACE_SITES[site], calls, units)
+    if hz != 0 and calls != 0:
+        us = 1e6 / hz
+        line += ', mean %.1f us, max %.1f us, latency' % (ticks * us / calls, longest * us)
+        for b, count in enumerate(fields[8:]):
+            if count != 0:
+                bound = (1 << b) * us if b + 1 < TRACE_BUCKETS else (1 << (b - 1)) * us
+                line += ' %s%g:%d' % ('<' if b + 1 < TRACE_BUCKETS else '>=', bound, count)
+        line += ' us'
+    return line
+
+class TRNGLinkReceiver(object):
+    """Receiving end of the framed transport of trngcore/trng_link.h, takes the
+    frames in sequence, drops damaged and out of sequence ones and answers a
+    sync with the sequence number it expects next.
+    """
+
+    def __init__(self):
+        self.expected = 0
+        self.data = bytearray()
+        self.damaged = 0
+        self.out_of_sequence = 0
+
+    @staticmethod
+    def crc(frame):
+        return zlib.crc32(bytes(frame[LINK_HEADER.size:]), zlib.crc32(bytes(frame[:LINK_HEADER.size - 4]))) & 0xffffffff
+
+    def frame(self, frame):
+        """Take a frame, returns True when its payload was added to the data
+        """
+        if len(frame) < LINK_HEADER.size:
+            self.damaged += 1
+            return False
+        magic, ftype, flags, seq, length, crc = LINK_HEADER.unpack_from(frame)
+        if (magic != LINK_MAGIC or ftype != LINK_DATA or length != len(frame) - LINK_HEADER.size or
+                crc != self.crc(frame)):
+            self.damaged += 1
+            return False
+        if seq != self.expected:
+            self.out_of_sequence += 1
+            return False
+        self.expected = (self.expected + 1) & 0xffffffff
+        self.data += frame[LINK_HEADER.size:]
+        return True
+
+    def ack(self):
+        """ACK frame of the receiver's state
+        """
+        frame = bytearray(LINK_HEADER.pack(LINK_MAGIC, LINK_ACK, 0, self.expected, 0, 0))
+        struct.pack_into('<I', frame, LINK_HEADER.size - 4, self.crc(frame))
+        return bytes(frame)
 
 class TRNGResetTest(BaseHostTest):
     """Test for the TRNG API.
@@ -45,6 +131,8 @@ class TRNGResetTest(BaseHostTest):
         self.finish = False
         self.suite_ended = False
         self.buffer = 0
+        self.link = None
+        self.link_start = 0
         cycle_s = self.get_config_item('program_cycle_s')
         self.program_cycle_s = cycle_s if cycle_s is not None else DEFAULT_CYCLE_PERIOD
         self.test_steps_sequence = self.test_steps()
@@ -55,8 +143,14 @@ class TRNGResetTest(BaseHostTest):
     def setup(self):
         self.register_callback(MSG_TRNG_READY, self.cb_device_ready)
         self.register_callback(MSG_TRNG_BUFFER, self.cb_trng_buffer)
+        self.register_callback(MSG_TRNG_RESEND, self.cb_trng_resend)
+        self.register_callback(MSG_TRNG_TRACE, self.cb_trng_trace)
         self.register_callback(MSG_TRNG_FINISH, self.cb_device_finish)
         self.register_callback(MSG_KEY_TEST_SUITE_ENDED, self.cb_device_test_suit_ended)
+        self.register_callback(MSG_LINK_START, self.cb_link_start)
+        self.register_callback(MSG_LINK_FRAME, self.cb_link_frame)
+        self.register_callback(MSG_LINK_SYNC, self.cb_link_sync)
+        self.register_callback(MSG_LINK_END, self.cb_link_end)
 
     #receive sent data from device before reset
     def cb_trng_buffer(self, key, value, timestamp):
@@ -64,6 +158,52 @@ class TRNGResetTest(BaseHostTest):
         """
         self.buffer = value
 
+    #send the buffer again when the device could not decode it
+    def cb_trng_resend(self, key, value, timestamp):
+        """Device found the buffer corrupted at position value, repeat step 2 data
+        """
+        self.log('trng buffer corrupted at %s, sending it again' % value)
+        self.send_kv(MSG_TRNG_TEST_STEP2, self.buffer)
+
+    #counters of a trace site, sent by TRNG_TRACE builds before a reset and at the end
+    def cb_trng_trace(self, key, value, timestamp):
+        """A base64 encoded record of a trace site
+        """
+        try:
+            line = trace_summary(bytearray(base64.b64decode(value)))
+        except (TypeError, binascii.Error):
+            line = None
+        self.log(line if line is not None else 'trace record damaged')
+
+    #framed export of trng output
+    def cb_link_start(self, key, value, timestamp):
+        """Device starts exporting value bytes of trng output
+        """
+        self.link = TRNGLinkReceiver()
+        self.link_start = time.time()
+
+    def cb_link_frame(self, key, value, timestamp):
+        """A base64 encoded frame, damaged ones are counted and left to the next sync
+        """
+        try:
+            self.link.frame(bytearray(base64.b64decode(value)))
+        except (TypeError, binascii.Error):
+            self.link.damaged += 1
+
+    def cb_link_sync(self, key, value, timestamp):
+        """Device sent a window of frames and waits for the ACK
+        """
+        self.send_kv(MSG_LINK_ACK, base64.b64encode(self.link.ack()).decode('ascii'))
+
+    def cb_link_end(self, key, value, timestamp):
+        """Device has every frame acknowledged, report what was received for it to compare
+        """
+        elapsed = time.time() - self.link_start
+        self.log('link: %d bytes in %.1f s (%.0f B/s), %d frames damaged, %d out of sequence' %
+                 (len(self.link.data), elapsed, len(self.link.data) / elapsed if elapsed > 0 else 0,
+                  self.link.damaged, self.link.out_of_sequence))
+        self.send_kv(MSG_LINK_DONE, '%d %08x' % (len(self.link.data), zlib.crc32(bytes(self.link.data)) & 0xffffffff))
+
     def cb_device_ready(self, key, value, timestamp):
         """Acknowledge device rebooted correctly and feed the test execution
         """
@@ -1,4 +1,5 @@
 #include "base64b.h"
+#include <string.h>
 
 using namespace std;
 
@@ -87,4 +88,896 @@ string b64decode(const void *src, const size_t len)
         }
     }
     return str;
-}
\ No newline at end of file
+}
+
+/*b64_index as bytes with all 256 entries spelled out, characters outside the alphabet decode to 0*/
+static const uint8_t b64_value[256] =
+    {
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0, 62, 63, 62, 62, 63,
+      52, 53, 54, 55, 56, 57, 58, 59, 60, 61,  0,  0,  0,  0,  0,  0,
+       0,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
+      15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25,  0,  0,  0,  0, 63,
+       0, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
+      41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+       0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 };
+
+size_t base64_encoded_len(size_t len)
+{
+    return 4 * ((len + 2) / 3);
+}
+
+size_t b64decode_len(const void *src, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)src;
+    int pad = len > 0 && (len % 4 || p[len - 1] == '=');
+    const size_t L = ((len + 3) / 4 - pad) * 4;
+
+    return L / 4 * 3 + pad + (pad && len > L + 2 && p[L + 2] != '=');
+}
+
+/*Encode the bytes from in to end, padding the last group, returns the end of the output*/
+static char *encode_scalar(const unsigned char *in, const unsigned char *end, char *pos)
+{
+    for (; end - in >= 3; in += 3)
+    {
+        uint32_t n = (uint32_t)in[0] << 16 | (uint32_t)in[1] << 8 | in[2];
+        pos[0] = b64_table[n >> 18];
+        pos[1] = b64_table[(n >> 12) & 0x3f];
+        pos[2] = b64_table[(n >> 6) & 0x3f];
+        pos[3] = b64_table[n & 0x3f];
+        pos += 4;
+    }
+
+    if (end - in)
+    {
+        *pos++ = b64_table[in[0] >> 2];
+        if (end - in == 1)
+        {
+            *pos++ = b64_table[(in[0] & 0x03) << 4];
+            *pos++ = '=';
+        }
+        else
+        {
+            *pos++ = b64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+            *pos++ = b64_table[(in[1] & 0x0f) << 2];
+        }
+        *pos++ = '=';
+    }
+
+    return pos;
+}
+
+static inline void decode_group(const unsigned char *p, unsigned char *out)
+{
+    uint32_t n = (uint32_t)b64_value[p[0]] << 18 | (uint32_t)b64_value[p[1]] << 12 |
+                 (uint32_t)b64_value[p[2]] << 6 | b64_value[p[3]];
+    out[0] = (unsigned char)(n >> 16);
+    out[1] = (unsigned char)(n >> 8);
+    out[2] = (unsigned char)n;
+}
+
+/*Decode the groups of src from i up to L and the padded group after them as b64decode does,
+  returns the number of bytes written*/
+static size_t decode_scalar(const unsigned char *p, size_t len, size_t i, unsigned char *out)
+{
+    int pad = len > 0 && (len % 4 || p[len - 1] == '=');
+    const size_t L = ((len + 3) / 4 - pad) * 4;
+    unsigned char *pos = out + i / 4 * 3;
+
+    for (; i < L; i += 4)
+    {
+        decode_group(p + i, pos);
+        pos += 3;
+    }
+    if (pad)
+    {
+        uint32_t n = (uint32_t)b64_value[p[L]] << 18 | (uint32_t)(L + 1 < len ? b64_value[p[L + 1]] : 0) << 12;
+        if (len > L + 2 && p[L + 2] != '=')
+        {
+            n |= (uint32_t)b64_value[p[L + 2]] << 6;
+            *pos++ = (unsigned char)(n >> 16);
+            *pos++ = (unsigned char)(n >> 8);
+        }
+        else
+        {
+            *pos++ = (unsigned char)(n >> 16);
+        }
+    }
+
+    return (size_t)(pos - out);
+}
+
+/*Number of characters of src that go through the group loop of b64decode*/
+static inline size_t decode_groups_len(const unsigned char *p, size_t len)
+{
+    int pad = len > 0 && (len % 4 || p[len - 1] == '=');
+    return ((len + 3) / 4 - pad) * 4;
+}
+
+size_t base64_encode_scalar(const unsigned char *src, size_t len, char *out)
+{
+    return (size_t)(encode_scalar(src, src + len, out) - out);
+}
+
+size_t b64decode_scalar(const void *src, size_t len, unsigned char *out)
+{
+    return decode_scalar((const unsigned char *)src, len, 0, out);
+}
+
+#if BASE64_HAVE_SSSE3 || BASE64_HAVE_AVX2
+
+#include <immintrin.h>
+
+/*
+ * x86 kernels after W. Mula and D. Lemire, "Faster Base64 Encoding and
+ * Decoding Using AVX2 Instructions". Encoding spreads 12 bytes over 16
+ * lanes, cuts out the 6 bit fields with two multiplies and turns them into
+ * characters with a 16 entry offset table. Decoding classifies every
+ * character by its nibbles (nonzero lo & hi means outside the standard
+ * alphabet), adds the offset of its class and packs 4 x 6 bits into 3 bytes.
+ */
+
+#define ENC_SHUFFLE     10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1
+#define ENC_OFFSETS     0, 0, 'A', '/' - 63, '+' - 62, '0' - 52, '0' - 52, '0' - 52, \
+                        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, 'a' - 26
+#define DEC_LUT_LO      0x1a, 0x1b, 0x1b, 0x1b, 0x1a, 0x13, 0x11, 0x11, \
+                        0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x15
+#define DEC_LUT_HI      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, \
+                        0x08, 0x04, 0x08, 0x04, 0x02, 0x01, 0x10, 0x10
+#define DEC_LUT_ROLL    0, 0, 0, 0, 0, 0, 0, 0, -71, -71, -65, -65, 4, 19, 16, 0
+#define DEC_PACK        -1, -1, -1, -1, 12, 13, 14, 8, 9, 10, 4, 5, 6, 0, 1, 2
+
+#endif
+
+#if BASE64_HAVE_SSSE3
+
+static inline __m128i enc_translate_128(__m128i in)
+{
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    __m128i idx = _mm_or_si128(t1, t3);
+
+    __m128i res = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+    __m128i less = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+    res = _mm_or_si128(res, _mm_and_si128(less, _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(_mm_set_epi8(ENC_OFFSETS), res), idx);
+}
+
+/*Decode 16 characters into the 12 low bytes of the result, lanes outside the alphabet
+  are flagged in *bad and decode to garbage*/
+static inline __m128i dec_translate_128(__m128i in, __m128i *bad)
+{
+    __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), _mm_set1_epi8(0x0f));
+    __m128i lo_nibbles = _mm_and_si128(in, _mm_set1_epi8(0x0f));
+    __m128i lo = _mm_shuffle_epi8(_mm_set_epi8(DEC_LUT_LO), lo_nibbles);
+    __m128i hi = _mm_shuffle_epi8(_mm_set_epi8(DEC_LUT_HI), hi_nibbles);
+    *bad = _mm_or_si128(*bad, _mm_and_si128(lo, hi));
+
+    __m128i eq_2f = _mm_cmpeq_epi8(in, _mm_set1_epi8('/'));
+    __m128i roll = _mm_shuffle_epi8(_mm_set_epi8(DEC_LUT_ROLL), _mm_add_epi8(eq_2f, hi_nibbles));
+    __m128i val = _mm_add_epi8(in, roll);
+
+    val = _mm_maddubs_epi16(val, _mm_set1_epi32(0x01400140));
+    val = _mm_madd_epi16(val, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(val, _mm_set_epi8(DEC_PACK));
+}
+
+static inline int any_bad_128(__m128i bad)
+{
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(bad, _mm_setzero_si128())) != 0xffff;
+}
+
+static inline void store_12(unsigned char *out, __m128i v)
+{
+    _mm_storel_epi64((__m128i *)out, v);
+    uint32_t hi = (uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+    memcpy(out + 8, &hi, 4);
+}
+
+size_t base64_encode_ssse3(const unsigned char *src, size_t len, char *out)
+{
+    const unsigned char *in = src, *end = src + len;
+    char *pos = out;
+
+    /*Loads are 16 bytes wide for 12 bytes of input*/
+    for (; end - in >= 16; in += 12, pos += 16)
+    {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)in), _mm_set_epi8(ENC_SHUFFLE));
+        _mm_storeu_si128((__m128i *)pos, enc_translate_128(v));
+    }
+
+    return (size_t)(encode_scalar(in, end, pos) - out);
+}
+
+size_t b64decode_ssse3(const void *src, size_t len, unsigned char *out)
+{
+    const unsigned char *p = (const unsigned char *)src;
+    const size_t L = decode_groups_len(p, len);
+    size_t i = 0;
+
+    while (L - i >= 16)
+    {
+        __m128i bad = _mm_setzero_si128();
+        __m128i v = dec_translate_128(_mm_loadu_si128((const __m128i *)(p + i)), &bad);
+        if (!any_bad_128(bad))
+        {
+            store_12(out + i / 4 * 3, v);
+        }
+        else
+        {
+            for (size_t k = 0; k < 16; k += 4)
+            {
+                decode_group(p + i + k, out + (i + k) / 4 * 3);
+            }
+        }
+        i += 16;
+    }
+
+    return decode_scalar(p, len, i, out);
+}
+
+#endif
+
+#if BASE64_HAVE_AVX2
+
+static inline __m256i enc_translate_256(__m256i in)
+{
+    __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+    __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+    __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+    __m256i idx = _mm256_or_si256(t1, t3);
+
+    __m256i res = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+    __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx);
+    res = _mm256_or_si256(res, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+    __m256i offsets = _mm256_broadcastsi128_si256(_mm_set_epi8(ENC_OFFSETS));
+    return _mm256_add_epi8(_mm256_shuffle_epi8(offsets, res), idx);
+}
+
+/*dec_translate_128 for 32 characters, the 24 bytes are packed at the bottom*/
+static inline __m256i dec_translate_256(__m256i in, __m256i *bad)
+{
+    const __m256i lut_lo = _mm256_broadcastsi128_si256(_mm_set_epi8(DEC_LUT_LO));
+    const __m256i lut_hi = _mm256_broadcastsi128_si256(_mm_set_epi8(DEC_LUT_HI));
+    const __m256i lut_roll = _mm256_broadcastsi128_si256(_mm_set_epi8(DEC_LUT_ROLL));
+    const __m256i pack = _mm256_broadcastsi128_si256(_mm_set_epi8(DEC_PACK));
+
+    __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), _mm256_set1_epi8(0x0f));
+    __m256i lo_nibbles = _mm256_and_si256(in, _mm256_set1_epi8(0x0f));
+    __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+    __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+    *bad = _mm256_or_si256(*bad, _mm256_and_si256(lo, hi));
+
+    __m256i eq_2f = _mm256_cmpeq_epi8(in, _mm256_set1_epi8('/'));
+    __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+    __m256i val = _mm256_add_epi8(in, roll);
+
+    val = _mm256_maddubs_epi16(val, _mm256_set1_epi32(0x01400140));
+    val = _mm256_madd_epi16(val, _mm256_set1_epi32(0x00011000));
+    val = _mm256_shuffle_epi8(val, pack);
+    return _mm256_permutevar8x32_epi32(val, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+}
+
+static inline void store_24(unsigned char *out, __m256i v)
+{
+    _mm_storeu_si128((__m128i *)out, _mm256_castsi256_si128(v));
+    _mm_storel_epi64((__m128i *)(out + 16), _mm256_extracti128_si256(v, 1));
+}
+
+size_t base64_encode_avx2(const unsigned char *src, size_t len, char *out)
+{
+    const unsigned char *in = src, *end = src + len;
+    char *pos = out;
+    const __m256i shuffle = _mm256_broadcastsi128_si256(_mm_set_epi8(ENC_SHUFFLE));
+
+    /*Two 16 byte loads, 12 bytes apart, for 24 bytes of input*/
+    for (; end - in >= 28; in += 24, pos += 32)
+    {
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)in)),
+                                            _mm_loadu_si128((const __m128i *)(in + 12)), 1);
+        _mm256_storeu_si256((__m256i *)pos, enc_translate_256(_mm256_shuffle_epi8(v, shuffle)));
+    }
+
+    return (size_t)(encode_scalar(in, end, pos) - out);
+}
+
+size_t b64decode_avx2(const void *src, size_t len, unsigned char *out)
+{
+    const unsigned char *p = (const unsigned char *)src;
+    const size_t L = decode_groups_len(p, len);
+    size_t i = 0;
+
+    while (L - i >= 32)
+    {
+        __m256i bad = _mm256_setzero_si256();
+        __m256i v = dec_translate_256(_mm256_loadu_si256((const __m256i *)(p + i)), &bad);
+        if (_mm256_testz_si256(bad, bad))
+        {
+            store_24(out + i / 4 * 3, v);
+        }
+        else
+        {
+            for (size_t k = 0; k < 32; k += 4)
+            {
+                decode_group(p + i + k, out + (i + k) / 4 * 3);
+            }
+        }
+        i += 32;
+    }
+
+    return decode_scalar(p, len, i, out);
+}
+
+#endif
+
+#if BASE64_HAVE_NEON
+
+#include <arm_neon.h>
+
+/*6 bit values to characters: 'A' + v, moved up for 'a'-'z', down for '0'-'9', '+' and '/'*/
+static inline uint8x16_t enc_translate_neon(uint8x16_t v)
+{
+    uint8x16_t off = vdupq_n_u8('A');
+    off = vaddq_u8(off, vandq_u8(vcgtq_u8(v, vdupq_n_u8(25)), vdupq_n_u8(6)));
+    off = vsubq_u8(off, vandq_u8(vcgtq_u8(v, vdupq_n_u8(51)), vdupq_n_u8(75)));
+    off = vsubq_u8(off, vandq_u8(vcgtq_u8(v, vdupq_n_u8(61)), vdupq_n_u8(15)));
+    off = vaddq_u8(off, vandq_u8(vcgtq_u8(v, vdupq_n_u8(62)), vdupq_n_u8(3)));
+    return vaddq_u8(v, off);
+}
+
+/*Characters to 6 bit values, lanes outside the standard alphabet are set in *bad*/
+static inline uint8x16_t dec_translate_neon(uint8x16_t c, uint8x16_t *bad)
+{
+    uint8x16_t upper = vcltq_u8(vsubq_u8(c, vdupq_n_u8('A')), vdupq_n_u8(26));
+    uint8x16_t lower = vcltq_u8(vsubq_u8(c, vdupq_n_u8('a')), vdupq_n_u8(26));
+    uint8x16_t digit = vcltq_u8(vsubq_u8(c, vdupq_n_u8('0')), vdupq_n_u8(10));
+    uint8x16_t plus = vceqq_u8(c, vdupq_n_u8('+'));
+    uint8x16_t slash = vceqq_u8(c, vdupq_n_u8('/'));
+
+    uint8x16_t v = vandq_u8(upper, vsubq_u8(c, vdupq_n_u8('A')));
+    v = vorrq_u8(v, vandq_u8(lower, vsubq_u8(c, vdupq_n_u8('a' - 26))));
+    v = vorrq_u8(v, vandq_u8(digit, vaddq_u8(c, vdupq_n_u8(52 - '0'))));
+    v = vorrq_u8(v, vandq_u8(plus, vdupq_n_u8(62)));
+    v = vorrq_u8(v, vandq_u8(slash, vdupq_n_u8(63)));
+
+    uint8x16_t ok = vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, vorrq_u8(plus, slash)));
+    *bad = vorrq_u8(*bad, vmvnq_u8(ok));
+    return v;
+}
+
+size_t base64_encode_neon(const unsigned char *src, size_t len, char *out)
+{
+    const unsigned char *in = src, *end = src + len;
+    char *pos = out;
+
+    for (; end - in >= 48; in += 48, pos += 64)
+    {
+        uint8x16x3_t b = vld3q_u8(in);
+        uint8x16x4_t c;
+        c.val[0] = vshrq_n_u8(b.val[0], 2);
+        c.val[1] = vorrq_u8(vandq_u8(vshlq_n_u8(b.val[0], 4), vdupq_n_u8(0x30)), vshrq_n_u8(b.val[1], 4));
+        c.val[2] = vorrq_u8(vandq_u8(vshlq_n_u8(b.val[1], 2), vdupq_n_u8(0x3c)), vshrq_n_u8(b.val[2], 6));
+        c.val[3] = vandq_u8(b.val[2], vdupq_n_u8(0x3f));
+        for (int k = 0; k < 4; k++)
+        {
+            c.val[k] = enc_translate_neon(c.val[k]);
+        }
+        vst4q_u8((uint8_t *)pos, c);
+    }
+
+    return (size_t)(encode_scalar(in, end, pos) - out);
+}
+
+/*Decode 64 characters into 48 bytes, lanes outside the alphabet are flagged in *bad*/
+static inline void dec_block_neon(const unsigned char *p, unsigned char *out, uint8x16_t *bad)
+{
+    uint8x16x4_t c = vld4q_u8(p);
+    uint8x16_t v0 = dec_translate_neon(c.val[0], bad);
+    uint8x16_t v1 = dec_translate_neon(c.val[1], bad);
+    uint8x16_t v2 = dec_translate_neon(c.val[2], bad);
+    uint8x16_t v3 = dec_translate_neon(c.val[3], bad);
+
+    uint8x16x3_t b;
+    b.val[0] = vorrq_u8(vshlq_n_u8(v0, 2), vshrq_n_u8(v1, 4));
+    b.val[1] = vorrq_u8(vshlq_n_u8(v1, 4), vshrq_n_u8(v2, 2));
+    b.val[2] = vorrq_u8(vshlq_n_u8(v2, 6), v3);
+    vst3q_u8(out, b);
+}
+
+static inline int any_bad_neon(uint8x16_t bad)
+{
+    uint8x8_t any = vorr_u8(vget_low_u8(bad), vget_high_u8(bad));
+    return vget_lane_u64(vreinterpret_u64_u8(any), 0) != 0;
+}
+
+size_t b64decode_neon(const void *src, size_t len, unsigned char *out)
+{
+    const unsigned char *p = (const unsigned char *)src;
+    const size_t L = decode_groups_len(p, len);
+    size_t i = 0;
+
+    for (; L - i >= 64; i += 64)
+    {
+        uint8x16_t bad = vdupq_n_u8(0);
+        dec_block_neon(p + i, out + i / 4 * 3, &bad);
+        if (any_bad_neon(bad))
+        {
+            for (size_t k = 0; k < 64; k += 4)
+            {
+                decode_group(p + i + k, out + (i + k) / 4 * 3);
+            }
+        }
+    }
+
+    return decode_scalar(p, len, i, out);
+}
+
+#endif
+
+/*
+ * Strict decoding. Every character goes through b64_strict, which holds its
+ * 6 bit value or STRICT_BAD for anything outside the standard alphabet
+ * ('=' included), and all classes are or-ed into one accumulator that is
+ * only looked at once the data is decoded. The vector kernels accumulate
+ * their classification the same way. Only when the accumulator shows an
+ * error is the input scanned again for its position.
+ */
+
+#define STRICT_BAD  0x80
+
+static const uint8_t b64_strict[256] =
+    {
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,   62, 0x80, 0x80, 0x80,   63,
+        52,   53,   54,   55,   56,   57,   58,   59,   60,   61, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80,    0,    1,    2,    3,    4,    5,    6,    7,    8,    9,   10,   11,   12,   13,   14,
+        15,   16,   17,   18,   19,   20,   21,   22,   23,   24,   25, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80,   26,   27,   28,   29,   30,   31,   32,   33,   34,   35,   36,   37,   38,   39,   40,
+        41,   42,   43,   44,   45,   46,   47,   48,   49,   50,   51, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+      0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 };
+
+
+/*Decode the groups of src up to L (a multiple of 4) without looking at the classes,
+  returns the classes of all characters or-ed together*/
+static unsigned int strict_groups(const unsigned char *p, size_t L, unsigned char *out)
+{
+    unsigned int err = 0;
+    size_t i = 0;
+
+#if BASE64_KERNEL == BASE64_AVX2
+    __m256i bad = _mm256_setzero_si256();
+    for (; L - i >= 32; i += 32)
+    {
+        store_24(out + i / 4 * 3, dec_translate_256(_mm256_loadu_si256((const __m256i *)(p + i)), &bad));
+    }
+    err |= _mm256_testz_si256(bad, bad) ? 0 : STRICT_BAD;
+#elif BASE64_KERNEL == BASE64_SSSE3
+    __m128i bad = _mm_setzero_si128();
+    for (; L - i >= 16; i += 16)
+    {
+        store_12(out + i / 4 * 3, dec_translate_128(_mm_loadu_si128((const __m128i *)(p + i)), &bad));
+    }
+    err |= any_bad_128(bad) ? STRICT_BAD : 0;
+#elif BASE64_KERNEL == BASE64_NEON
+    uint8x16_t bad = vdupq_n_u8(0);
+    for (; L - i >= 64; i += 64)
+    {
+        dec_block_neon(p + i, out + i / 4 * 3, &bad);
+    }
+    err |= any_bad_neon(bad) ? STRICT_BAD : 0;
+#endif
+
+    for (; i < L; i += 4)
+    {
+        uint32_t a = b64_strict[p[i]], b = b64_strict[p[i + 1]], c = b64_strict[p[i + 2]], d = b64_strict[p[i + 3]];
+        uint32_t n = a << 18 | b << 12 | c << 6 | d;
+        err |= a | b | c | d;
+        out[i / 4 * 3] = (unsigned char)(n >> 16);
+        out[i / 4 * 3 + 1] = (unsigned char)(n >> 8);
+        out[i / 4 * 3 + 2] = (unsigned char)n;
+    }
+
+    return err;
+}
+
+/*Position of the first character from i up to end that is outside the alphabet, end if none*/
+static size_t strict_find(const unsigned char *p, size_t i, size_t end)
+{
+    while (i < end && !(b64_strict[p[i]] & STRICT_BAD))
+    {
+        i++;
+    }
+    return i;
+}
+
+static int strict_error(const unsigned char *p, size_t pos, size_t *decoded, size_t *error_pos)
+{
+    *decoded = pos / 4 * 3;
+    *error_pos = pos;
+    return p[pos] == '=' ? BASE64_ERR_PADDING : BASE64_ERR_CHAR;
+}
+
+int b64decode_strict(const void *src, size_t len, unsigned char *out, size_t out_len,
+                     size_t *decoded, size_t *error_pos)
+{
+    const unsigned char *p = (const unsigned char *)src;
+    size_t body = len / 4 * 4;
+    size_t pad = 0;
+
+    if (len % 4 == 0 && len > 0 && p[len - 1] == '=')
+    {
+        pad = p[len - 2] == '=' ? 2 : 1;
+    }
+
+    size_t L = pad ? body - 4 : body;
+    *decoded = 0;
+    *error_pos = 0;
+
+    if (out_len < body / 4 * 3 - pad)
+    {
+        return BASE64_ERR_SPACE;
+    }
+
+    if (strict_groups(p, L, out) & STRICT_BAD)
+    {
+        return strict_error(p, strict_find(p, 0, L), decoded, error_pos);
+    }
+
+    if (pad)
+    {
+        /*Padded group, the bits below the last byte must be 0 for the encoding to be canonical*/
+        size_t pos = strict_find(p, L, len - pad);
+        if (pos < len - pad)
+        {
+            return strict_error(p, pos, decoded, error_pos);
+        }
+
+        uint32_t n = (uint32_t)b64_strict[p[L]] << 18 | (uint32_t)b64_strict[p[L + 1]] << 12;
+        if (pad == 1)
+        {
+            n |= (uint32_t)b64_strict[p[L + 2]] << 6;
+        }
+        if (n & (pad == 1 ? 0xff : 0xffff))
+        {
+            *decoded = L / 4 * 3;
+            *error_pos = len - pad - 1;
+            return BASE64_ERR_PADDING;
+        }
+
+        out[L / 4 * 3] = (unsigned char)(n >> 16);
+        if (pad == 1)
+        {
+            out[L / 4 * 3 + 1] = (unsigned char)(n >> 8);
+        }
+    }
+
+    if (body != len)
+    {
+        size_t pos = strict_find(p, body, len);
+        if (pos < len)
+        {
+            return strict_error(p, pos, decoded, error_pos);
+        }
+
+        *decoded = body / 4 * 3;
+        *error_pos = len;
+        return BASE64_ERR_LENGTH;
+    }
+
+    *decoded = body / 4 * 3 - pad;
+    return BASE64_OK;
+}
+
+size_t base64_encode_to(const unsigned char *src, size_t len, char *out, size_t out_len)
+{
+    if (out_len < base64_encoded_len(len))
+    {
+        return 0;
+    }
+
+#if BASE64_KERNEL == BASE64_AVX2
+    return base64_encode_avx2(src, len, out);
+#elif BASE64_KERNEL == BASE64_SSSE3
+    return base64_encode_ssse3(src, len, out);
+#elif BASE64_KERNEL == BASE64_NEON
+    return base64_encode_neon(src, len, out);
+#else
+    return base64_encode_scalar(src, len, out);
+#endif
+}
+
+size_t b64decode_to(const void *src, size_t len, unsigned char *out, size_t out_len)
+{
+    if (out_len < b64decode_len(src, len))
+    {
+        return 0;
+    }
+
+#if BASE64_KERNEL == BASE64_AVX2
+    return b64decode_avx2(src, len, out);
+#elif BASE64_KERNEL == BASE64_SSSE3
+    return b64decode_ssse3(src, len, out);
+#elif BASE64_KERNEL == BASE64_NEON
+    return b64decode_neon(src, len, out);
+#else
+    return b64decode_scalar(src, len, out);
+#endif
+}
+
+static void encoder_put(base64_encoder *enc, const char *s, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        enc->window[enc->fill++] = s[i];
+        if (enc->fill == enc->window_len)
+        {
+            enc->emit(enc->window, enc->fill, enc->emit_ctx);
+            enc->fill = 0;
+        }
+    }
+    enc->total += n;
+}
+
+void base64_encoder_init(base64_encoder *enc, char *window, size_t window_len,
+                         base64_window_cb emit, void *ctx)
+{
+    memset(enc, 0, sizeof(*enc));
+    enc->window = window;
+    enc->window_len = window_len;
+    enc->emit = emit;
+    enc->emit_ctx = ctx;
+}
+
+void base64_encoder_update(base64_encoder *enc, const unsigned char *src, size_t len)
+{
+    char group[4];
+
+    /*Complete a carried group first*/
+    while (enc->carry_len > 0 && len > 0)
+    {
+        enc->carry[enc->carry_len++] = *src++;
+        len--;
+        if (enc->carry_len == 3)
+        {
+            encoder_put(enc, group, base64_encode_to(enc->carry, 3, group, sizeof(group)));
+            enc->carry_len = 0;
+        }
+    }
+
+    while (len >= 3)
+    {
+        /*As many whole groups as the window holds go straight into it*/
+        size_t groups = (enc->window_len - enc->fill) / 4;
+        groups = groups < len / 3 ? groups : len / 3;
+
+        if (groups == 0)
+        {
+            /*Group across a window boundary*/
+            encoder_put(enc, group, base64_encode_to(src, 3, group, sizeof(group)));
+            src += 3;
+            len -= 3;
+            continue;
+        }
+
+        enc->fill += base64_encode_to(src, groups * 3, enc->window + enc->fill, groups * 4);
+        enc->total += groups * 4;
+        src += groups * 3;
+        len -= groups * 3;
+        if (enc->fill == enc->window_len)
+        {
+            enc->emit(enc->window, enc->fill, enc->emit_ctx);
+            enc->fill = 0;
+        }
+    }
+
+    memcpy(enc->carry + enc->carry_len, src, len);
+    enc->carry_len += len;
+}
+
+void base64_encoder_final(base64_encoder *enc)
+{
+    char group[4];
+
+    if (enc->carry_len > 0)
+    {
+        encoder_put(enc, group, base64_encode_to(enc->carry, enc->carry_len, group, sizeof(group)));
+        enc->carry_len = 0;
+    }
+    if (enc->fill > 0)
+    {
+        enc->emit(enc->window, enc->fill, enc->emit_ctx);
+        enc->fill = 0;
+    }
+}
+
+static void decoder_put(base64_decoder *dec, const unsigned char *s, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        dec->window[dec->fill++] = s[i];
+        if (dec->fill == dec->window_len)
+        {
+            dec->emit(dec->window, dec->fill, dec->emit_ctx);
+            dec->fill = 0;
+        }
+    }
+}
+
+static int decoder_fail(base64_decoder *dec, int error, uint64_t pos)
+{
+    dec->error = error;
+    dec->error_pos = pos;
+    return error;
+}
+
+/*Decode one group that may be the padded last one of the stream*/
+static int decoder_group(base64_decoder *dec, const unsigned char *p)
+{
+    unsigned char bytes[3];
+    size_t decoded = 0, error_pos = 0;
+
+    if (dec->padded)
+    {
+        /*Data after the padding, the '=' was not at the end after all*/
+        return decoder_fail(dec, BASE64_ERR_PADDING, dec->pad_pos);
+    }
+
+    int res = b64decode_strict(p, 4, bytes, sizeof(bytes), &decoded, &error_pos);
+    if (res == BASE64_ERR_PADDING && p[3] == '=' && p[error_pos] != '=')
+    {
+        /*Non canonical padded group, an error unless more data follows, which makes the '=' one*/
+        dec->pending = res;
+        dec->pending_pos = dec->total + error_pos;
+    }
+    else if (res != BASE64_OK)
+    {
+        return decoder_fail(dec, res, dec->total + error_pos);
+    }
+
+    if (p[3] == '=')
+    {
+        dec->padded = 1;
+        dec->pad_pos = dec->total + (p[2] == '=' ? 2 : 3);
+        memcpy(dec->pad_bytes, bytes, decoded);
+        dec->pad_len = decoded;
+    }
+    else
+    {
+        decoder_put(dec, bytes, decoded);
+    }
+    dec->total += 4;
+    return BASE64_OK;
+}
+
+void base64_decoder_init(base64_decoder *dec, unsigned char *window, size_t window_len,
+                         base64_window_cb emit, void *ctx)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->window = window;
+    dec->window_len = window_len;
+    dec->emit = emit;
+    dec->emit_ctx = ctx;
+}
+
+int base64_decoder_update(base64_decoder *dec, const void *src, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)src;
+
+    if (dec->error != BASE64_OK)
+    {
+        return dec->error;
+    }
+
+    /*Complete a carried group first*/
+    while (dec->carry_len > 0 && len > 0)
+    {
+        dec->carry[dec->carry_len++] = *p++;
+        len--;
+        if (dec->carry_len == 4)
+        {
+            dec->carry_len = 0;
+            if (decoder_group(dec, dec->carry) != BASE64_OK)
+            {
+                return dec->error;
+            }
+        }
+    }
+
+    while (len >= 4)
+    {
+        /*As many whole groups as the window holds go straight into it. A padded group is
+          left to decoder_group, and so is the last group of the slice, which may be one.
+          The bulk range stops before the group of its first '=', which ends the text*/
+        size_t groups = (dec->window_len - dec->fill) / 3;
+        groups = groups < len / 4 - 1 ? groups : len / 4 - 1;
+        const unsigned char *pad = (const unsigned char *)memchr(p, '=', groups * 4);
+        groups = pad != NULL ? (size_t)(pad - p) / 4 : groups;
+
+        if (groups == 0 || dec->padded)
+        {
+            if (decoder_group(dec, p) != BASE64_OK)
+            {
+                return dec->error;
+            }
+            p += 4;
+            len -= 4;
+            continue;
+        }
+
+        size_t decoded = 0, error_pos = 0;
+        int res = b64decode_strict(p, groups * 4, dec->window + dec->fill, groups * 3, &decoded, &error_pos);
+        dec->fill += decoded;
+        if (res != BASE64_OK)
+        {
+            return decoder_fail(dec, res, dec->total + error_pos);
+        }
+
+        dec->total += groups * 4;
+        p += groups * 4;
+        len -= groups * 4;
+        if (dec->fill == dec->window_len)
+        {
+            dec->emit(dec->window, dec->fill, dec->emit_ctx);
+            dec->fill = 0;
+        }
+    }
+
+    if (len > 0 && dec->padded)
+    {
+        return decoder_fail(dec, BASE64_ERR_PADDING, dec->pad_pos);
+    }
+    memcpy(dec->carry + dec->carry_len, p, len);
+    dec->carry_len += len;
+    return BASE64_OK;
+}
+
+int base64_decoder_final(base64_decoder *dec)
+{
+    if (dec->error == BASE64_OK && dec->pending != BASE64_OK)
+    {
+        decoder_fail(dec, dec->pending, dec->pending_pos);
+    }
+    if (dec->error == BASE64_OK && dec->padded)
+    {
+        decoder_put(dec, dec->pad_bytes, dec->pad_len);
+    }
+    if (dec->error == BASE64_OK && dec->carry_len > 0)
+    {
+        /*Characters of the last group are checked before its length*/
+        size_t pos = strict_find(dec->carry, 0, dec->carry_len);
+        if (pos < dec->carry_len)
+        {
+            decoder_fail(dec, dec->carry[pos] == '=' ? BASE64_ERR_PADDING : BASE64_ERR_CHAR, dec->total + pos);
+        }
+        else
+        {
+            decoder_fail(dec, BASE64_ERR_LENGTH, dec->total + dec->carry_len);
+        }
+    }
+    if (dec->fill > 0)
+    {
+        dec->emit(dec->window, dec->fill, dec->emit_ctx);
+        dec->fill = 0;
+    }
+    return dec->error;
+}
@@ -1,3 +1,6 @@
+#ifndef BASE64B_H
+#define BASE64B_H
+
 #include <stdint.h>
 #include <stdlib.h>
 #include <string>
@@ -5,3 +8,160 @@
 std::string base64_encode(const unsigned char *src, size_t len);
 std::string b64decode(const void* data, const size_t len);
 
+/*
+ * Encoding and decoding into caller supplied buffers, no allocation. The
+ * output is the same as base64_encode and b64decode give for the input.
+ *
+ * The bulk of the data goes through a vectorized kernel selected at build
+ * time, BASE64_KERNEL may be set to one of the values below to override:
+ *
+ *   BASE64_SCALAR  4 characters per 3 bytes through lookup tables
+ *   BASE64_SSSE3   16 characters at a time (x86 with SSSE3)
+ *   BASE64_AVX2    32 characters at a time (x86 with AVX2)
+ *   BASE64_NEON    64 characters at a time (ARMv7 NEON and AArch64)
+ *
+ * The vector decoders only take the standard alphabet, blocks holding
+ * anything else ('-', '_', ',', '.' or invalid characters, decoded the
+ * lenient b64decode way) go through the scalar code.
+ */
+
+#define BASE64_SCALAR   0
+#define BASE64_SSSE3    1
+#define BASE64_AVX2     2
+#define BASE64_NEON     3
+
+#ifndef BASE64_KERNEL
+# if defined(__AVX2__)
+#  define BASE64_KERNEL BASE64_AVX2
+# elif defined(__SSSE3__)
+#  define BASE64_KERNEL BASE64_SSSE3
+# elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#  define BASE64_KERNEL BASE64_NEON
+# else
+#  define BASE64_KERNEL BASE64_SCALAR
+# endif
+#endif
+
+#if defined(__SSSE3__)
+# define BASE64_HAVE_SSSE3 1
+#endif
+#if defined(__AVX2__)
+# define BASE64_HAVE_AVX2 1
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define BASE64_HAVE_NEON 1
+#endif
+
+/*Number of characters base64_encode produces for len bytes*/
+size_t base64_encoded_len(size_t len);
+
+/*Number of bytes b64decode produces for the len characters of src*/
+size_t b64decode_len(const void *src, size_t len);
+
+/*Encode len bytes of src into out, no terminating NUL is written.
+  Returns the number of characters written or 0 if out_len is below base64_encoded_len(len)*/
+size_t base64_encode_to(const unsigned char *src, size_t len, char *out, size_t out_len);
+
+/*Decode len characters of src into out. Characters past len are taken as NUL, where
+  b64decode reads one past the end for lengths of 4n+1.
+  Returns the number of bytes written or 0 if out_len is below b64decode_len(src, len)*/
+size_t b64decode_to(const void *src, size_t len, unsigned char *out, size_t out_len);
+
+/*
+ * Strict decoding for data that must come through unchanged: only the
+ * standard alphabet, a length that is a multiple of 4, '=' only as the
+ * padding of the last group and no bits set below the last decoded byte.
+ * Runs through the same vector kernels as b64decode_to.
+ */
+
+#define BASE64_OK               0
+#define BASE64_ERR_CHAR         -1  //character outside the alphabet
+#define BASE64_ERR_PADDING      -2  //'=' anywhere but the end, or a non canonical last group
+#define BASE64_ERR_LENGTH       -3  //input ends inside a group
+#define BASE64_ERR_SPACE        -4  //out_len is too small
+
+/*Decode len characters of src into out. Returns BASE64_OK or the first error found, *decoded
+  is set to the number of bytes decoded before the group holding the error (all of them on
+  success) and *error_pos to the position of the offending character (len for BASE64_ERR_LENGTH)*/
+int b64decode_strict(const void *src, size_t len, unsigned char *out, size_t out_len,
+                     size_t *decoded, size_t *error_pos);
+
+/*
+ * Incremental encoding and decoding of data of any size in constant memory.
+ * Input is taken in slices of any length, partial 3 byte (or 4 character)
+ * groups are carried to the next call, and the output is collected in a
+ * caller supplied window that is handed to emit every time it is full, the
+ * last, partial window when the stream is finished. The decoder applies the
+ * rules of b64decode_strict to the stream as a whole.
+ */
+
+typedef void (*base64_window_cb)(const void *window, size_t len, void *ctx);
+
+typedef struct {
+    unsigned char carry[3];             //bytes of a group not encoded yet
+    size_t carry_len;
+    char *window;
+    size_t window_len;
+    size_t fill;                        //characters in the window
+    base64_window_cb emit;
+    void *emit_ctx;
+    uint64_t total;                     //characters produced so far
+} base64_encoder;
+
+typedef struct {
+    unsigned char carry[4];             //characters of a group not decoded yet
+    size_t carry_len;
+    unsigned char *window;
+    size_t window_len;
+    size_t fill;                        //bytes in the window
+    base64_window_cb emit;
+    void *emit_ctx;
+    uint64_t total;                     //characters consumed so far
+    int padded;                         //the padded last group was seen
+    uint64_t pad_pos;                   //stream position of its first '='
+    unsigned char pad_bytes[2];         //its bytes, held back until the stream ends there
+    size_t pad_len;
+    int pending;                        //error of that group, reported if it stays the last one
+    uint64_t pending_pos;
+    int error;                          //first error, sticky
+    uint64_t error_pos;                 //stream position of the offending character
+} base64_decoder;
+
+/*Start a stream writing into window (at least 1 byte), emit is called with ctx for every full window*/
+void base64_encoder_init(base64_encoder *enc, char *window, size_t window_len,
+                         base64_window_cb emit, void *ctx);
+
+/*Encode len bytes of src*/
+void base64_encoder_update(base64_encoder *enc, const unsigned char *src, size_t len);
+
+/*Encode and pad the carried bytes, emit what is left in the window, the encoder can then start a new stream*/
+void base64_encoder_final(base64_encoder *enc);
+
+void base64_decoder_init(base64_decoder *dec, unsigned char *window, size_t window_len,
+                         base64_window_cb emit, void *ctx);
+
+/*Decode len characters of src. Returns BASE64_OK or the first error of the stream, once an
+  error is found the rest of the stream is ignored*/
+int base64_decoder_update(base64_decoder *dec, const void *src, size_t len);
+
+/*Emit what is left in the window. Returns BASE64_OK or the first error of the stream,
+  BASE64_ERR_LENGTH if it ends inside a group*/
+int base64_decoder_final(base64_decoder *dec);
+
+/*The kernels behind base64_encode_to and b64decode_to, out is large enough for the result*/
+size_t base64_encode_scalar(const unsigned char *src, size_t len, char *out);
+size_t b64decode_scalar(const void *src, size_t len, unsigned char *out);
+#if BASE64_HAVE_SSSE3
+size_t base64_encode_ssse3(const unsigned char *src, size_t len, char *out);
+size_t b64decode_ssse3(const void *src, size_t len, unsigned char *out);
+#endif
+#if BASE64_HAVE_AVX2
+size_t base64_encode_avx2(const unsigned char *src, size_t len, char *out);
+size_t b64decode_avx2(const void *src, size_t len, unsigned char *out);
+#endif
+#if BASE64_HAVE_NEON
+size_t base64_encode_neon(const unsigned char *src, size_t len, char *out);
+size_t b64decode_neon(const void *src, size_t len, unsigned char *out);
+#endif
+
+#endif
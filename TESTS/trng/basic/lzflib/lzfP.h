@@ -165,6 +165,17 @@ typedef unsigned char u8;
 
 typedef LZF_HSLOT LZF_STATE[1 << (HLOG)];
 
+/*
+ * Generation tagged slot, a slot only counts as used when its tag equals
+ * the generation of the current call, so a whole table is invalidated by
+ * bumping the generation instead of clearing it.
+ */
+typedef struct
+{
+  unsigned int off;
+  unsigned int gen;
+} LZF_TSLOT;
+
 #if !STRICT_ALIGN
 /* for unaligned accesses we need a 16 bit datatype. */
 # if USHRT_MAX == 65535
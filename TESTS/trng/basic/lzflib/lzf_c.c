@@ -35,8 +35,10 @@
  */
 
 #include "lzfP.h"
+#include "lzf_ctx.h"
+#include "lzf_match.h"
 
-#define HSIZE (1 << (HLOG))
+#define HSIZE (1 << (hlog))
 
 /*
  * don't play with this unless you benchmark!
@@ -48,11 +50,11 @@
 # define FRST(p) (((p[0]) << 8) | p[1])
 # define NEXT(v,p) (((v) << 8) | p[2])
 # if ULTRA_FAST
-#  define IDX(h) ((( h             >> (3*8 - HLOG)) - h  ) & (HSIZE - 1))
+#  define IDX(h) ((( h             >> (3*8 - hlog)) - h  ) & (HSIZE - 1))
 # elif VERY_FAST
-#  define IDX(h) ((( h             >> (3*8 - HLOG)) - h*5) & (HSIZE - 1))
+#  define IDX(h) ((( h             >> (3*8 - hlog)) - h*5) & (HSIZE - 1))
 # else
-#  define IDX(h) ((((h ^ (h << 5)) >> (3*8 - HLOG)) - h*5) & (HSIZE - 1))
+#  define IDX(h) ((((h ^ (h << 5)) >> (3*8 - hlog)) - h*5) & (HSIZE - 1))
 # endif
 #endif
 /*
@@ -86,6 +88,12 @@
 #define expect_false(expr) expect ((expr) != 0, 0)
 #define expect_true(expr)  expect ((expr) != 0, 1)
 
+#if __GNUC__ >= 3
+# define always_inline              static inline __attribute__ ((__always_inline__))
+#else
+# define always_inline              static
+#endif
+
 /*
  * compressed format
  *
@@ -95,17 +103,39 @@
  *
  */
 
-unsigned int
-lzf_compress (const void *const in_data, unsigned int in_len,
-	      void *out_data, unsigned int out_len
-#if LZF_STATE_ARG
-              , LZF_STATE htab
-#endif
-              )
+/*
+ * hlog selects the size of htab at run time (1 << hlog slots). Only
+ * lzf_compress passes a constant (HLOG), the _hlog, _tagged and screening
+ * entry points take the caller's hlog, so for them the table mask and
+ * the hash shift are computed at run time.
+ * With tagged set htab holds LZF_TSLOT entries and only slots tagged
+ * with gen are looked at; it is a constant as well, so each entry point
+ * gets a copy of the loop without the test.
+ */
+#define HSLOT_LOAD(idx)                                                    \
+  (tagged                                                                  \
+   ? (((LZF_TSLOT *)htab)[idx].gen == gen                                  \
+      ? (const u8 *)in_data + ((LZF_TSLOT *)htab)[idx].off                 \
+      : (const u8 *)in_data)                                               \
+   : ((LZF_HSLOT *)htab)[idx] + LZF_HSLOT_BIAS)
+
+#define HSLOT_STORE(idx,p)                                                 \
+  do {                                                                     \
+    if (tagged)                                                            \
+      {                                                                    \
+        ((LZF_TSLOT *)htab)[idx].off = (unsigned int)((p) - (const u8 *)in_data); \
+        ((LZF_TSLOT *)htab)[idx].gen = gen;                                \
+      }                                                                    \
+    else                                                                   \
+      ((LZF_HSLOT *)htab)[idx] = (p) - LZF_HSLOT_BIAS;                     \
+  } while (0)
+
+always_inline unsigned int
+lzf_compress_core (const void *const in_data, unsigned int in_len,
+                   void *out_data, unsigned int out_len,
+                   void *htab, unsigned int hlog,
+                   int tagged, unsigned int gen)
 {
-#if !LZF_STATE_ARG
-  LZF_STATE htab;
-#endif
   const u8 *ip = (const u8 *)in_data;
         u8 *op = (u8 *)out_data;
   const u8 *in_end  = ip + in_len;
@@ -131,19 +161,20 @@ lzf_compress (const void *const in_data, unsigned int in_len,
     return 0;
 
 #if INIT_HTAB
-  memset (htab, 0, sizeof (htab));
+  if (!tagged)
+    memset (htab, 0, sizeof (LZF_HSLOT) << hlog);
 #endif
 
   lit = 0; op++; /* start run */
 
-  hval = FRST (ip);
+  hval = in_len > 1 ? FRST (ip) : 0; /* a single byte is only copied */
   while (ip < in_end - 2)
     {
-      LZF_HSLOT *hslot;
+      unsigned int hidx;
 
       hval = NEXT (hval, ip);
-      hslot = htab + IDX (hval);
-      ref = *hslot + LZF_HSLOT_BIAS; *hslot = ip - LZF_HSLOT_BIAS;
+      hidx = IDX (hval);
+      ref = HSLOT_LOAD (hidx); HSLOT_STORE (hidx, ip);
 
       if (1
 #if INIT_HTAB
@@ -171,37 +202,7 @@ lzf_compress (const void *const in_data, unsigned int in_len,
           op [- lit - 1] = lit - 1; /* stop run */
           op -= !lit; /* undo run if length is zero */
 
-          for (;;)
-            {
-              if (expect_true (maxlen > 16))
-                {
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-                  len++; if (ref [len] != ip [len]) break;
-                }
-
-              do
-                len++;
-              while (len < maxlen && ref[len] == ip[len]);
-
-              break;
-            }
+          len = lzf_match_len (ref, ip, maxlen);
 
           len -= 2; /* len is now #octets - 1 */
           ip++;
@@ -233,12 +234,12 @@ lzf_compress (const void *const in_data, unsigned int in_len,
           hval = FRST (ip);
 
           hval = NEXT (hval, ip);
-          htab[IDX (hval)] = ip - LZF_HSLOT_BIAS;
+          HSLOT_STORE (IDX (hval), ip);
           ip++;
 
 # if VERY_FAST && !ULTRA_FAST
           hval = NEXT (hval, ip);
-          htab[IDX (hval)] = ip - LZF_HSLOT_BIAS;
+          HSLOT_STORE (IDX (hval), ip);
           ip++;
 # endif
 #else
@@ -247,7 +248,7 @@ lzf_compress (const void *const in_data, unsigned int in_len,
           do
             {
               hval = NEXT (hval, ip);
-              htab[IDX (hval)] = ip - LZF_HSLOT_BIAS;
+              HSLOT_STORE (IDX (hval), ip);
               ip++;
             }
           while (len--);
@@ -289,3 +290,238 @@ lzf_compress (const void *const in_data, unsigned int in_len,
   return (unsigned int)((uintptr_t)op - (uintptr_t)out_data);
 }
 
+/*
+ * Screening: runs the match search of lzf_compress_core without producing
+ * output. op counts the bytes the compressor would have written, and the
+ * same end of buffer checks decide the verdict, so the result is the one
+ * lzf_compress would give for out_len. At every run boundary and match
+ * the verdict is also settled early when the rest of the input can no
+ * longer change it: stored as literals (the largest output a byte can
+ * turn into) it still fits, or coded as maximum length references (the
+ * smallest) it no longer fits.
+ */
+#define SCREEN_MIN_OUT(rem) (((rem) + MAX_REF - 1) / MAX_REF * 2)
+#define SCREEN_MAX_OUT(rem) ((rem) + ((rem) + lit) / MAX_LIT)
+
+always_inline int
+lzf_screen_core (const void *const in_data, unsigned int in_len,
+                 unsigned int out_len, lzf_screen_stats *stats,
+                 void *htab, unsigned int hlog,
+                 int tagged, unsigned int gen)
+{
+  const u8 *ip = (const u8 *)in_data;
+  const u8 *in_end = ip + in_len;
+  const u8 *ref;
+  unsigned long off;
+  unsigned long op; /* bytes the compressor would have written */
+  unsigned int hval;
+  unsigned int rem;
+  int lit;
+  int res = -1;
+
+  memset (stats, 0, sizeof (*stats));
+
+  if (!in_len || !out_len)
+    return 0;
+
+#if INIT_HTAB
+  if (!tagged)
+    memset (htab, 0, sizeof (LZF_HSLOT) << hlog);
+#endif
+
+  lit = 0; op = 1; /* start run */
+
+  hval = in_len > 1 ? FRST (ip) : 0;
+  while (ip < in_end - 2)
+    {
+      unsigned int hidx;
+
+      hval = NEXT (hval, ip);
+      hidx = IDX (hval);
+      ref = HSLOT_LOAD (hidx); HSLOT_STORE (hidx, ip);
+
+      if (1
+#if INIT_HTAB
+          && ref < ip
+#endif
+          && (off = (unsigned long)(uintptr_t)(ip - ref - 1)) < MAX_OFF
+          && ref > (u8 *)in_data
+          && ref[2] == ip[2]
+          && ref[1] == ip[1]
+          && ref[0] == ip[0]
+        )
+        {
+          unsigned int len = 2;
+          unsigned int maxlen = (unsigned int)((uintptr_t)in_end - (uintptr_t)ip) - len;
+          maxlen = maxlen > MAX_REF ? MAX_REF : maxlen;
+
+          if (expect_false (op + 3 + 1 >= out_len))
+            if (op - !lit + 3 + 1 >= out_len)
+              {
+                res = 0;
+                break;
+              }
+
+          op -= !lit;
+
+          len = lzf_match_len (ref, ip, maxlen);
+
+          stats->matches++;
+          stats->match_bytes += len;
+
+          len -= 2;
+          ip++;
+
+          op += len < 7 ? 2 : 3;
+          lit = 0; op++; /* start run */
+
+          ip += len + 1;
+
+          if (expect_false (ip >= in_end - 2))
+            break;
+
+          rem = (unsigned int)(in_end - ip);
+          if (op - 1 + SCREEN_MIN_OUT (rem) > out_len)
+            {
+              res = 0;
+              break;
+            }
+          if (op + SCREEN_MAX_OUT (rem) + 4 < out_len)
+            {
+              res = 1;
+              break;
+            }
+
+#if ULTRA_FAST || VERY_FAST
+          --ip;
+# if VERY_FAST && !ULTRA_FAST
+          --ip;
+# endif
+          hval = FRST (ip);
+
+          hval = NEXT (hval, ip);
+          HSLOT_STORE (IDX (hval), ip);
+          ip++;
+
+# if VERY_FAST && !ULTRA_FAST
+          hval = NEXT (hval, ip);
+          HSLOT_STORE (IDX (hval), ip);
+          ip++;
+# endif
+#else
+          ip -= len + 1;
+
+          do
+            {
+              hval = NEXT (hval, ip);
+              HSLOT_STORE (IDX (hval), ip);
+              ip++;
+            }
+          while (len--);
+#endif
+        }
+      else
+        {
+          if (expect_false (op >= out_len))
+            {
+              res = 0;
+              break;
+            }
+
+          lit++; op++; ip++;
+          stats->literals++;
+
+          if (expect_false (lit == MAX_LIT))
+            {
+              lit = 0; op++; /* start run */
+
+              rem = (unsigned int)(in_end - ip);
+              if (op - 1 + SCREEN_MIN_OUT (rem) > out_len)
+                {
+                  res = 0;
+                  break;
+                }
+              if (op + SCREEN_MAX_OUT (rem) + 4 < out_len)
+                {
+                  res = 1;
+                  break;
+                }
+            }
+        }
+    }
+
+  stats->scanned = (unsigned int)(ip - (const u8 *)in_data);
+
+  if (res >= 0)
+    {
+      /* settled early, bound the final size by the rest as literals */
+      rem = (unsigned int)(in_end - ip);
+      stats->projected = (unsigned int)op;
+      stats->bound = res ? (unsigned int)(op + SCREEN_MAX_OUT (rem)) : 0;
+      return res;
+    }
+
+  if (op + 3 > out_len)
+    {
+      stats->projected = (unsigned int)op;
+      return 0;
+    }
+
+  rem = (unsigned int)(in_end - ip);
+  stats->literals += rem;
+  stats->scanned = in_len;
+  lit += rem;
+  op += rem + lit / MAX_LIT; /* tail literals and their run headers */
+  lit %= MAX_LIT;
+  op -= !lit;
+
+  stats->projected = stats->bound = (unsigned int)op;
+  return 1;
+}
+
+unsigned int
+lzf_compress (const void *const in_data, unsigned int in_len,
+	      void *out_data, unsigned int out_len
+#if LZF_STATE_ARG
+              , LZF_STATE htab
+#endif
+              )
+{
+#if !LZF_STATE_ARG
+  LZF_STATE htab;
+#endif
+
+  return lzf_compress_core (in_data, in_len, out_data, out_len, htab, HLOG, 0, 0);
+}
+
+unsigned int
+lzf_compress_hlog (const void *const in_data, unsigned int in_len,
+                   void *out_data, unsigned int out_len,
+                   void *htab, unsigned int hlog)
+{
+  return lzf_compress_core (in_data, in_len, out_data, out_len, htab, hlog, 0, 0);
+}
+
+unsigned int
+lzf_compress_tagged (const void *const in_data, unsigned int in_len,
+                     void *out_data, unsigned int out_len,
+                     void *htab, unsigned int hlog, unsigned int gen)
+{
+  return lzf_compress_core (in_data, in_len, out_data, out_len, htab, hlog, 1, gen);
+}
+
+int
+lzf_screen_hlog (const void *const in_data, unsigned int in_len,
+                 unsigned int out_len, lzf_screen_stats *stats,
+                 void *htab, unsigned int hlog)
+{
+  return lzf_screen_core (in_data, in_len, out_len, stats, htab, hlog, 0, 0);
+}
+
+int
+lzf_screen_tagged (const void *const in_data, unsigned int in_len,
+                   unsigned int out_len, lzf_screen_stats *stats,
+                   void *htab, unsigned int hlog, unsigned int gen)
+{
+  return lzf_screen_core (in_data, in_len, out_len, stats, htab, hlog, 1, gen);
+}
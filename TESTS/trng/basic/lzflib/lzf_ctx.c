@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "lzfP.h"
+#include "lzf_ctx.h"
+
+size_t
+lzf_ctx_state_size (unsigned int hlog)
+{
+  if (hlog < LZF_CTX_HLOG_MIN || hlog > LZF_CTX_HLOG_MAX)
+    return 0;
+
+  return sizeof (LZF_HSLOT) << hlog;
+}
+
+size_t
+lzf_ctx_state_size_mode (unsigned int hlog, int mode)
+{
+  if (mode == LZF_CTX_TAGGED)
+    return lzf_ctx_state_size (hlog) ? sizeof (LZF_TSLOT) << hlog : 0;
+
+  if (mode != LZF_CTX_REUSE && mode != LZF_CTX_CLEAR)
+    return 0;
+
+  return lzf_ctx_state_size (hlog);
+}
+
+unsigned int
+lzf_ctx_hlog_for (unsigned int in_len, unsigned int max_hlog)
+{
+  unsigned int hlog = LZF_CTX_HLOG_MIN;
+
+  if (max_hlog > LZF_CTX_HLOG_MAX)
+    max_hlog = LZF_CTX_HLOG_MAX;
+
+  while (hlog < max_hlog && (1U << hlog) < in_len)
+    hlog++;
+
+  return hlog;
+}
+
+int
+lzf_ctx_init (lzf_ctx *ctx, unsigned int hlog, void *arena, size_t arena_len)
+{
+  return lzf_ctx_init_mode (ctx, hlog, LZF_CTX_REUSE, arena, arena_len);
+}
+
+int
+lzf_ctx_init_mode (lzf_ctx *ctx, unsigned int hlog, int mode,
+                   void *arena, size_t arena_len)
+{
+  size_t size = lzf_ctx_state_size_mode (hlog, mode);
+
+  if (!size || !arena || arena_len < size)
+    return -1;
+
+  ctx->htab = arena;
+  ctx->hlog = hlog;
+  ctx->mode = mode;
+  ctx->gen = 0;
+
+  if (mode == LZF_CTX_TAGGED)
+    memset (arena, 0, size); /* generation 0 is never used */
+
+  return 0;
+}
+
+/*
+ * Gets the table ready for the next input, returns nonzero if it is tagged.
+ */
+static int
+lzf_ctx_begin (lzf_ctx *ctx)
+{
+  if (ctx->mode == LZF_CTX_TAGGED)
+    {
+      if (!++ctx->gen)
+        {
+          memset (ctx->htab, 0, sizeof (LZF_TSLOT) << ctx->hlog);
+          ctx->gen = 1;
+        }
+
+      return 1;
+    }
+
+  if (ctx->mode == LZF_CTX_CLEAR)
+    memset (ctx->htab, 0, sizeof (LZF_HSLOT) << ctx->hlog);
+
+  return 0;
+}
+
+unsigned int
+lzf_ctx_compress (lzf_ctx *ctx,
+                  const void *const in_data, unsigned int in_len,
+                  void *out_data, unsigned int out_len)
+{
+  if (lzf_ctx_begin (ctx))
+    return lzf_compress_tagged (in_data, in_len, out_data, out_len, ctx->htab, ctx->hlog, ctx->gen);
+
+  return lzf_compress_hlog (in_data, in_len, out_data, out_len, ctx->htab, ctx->hlog);
+}
+
+int
+lzf_ctx_screen (lzf_ctx *ctx,
+                const void *const in_data, unsigned int in_len,
+                unsigned int out_len, lzf_screen_stats *stats)
+{
+  if (lzf_ctx_begin (ctx))
+    return lzf_screen_tagged (in_data, in_len, out_len, stats, ctx->htab, ctx->hlog, ctx->gen);
+
+  return lzf_screen_hlog (in_data, in_len, out_len, stats, ctx->htab, ctx->hlog);
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2018 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LZF_CTX_H
+#define LZF_CTX_H
+
+#include <stddef.h>
+
+/*
+ * Compressor context: owns the hash table lzf_compress works on (LZF_STATE
+ * in lzfP.h), sized at run time with hlog (1 << hlog slots) and placed in
+ * caller supplied memory, so the same table is reused by every call and the
+ * footprint is known up front.
+ *
+ * How slots left over from a previous call are dealt with is selected by
+ * the mode of the context:
+ *
+ * LZF_CTX_REUSE   the table is used as is, stale slots are rejected by the
+ *                 offset checks of the compressor (INIT_HTAB 0). Fastest,
+ *                 but the output depends on earlier calls.
+ * LZF_CTX_CLEAR   the table is cleared before every call (INIT_HTAB 1),
+ *                 output is repeatable, the memset dominates small inputs.
+ * LZF_CTX_TAGGED  slots carry the generation of the call that wrote them
+ *                 and every call starts a new generation, so the output is
+ *                 the same as LZF_CTX_CLEAR at O(1) cost per call. Slots
+ *                 are twice as large, the table is only cleared when the
+ *                 generation counter wraps.
+ */
+
+#define LZF_CTX_REUSE  0
+#define LZF_CTX_CLEAR  1
+#define LZF_CTX_TAGGED 2
+
+#define LZF_CTX_HLOG_MIN 6
+#define LZF_CTX_HLOG_MAX 22
+
+/*
+ * Upper bound of the table size for hlog, a slot is never larger than a
+ * pointer (two unsigned ints when tagged). Usable for static arenas:
+ *
+ *   static void *arena[1 << 8];   - or -   LZF_CTX_ARENA (arena, 8);
+ */
+#define LZF_CTX_STATE_SIZE(hlog) (sizeof (void *) << (hlog))
+#define LZF_CTX_ARENA(name, hlog) static void *name[(size_t)1 << (hlog)]
+#define LZF_CTX_TAGGED_STATE_SIZE(hlog) ((2 * sizeof (unsigned int)) << (hlog))
+#define LZF_CTX_TAGGED_ARENA(name, hlog) static unsigned int name[(size_t)2 << (hlog)]
+
+/*
+ * Output buffer size that any in_len bytes compress into, lzf expands
+ * incompressible data by one byte per 32, the rest is slack for the
+ * conservative end of buffer checks of the compressor.
+ */
+#define LZF_COMPRESS_BOUND(in_len) ((in_len) + ((in_len) >> 5) + 16)
+
+typedef struct
+{
+  void *htab;
+  unsigned int hlog;
+  int mode;
+  unsigned int gen;
+} lzf_ctx;
+
+/*
+ * Exact table size in bytes for hlog in LZF_CTX_REUSE and LZF_CTX_CLEAR
+ * modes, 0 if hlog is out of range.
+ */
+size_t
+lzf_ctx_state_size (unsigned int hlog);
+
+/*
+ * Exact table size in bytes for hlog and mode, 0 if out of range.
+ */
+size_t
+lzf_ctx_state_size_mode (unsigned int hlog, int mode);
+
+/*
+ * Smallest hlog whose table has a slot per input byte of in_len, clamped
+ * to LZF_CTX_HLOG_MIN and max_hlog.
+ */
+unsigned int
+lzf_ctx_hlog_for (unsigned int in_len, unsigned int max_hlog);
+
+/*
+ * Bind ctx to arena in LZF_CTX_REUSE mode, arena must hold at least
+ * lzf_ctx_state_size (hlog) bytes aligned for a pointer. Returns 0, or -1
+ * if hlog is out of range or the arena is too small.
+ */
+int
+lzf_ctx_init (lzf_ctx *ctx, unsigned int hlog, void *arena, size_t arena_len);
+
+/*
+ * Same as lzf_ctx_init for any mode, arena must hold at least
+ * lzf_ctx_state_size_mode (hlog, mode) bytes. A tagged table is cleared
+ * here once.
+ */
+int
+lzf_ctx_init_mode (lzf_ctx *ctx, unsigned int hlog, int mode,
+                   void *arena, size_t arena_len);
+
+/*
+ * Same as lzf_compress, using the table of ctx.
+ */
+unsigned int
+lzf_ctx_compress (lzf_ctx *ctx,
+                  const void *const in_data,  unsigned int in_len,
+                  void              *out_data, unsigned int out_len);
+
+/*
+ * Result of screening an input against an output size.
+ */
+typedef struct
+{
+  unsigned int scanned;     /* input bytes looked at before the verdict */
+  unsigned int projected;   /* output bytes lzf_compress had produced by then */
+  unsigned int bound;       /* upper bound of the compressed size, 0 if it does not fit */
+  unsigned int matches;     /* back references found */
+  unsigned int match_bytes; /* input bytes covered by them */
+  unsigned int literals;    /* input bytes left as literals */
+} lzf_screen_stats;
+
+/*
+ * Tell whether in_len bytes would compress into out_len bytes without
+ * producing the output: returns 1 if lzf_ctx_compress with out_len would
+ * succeed, 0 if it would return 0. The search stops as soon as the rest
+ * of the input can no longer change the answer, stats tells how far it
+ * got and what it found. The table of ctx is updated as by a compress.
+ */
+int
+lzf_ctx_screen (lzf_ctx *ctx,
+                const void *const in_data, unsigned int in_len,
+                unsigned int out_len, lzf_screen_stats *stats);
+
+/*
+ * lzf_compress with a table of 1 << hlog slots, used by the context.
+ */
+unsigned int
+lzf_compress_hlog (const void *const in_data,  unsigned int in_len,
+                   void              *out_data, unsigned int out_len,
+                   void *htab, unsigned int hlog);
+
+/*
+ * Same with a table of 1 << hlog LZF_TSLOT entries, only entries tagged
+ * with gen are considered valid.
+ */
+unsigned int
+lzf_compress_tagged (const void *const in_data,  unsigned int in_len,
+                     void              *out_data, unsigned int out_len,
+                     void *htab, unsigned int hlog, unsigned int gen);
+
+/*
+ * Screening with a table of 1 << hlog slots, plain or tagged.
+ */
+int
+lzf_screen_hlog (const void *const in_data, unsigned int in_len,
+                 unsigned int out_len, lzf_screen_stats *stats,
+                 void *htab, unsigned int hlog);
+
+int
+lzf_screen_tagged (const void *const in_data, unsigned int in_len,
+                   unsigned int out_len, lzf_screen_stats *stats,
+                   void *htab, unsigned int hlog, unsigned int gen);
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2000-2010 Marc Alexander Lehmann <schmorp@schmorp.de>
+ * 
+ * Redistribution and use in source and binary forms, with or without modifica-
+ * tion, are permitted provided that the following conditions are met:
+ * 
+ *   1.  Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ * 
+ *   2.  Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ * 
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MER-
+ * CHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPE-
+ * CIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTH-
+ * ERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * the GNU General Public License ("GPL") version 2 or any later version,
+ * in which case the provisions of the GPL are applicable instead of
+ * the above. If you wish to allow the use of your version of this file
+ * only under the terms of the GPL and not to allow others to use your
+ * version of this file under the BSD license, indicate your decision
+ * by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL. If you do not delete the
+ * provisions above, a recipient may use your version of this file under
+ * either the BSD or the GPL.
+ */
+
+#include "lzfP.h"
+
+#if AVOID_ERRNO
+# define SET_ERRNO(n)
+#else
+# include <errno.h>
+# define SET_ERRNO(n) errno = (n)
+#endif
+
+#if __GNUC__ >= 3
+# define expect(expr,value)         __builtin_expect ((expr),(value))
+#else
+# define expect(expr,value)         (expr)
+#endif
+
+#define expect_false(expr) expect ((expr) != 0, 0)
+#define expect_true(expr)  expect ((expr) != 0, 1)
+
+/*
+ * Literal runs and back references are copied in fixed size blocks
+ * (memcpy with a constant size becomes a few wide loads and stores)
+ * whenever the buffers have enough room left for the overshoot; bytes
+ * written past the end of the current run are overwritten by the next
+ * one. Close to the end of either buffer the exact copies are used.
+ */
+#define WIDE_LIT   16
+#define WIDE_REF   8
+
+unsigned int
+lzf_decompress (const void *const in_data,  unsigned int in_len,
+                void             *out_data, unsigned int out_len)
+{
+  u8 const *ip = (const u8 *)in_data;
+  u8       *op = (u8 *)out_data;
+  u8 const *const in_end  = ip + in_len;
+  u8       *const out_end = op + out_len;
+
+  while (ip < in_end)
+    {
+      unsigned int ctrl = *ip++;
+
+      if (ctrl < (1 << 5)) /* literal run */
+        {
+          ctrl++;
+
+          if (expect_false (op + ctrl > out_end))
+            {
+              SET_ERRNO (E2BIG);
+              return 0;
+            }
+
+#if CHECK_INPUT
+          if (expect_false (ip + ctrl > in_end))
+            {
+              SET_ERRNO (EINVAL);
+              return 0;
+            }
+#endif
+
+          if (expect_true (in_end - ip >= 2 * WIDE_LIT && out_end - op >= 2 * WIDE_LIT))
+            {
+              memcpy (op, ip, WIDE_LIT);
+              if (ctrl > WIDE_LIT)
+                memcpy (op + WIDE_LIT, ip + WIDE_LIT, WIDE_LIT);
+            }
+          else
+            memcpy (op, ip, ctrl);
+
+          op += ctrl;
+          ip += ctrl;
+        }
+      else /* back reference */
+        {
+          unsigned int len = ctrl >> 5;
+          unsigned int off;
+          u8 *ref;
+
+#if CHECK_INPUT
+          if (expect_false (ip >= in_end))
+            {
+              SET_ERRNO (EINVAL);
+              return 0;
+            }
+#endif
+          if (len == 7)
+            {
+              len += *ip++;
+#if CHECK_INPUT
+              if (expect_false (ip >= in_end))
+                {
+                  SET_ERRNO (EINVAL);
+                  return 0;
+                }
+#endif
+            }
+
+          off = ((ctrl & 0x1f) << 8) + *ip++ + 1;
+          len += 2;
+
+          if (expect_false (op + len > out_end))
+            {
+              SET_ERRNO (E2BIG);
+              return 0;
+            }
+
+          if (expect_false ((unsigned int)(op - (u8 *)out_data) < off))
+            {
+              SET_ERRNO (EINVAL);
+              return 0;
+            }
+
+          ref = op - off;
+
+          if (expect_true (off >= WIDE_REF && (unsigned int)(out_end - op) >= len + WIDE_REF))
+            {
+              /* every block only reads bytes written before it */
+              u8 *end = op + len;
+
+              do
+                {
+                  memcpy (op, ref, WIDE_REF);
+                  op += WIDE_REF;
+                  ref += WIDE_REF;
+                }
+              while (op < end);
+
+              op = end;
+            }
+          else if (off == 1)
+            {
+              memset (op, *ref, len);
+              op += len;
+            }
+          else
+            {
+              do
+                *op++ = *ref++;
+              while (--len);
+            }
+        }
+    }
+
+  return (unsigned int)(op - (u8 *)out_data);
+}
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2018 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LZF_MATCH_H
+#define LZF_MATCH_H
+
+#include <string.h>
+
+/*
+ * Match extension kernels of lzf_compress. Once the first three bytes of
+ * ref and ip are known to match, a kernel returns the match end the
+ * original byte loop of lzf_c.c would have found for maxlen:
+ *
+ *   the first k >= 3 with ref[k] != ip[k], but no more than limit, where
+ *   limit is maxlen, at least 3, and at least 19 when maxlen > 16 (the
+ *   16 way unrolled compares run past maxlen by up to two bytes, which
+ *   the caller's maxlen leaves room for).
+ *
+ * Only bytes below limit are read, so every kernel produces the same
+ * compressed stream. Most matches in random or biased data end at the
+ * first extra byte, so the wide kernels test that byte on its own first.
+ *
+ * The kernel is selected at build time, LZF_MATCH_KERNEL may be set to
+ * one of the LZF_MATCH_* values below to override the choice:
+ *
+ *   LZF_MATCH_UNROLLED  the original unrolled byte loop
+ *   LZF_MATCH_WORD      a machine word at a time, first difference found
+ *                       with count trailing (or leading) zeros
+ *   LZF_MATCH_SSE2      16 bytes at a time (x86 with SSE2)
+ *   LZF_MATCH_AVX2      32 bytes at a time (x86 with AVX2)
+ *   LZF_MATCH_NEON      16 bytes at a time (ARMv7 NEON and AArch64)
+ */
+
+#define LZF_MATCH_UNROLLED  0
+#define LZF_MATCH_WORD      1
+#define LZF_MATCH_SSE2      2
+#define LZF_MATCH_AVX2      3
+#define LZF_MATCH_NEON      4
+
+#ifndef LZF_MATCH_KERNEL
+# if defined (__AVX2__)
+#  define LZF_MATCH_KERNEL LZF_MATCH_AVX2
+# elif defined (__SSE2__) || defined (_M_X64)
+#  define LZF_MATCH_KERNEL LZF_MATCH_SSE2
+# elif defined (__ARM_NEON) || defined (__ARM_NEON__)
+#  define LZF_MATCH_KERNEL LZF_MATCH_NEON
+# elif defined (__GNUC__)
+#  define LZF_MATCH_KERNEL LZF_MATCH_WORD
+# else
+#  define LZF_MATCH_KERNEL LZF_MATCH_UNROLLED
+# endif
+#endif
+
+#if defined (__SSE2__) || defined (_M_X64)
+# include <emmintrin.h>
+# define LZF_MATCH_HAVE_SSE2 1
+#endif
+#if defined (__AVX2__)
+# include <immintrin.h>
+# define LZF_MATCH_HAVE_AVX2 1
+#endif
+#if defined (__ARM_NEON) || defined (__ARM_NEON__)
+# include <arm_neon.h>
+# define LZF_MATCH_HAVE_NEON 1
+#endif
+#if defined (__GNUC__)
+# define LZF_MATCH_HAVE_WORD 1
+#endif
+
+#define lzf_match_limit(maxlen) \
+  ((maxlen) > 16 ? ((maxlen) > 19 ? (maxlen) : 19) : ((maxlen) > 3 ? (maxlen) : 3))
+
+static inline unsigned int
+lzf_match_tail (const unsigned char *ref, const unsigned char *ip,
+                unsigned int k, unsigned int limit)
+{
+  while (k < limit && ref[k] == ip[k])
+    k++;
+
+  return k;
+}
+
+static inline unsigned int
+lzf_match_len_unrolled (const unsigned char *ref, const unsigned char *ip, unsigned int maxlen)
+{
+  unsigned int len = 2;
+
+  for (;;)
+    {
+      if (maxlen > 16)
+        {
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+          len++; if (ref [len] != ip [len]) break;
+        }
+
+      do
+        len++;
+      while (len < maxlen && ref[len] == ip[len]);
+
+      break;
+    }
+
+  return len;
+}
+
+#if LZF_MATCH_HAVE_WORD
+static inline unsigned int
+lzf_match_len_word (const unsigned char *ref, const unsigned char *ip, unsigned int maxlen)
+{
+  unsigned int limit = lzf_match_limit (maxlen);
+  unsigned int k = 4;
+
+  if (limit == 3 || ref[3] != ip[3])
+    return 3;
+
+  /* memcpy keeps the loads legal on strict alignment targets */
+  while (k + sizeof (unsigned long) <= limit)
+    {
+      unsigned long a, b, x;
+
+      memcpy (&a, ref + k, sizeof (a));
+      memcpy (&b, ip + k, sizeof (b));
+      x = a ^ b;
+
+      if (x)
+        {
+# if defined (__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+          return k + (unsigned int)__builtin_clzl (x) / 8;
+# else
+          return k + (unsigned int)__builtin_ctzl (x) / 8;
+# endif
+        }
+
+      k += sizeof (unsigned long);
+    }
+
+  return lzf_match_tail (ref, ip, k, limit);
+}
+#endif
+
+#if LZF_MATCH_HAVE_SSE2
+static inline unsigned int
+lzf_match_len_sse2 (const unsigned char *ref, const unsigned char *ip, unsigned int maxlen)
+{
+  unsigned int limit = lzf_match_limit (maxlen);
+  unsigned int k = 4;
+
+  if (limit == 3 || ref[3] != ip[3])
+    return 3;
+
+  while (k + 16 <= limit)
+    {
+      __m128i a = _mm_loadu_si128 ((const __m128i *)(ref + k));
+      __m128i b = _mm_loadu_si128 ((const __m128i *)(ip + k));
+      unsigned int ne = ~(unsigned int)_mm_movemask_epi8 (_mm_cmpeq_epi8 (a, b)) & 0xffff;
+
+      if (ne)
+        return k + (unsigned int)__builtin_ctz (ne);
+
+      k += 16;
+    }
+
+  return lzf_match_tail (ref, ip, k, limit);
+}
+#endif
+
+#if LZF_MATCH_HAVE_AVX2
+static inline unsigned int
+lzf_match_len_avx2 (const unsigned char *ref, const unsigned char *ip, unsigned int maxlen)
+{
+  unsigned int limit = lzf_match_limit (maxlen);
+  unsigned int k = 4;
+
+  if (limit == 3 || ref[3] != ip[3])
+    return 3;
+
+  while (k + 32 <= limit)
+    {
+      __m256i a = _mm256_loadu_si256 ((const __m256i *)(ref + k));
+      __m256i b = _mm256_loadu_si256 ((const __m256i *)(ip + k));
+      unsigned int ne = ~(unsigned int)_mm256_movemask_epi8 (_mm256_cmpeq_epi8 (a, b));
+
+      if (ne)
+        return k + (unsigned int)__builtin_ctz (ne);
+
+      k += 32;
+    }
+
+  /* most matches of random data end within the first 16 bytes */
+  if (k + 16 <= limit)
+    {
+      __m128i a = _mm_loadu_si128 ((const __m128i *)(ref + k));
+      __m128i b = _mm_loadu_si128 ((const __m128i *)(ip + k));
+      unsigned int ne = ~(unsigned int)_mm_movemask_epi8 (_mm_cmpeq_epi8 (a, b)) & 0xffff;
+
+      if (ne)
+        return k + (unsigned int)__builtin_ctz (ne);
+
+      k += 16;
+    }
+
+  return lzf_match_tail (ref, ip, k, limit);
+}
+#endif
+
+#if LZF_MATCH_HAVE_NEON
+static inline unsigned int
+lzf_match_len_neon (const unsigned char *ref, const unsigned char *ip, unsigned int maxlen)
+{
+  unsigned int limit = lzf_match_limit (maxlen);
+  unsigned int k = 4;
+
+  if (limit == 3 || ref[3] != ip[3])
+    return 3;
+
+  while (k + 16 <= limit)
+    {
+      uint8x16_t eq = vceqq_u8 (vld1q_u8 (ref + k), vld1q_u8 (ip + k));
+      /* narrow every byte of the compare mask to 4 bits of a 64 bit word */
+      uint64_t ne = ~vget_lane_u64 (vreinterpret_u64_u8 (vshrn_n_u16 (vreinterpretq_u16_u8 (eq), 4)), 0);
+
+      if (ne)
+        return k + (unsigned int)__builtin_ctzll (ne) / 4;
+
+      k += 16;
+    }
+
+  return lzf_match_tail (ref, ip, k, limit);
+}
+#endif
+
+#if LZF_MATCH_KERNEL == LZF_MATCH_AVX2
+# define lzf_match_len lzf_match_len_avx2
+#elif LZF_MATCH_KERNEL == LZF_MATCH_SSE2
+# define lzf_match_len lzf_match_len_sse2
+#elif LZF_MATCH_KERNEL == LZF_MATCH_NEON
+# define lzf_match_len lzf_match_len_neon
+#elif LZF_MATCH_KERNEL == LZF_MATCH_WORD
+# define lzf_match_len lzf_match_len_word
+#else
+# define lzf_match_len lzf_match_len_unrolled
+#endif
+
+#endif
@@ -0,0 +1,343 @@
+/*
+ * Copyright (c) 2018 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "lzfP.h"
+#include "lzf_ctx.h"
+#include "lzf_match.h"
+#include "lzf_stream.h"
+
+#if AVOID_ERRNO
+# define SET_ERRNO(n)
+#else
+# include <errno.h>
+# define SET_ERRNO(n) errno = (n)
+#endif
+
+#define MAX_LIT        (1 <<  5)
+#define MAX_OFF        (1 << 13)
+#define MAX_REF        ((1 << 8) + (1 << 3))
+
+/* the hash of lzf_c.c, so a stream finds the matches lzf_compress would */
+#define HSIZE (1 << (hlog))
+#define FRST(p) (((p[0]) << 8) | p[1])
+#define NEXT(v,p) (((v) << 8) | p[2])
+#if ULTRA_FAST
+# define IDX(h) ((( h             >> (3*8 - hlog)) - h  ) & (HSIZE - 1))
+#elif VERY_FAST
+# define IDX(h) ((( h             >> (3*8 - hlog)) - h*5) & (HSIZE - 1))
+#else
+# define IDX(h) ((((h ^ (h << 5)) >> (3*8 - hlog)) - h*5) & (HSIZE - 1))
+#endif
+
+/* output bytes are only stored while they fit, the size is counted on */
+#define PUT(i,v)                                                           \
+  do {                                                                     \
+    if (op_buf && (i) < out_len)                                           \
+      op_buf[i] = (u8)(v);                                                 \
+  } while (0)
+
+/* byte i of the chunk, negative i reaching back into the ring */
+#define STREAM_BYTE(i)                                                     \
+  ((i) >= 0 ? in[i] : s->ring[(unsigned int)(base + (i)) & wmask])
+
+int
+lzf_stream_init (lzf_stream *s, unsigned int hlog, unsigned int wlog,
+                 void *arena, size_t arena_len)
+{
+  if (hlog < LZF_CTX_HLOG_MIN || hlog > LZF_CTX_HLOG_MAX
+      || wlog < LZF_STREAM_WLOG_MIN || wlog > LZF_STREAM_WLOG_MAX
+      || !arena || arena_len < LZF_STREAM_STATE_SIZE (hlog, wlog))
+    return -1;
+
+  /* the table goes first, it is the part that needs the alignment */
+  s->htab = (unsigned int *)arena;
+  s->ring = (unsigned char *)arena + (sizeof (unsigned int) << hlog);
+  s->hlog = hlog;
+  s->wlog = wlog;
+  s->pos = 0;
+  memset (arena, 0, LZF_STREAM_STATE_SIZE (hlog, wlog));
+
+  return 0;
+}
+
+static void
+lzf_ring_take (unsigned char *ring, unsigned int wlog, unsigned long long pos,
+               const u8 *data, unsigned int len)
+{
+  unsigned int size = 1U << wlog;
+  unsigned int at, first;
+
+  if (len > size)
+    {
+      pos += len - size;
+      data += len - size;
+      len = size;
+    }
+
+  at = (unsigned int)pos & (size - 1);
+  first = size - at < len ? size - at : len;
+  memcpy (ring + at, data, first);
+  memcpy (ring, data + first, len - first);
+}
+
+unsigned int
+lzf_stream_compress (lzf_stream *s,
+                     const void *const in_data, unsigned int in_len,
+                     void *out_data, unsigned int out_len)
+{
+  const u8 *in = (const u8 *)in_data;
+  const u8 *ip = in;
+  const u8 *in_end = in + in_len;
+  u8 *op_buf = (u8 *)out_data;
+  unsigned int *htab = s->htab;
+  unsigned int hlog = s->hlog;
+  unsigned int wmask = (1U << s->wlog) - 1;
+  unsigned long long base = s->pos;
+  /* bytes of history a reference may reach back into */
+  unsigned int hist = base < wmask + 1 ? (unsigned int)base : wmask + 1;
+  unsigned long op;
+  unsigned int hval;
+  int lit;
+
+  if (!in_len)
+    return 0;
+
+  lit = 0; op = 1; /* start run */
+
+  hval = in_len > 1 ? FRST (ip) : 0;
+  while (in_len > 2 && ip < in_end - 2)
+    {
+      unsigned int here = (unsigned int)(ip - in);
+      unsigned int cur = (unsigned int)base + here;
+      unsigned int hidx, off;
+      long ref;
+
+      hval = NEXT (hval, ip);
+      hidx = IDX (hval);
+      off = cur - htab[hidx] - 1;
+      htab[hidx] = cur;
+      ref = (long)here - (long)off - 1;
+
+      /* the slot may be stale or from another lap of the 32 bit positions,
+         the bytes decide */
+      if (off < MAX_OFF
+          && off < here + hist
+          && STREAM_BYTE (ref) == ip[0]
+          && STREAM_BYTE (ref + 1) == ip[1]
+          && STREAM_BYTE (ref + 2) == ip[2])
+        {
+          unsigned int len;
+          unsigned int maxlen = (unsigned int)(in_end - ip) - 2;
+          maxlen = maxlen > MAX_REF ? MAX_REF : maxlen;
+
+          PUT (op - lit - 1, lit - 1); /* stop run */
+          op -= !lit; /* undo run if length is zero */
+
+          if (ref >= 0)
+            len = lzf_match_len (in + ref, ip, maxlen);
+          else
+            for (len = 3; len < maxlen && STREAM_BYTE (ref + (long)len) == ip[len]; len++)
+              ;
+
+          len -= 2; /* len is now #octets - 1 */
+
+          if (len < 7)
+            {
+              PUT (op, (off >> 8) + (len << 5)); op++;
+            }
+          else
+            {
+              PUT (op, (off >> 8) + (7 << 5)); op++;
+              PUT (op, len - 7); op++;
+            }
+
+          PUT (op, off); op++;
+
+          lit = 0; op++; /* start run */
+
+          ip += len + 2;
+
+          if (ip >= in_end - 2)
+            break;
+
+          /* as VERY_FAST in lzf_c.c, the last two positions of the match are hashed */
+          ip -= 2;
+          hval = FRST (ip);
+          hval = NEXT (hval, ip);
+          htab[IDX (hval)] = (unsigned int)base + (unsigned int)(ip - in);
+          ip++;
+          hval = NEXT (hval, ip);
+          htab[IDX (hval)] = (unsigned int)base + (unsigned int)(ip - in);
+          ip++;
+        }
+      else
+        {
+          /* one more literal byte we must copy */
+          PUT (op, *ip); op++;
+          lit++; ip++;
+
+          if (lit == MAX_LIT)
+            {
+              PUT (op - lit - 1, lit - 1); /* stop run */
+              lit = 0; op++; /* start run */
+            }
+        }
+    }
+
+  while (ip < in_end)
+    {
+      PUT (op, *ip); op++;
+      lit++; ip++;
+
+      if (lit == MAX_LIT)
+        {
+          PUT (op - lit - 1, lit - 1); /* stop run */
+          lit = 0; op++; /* start run */
+        }
+    }
+
+  PUT (op - lit - 1, lit - 1); /* end run */
+  op -= !lit; /* undo run if length is zero */
+
+  lzf_ring_take (s->ring, s->wlog, base, in, in_len);
+  s->pos = base + in_len;
+
+  return op <= out_len ? (unsigned int)op : 0;
+}
+
+int
+lzf_stream_decoder_init (lzf_stream_decoder *d, unsigned int wlog,
+                         void *arena, size_t arena_len)
+{
+  if (wlog < LZF_STREAM_WLOG_MIN || wlog > LZF_STREAM_WLOG_MAX
+      || !arena || arena_len < LZF_STREAM_DECODER_SIZE (wlog))
+    return -1;
+
+  d->ring = (unsigned char *)arena;
+  d->wlog = wlog;
+  d->pos = 0;
+
+  return 0;
+}
+
+void
+lzf_stream_decoder_take (lzf_stream_decoder *d, const void *data, unsigned int len)
+{
+  lzf_ring_take (d->ring, d->wlog, d->pos, (const u8 *)data, len);
+  d->pos += len;
+}
+
+unsigned int
+lzf_stream_decompress (lzf_stream_decoder *d,
+                       const void *const in_data, unsigned int in_len,
+                       void *out_data, unsigned int out_len)
+{
+  u8 const *ip = (const u8 *)in_data;
+  u8 *out = (u8 *)out_data;
+  u8 const *const in_end = ip + in_len;
+  unsigned int wmask = (1U << d->wlog) - 1;
+  unsigned int hist = d->pos < wmask + 1 ? (unsigned int)d->pos : wmask + 1;
+  unsigned int o = 0;
+
+  while (ip < in_end)
+    {
+      unsigned int ctrl = *ip++;
+
+      if (ctrl < (1 << 5)) /* literal run */
+        {
+          ctrl++;
+
+          if (o + ctrl > out_len)
+            {
+              SET_ERRNO (E2BIG);
+              return 0;
+            }
+
+          if ((unsigned int)(in_end - ip) < ctrl)
+            {
+              SET_ERRNO (EINVAL);
+              return 0;
+            }
+
+          memcpy (out + o, ip, ctrl);
+          o += ctrl;
+          ip += ctrl;
+        }
+      else /* back reference */
+        {
+          unsigned int len = ctrl >> 5;
+          unsigned int off;
+
+          if (ip >= in_end || (len == 7 && ip + 1 >= in_end))
+            {
+              SET_ERRNO (EINVAL);
+              return 0;
+            }
+
+          if (len == 7)
+            len += *ip++;
+
+          off = ((ctrl & 0x1f) << 8) + *ip++ + 1;
+          len += 2;
+
+          if (o + len > out_len)
+            {
+              SET_ERRNO (E2BIG);
+              return 0;
+            }
+
+          if (off > o + hist)
+            {
+              SET_ERRNO (EINVAL);
+              return 0;
+            }
+
+          if (off <= o)
+            {
+              /* within the chunk, overlapping copies repeat the pattern */
+              if (off >= len)
+                {
+                  memcpy (out + o, out + o - off, len);
+                  o += len;
+                }
+              else
+                for (; len; len--)
+                  {
+                    out[o] = out[o - off];
+                    o++;
+                  }
+            }
+          else
+            {
+              /* from the ring until the reference reaches the chunk */
+              unsigned long long from = d->pos + o - off;
+
+              for (; len && from < d->pos; len--, from++)
+                out[o++] = d->ring[(unsigned int)from & wmask];
+
+              for (; len; len--)
+                {
+                  out[o] = out[o - off];
+                  o++;
+                }
+            }
+        }
+    }
+
+  lzf_stream_decoder_take (d, out, o);
+
+  return o;
+}
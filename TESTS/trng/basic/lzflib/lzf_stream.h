@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2018 ARM Limited. All rights reserved.
+ * SPDX-License-Identifier: Apache-2.0
+ * Licensed under the Apache License, Version 2.0 (the License); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an AS IS BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LZF_STREAM_H
+#define LZF_STREAM_H
+
+#include <stddef.h>
+
+/*
+ * Streaming compressor: lzf_compress for a sequence of chunks, where
+ * every chunk is compressed against the chunks before it as well. The
+ * history of the stream, its last 1 << wlog bytes (up to the 8 KB an
+ * lzf back reference reaches), is kept in a ring, and the hash table
+ * holds stream positions, so both carry over from one call to the next
+ * and a chunk never has to be copied next to the one before it. Memory
+ * stays at the ring and the table whatever the length of the stream.
+ *
+ * The output of a chunk is lzf data whose back references may reach
+ * into earlier chunks, lzf_stream_decompress undoes it with a ring of
+ * its own. A chunk that does not fit its out_len is still taken into the
+ * history; the caller keeps it as it is and hands it to the decoder with
+ * lzf_stream_decoder_take, so both rings stay the same.
+ *
+ * The last two bytes of a chunk can't start a match (their hash needs the
+ * next chunk) and no match runs past the end of a chunk, so a stream
+ * compresses a little worse than its chunks put together in one buffer.
+ */
+
+#define LZF_STREAM_WLOG_MIN 6
+#define LZF_STREAM_WLOG_MAX 13  /* MAX_OFF of lzf_c.c */
+
+/*
+ * Arena of a compressor with a ring of 1 << wlog bytes and a table of
+ * 1 << hlog slots, and of a decoder with a ring of 1 << wlog bytes. A
+ * decoder decodes the output of compressors with rings no larger than
+ * its own. Usable for static arenas:
+ *
+ *   LZF_STREAM_ARENA (arena, 8, 7);
+ */
+#define LZF_STREAM_STATE_SIZE(hlog, wlog) (((size_t)1 << (wlog)) + (sizeof (unsigned int) << (hlog)))
+#define LZF_STREAM_ARENA(name, hlog, wlog) \
+  static unsigned int name[LZF_STREAM_STATE_SIZE (hlog, wlog) / sizeof (unsigned int)]
+#define LZF_STREAM_DECODER_SIZE(wlog) ((size_t)1 << (wlog))
+
+typedef struct
+{
+  unsigned char *ring;          /* the last bytes of the stream, by position */
+  unsigned int *htab;           /* low 32 bits of the stream position of every slot */
+  unsigned int hlog;
+  unsigned int wlog;
+  unsigned long long pos;       /* bytes taken so far */
+} lzf_stream;
+
+typedef struct
+{
+  unsigned char *ring;
+  unsigned int wlog;
+  unsigned long long pos;       /* bytes delivered so far */
+} lzf_stream_decoder;
+
+/*
+ * Start a stream in arena, which holds LZF_STREAM_STATE_SIZE (hlog, wlog)
+ * bytes aligned for an unsigned int. hlog is limited as by lzf_ctx.
+ * Returns 0, or -1 if hlog or wlog is out of range or the arena is too
+ * small.
+ */
+int
+lzf_stream_init (lzf_stream *s, unsigned int hlog, unsigned int wlog,
+                 void *arena, size_t arena_len);
+
+/*
+ * Compress the next chunk of the stream into out_data. Returns the size of
+ * the output, or 0 if it is larger than out_len (the chunk looks random),
+ * the chunk joins the history either way. With out_data NULL nothing is
+ * written and only the size is worked out, the screening of a stream.
+ */
+unsigned int
+lzf_stream_compress (lzf_stream *s,
+                     const void *const in_data, unsigned int in_len,
+                     void *out_data, unsigned int out_len);
+
+/*
+ * Start a decoder in arena, LZF_STREAM_DECODER_SIZE (wlog) bytes.
+ * Returns 0, or -1 if wlog is out of range or the arena is too small.
+ */
+int
+lzf_stream_decoder_init (lzf_stream_decoder *d, unsigned int wlog,
+                         void *arena, size_t arena_len);
+
+/*
+ * Decompress the output of a chunk, as lzf_decompress does, with back
+ * references into the chunks before it. Returns the size of the chunk,
+ * which joins the history, or 0 with errno set to E2BIG or EINVAL.
+ */
+unsigned int
+lzf_stream_decompress (lzf_stream_decoder *d,
+                       const void *const in_data, unsigned int in_len,
+                       void *out_data, unsigned int out_len);
+
+/*
+ * Take a chunk that was kept uncompressed into the history.
+ */
+void
+lzf_stream_decoder_take (lzf_stream_decoder *d, const void *data, unsigned int len);
+
+#endif
@@ -40,15 +40,22 @@
 #include "utest/utest.h"
 #include "hal/trng_api.h"
 #include "base64b.h"
+#include "trng_core.h"
+#include "trng_nist.h"
+#include "trng_health.h"
+#include "trng_pool.h"
+#include "trng_async.h"
+#include "trng_drbg.h"
+#include "trng_fingerprint.h"
+#include "trng_snapshot.h"
+#include "trng_link.h"
+#include "trng_trace.h"
+#include "hal/us_ticker_api.h"
+#include "rtos.h"
 #include <stdio.h>
 
 #include "nvstore.h"
 
-/*Include LZF Compressor librart */
-extern "C" {
-#include "lzf.h"
-}
-
 #define MSG_VALUE_DUMMY                 "0"
 #define MSG_VALUE_LEN                   128
 #define MSG_KEY_LEN                     32
@@ -59,86 +66,380 @@ extern "C" {
 #define MSG_TRNG_READY                  "ready"
 #define MSG_TRNG_FINISH                 "finish"
 #define MSG_TRNG_BUFFER                 "buffer"
+#define MSG_TRNG_RESEND                 "resend"
+#define MSG_TRNG_TRACE                  "trace"
 
 #define MSG_TRNG_TEST_STEP1             "check_step1"
 #define MSG_TRNG_TEST_STEP2             "check_step2"
 #define MSG_TRNG_TEST_SUITE_ENDED       "Test_suite_ended"
 
+#define MSG_LINK_START                  "link_start"
+#define MSG_LINK_FRAME                  "link_frame"
+#define MSG_LINK_SYNC                   "link_sync"
+#define MSG_LINK_ACK                    "link_ack"
+#define MSG_LINK_END                    "link_end"
+#define MSG_LINK_DONE                   "link_done"
+
 #define NVKEY                           1                           //NVstore key for storing and loading data
+#define FINGERPRINT_NVKEY               2                           //NVstore key of the fingerprint index of previous boots
+#define FINGERPRINT_BOOTS               1                           //look every boot up in the fingerprints of the previous ones
+#define SNAPSHOT_FIRST_NVKEY            3                           //first NVstore key of the ring of boot records
+#define SNAPSHOT_SLOTS                  8                           //boot records kept, one NVstore key each
+#define SNAPSHOT_RECORD                 192                         //largest boot record, header included
+
+#define TRANSFER_RETRIES                3                           //times a corrupted step 1 buffer is requested again from the host
+
+#define LZF_HLOG                        8                           //log2 of lzf hash table slots, enough for BUFFER_LEN * 2 input
+#define LZF_STREAM_WLOG                 7                           //log2 of the lzf stream history, holds the step 1 buffer
+
+#ifdef MBED_CONF_APP_TRNG_NIST_BYTES
+#define NIST_BYTES                      MBED_CONF_APP_TRNG_NIST_BYTES   //trng output run through the SP 800-22 battery
+#else
+#define NIST_BYTES                      (8 * 1024)
+#endif
+#define NIST_PATTERN_BITS               8                           //m of the serial test, approximate entropy uses m - 1
+#define NIST_DFT_BITS                   256                         //DFT block size
+#define NIST_REJECT                     0.0001                      //p-value failing the battery, 1 in 100 random tests is below 0.01
+
+#define HEALTH_ENTROPY                  4                           //min-entropy per byte claimed for the health test cutoffs
+#define HEALTH_ALPHA_LOG2               30                          //false positive rate of the health tests, 2^-30 per sample
+
+#define POOL_LOG2                       11                          //log2 of the entropy pool ring
+#define POOL_BATCH                      256                         //bytes per refill of the pool
+#define POOL_READ                       16                          //bytes per read from the pool
+#define POOL_ROUNDS                     64                          //buffers of BUFFER_LEN * 2 assembled from pool reads
+
+#define ASYNC_READ                      16                          //bytes per asynchronous request
+#define ASYNC_STAGE                     256                         //bytes the requests of a drain are read in at a time
+#define ASYNC_ROUNDS                    64                          //buffers of BUFFER_LEN * 2 assembled from requests
+#define ASYNC_REQUESTS                  (BUFFER_LEN * 2 / ASYNC_READ)
+
+#ifdef MBED_CONF_APP_TRNG_DRBG_BYTES
+#define DRBG_BYTES                      MBED_CONF_APP_TRNG_DRBG_BYTES   //output of each DRBG screened and run through SP 800-22
+#else
+#define DRBG_BYTES                      (8 * 1024)
+#endif
+#define DRBG_RESEED_INTERVAL            16                          //generate requests between reseeds, low so the test sees some
+
+#ifdef MBED_CONF_APP_TRNG_LINK_BYTES
+#define LINK_BYTES                      MBED_CONF_APP_TRNG_LINK_BYTES   //trng output exported through the framed transport
+#else
+#define LINK_BYTES                      (8 * 1024)
+#endif
+#define LINK_FRAME                      1024                        //payload bytes per frame
+#define LINK_WINDOW                     4                           //frames sent before an ACK is asked for
+
+#ifdef MBED_CONF_PLATFORM_STDIO_BAUD_RATE
+#define STDIO_BAUD                      MBED_CONF_PLATFORM_STDIO_BAUD_RATE
+#else
+#define STDIO_BAUD                      9600
+#endif
+/*Characters of the export on the line: base64 frames and the KV framing around them*/
+#define LINK_WIRE_CHARS                 (LINK_BYTES / LINK_FRAME * ((TRNG_LINK_HEADER + LINK_FRAME + 2) / 3 * 4 + 32))
+/*100 s of the two steps and the reset between them, 60 s of the NIST, pool, async and DRBG
+  cases at their default sizes and the export at 10 bits a character, twice over for resends*/
+#define TEST_TIMEOUT                    (100 + 60 + 2 * LINK_WIRE_CHARS * 10 / STDIO_BAUD)
 
 using namespace utest::v1;
 
+/*LZF hash table, allocated once instead of on the stack of every step*/
+LZF_CTX_ARENA(lzf_arena, LZF_HLOG);
+
+/*Hash table and history of the stream step 2 screens the two buffers in*/
+LZF_STREAM_ARENA(lzf_stream_arena, LZF_HLOG, LZF_STREAM_WLOG);
+
+/*Pattern counters and DFT block of the statistical tests*/
+TRNG_NIST_ARENA(nist_arena, NIST_PATTERN_BITS, NIST_DFT_BITS);
+
+/*Fingerprint index image, loaded from and stored to NVStore on every boot*/
+TRNG_FINGERPRINT_ARENA(fingerprint_arena, 12);
+
+/*Work buffer of the boot records*/
+static uint8_t snapshot_work[TRNG_SNAPSHOT_WORK_SIZE(SNAPSHOT_RECORD)];
+
+/*Frames of the transport window, and a frame encoded for a greentea message*/
+static uint8_t link_frames[TRNG_LINK_TX_SIZE(LINK_WINDOW, LINK_FRAME)];
+static char link_msg[(TRNG_LINK_HEADER + LINK_FRAME + 2) / 3 * 4 + 1];
+
+/*Ring of the entropy pool*/
+static uint8_t pool_ring[1 << POOL_LOG2];
+static volatile bool pool_stop = false;
+
+/*Stage and requests of the asynchronous front end, a buffer of requests is read while the other
+  is screened*/
+static uint8_t async_stage[ASYNC_STAGE];
+static trng_async_request async_requests[2][ASYNC_REQUESTS];
+static volatile uint32_t async_completed = 0;
+static volatile bool async_stop = false;
+static Semaphore async_sem(0);          //released by the callback of every completed request
+
+#if NVSTORE_ENABLED && FINGERPRINT_BOOTS
+/*Step 2 only compares with the boot before the reset, a source that comes back to a seed every
+  few boots is found by looking the output up in the fingerprints of the previous boots*/
+static uint32_t fingerprint_boot(const uint8_t *buffer, size_t len)
+{
+    NVStore &nvstore = NVStore::get_instance();
+    trng_fingerprint_config cfg;
+    trng_fingerprint fp;
+    uint16_t actual = 0;
+    size_t first_match = 0;
+
+    trng_fingerprint_config_default(&cfg);
+    size_t image_len = trng_fingerprint_size(&cfg);
+    TEST_ASSERT_TRUE_MESSAGE(image_len != 0 && image_len <= sizeof(fingerprint_arena), "fingerprint index does not fit!");
+
+    /*Without a stored index the arena stays zeroed and trng_fingerprint_open formats it*/
+    memset(fingerprint_arena, 0, sizeof(fingerprint_arena));
+    TRNG_TRACE_BEGIN(get_start);
+    int result = nvstore.get(FINGERPRINT_NVKEY, (uint16_t)image_len, fingerprint_arena, actual);
+    TRNG_TRACE_END(TRNG_TRACE_NVSTORE, get_start, actual);
+    TEST_ASSERT_TRUE_MESSAGE(result == NVSTORE_SUCCESS || result == NVSTORE_NOT_FOUND, "nvstore get error!");
+    TEST_ASSERT_NOT_EQUAL_MESSAGE(-1, trng_fingerprint_open(&fp, &cfg, fingerprint_arena, sizeof(fingerprint_arena)),
+                                  "trng_fingerprint_open error!");
+
+    uint32_t matches = trng_fingerprint_check(&fp, buffer, len, &first_match);
+    printf("trng buffer looked up in the fingerprints of %u previous boots: %u windows seen\n",
+           (unsigned int)(fp.header->boots[0] + fp.header->boots[1]), (unsigned int)matches);
+
+    trng_fingerprint_add(&fp, buffer, len);
+    TRNG_TRACE_BEGIN(set_start);
+    result = nvstore.set(FINGERPRINT_NVKEY, (uint16_t)image_len, fingerprint_arena);
+    TRNG_TRACE_END(TRNG_TRACE_NVSTORE, set_start, image_len);
+    TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
+    return matches;
+}
+#endif
+
+#if NVSTORE_ENABLED
+static int snapshot_get(void *ctx, uint16_t key, uint16_t buf_size, void *buf, uint16_t *actual)
+{
+    TRNG_TRACE_BEGIN(start);
+    int result = NVStore::get_instance().get(key, buf_size, buf, *actual);
+    TRNG_TRACE_END(TRNG_TRACE_NVSTORE, start, *actual);
+    return result;
+}
+
+static int snapshot_set(void *ctx, uint16_t key, uint16_t size, const void *buf)
+{
+    TRNG_TRACE_BEGIN(start);
+    int result = NVStore::get_instance().set(key, size, buf);
+    TRNG_TRACE_END(TRNG_TRACE_NVSTORE, start, size);
+    return result;
+}
+
+static int print_record(const trng_snapshot_record *record, void *ctx)
+{
+    printf("boot %u: %.*s\n", (unsigned int)record->seq, (int)record->meta_len, (const char *)record->meta);
+    return 0;
+}
+
+static void open_history(trng_snapshot *snap)
+{
+    trng_snapshot_config cfg;
+
+    cfg.first_key = SNAPSHOT_FIRST_NVKEY;
+    cfg.slots = SNAPSHOT_SLOTS;
+    cfg.max_record = SNAPSHOT_RECORD;
+    cfg.store.get = snapshot_get;
+    cfg.store.set = snapshot_set;
+    cfg.store.ctx = NULL;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_snapshot_open(snap, &cfg, snapshot_work, sizeof(snapshot_work)),
+                                  "trng_snapshot_open error!");
+}
+
+/*Append the buffer of this boot and what the test found about it to the history kept in
+  NVStore, one key written per boot, and print the history*/
+static void record_boot(const uint8_t *buffer, size_t len, const char *meta, lzf_ctx *lzf)
+{
+    trng_snapshot snap;
+
+    open_history(&snap);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_snapshot_append(&snap, buffer, (uint16_t)len, (const uint8_t *)meta,
+                                                          (uint16_t)strlen(meta), lzf), "trng_snapshot_append error!");
+    uint32_t records = trng_snapshot_read(&snap, print_record, NULL);
+    printf("%u boot records, %u damaged\n", (unsigned int)records, (unsigned int)snap.damaged);
+}
+
+#if FINGERPRINT_BOOTS
+typedef struct {
+    const uint8_t *buffer;
+    size_t len;
+    size_t window;
+    uint32_t repeats;                   //records sharing a window with buffer
+} repeat_search;
+
+static int find_repeat(const trng_snapshot_record *record, void *ctx)
+{
+    repeat_search *search = (repeat_search *)ctx;
+    for (size_t i = 0; i + search->window <= search->len; i++)
+    {
+        for (size_t j = 0; j + search->window <= record->sample_len; j++)
+        {
+            if (memcmp(search->buffer + i, record->sample + j, search->window) == 0)
+            {
+                printf("boot %u holds the trng buffer window at %u\n", (unsigned int)record->seq, (unsigned int)i);
+                search->repeats++;
+                return 0;
+            }
+        }
+    }
+    return 0;
+}
+
+/*The fingerprint index has false positives and remembers more boots than the history keeps,
+  a window it reports seen is only a repeat when a boot record holds it too. Call before the
+  buffer of this boot is recorded*/
+static uint32_t confirm_repeat(const uint8_t *buffer, size_t len)
+{
+    trng_fingerprint_config cfg;
+    trng_snapshot snap;
+    repeat_search search;
+
+    trng_fingerprint_config_default(&cfg);
+    search.buffer = buffer;
+    search.len = len;
+    search.window = cfg.window;
+    search.repeats = 0;
+    open_history(&snap);
+    trng_snapshot_read(&snap, find_repeat, &search);
+    return search.repeats;
+}
+#endif
+#endif
+
+#if TRNG_TRACE
+static uint32_t trace_now(void)
+{
+    return us_ticker_read();
+}
+
+/*Send the counters of every site to the host, a base64 encoded record each*/
+static void trace_dump(void)
+{
+    trng_trace trace;
+    uint8_t record[TRNG_TRACE_RECORD];
+    char str[MSG_VALUE_LEN + 1];
+
+    trng_trace_snapshot(&trace);
+    for (unsigned int site = 0; site < TRNG_TRACE_SITES; site++)
+    {
+        size_t len = trng_trace_pack(&trace, site, record, sizeof(record));
+        size_t str_len = base64_encode_to(record, len, str, MSG_VALUE_LEN);
+        if (str_len != 0)
+        {
+            str[str_len] = 0;
+            greentea_send_kv(MSG_TRNG_TRACE, (const char *)str);
+        }
+    }
+}
+#endif
+
 static void compress_and_compare(char *key, char *value)
 {
     trng_t trng_obj;
-    uint8_t out_comp_buf[BUFFER_LEN] = {0}, buffer[BUFFER_LEN] = {0}, input_buf[BUFFER_LEN * 2] = {0};
-    size_t input_buf_len = 0, temp_size = 0, trng_len = BUFFER_LEN;
-    uint8_t *temp_in_buf = NULL;
+    uint8_t buffer[BUFFER_LEN] = {0};
     int trng_res = 0;
     unsigned int comp_res = 0;
-    unsigned char htab[32][32] = {0};
+    uint32_t seen = 0;
+    uint32_t repeats = 0;
+    lzf_ctx lzf;
+    lzf_stream stream;
     NVStore &nvstore = NVStore::get_instance();
 
     /*Output compressed data size is smaller in COMPRESS_TEST_PERCENTAGE from input data*/
-    unsigned int out_comp_buf_len = (unsigned int)((BUFFER_LEN *COMPRESS_TEST_PERCENTAGE) / 100);
+    unsigned int out_comp_buf_len = trng_core_threshold(BUFFER_LEN, COMPRESS_TEST_PERCENTAGE);
 
     /*At the begining of step 2 load trng buffer from step 1*/
     if (strcmp(key, MSG_TRNG_TEST_STEP2) == 0)
     {
 #if NVSTORE_ENABLED
         uint16_t actual = 0;
+        TRNG_TRACE_BEGIN(get_start);
         int result = nvstore.get(NVKEY, sizeof(buffer), buffer, actual);
+        TRNG_TRACE_END(TRNG_TRACE_NVSTORE, get_start, actual);
         TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
 #else
-        /*Using base64 to decode data sent from host*/
-        string str(b64decode((const void *)value, MSG_VALUE_LEN));
-        memcpy(buffer, str.c_str(), BUFFER_LEN);
+        /*Using base64 to decode data sent from host, a corrupted transfer is requested again*/
+        size_t decoded = 0, error_pos = 0;
+        TRNG_TRACE_BEGIN(decode_start);
+        int b64_res = b64decode_strict(value, strlen(value), buffer, sizeof(buffer), &decoded, &error_pos);
+        TRNG_TRACE_END(TRNG_TRACE_BASE64, decode_start, decoded);
+        for (int retry = 0; (b64_res != BASE64_OK || decoded != BUFFER_LEN) && retry < TRANSFER_RETRIES; retry++)
+        {
+            printf("trng buffer transfer corrupted (error %d at %u), requesting it again\n", b64_res, (unsigned int)error_pos);
+            greentea_send_kv(MSG_TRNG_RESEND, (int)error_pos);
+            memset(key, 0, MSG_KEY_LEN + 1);
+            memset(value, 0, MSG_VALUE_LEN + 1);
+            greentea_parse_kv(key, value, MSG_KEY_LEN, MSG_VALUE_LEN);
+            TEST_ASSERT_EQUAL_STRING_MESSAGE(MSG_TRNG_TEST_STEP2, key, "unexpected key while resending trng buffer!");
+            TRNG_TRACE_BEGIN(retry_start);
+            b64_res = b64decode_strict(value, strlen(value), buffer, sizeof(buffer), &decoded, &error_pos);
+            TRNG_TRACE_END(TRNG_TRACE_BASE64, retry_start, decoded);
+        }
+        TEST_ASSERT_EQUAL_INT_MESSAGE(BASE64_OK, b64_res, "b64decode_strict error!");
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(BUFFER_LEN, decoded, "trng buffer has the wrong length!");
 #endif
-        memcpy(input_buf, buffer, BUFFER_LEN);
+
+        /*The step 1 buffer becomes the history the new buffer is screened against. Nothing is
+          written with out_data NULL, and no output fits in out_len 0, so priming returns 0*/
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, lzf_stream_init(&stream, LZF_HLOG, LZF_STREAM_WLOG, lzf_stream_arena,
+                                                         sizeof(lzf_stream_arena)), "lzf_stream_init error!");
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, lzf_stream_compress(&stream, buffer, BUFFER_LEN, NULL, 0),
+                                       "lzf_stream_compress priming error!");
     }
 
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, lzf_ctx_init(&lzf, LZF_HLOG, lzf_arena, sizeof(lzf_arena)), "lzf_ctx_init error!");
+
     trng_init(&trng_obj);
     memset(buffer, 0, BUFFER_LEN);
-    temp_in_buf = buffer;
 
     /*Fill buffer with trng values*/
-    while (true)
-    {
-        trng_res = trng_get_bytes(&trng_obj, temp_in_buf, trng_len, &input_buf_len);
-        TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_res, "trng_get_bytes error!");
-        temp_size += input_buf_len;
-        temp_in_buf += input_buf_len;
-        trng_len -= input_buf_len;
-        if (temp_size == BUFFER_LEN)
-        {
-            break;
-        }
-    }
+    trng_res = trng_core_fill(&trng_obj, buffer, BUFFER_LEN);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_res, "trng_get_bytes error!");
 
     trng_free(&trng_obj);
 
-    /*comp_res equals to 0 means that the compress function wasn't able to fit the compressed buffer
-     into out_comp_buf (which is threshold % of buffer), this means that the trng data is random*/
+#if NVSTORE_ENABLED && FINGERPRINT_BOOTS
+    seen = fingerprint_boot(buffer, sizeof(buffer));
+    repeats = seen != 0 ? confirm_repeat(buffer, sizeof(buffer)) : 0;
+#endif
+
+    /*comp_res equals to 0 means that the compressed buffer would not fit into out_comp_buf_len bytes
+     (which is threshold % of buffer), this means that the trng data is random. Only the verdict is
+     needed, so the data is screened and the search stops as soon as it is known*/
     if (strcmp(key, MSG_TRNG_TEST_STEP1) == 0)
     {
-        comp_res = lzf_compress((const void *)buffer, 
-                                (unsigned int)sizeof(buffer), 
-                                (void *)out_comp_buf, 
-                                out_comp_buf_len, 
-                                (unsigned char **)htab);
+        comp_res = trng_core_screen(buffer, 
+                                    (unsigned int)sizeof(buffer), 
+                                    out_comp_buf_len, 
+                                    &lzf, 
+                                    NULL);
     }
     else if (strcmp(key, MSG_TRNG_TEST_STEP2) == 0)
     {
-        memcpy(input_buf + BUFFER_LEN, buffer, BUFFER_LEN);
-        comp_res = lzf_compress((const void *)input_buf, 
-                                (unsigned int)sizeof(input_buf), 
-                                (void *)out_comp_buf, 
-                                out_comp_buf_len, 
-                                (unsigned char **)htab);
+        /*Back references may reach into the step 1 buffer, so a repeat of it compresses*/
+        TRNG_TRACE_BEGIN(lzf_start);
+        comp_res = lzf_stream_compress(&stream, 
+                                       buffer, 
+                                       (unsigned int)sizeof(buffer), 
+                                       NULL, 
+                                       out_comp_buf_len);
+        TRNG_TRACE_END(TRNG_TRACE_LZF, lzf_start, sizeof(buffer));
     }
 
-    temp_in_buf = NULL;
+#if NVSTORE_ENABLED
+    char meta[SNAPSHOT_RECORD - TRNG_SNAPSHOT_HEADER - BUFFER_LEN];
+    snprintf(meta, sizeof(meta), "%s, screened to %u of %u bytes, %u windows seen in previous boots",
+             key, comp_res, out_comp_buf_len, (unsigned int)seen);
+    record_boot(buffer, sizeof(buffer), meta, &lzf);
+#endif
 
+    if (seen != 0 && repeats == 0)
+    {
+        printf("warning: %u windows seen by the fingerprint index are in none of the boot records, "
+               "a false positive or a boot older than the history\n", (unsigned int)seen);
+    }
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, repeats, "trng buffer repeats the output of a previous boot!");
     TEST_ASSERT_EQUAL_UINT_MESSAGE(0, comp_res, "compression of trng buffer was successful - trng buffer is not random!");
     printf("compression of trng buffer was not successful - trng buffer is indeed random!\n");
 
@@ -146,12 +447,22 @@ static void compress_and_compare(char *key, char *value)
     if (strcmp(key, MSG_TRNG_TEST_STEP1) == 0)
     {
 #if NVSTORE_ENABLED
+        TRNG_TRACE_BEGIN(set_start);
         int result = nvstore.set(NVKEY, sizeof(buffer), buffer);
+        TRNG_TRACE_END(TRNG_TRACE_NVSTORE, set_start, sizeof(buffer));
         TEST_ASSERT_EQUAL(NVSTORE_SUCCESS, result);
 #else
         /*Using base64 to encode data sending from host*/
-        string str(base64_encode((const unsigned char *)buffer, sizeof(buffer)));
-        greentea_send_kv(MSG_TRNG_BUFFER, (const char *)str.c_str());
+        char str[MSG_VALUE_LEN + 1] = {0};
+        TRNG_TRACE_BEGIN(encode_start);
+        size_t str_len = base64_encode_to((const unsigned char *)buffer, sizeof(buffer), str, MSG_VALUE_LEN);
+        TRNG_TRACE_END(TRNG_TRACE_BASE64, encode_start, sizeof(buffer));
+        TEST_ASSERT_NOT_EQUAL_MESSAGE(0, str_len, "base64_encode_to error!");
+        greentea_send_kv(MSG_TRNG_BUFFER, (const char *)str);
+#endif
+#if TRNG_TRACE
+        /*The counters of step 1 do not survive the reset*/
+        trace_dump();
 #endif
         system_reset();
         TEST_ASSERT_MESSAGE(false, "system_reset() did not reset the device as expected.");
@@ -186,6 +497,348 @@ void trng_test()
     }
 }
 
+/*Battery sized to nist_arena*/
+static void nist_start(trng_nist *nist)
+{
+    trng_nist_config cfg;
+    cfg.block_frequency_bits = 128;
+    cfg.longest_run_bits = 128;
+    cfg.serial_m = NIST_PATTERN_BITS;
+    cfg.apen_m = NIST_PATTERN_BITS - 1;
+    cfg.dft_block_bits = NIST_DFT_BITS;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_nist_init(nist, &cfg, nist_arena, sizeof(nist_arena)), "trng_nist_init error!");
+}
+
+/*Run NIST_BYTES of trng output through the SP 800-22 tests in small chunks, catching bias
+  and correlations that leave the data incompressible, and through the health tests*/
+void trng_nist_test()
+{
+    trng_health health;
+    trng_health_config health_cfg;
+    uint8_t chunk[BUFFER_LEN * 4] = {0};
+    trng_nist nist;
+    trng_nist_result res;
+
+    nist_start(&nist);
+
+    /*Output goes through the SP 800-90B health tests as well, start up tests included*/
+    trng_health_config_default(&health_cfg, HEALTH_ENTROPY, HEALTH_ALPHA_LOG2);
+    int health_res = trng_health_init(&health, &health_cfg);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, health_res, "trng failed the start up health tests!");
+    for (unsigned int done = 0; done < NIST_BYTES; done += sizeof(chunk))
+    {
+        int trng_res = trng_health_fill(&health, chunk, sizeof(chunk));
+        TEST_ASSERT_NOT_EQUAL_MESSAGE(TRNG_HEALTH_FAILED, trng_res, "trng failed the health tests!");
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_res, "trng_get_bytes error!");
+        trng_nist_update(&nist, chunk, sizeof(chunk));
+    }
+    printf("health: longest run %lu (cutoff %lu), highest count %lu of %lu (cutoff %lu)\n",
+           (unsigned long)health.counters.longest_run, (unsigned long)health_cfg.rct_cutoff,
+           (unsigned long)health.counters.highest_count, (unsigned long)health_cfg.apt_window,
+           (unsigned long)health_cfg.apt_cutoff);
+    trng_health_free(&health);
+
+    trng_nist_final(&nist, &res);
+    for (unsigned int i = 0; i < TRNG_NIST_TESTS; i++)
+    {
+        /*p-values in millionths, float printf may not be available*/
+        printf("%s: p = %ld/1000000\n", trng_nist_test_name(i), (long)(res.p[i] * 1e6));
+    }
+
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, trng_nist_failures(&res, NIST_REJECT), "trng buffer failed the SP 800-22 tests - trng buffer is not random!");
+}
+
+static uint64_t pool_now_ns(void)
+{
+    return (uint64_t)us_ticker_read() * 1000;
+}
+
+/*Body of the refilling thread, waits a tick whenever the ring has no room for a batch*/
+static void pool_refill_loop(trng_pool *pool)
+{
+    while (!pool_stop)
+    {
+        if (trng_pool_refill(pool) <= 0)
+        {
+            Thread::wait(1);
+        }
+    }
+}
+
+/*Serve POOL_ROUNDS buffers in POOL_READ byte reads from the entropy pool, refilled by a thread
+  of its own, and check that the pooled output is as incompressible as trng_get_bytes output*/
+void trng_pool_test()
+{
+    trng_t trng_obj;
+    trng_pool pool;
+    trng_pool_config cfg;
+    trng_pool_stats stats;
+    uint8_t buffer[BUFFER_LEN * 2] = {0};
+    lzf_ctx lzf;
+
+    trng_init(&trng_obj);
+    cfg.capacity = sizeof(pool_ring);
+    cfg.batch = POOL_BATCH;
+    cfg.trng = &trng_obj;
+    cfg.health = NULL;
+    cfg.now_ns = pool_now_ns;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_pool_init(&pool, &cfg, pool_ring), "trng_pool_init error!");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, lzf_ctx_init(&lzf, LZF_HLOG, lzf_arena, sizeof(lzf_arena)), "lzf_ctx_init error!");
+
+    pool_stop = false;
+    Thread refill_thread(osPriorityBelowNormal, 1024);
+    refill_thread.start(callback(pool_refill_loop, &pool));
+
+    unsigned int out_comp_buf_len = trng_core_threshold(sizeof(buffer), COMPRESS_TEST_PERCENTAGE);
+    for (unsigned int round = 0; round < POOL_ROUNDS; round++)
+    {
+        for (size_t pos = 0; pos < sizeof(buffer);)
+        {
+            size_t len = sizeof(buffer) - pos < POOL_READ ? sizeof(buffer) - pos : POOL_READ;
+            size_t got = trng_pool_read(&pool, buffer + pos, len);
+            pos += got;
+            if (got < len)
+            {
+                /*The refill thread runs below this one, yielding would never let it in*/
+                Thread::wait(1);
+            }
+        }
+        unsigned int comp_res = trng_core_screen(buffer, (unsigned int)sizeof(buffer), out_comp_buf_len, &lzf, NULL);
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, comp_res, "compression of pooled trng buffer was successful - trng buffer is not random!");
+    }
+
+    pool_stop = true;
+    refill_thread.join();
+    trng_free(&trng_obj);
+
+    trng_pool_get_stats(&pool, &stats);
+    printf("pool: %lu reads, %lu hits, %lu refills (%lu errors), refill %lu us on average, %lu us at most\n",
+           stats.reads, stats.hits, (unsigned long)stats.refills, (unsigned long)stats.refill_errors,
+           (unsigned long)(stats.refills ? stats.refill_ns / stats.refills / 1000 : 0),
+           (unsigned long)(stats.refill_max_ns / 1000));
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, stats.refill_errors, "trng_get_bytes error while refilling the pool!");
+}
+
+/*Body of the draining thread, waits a tick whenever no request is queued*/
+static void async_drain_loop(trng_async *async)
+{
+    while (!async_stop)
+    {
+        if (trng_async_drain(async) == 0)
+        {
+            Thread::wait(1);
+        }
+    }
+}
+
+static void async_count(trng_async_request *req, void *ctx)
+{
+    (void)req;
+    (void)ctx;
+    async_completed = async_completed + 1;
+    async_sem.release();
+}
+
+static void async_submit_buffer(trng_async *async, trng_async_request *req, uint8_t *buffer)
+{
+    for (unsigned int r = 0; r < ASYNC_REQUESTS; r++)
+    {
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_async_submit(async, &req[r], buffer + r * ASYNC_READ, ASYNC_READ, async_count, NULL),
+                                      "trng_async_submit error!");
+    }
+}
+
+/*Assemble ASYNC_ROUNDS buffers from ASYNC_READ byte asynchronous requests, drained by a thread of
+  its own in batches of ASYNC_STAGE bytes, and screen every buffer while the next one is read*/
+void trng_async_test()
+{
+    trng_t trng_obj;
+    trng_async async;
+    trng_async_config cfg;
+    trng_async_stats stats;
+    static uint8_t buffers[2][BUFFER_LEN * 2];
+    lzf_ctx lzf;
+
+    trng_init(&trng_obj);
+    cfg.trng = &trng_obj;
+    cfg.health = NULL;
+    cfg.stage = async_stage;
+    cfg.stage_len = sizeof(async_stage);
+    cfg.wake = NULL;
+    cfg.wake_ctx = NULL;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_async_init(&async, &cfg), "trng_async_init error!");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, lzf_ctx_init(&lzf, LZF_HLOG, lzf_arena, sizeof(lzf_arena)), "lzf_ctx_init error!");
+
+    async_stop = false;
+    async_completed = 0;
+    Thread drain_thread(osPriorityNormal, 1024);
+    drain_thread.start(callback(async_drain_loop, &async));
+
+    unsigned int out_comp_buf_len = trng_core_threshold(sizeof(buffers[0]), COMPRESS_TEST_PERCENTAGE);
+    async_submit_buffer(&async, async_requests[0], buffers[0]);
+    for (unsigned int round = 0; round < ASYNC_ROUNDS; round++)
+    {
+        trng_async_request *req = async_requests[round % 2];
+        for (unsigned int r = 0; r < ASYNC_REQUESTS; r++)
+        {
+            /*Requests complete in order of submission, a callback per request. The request is
+              marked done right after its callback, on the drain thread, which runs at this
+              priority so the yield hands over to it*/
+            async_sem.wait();
+            while (!trng_async_done(&req[r]))
+            {
+                Thread::yield();
+            }
+            TEST_ASSERT_EQUAL_INT_MESSAGE(0, req[r].status, "trng_get_bytes error while draining the requests!");
+        }
+        if (round + 1 < ASYNC_ROUNDS)
+        {
+            async_submit_buffer(&async, async_requests[(round + 1) % 2], buffers[(round + 1) % 2]);
+        }
+        unsigned int comp_res = trng_core_screen(buffers[round % 2], (unsigned int)sizeof(buffers[0]), out_comp_buf_len, &lzf, NULL);
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, comp_res, "compression of asynchronous trng buffer was successful - trng buffer is not random!");
+    }
+
+    async_stop = true;
+    drain_thread.join();
+    trng_free(&trng_obj);
+
+    trng_async_get_stats(&async, &stats);
+    printf("async: %lu requests in %lu drains (%lu at most), %lu reads, %lu errors\n",
+           (unsigned long)stats.requests, (unsigned long)stats.drains, (unsigned long)stats.max_batch,
+           (unsigned long)stats.reads, (unsigned long)stats.errors);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(ASYNC_ROUNDS * ASYNC_REQUESTS, async_completed, "callbacks missing for completed requests!");
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, stats.errors, "trng_get_bytes error while draining the requests!");
+}
+
+/*Regression gate of the DRBGs: DRBG_BYTES of CTR_DRBG and of HMAC_DRBG output, seeded through the
+  health tests, must be as incompressible as trng output and pass the SP 800-22 tests*/
+void trng_drbg_test()
+{
+    static trng_drbg drbg;
+    trng_health health;
+    trng_health_config health_cfg;
+    trng_drbg_config cfg;
+    trng_nist nist;
+    trng_nist_result res;
+    uint8_t chunk[BUFFER_LEN * 4] = {0};
+    lzf_ctx lzf;
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, lzf_ctx_init(&lzf, LZF_HLOG, lzf_arena, sizeof(lzf_arena)), "lzf_ctx_init error!");
+    unsigned int out_comp_buf_len = trng_core_threshold(sizeof(chunk), COMPRESS_TEST_PERCENTAGE);
+
+    trng_health_config_default(&health_cfg, HEALTH_ENTROPY, HEALTH_ALPHA_LOG2);
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_health_init(&health, &health_cfg), "trng failed the start up health tests!");
+
+    for (int mechanism = TRNG_DRBG_CTR; mechanism <= TRNG_DRBG_HMAC; mechanism++)
+    {
+        trng_drbg_config_default(&cfg, mechanism, trng_drbg_entropy_health, &health);
+        cfg.entropy_per_byte = HEALTH_ENTROPY;
+        cfg.reseed_interval = DRBG_RESEED_INTERVAL;
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_drbg_init(&drbg, &cfg, NULL, 0), "trng_drbg_init error!");
+
+        nist_start(&nist);
+        for (unsigned int done = 0; done < DRBG_BYTES; done += sizeof(chunk))
+        {
+            TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_drbg_generate(&drbg, chunk, sizeof(chunk), NULL, 0), "trng_drbg_generate error!");
+            unsigned int comp_res = trng_core_screen(chunk, (unsigned int)sizeof(chunk), out_comp_buf_len, &lzf, NULL);
+            TEST_ASSERT_EQUAL_UINT_MESSAGE(0, comp_res, "compression of drbg buffer was successful - drbg output is not random!");
+            trng_nist_update(&nist, chunk, sizeof(chunk));
+        }
+        printf("%s: %lu reseeds\n", mechanism == TRNG_DRBG_CTR ? "CTR_DRBG" : "HMAC_DRBG", (unsigned long)drbg.reseeds);
+        trng_drbg_free(&drbg);
+
+        trng_nist_final(&nist, &res);
+        TEST_ASSERT_EQUAL_UINT_MESSAGE(0, trng_nist_failures(&res, NIST_REJECT), "drbg output failed the SP 800-22 tests!");
+    }
+    trng_health_free(&health);
+}
+
+/*Frames go to the host base64 encoded, one greentea message each*/
+static int link_send(void *ctx, const uint8_t *frame, size_t len)
+{
+    size_t str_len = base64_encode_to(frame, len, link_msg, sizeof(link_msg) - 1);
+    if (str_len == 0)
+    {
+        return -1;
+    }
+    link_msg[str_len] = 0;
+    greentea_send_kv(MSG_LINK_FRAME, link_msg);
+    return 0;
+}
+
+/*Ask the host for its ACK, the frames it did not take are sent again*/
+static void link_sync(trng_link_tx *tx, char *key, char *value)
+{
+    uint8_t ack[TRNG_LINK_HEADER];
+    size_t decoded = 0, error_pos = 0;
+
+    greentea_send_kv(MSG_LINK_SYNC, MSG_VALUE_DUMMY);
+    memset(key, 0, MSG_KEY_LEN + 1);
+    memset(value, 0, MSG_VALUE_LEN + 1);
+    greentea_parse_kv(key, value, MSG_KEY_LEN, MSG_VALUE_LEN);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(MSG_LINK_ACK, key, "unexpected key while waiting for a link ack!");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(BASE64_OK, b64decode_strict(value, strlen(value), ack, sizeof(ack), &decoded, &error_pos),
+                                  "b64decode_strict error!");
+    TEST_ASSERT_TRUE_MESSAGE(trng_link_tx_ack(tx, ack, decoded) >= 0, "trng_link_tx_ack error!");
+}
+
+/*Export trng output to the host in frames of LINK_FRAME bytes, LINK_WINDOW frames per ACK, and
+  compare the length and CRC-32 the host received with the ones sent*/
+void trng_link_test()
+{
+    static char key[MSG_KEY_LEN + 1] = { };
+    static char value[MSG_VALUE_LEN + 1] = { };
+    trng_t trng_obj;
+    trng_link_tx tx;
+    trng_link_tx_config cfg;
+    uint8_t chunk[256];
+    uint32_t crc = 0;
+
+    cfg.frame_len = LINK_FRAME;
+    cfg.window = LINK_WINDOW;
+    cfg.send = link_send;
+    cfg.ctx = NULL;
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_link_tx_init(&tx, &cfg, link_frames, sizeof(link_frames)), "trng_link_tx_init error!");
+
+    greentea_send_kv(MSG_LINK_START, LINK_BYTES);
+    trng_init(&trng_obj);
+    for (size_t sent = 0; sent < LINK_BYTES; sent += sizeof(chunk))
+    {
+        TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_core_fill(&trng_obj, chunk, sizeof(chunk)), "trng_get_bytes error!");
+        crc = trng_core_crc32(crc, chunk, sizeof(chunk));
+        for (size_t pos = 0; pos < sizeof(chunk);)
+        {
+            int taken = trng_link_tx_write(&tx, chunk + pos, sizeof(chunk) - pos);
+            TEST_ASSERT_TRUE_MESSAGE(taken >= 0, "trng_link_tx_write error!");
+            pos += (size_t)taken;
+            while (trng_link_tx_window_full(&tx))
+            {
+                link_sync(&tx, key, value);
+            }
+        }
+    }
+    trng_free(&trng_obj);
+
+    TEST_ASSERT_EQUAL_INT_MESSAGE(0, trng_link_tx_flush(&tx), "trng_link_tx_flush error!");
+    while (trng_link_tx_in_flight(&tx) != 0)
+    {
+        link_sync(&tx, key, value);
+    }
+
+    unsigned long host_bytes = 0, host_crc = 0;
+    greentea_send_kv(MSG_LINK_END, MSG_VALUE_DUMMY);
+    memset(key, 0, MSG_KEY_LEN + 1);
+    memset(value, 0, MSG_VALUE_LEN + 1);
+    greentea_parse_kv(key, value, MSG_KEY_LEN, MSG_VALUE_LEN);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE(MSG_LINK_DONE, key, "unexpected key while waiting for the link to end!");
+    TEST_ASSERT_EQUAL_INT_MESSAGE(2, sscanf(value, "%lu %lx", &host_bytes, &host_crc), "bad link summary!");
+    printf("link: %u frames (%u resent), %u acks\n", (unsigned int)tx.stats.frames, (unsigned int)tx.stats.resent,
+           (unsigned int)tx.stats.acks);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(LINK_BYTES, host_bytes, "host received a different amount of trng output!");
+    TEST_ASSERT_EQUAL_HEX32_MESSAGE(crc, (uint32_t)host_crc, "host received different trng output!");
+}
+
 utest::v1::status_t greentea_failure_handler(const Case *const source, const failure_t reason) {
     greentea_case_failure_abort_handler(source, reason);
     return STATUS_CONTINUE;
@@ -193,11 +846,19 @@ utest::v1::status_t greentea_failure_handler(const Case *const source, const fai
 
 Case cases[] = {
     Case("TRNG: trng_test", trng_test, greentea_failure_handler),
+    Case("TRNG: trng_nist_test", trng_nist_test, greentea_failure_handler),
+    Case("TRNG: trng_pool_test", trng_pool_test, greentea_failure_handler),
+    Case("TRNG: trng_async_test", trng_async_test, greentea_failure_handler),
+    Case("TRNG: trng_drbg_test", trng_drbg_test, greentea_failure_handler),
+    Case("TRNG: trng_link_test", trng_link_test, greentea_failure_handler),
 };
 
 utest::v1::status_t greentea_test_setup(const size_t number_of_cases)
 {
-    GREENTEA_SETUP(100, "trng_reset");
+    GREENTEA_SETUP(TEST_TIMEOUT, "trng_reset");
+#if TRNG_TRACE
+    trng_trace_clock(trace_now, 1000000);
+#endif
     return greentea_test_setup_handler(number_of_cases);
 }
 
@@ -206,6 +867,9 @@ Specification specification(greentea_test_setup, cases, greentea_test_teardown_h
 int main()
 {
     bool ret = !Harness::run(specification);
+#if TRNG_TRACE
+    trace_dump();
+#endif
     greentea_send_kv(MSG_TRNG_TEST_SUITE_ENDED, MSG_VALUE_DUMMY);
 
     return ret;
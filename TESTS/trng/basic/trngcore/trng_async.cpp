@@ -0,0 +1,202 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_async.h"
+#include "trng_trace.h"
+#include "trng_atomic.h"
+
+#include <string.h>
+
+int trng_async_init(trng_async *a, const trng_async_config *cfg)
+{
+    if ((cfg->trng == NULL && cfg->health == NULL) || (cfg->stage != NULL && cfg->stage_len == 0))
+    {
+        return TRNG_ASYNC_ERR_CONFIG;
+    }
+
+    memset(a, 0, sizeof(*a));
+    a->cfg = *cfg;
+    return 0;
+}
+
+int trng_async_submit(trng_async *a, trng_async_request *req, uint8_t *buf, size_t len,
+                      trng_async_done_fn done, void *ctx)
+{
+    if (LOAD_ACQUIRE(&req->state) == TRNG_ASYNC_PENDING)
+    {
+        return TRNG_ASYNC_ERR_PENDING;
+    }
+
+    req->buf = buf;
+    req->len = len;
+    req->done = done;
+    req->ctx = ctx;
+    req->status = 0;
+    STORE_RELAXED(&req->state, (uint32_t)TRNG_ASYNC_PENDING);
+
+    /*The release publishes the request to the drain that takes the list*/
+    trng_async_request *head = LOAD_RELAXED(&a->queue);
+    do
+    {
+        req->next = head;
+    } while (!CAS_RELEASE(&a->queue, &head, req));
+
+    if (head == NULL && a->cfg.wake != NULL)
+    {
+        a->cfg.wake(a->cfg.wake_ctx);
+    }
+    return 0;
+}
+
+/*Read len bytes into buf, as trng_core_fill does*/
+static int read_source(trng_async *a, uint8_t *buf, size_t len)
+{
+    while (len > 0)
+    {
+        size_t got = 0;
+        int res;
+        if (a->cfg.health != NULL)
+        {
+            res = trng_health_get_bytes(a->cfg.health, buf, len, &got);
+        }
+        else
+        {
+            TRNG_TRACE_BEGIN(start);
+            res = trng_get_bytes(a->cfg.trng, buf, len, &got);
+            TRNG_TRACE_END(TRNG_TRACE_GET_BYTES, start, res == 0 ? got : 0);
+        }
+        a->stats.reads++;
+        if (res != 0)
+        {
+            return res;
+        }
+        buf += got;
+        len -= got;
+    }
+    return 0;
+}
+
+/*Run the callback of req and mark it done, unless the callback submitted it again*/
+static void complete(trng_async *a, trng_async_request *req, int status)
+{
+    a->stats.requests++;
+    a->stats.bytes += status == 0 ? req->len : 0;
+    a->stats.errors += status != 0;
+    req->status = status;
+    if (req->done == NULL)
+    {
+        STORE_RELEASE(&req->state, (uint32_t)TRNG_ASYNC_DONE);
+        return;
+    }
+
+    uint32_t state = TRNG_ASYNC_CALLBACK;
+    STORE_RELAXED(&req->state, state);
+    req->done(req, req->ctx);
+    CAS_RELEASE(&req->state, &state, (uint32_t)TRNG_ASYNC_DONE);
+}
+
+int trng_async_drain(trng_async *a)
+{
+    trng_async_request *list = EXCHANGE_ACQUIRE(&a->queue, (trng_async_request *)NULL);
+    trng_async_request *req = NULL, *next;
+    uint32_t count = 0;
+
+    /*The list is newest first*/
+    for (; list != NULL; list = next, count++)
+    {
+        next = list->next;
+        list->next = req;
+        req = list;
+    }
+    if (count == 0)
+    {
+        return 0;
+    }
+    a->stats.drains++;
+    a->stats.max_batch = count > a->stats.max_batch ? count : a->stats.max_batch;
+
+    if (a->cfg.stage == NULL)
+    {
+        for (; req != NULL; req = next)
+        {
+            next = req->next;
+            complete(a, req, read_source(a, req->buf, req->len));
+        }
+        return (int)count;
+    }
+
+    /*Up to a stage of the requests at a time in one read, pos bytes of req are there already*/
+    size_t pos = 0;
+    while (req != NULL)
+    {
+        if (pos == req->len)
+        {
+            next = req->next;
+            complete(a, req, 0);
+            req = next;
+            pos = 0;
+            continue;
+        }
+
+        size_t want = 0, skip = pos;
+        for (trng_async_request *r = req; r != NULL && want < a->cfg.stage_len; r = r->next, skip = 0)
+        {
+            want += r->len - skip;
+        }
+        want = want < a->cfg.stage_len ? want : a->cfg.stage_len;
+
+        int res = read_source(a, a->cfg.stage, want);
+        if (res != 0)
+        {
+            next = req->next;
+            complete(a, req, res);
+            req = next;
+            pos = 0;
+            continue;
+        }
+
+        for (size_t used = 0; used < want;)
+        {
+            size_t n = req->len - pos < want - used ? req->len - pos : want - used;
+            memcpy(req->buf + pos, a->cfg.stage + used, n);
+            pos += n;
+            used += n;
+            if (pos == req->len)
+            {
+                next = req->next;
+                complete(a, req, 0);
+                req = next;
+                pos = 0;
+            }
+        }
+    }
+    return (int)count;
+}
+
+int trng_async_done(const trng_async_request *req)
+{
+    return LOAD_ACQUIRE(&req->state) == TRNG_ASYNC_DONE;
+}
+
+int trng_async_pending(const trng_async *a)
+{
+    return LOAD_RELAXED(&a->queue) != NULL;
+}
+
+void trng_async_get_stats(const trng_async *a, trng_async_stats *stats)
+{
+    *stats = a->stats;
+}
@@ -0,0 +1,116 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Asynchronous front end of hal/trng_api.h: a thread that needs trng output
+* submits a request for len bytes into a buffer of its own and goes on with
+* other work, e.g. screening the previous chunk, while a draining thread
+* reads the trng. The draining thread takes every request queued at once
+* and reads them in one pass. With a stage buffer the bytes of all of them
+* are asked of trng_get_bytes together, so many small requests cost a few
+* driver calls, and are copied out in order of submission.
+*
+* Completion is signalled twice: the callback of the request runs on the
+* draining thread, then the request is marked done (seen with
+* trng_async_done) and its buffer is the caller's again. The callback may
+* post to an event queue, release a semaphore or submit the request again,
+* which leaves it queued instead of done. Submitting is lock free for any
+* number of threads: requests are pushed on a list with a compare and swap,
+* the draining thread takes the whole list with one exchange. The module makes no threads and never
+* blocks, the wake callback tells the draining thread there is work.
+* Atomics are those of trng_atomic.h, critical sections on mbed targets.
+*/
+
+#ifndef TRNG_ASYNC_H
+#define TRNG_ASYNC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hal/trng_api.h"
+#include "trng_health.h"
+
+#define TRNG_ASYNC_IDLE             0           //request states
+#define TRNG_ASYNC_PENDING          1
+#define TRNG_ASYNC_DONE             2
+#define TRNG_ASYNC_CALLBACK         3           //its callback is running
+
+#define TRNG_ASYNC_ERR_CONFIG       -1          //no source, or a stage of 0 bytes
+#define TRNG_ASYNC_ERR_PENDING      -2          //the request is still queued or being read
+
+struct trng_async_request;
+
+/*Called on the draining thread once the bytes of req are there, before it is marked done*/
+typedef void (*trng_async_done_fn)(struct trng_async_request *req, void *ctx);
+
+typedef struct trng_async_request {
+    uint8_t *buf;
+    size_t len;
+    trng_async_done_fn done;            //may be NULL
+    void *ctx;
+    int status;                         //0, or the error of the read that failed it, once done
+    uint32_t state;                     //TRNG_ASYNC_IDLE (zeroed) before the first submit
+    struct trng_async_request *next;    //queue link
+} trng_async_request;
+
+typedef struct {
+    trng_t *trng;                       //source, used by the draining thread only
+    trng_health *health;                //read through its health tests instead of trng (may be NULL)
+    uint8_t *stage;                     //batch buffer the requests of a drain are read into (may be NULL)
+    size_t stage_len;
+    void (*wake)(void *ctx);            //called by a submit finding the queue empty (may be NULL)
+    void *wake_ctx;
+} trng_async_config;
+
+typedef struct {
+    uint64_t drains;                    //drains that found requests
+    uint64_t requests;                  //requests completed
+    uint64_t bytes;
+    uint64_t reads;                     //trng_get_bytes calls
+    uint64_t errors;                    //requests completed with an error
+    uint32_t max_batch;                 //most requests taken by one drain
+} trng_async_stats;
+
+typedef struct {
+    trng_async_config cfg;
+    trng_async_request *queue;          //submitted requests, newest first
+    trng_async_stats stats;             //written by the draining thread
+} trng_async;
+
+/*Set up a over the source of cfg. Returns 0, or TRNG_ASYNC_ERR_CONFIG if there is neither trng
+  nor health or the stage has no room*/
+int trng_async_init(trng_async *a, const trng_async_config *cfg);
+
+/*Queue req for len bytes into buf, done(req, ctx) is called once they are there. Returns 0, or
+  TRNG_ASYNC_ERR_PENDING if req is queued already. buf and req belong to a until req is done,
+  they may be submitted again from the callback*/
+int trng_async_submit(trng_async *a, trng_async_request *req, uint8_t *buf, size_t len,
+                      trng_async_done_fn done, void *ctx);
+
+/*Draining thread: read every request queued, completing them in order of submission. A failed
+  read fails the first request it was for, the next one gets a read of its own. Returns the
+  number of requests completed, 0 if the queue was empty*/
+int trng_async_drain(trng_async *a);
+
+/*1 once req is done, its buffer and status are valid then*/
+int trng_async_done(const trng_async_request *req);
+
+/*1 if requests are queued for the next drain*/
+int trng_async_pending(const trng_async *a);
+
+/*Counters, consistent while no drain runs*/
+void trng_async_get_stats(const trng_async *a, trng_async_stats *stats);
+
+#endif
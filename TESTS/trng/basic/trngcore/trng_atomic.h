@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Atomic operations of the lock free parts of trngcore. The host build uses
+* the GCC builtins with the memory orders named. The mbed build can't:
+* ARMv6-M (Cortex-M0/M0+) has no exclusive access instructions, so GCC_ARM
+* turns the builtins into libatomic calls that mbed does not ship, and
+* ARMCC5 and IAR have no __atomic builtins at all. There every operation
+* runs in a critical section of mbed_critical.h instead, as the
+* core_util_atomic_* functions do on ARMv6-M, which builds on every target
+* and toolchain and orders memory on the single core of the target. It
+* works for 64 bit counters and pointers too, and masks interrupts for a
+* few instructions per operation.
+*
+* CAS macros update *p to v if it holds *e and return true, otherwise load
+* *p into *e and return false; they never fail spuriously.
+*/
+
+#ifndef TRNG_ATOMIC_H
+#define TRNG_ATOMIC_H
+
+#if defined(__MBED__)
+#define TRNG_ATOMIC_CRITICAL        1           //operations in critical sections
+#else
+#define TRNG_ATOMIC_CRITICAL        0           //GCC builtins
+#endif
+
+#if TRNG_ATOMIC_CRITICAL
+#include "platform/mbed_critical.h"
+
+template <typename T>
+inline T trng_atomic_load(const volatile T *p)
+{
+    core_util_critical_section_enter();
+    T v = *p;
+    core_util_critical_section_exit();
+    return v;
+}
+
+template <typename T, typename V>
+inline void trng_atomic_store(volatile T *p, V v)
+{
+    core_util_critical_section_enter();
+    *p = (T)v;
+    core_util_critical_section_exit();
+}
+
+/*Returns the value before the add*/
+template <typename T, typename V>
+inline T trng_atomic_add(volatile T *p, V v)
+{
+    core_util_critical_section_enter();
+    T old = *p;
+    *p = (T)(old + v);
+    core_util_critical_section_exit();
+    return old;
+}
+
+template <typename T, typename V>
+inline bool trng_atomic_cas(volatile T *p, T *e, V v)
+{
+    core_util_critical_section_enter();
+    T cur = *p;
+    bool swapped = cur == *e;
+    if (swapped)
+    {
+        *p = (T)v;
+    }
+    core_util_critical_section_exit();
+    *e = cur;
+    return swapped;
+}
+
+/*Returns the value before the exchange*/
+template <typename T, typename V>
+inline T trng_atomic_exchange(volatile T *p, V v)
+{
+    core_util_critical_section_enter();
+    T old = *p;
+    *p = (T)v;
+    core_util_critical_section_exit();
+    return old;
+}
+
+/*Entering and leaving a critical section is a compiler barrier, all a single core needs*/
+inline void trng_atomic_fence(void)
+{
+    core_util_critical_section_enter();
+    core_util_critical_section_exit();
+}
+
+#define LOAD_ACQUIRE(p)             trng_atomic_load(p)
+#define LOAD_RELAXED(p)             trng_atomic_load(p)
+#define STORE_RELEASE(p, v)         trng_atomic_store(p, v)
+#define STORE_RELAXED(p, v)         trng_atomic_store(p, v)
+#define ADD_RELAXED(p, v)           trng_atomic_add(p, v)
+#define EXCHANGE_ACQUIRE(p, v)      trng_atomic_exchange(p, v)
+#define CAS_ACQ_REL(p, e, v)        trng_atomic_cas(p, e, v)
+#define CAS_RELEASE(p, e, v)        trng_atomic_cas(p, e, v)
+#define CAS_RELAXED(p, e, v)        trng_atomic_cas(p, e, v)
+#define FENCE_ACQUIRE()             trng_atomic_fence()
+#define FENCE_RELEASE()             trng_atomic_fence()
+#else
+#define LOAD_ACQUIRE(p)             __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define LOAD_RELAXED(p)             __atomic_load_n(p, __ATOMIC_RELAXED)
+#define STORE_RELEASE(p, v)         __atomic_store_n(p, v, __ATOMIC_RELEASE)
+#define STORE_RELAXED(p, v)         __atomic_store_n(p, v, __ATOMIC_RELAXED)
+#define ADD_RELAXED(p, v)           __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+#define EXCHANGE_ACQUIRE(p, v)      __atomic_exchange_n(p, v, __ATOMIC_ACQUIRE)
+#define CAS_ACQ_REL(p, e, v)        __atomic_compare_exchange_n(p, e, v, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)
+#define CAS_RELEASE(p, e, v)        __atomic_compare_exchange_n(p, e, v, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)
+#define CAS_RELAXED(p, e, v)        __atomic_compare_exchange_n(p, e, v, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#define FENCE_ACQUIRE()             __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define FENCE_RELEASE()             __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+#endif
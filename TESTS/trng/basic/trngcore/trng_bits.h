@@ -0,0 +1,95 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Bit counting of trngcore. GCC_ARM and the host compilers have builtins
+* for it, ARMCC5 and IAR have not, so those get plain C versions: a
+* parallel bit count and a binary search for the highest set bit. Count
+* leading and trailing zeros are undefined for 0, as the builtins are.
+*/
+
+#ifndef TRNG_BITS_H
+#define TRNG_BITS_H
+
+#include <stdint.h>
+
+#if defined(__GNUC__)
+inline unsigned int trng_popcount32(uint32_t v)
+{
+    return (unsigned int)__builtin_popcount(v);
+}
+
+inline unsigned int trng_popcount64(uint64_t v)
+{
+    return (unsigned int)__builtin_popcountll(v);
+}
+
+inline unsigned int trng_clz32(uint32_t v)
+{
+    return (unsigned int)__builtin_clz(v);
+}
+
+inline unsigned int trng_ctz32(uint32_t v)
+{
+    return (unsigned int)__builtin_ctz(v);
+}
+
+inline unsigned int trng_clz64(uint64_t v)
+{
+    return (unsigned int)__builtin_clzll(v);
+}
+#else
+inline unsigned int trng_popcount32(uint32_t v)
+{
+    v = v - ((v >> 1) & 0x55555555U);
+    v = (v & 0x33333333U) + ((v >> 2) & 0x33333333U);
+    v = (v + (v >> 4)) & 0x0f0f0f0fU;
+    return (unsigned int)((v * 0x01010101U) >> 24);
+}
+
+inline unsigned int trng_popcount64(uint64_t v)
+{
+    return trng_popcount32((uint32_t)v) + trng_popcount32((uint32_t)(v >> 32));
+}
+
+inline unsigned int trng_clz32(uint32_t v)
+{
+    unsigned int n = 0;
+    for (unsigned int s = 16; s != 0; s >>= 1)
+    {
+        if ((v >> (32 - s)) == 0)
+        {
+            n += s;
+            v <<= s;
+        }
+    }
+    return n;
+}
+
+/*The bits below the lowest set one*/
+inline unsigned int trng_ctz32(uint32_t v)
+{
+    return trng_popcount32((v & (0U - v)) - 1);
+}
+
+inline unsigned int trng_clz64(uint64_t v)
+{
+    uint32_t hi = (uint32_t)(v >> 32);
+    return hi != 0 ? trng_clz32(hi) : 32 + trng_clz32((uint32_t)v);
+}
+#endif
+
+#endif
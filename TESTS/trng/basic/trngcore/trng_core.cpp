@@ -0,0 +1,108 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_core.h"
+#include "trng_trace.h"
+#include <string.h>
+
+extern "C" {
+#include "lzf.h"
+}
+
+int trng_core_fill(trng_t *obj, uint8_t *buf, size_t len)
+{
+    size_t output_len = 0;
+    int trng_res = 0;
+    unsigned int reads = 0;
+    TRNG_TRACE_BEGIN(fill_start);
+
+    /*trng_get_bytes may return less than requested, keep asking for the rest*/
+    while (len > 0)
+    {
+        TRNG_TRACE_BEGIN(read_start);
+        trng_res = trng_get_bytes(obj, buf, len, &output_len);
+        TRNG_TRACE_END(TRNG_TRACE_GET_BYTES, read_start, output_len);
+        reads++;
+        if (trng_res != 0)
+        {
+            return trng_res;
+        }
+        buf += output_len;
+        len -= output_len;
+    }
+
+    TRNG_TRACE_END(TRNG_TRACE_FILL, fill_start, reads);
+    return 0;
+}
+
+unsigned int trng_core_threshold(unsigned int len, unsigned int percentage)
+{
+    return (unsigned int)((len * percentage) / 100);
+}
+
+unsigned int trng_core_compress(const uint8_t *in, unsigned int in_len,
+                                uint8_t *out, unsigned int out_len,
+                                lzf_ctx *ctx)
+{
+    TRNG_TRACE_BEGIN(start);
+    unsigned int res = lzf_ctx_compress(ctx, (const void *)in, in_len, (void *)out, out_len);
+    TRNG_TRACE_END(TRNG_TRACE_LZF, start, in_len);
+    return res;
+}
+
+unsigned int trng_core_screen(const uint8_t *in, unsigned int in_len,
+                              unsigned int out_len, lzf_ctx *ctx,
+                              lzf_screen_stats *stats)
+{
+    lzf_screen_stats local;
+    if (stats == NULL)
+    {
+        stats = &local;
+    }
+    TRNG_TRACE_BEGIN(start);
+    unsigned int res = lzf_ctx_screen(ctx, (const void *)in, in_len, out_len, stats) ? stats->bound : 0;
+    TRNG_TRACE_END(TRNG_TRACE_LZF, start, in_len);
+    return res;
+}
+
+int trng_core_verify(const uint8_t *comp, unsigned int comp_len,
+                     const uint8_t *orig, unsigned int orig_len,
+                     uint8_t *scratch)
+{
+    unsigned int len = lzf_decompress((const void *)comp, comp_len, (void *)scratch, orig_len);
+    if (len != orig_len)
+    {
+        return -1;
+    }
+    return memcmp(scratch, orig, orig_len) == 0 ? 0 : -1;
+}
+
+uint32_t trng_core_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    /*Half a byte at a time, 64 bytes of table*/
+    static const uint32_t table[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac, 0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c, 0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+    };
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 15];
+        crc = (crc >> 4) ^ table[crc & 15];
+    }
+    return ~crc;
+}
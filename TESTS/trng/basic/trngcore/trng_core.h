@@ -0,0 +1,65 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Core of the trng test, kept free of greentea/unity so the same code can be
+* built on the device and on a host against a trng_api stand-in.
+*/
+
+#ifndef TRNG_CORE_H
+#define TRNG_CORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hal/trng_api.h"
+
+extern "C" {
+#include "lzf_ctx.h"
+#include "lzf_stream.h"
+}
+
+/*Fill buf with len bytes of trng output, calling trng_get_bytes until the buffer is full.
+  Returns 0 on success or the first non zero value returned by trng_get_bytes*/
+int trng_core_fill(trng_t *obj, uint8_t *buf, size_t len);
+
+/*Size of the compression output buffer that holds percentage % of len bytes*/
+unsigned int trng_core_threshold(unsigned int len, unsigned int percentage);
+
+/*Compress in_len bytes into at most out_len bytes of out using the hash table of ctx,
+  returns the compressed size or 0 if the data could not be compressed into out_len bytes
+  (i.e. the data looks random)*/
+unsigned int trng_core_compress(const uint8_t *in, unsigned int in_len,
+                                uint8_t *out, unsigned int out_len,
+                                lzf_ctx *ctx);
+
+/*Tell whether in_len bytes would compress into out_len bytes as trng_core_compress does, without
+  producing the output and stopping as soon as the answer is known. Returns an upper bound of the
+  compressed size or 0 if the data does not fit (i.e. the data looks random), stats (may be NULL)
+  receives what the match search found*/
+unsigned int trng_core_screen(const uint8_t *in, unsigned int in_len,
+                              unsigned int out_len, lzf_ctx *ctx,
+                              lzf_screen_stats *stats);
+
+/*Decompress comp_len bytes of comp into scratch (orig_len bytes) and compare the result with orig,
+  returns 0 when the round trip reproduces orig exactly*/
+int trng_core_verify(const uint8_t *comp, unsigned int comp_len,
+                     const uint8_t *orig, unsigned int orig_len,
+                     uint8_t *scratch);
+
+/*CRC-32 (IEEE 802.3, as zlib.crc32) of len bytes continuing from crc, 0 to start*/
+uint32_t trng_core_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+#endif
@@ -0,0 +1,870 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_drbg.h"
+#include "trng_core.h"
+
+#include <string.h>
+
+#if TRNG_AES_HAVE_AESNI
+# include <wmmintrin.h>
+#elif TRNG_AES_HAVE_ARMV8
+# include <arm_neon.h>
+#endif
+
+#define SEEDLEN             48          //CTR_DRBG key and block, the size of its provided data
+#define ENTROPY_MAX         (TRNG_DRBG_STRENGTH * 8)    //entropy input at 1 bit per byte
+#define CTR_LANES           8           //counter blocks encrypted together by the vector kernels
+
+static const uint8_t aes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+
+/*Round table, the MixColumns column of a substituted byte in row 0, the other rows are rotations of it*/
+static const uint32_t aes_te[256] = {
+    0xc66363a5U, 0xf87c7c84U, 0xee777799U, 0xf67b7b8dU, 0xfff2f20dU, 0xd66b6bbdU, 0xde6f6fb1U, 0x91c5c554U,
+    0x60303050U, 0x02010103U, 0xce6767a9U, 0x562b2b7dU, 0xe7fefe19U, 0xb5d7d762U, 0x4dababe6U, 0xec76769aU,
+    0x8fcaca45U, 0x1f82829dU, 0x89c9c940U, 0xfa7d7d87U, 0xeffafa15U, 0xb25959ebU, 0x8e4747c9U, 0xfbf0f00bU,
+    0x41adadecU, 0xb3d4d467U, 0x5fa2a2fdU, 0x45afafeaU, 0x239c9cbfU, 0x53a4a4f7U, 0xe4727296U, 0x9bc0c05bU,
+    0x75b7b7c2U, 0xe1fdfd1cU, 0x3d9393aeU, 0x4c26266aU, 0x6c36365aU, 0x7e3f3f41U, 0xf5f7f702U, 0x83cccc4fU,
+    0x6834345cU, 0x51a5a5f4U, 0xd1e5e534U, 0xf9f1f108U, 0xe2717193U, 0xabd8d873U, 0x62313153U, 0x2a15153fU,
+    0x0804040cU, 0x95c7c752U, 0x46232365U, 0x9dc3c35eU, 0x30181828U, 0x379696a1U, 0x0a05050fU, 0x2f9a9ab5U,
+    0x0e070709U, 0x24121236U, 0x1b80809bU, 0xdfe2e23dU, 0xcdebeb26U, 0x4e272769U, 0x7fb2b2cdU, 0xea75759fU,
+    0x1209091bU, 0x1d83839eU, 0x582c2c74U, 0x341a1a2eU, 0x361b1b2dU, 0xdc6e6eb2U, 0xb45a5aeeU, 0x5ba0a0fbU,
+    0xa45252f6U, 0x763b3b4dU, 0xb7d6d661U, 0x7db3b3ceU, 0x5229297bU, 0xdde3e33eU, 0x5e2f2f71U, 0x13848497U,
+    0xa65353f5U, 0xb9d1d168U, 0x00000000U, 0xc1eded2cU, 0x40202060U, 0xe3fcfc1fU, 0x79b1b1c8U, 0xb65b5bedU,
+    0xd46a6abeU, 0x8dcbcb46U, 0x67bebed9U, 0x7239394bU, 0x944a4adeU, 0x984c4cd4U, 0xb05858e8U, 0x85cfcf4aU,
+    0xbbd0d06bU, 0xc5efef2aU, 0x4faaaae5U, 0xedfbfb16U, 0x864343c5U, 0x9a4d4dd7U, 0x66333355U, 0x11858594U,
+    0x8a4545cfU, 0xe9f9f910U, 0x04020206U, 0xfe7f7f81U, 0xa05050f0U, 0x783c3c44U, 0x259f9fbaU, 0x4ba8a8e3U,
+    0xa25151f3U, 0x5da3a3feU, 0x804040c0U, 0x058f8f8aU, 0x3f9292adU, 0x219d9dbcU, 0x70383848U, 0xf1f5f504U,
+    0x63bcbcdfU, 0x77b6b6c1U, 0xafdada75U, 0x42212163U, 0x20101030U, 0xe5ffff1aU, 0xfdf3f30eU, 0xbfd2d26dU,
+    0x81cdcd4cU, 0x180c0c14U, 0x26131335U, 0xc3ecec2fU, 0xbe5f5fe1U, 0x359797a2U, 0x884444ccU, 0x2e171739U,
+    0x93c4c457U, 0x55a7a7f2U, 0xfc7e7e82U, 0x7a3d3d47U, 0xc86464acU, 0xba5d5de7U, 0x3219192bU, 0xe6737395U,
+    0xc06060a0U, 0x19818198U, 0x9e4f4fd1U, 0xa3dcdc7fU, 0x44222266U, 0x542a2a7eU, 0x3b9090abU, 0x0b888883U,
+    0x8c4646caU, 0xc7eeee29U, 0x6bb8b8d3U, 0x2814143cU, 0xa7dede79U, 0xbc5e5ee2U, 0x160b0b1dU, 0xaddbdb76U,
+    0xdbe0e03bU, 0x64323256U, 0x743a3a4eU, 0x140a0a1eU, 0x924949dbU, 0x0c06060aU, 0x4824246cU, 0xb85c5ce4U,
+    0x9fc2c25dU, 0xbdd3d36eU, 0x43acacefU, 0xc46262a6U, 0x399191a8U, 0x319595a4U, 0xd3e4e437U, 0xf279798bU,
+    0xd5e7e732U, 0x8bc8c843U, 0x6e373759U, 0xda6d6db7U, 0x018d8d8cU, 0xb1d5d564U, 0x9c4e4ed2U, 0x49a9a9e0U,
+    0xd86c6cb4U, 0xac5656faU, 0xf3f4f407U, 0xcfeaea25U, 0xca6565afU, 0xf47a7a8eU, 0x47aeaee9U, 0x10080818U,
+    0x6fbabad5U, 0xf0787888U, 0x4a25256fU, 0x5c2e2e72U, 0x381c1c24U, 0x57a6a6f1U, 0x73b4b4c7U, 0x97c6c651U,
+    0xcbe8e823U, 0xa1dddd7cU, 0xe874749cU, 0x3e1f1f21U, 0x964b4bddU, 0x61bdbddcU, 0x0d8b8b86U, 0x0f8a8a85U,
+    0xe0707090U, 0x7c3e3e42U, 0x71b5b5c4U, 0xcc6666aaU, 0x904848d8U, 0x06030305U, 0xf7f6f601U, 0x1c0e0e12U,
+    0xc26161a3U, 0x6a35355fU, 0xae5757f9U, 0x69b9b9d0U, 0x17868691U, 0x99c1c158U, 0x3a1d1d27U, 0x279e9eb9U,
+    0xd9e1e138U, 0xebf8f813U, 0x2b9898b3U, 0x22111133U, 0xd26969bbU, 0xa9d9d970U, 0x078e8e89U, 0x339494a7U,
+    0x2d9b9bb6U, 0x3c1e1e22U, 0x15878792U, 0xc9e9e920U, 0x87cece49U, 0xaa5555ffU, 0x50282878U, 0xa5dfdf7aU,
+    0x038c8c8fU, 0x59a1a1f8U, 0x09898980U, 0x1a0d0d17U, 0x65bfbfdaU, 0xd7e6e631U, 0x844242c6U, 0xd06868b8U,
+    0x824141c3U, 0x299999b0U, 0x5a2d2d77U, 0x1e0f0f11U, 0x7bb0b0cbU, 0xa85454fcU, 0x6dbbbbd6U, 0x2c16163aU,
+};
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98U, 0x71374491U, 0xb5c0fbcfU, 0xe9b5dba5U, 0x3956c25bU, 0x59f111f1U, 0x923f82a4U, 0xab1c5ed5U,
+    0xd807aa98U, 0x12835b01U, 0x243185beU, 0x550c7dc3U, 0x72be5d74U, 0x80deb1feU, 0x9bdc06a7U, 0xc19bf174U,
+    0xe49b69c1U, 0xefbe4786U, 0x0fc19dc6U, 0x240ca1ccU, 0x2de92c6fU, 0x4a7484aaU, 0x5cb0a9dcU, 0x76f988daU,
+    0x983e5152U, 0xa831c66dU, 0xb00327c8U, 0xbf597fc7U, 0xc6e00bf3U, 0xd5a79147U, 0x06ca6351U, 0x14292967U,
+    0x27b70a85U, 0x2e1b2138U, 0x4d2c6dfcU, 0x53380d13U, 0x650a7354U, 0x766a0abbU, 0x81c2c92eU, 0x92722c85U,
+    0xa2bfe8a1U, 0xa81a664bU, 0xc24b8b70U, 0xc76c51a3U, 0xd192e819U, 0xd6990624U, 0xf40e3585U, 0x106aa070U,
+    0x19a4c116U, 0x1e376c08U, 0x2748774cU, 0x34b0bcb5U, 0x391c0cb3U, 0x4ed8aa4aU, 0x5b9cca4fU, 0x682e6ff3U,
+    0x748f82eeU, 0x78a5636fU, 0x84c87814U, 0x8cc70208U, 0x90befffaU, 0xa4506cebU, 0xbef9a3f7U, 0xc67178f2U,
+};
+
+static inline uint32_t load_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void store_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+static inline uint64_t load_be64(const uint8_t *p)
+{
+    return ((uint64_t)load_be32(p) << 32) | load_be32(p + 4);
+}
+
+static inline void store_be64(uint8_t *p, uint64_t v)
+{
+    store_be32(p, (uint32_t)(v >> 32));
+    store_be32(p + 4, (uint32_t)v);
+}
+
+static inline uint32_t rotr(uint32_t v, unsigned int n)
+{
+    return (v >> n) | (v << (32 - n));
+}
+
+/*Zeroing the compiler can't drop as a dead store*/
+static void wipe(void *p, size_t len)
+{
+    volatile uint8_t *v = (volatile uint8_t *)p;
+    while (len--)
+    {
+        *v++ = 0;
+    }
+}
+
+/*
+* AES-256
+*/
+
+static inline uint32_t sub_word(uint32_t w)
+{
+    return ((uint32_t)aes_sbox[w >> 24] << 24) | ((uint32_t)aes_sbox[(w >> 16) & 0xff] << 16) |
+           ((uint32_t)aes_sbox[(w >> 8) & 0xff] << 8) | aes_sbox[w & 0xff];
+}
+
+/*CTR_DRBG rekeys after every request, so the schedule is done a word at a time*/
+void trng_aes256_init(trng_aes256 *aes, const uint8_t key[32])
+{
+    static const uint8_t rcon[7] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40 };
+    uint32_t w[60];
+
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        w[i] = load_be32(key + 4 * i);
+    }
+    for (unsigned int i = 8; i < 60; i++)
+    {
+        uint32_t t = w[i - 1];
+        if (i % 8 == 0)
+        {
+            t = sub_word(rotr(t, 24)) ^ ((uint32_t)rcon[i / 8 - 1] << 24);
+        }
+        else if (i % 8 == 4)
+        {
+            t = sub_word(t);
+        }
+        w[i] = w[i - 8] ^ t;
+    }
+    for (unsigned int i = 0; i < 60; i++)
+    {
+        store_be32(aes->rk + 4 * i, w[i]);
+    }
+    wipe(w, sizeof(w));
+}
+
+static void aes256_block_scalar(const trng_aes256 *aes, const uint8_t in[16], uint8_t out[16])
+{
+    const uint8_t *rk = aes->rk;
+    uint32_t s0 = load_be32(in) ^ load_be32(rk);
+    uint32_t s1 = load_be32(in + 4) ^ load_be32(rk + 4);
+    uint32_t s2 = load_be32(in + 8) ^ load_be32(rk + 8);
+    uint32_t s3 = load_be32(in + 12) ^ load_be32(rk + 12);
+
+    for (unsigned int r = 1; r < 14; r++)
+    {
+        rk += 16;
+        uint32_t t0 = aes_te[s0 >> 24] ^ rotr(aes_te[(s1 >> 16) & 0xff], 8) ^
+                      rotr(aes_te[(s2 >> 8) & 0xff], 16) ^ rotr(aes_te[s3 & 0xff], 24) ^ load_be32(rk);
+        uint32_t t1 = aes_te[s1 >> 24] ^ rotr(aes_te[(s2 >> 16) & 0xff], 8) ^
+                      rotr(aes_te[(s3 >> 8) & 0xff], 16) ^ rotr(aes_te[s0 & 0xff], 24) ^ load_be32(rk + 4);
+        uint32_t t2 = aes_te[s2 >> 24] ^ rotr(aes_te[(s3 >> 16) & 0xff], 8) ^
+                      rotr(aes_te[(s0 >> 8) & 0xff], 16) ^ rotr(aes_te[s1 & 0xff], 24) ^ load_be32(rk + 8);
+        uint32_t t3 = aes_te[s3 >> 24] ^ rotr(aes_te[(s0 >> 16) & 0xff], 8) ^
+                      rotr(aes_te[(s1 >> 8) & 0xff], 16) ^ rotr(aes_te[s2 & 0xff], 24) ^ load_be32(rk + 12);
+        s0 = t0;
+        s1 = t1;
+        s2 = t2;
+        s3 = t3;
+    }
+
+    /*Last round without MixColumns*/
+    rk += 16;
+    uint32_t s[4] = { s0, s1, s2, s3 };
+    for (unsigned int c = 0; c < 4; c++)
+    {
+        uint32_t t = ((uint32_t)aes_sbox[s[c] >> 24] << 24) |
+                     ((uint32_t)aes_sbox[(s[(c + 1) & 3] >> 16) & 0xff] << 16) |
+                     ((uint32_t)aes_sbox[(s[(c + 2) & 3] >> 8) & 0xff] << 8) |
+                     aes_sbox[s[(c + 3) & 3] & 0xff];
+        store_be32(out + 4 * c, t ^ load_be32(rk + 4 * c));
+    }
+}
+
+void trng_aes256_ctr_scalar(const trng_aes256 *aes, uint8_t v[16], uint8_t *out, size_t len)
+{
+    uint64_t hi = load_be64(v), lo = load_be64(v + 8);
+    uint8_t block[16], ks[16];
+
+    for (size_t pos = 0; pos < len; pos += 16)
+    {
+        hi += ++lo == 0;
+        store_be64(block, hi);
+        store_be64(block + 8, lo);
+        if (len - pos >= 16)
+        {
+            aes256_block_scalar(aes, block, out + pos);
+        }
+        else
+        {
+            aes256_block_scalar(aes, block, ks);
+            memcpy(out + pos, ks, len - pos);
+            wipe(ks, sizeof(ks));
+        }
+    }
+    store_be64(v, hi);
+    store_be64(v + 8, lo);
+}
+
+#if TRNG_AES_HAVE_AESNI
+static inline uint64_t bswap64(uint64_t v)
+{
+    return __builtin_bswap64(v);
+}
+
+void trng_aes256_ctr_aesni(const trng_aes256 *aes, uint8_t v[16], uint8_t *out, size_t len)
+{
+    __m128i rk[15];
+    for (unsigned int r = 0; r < 15; r++)
+    {
+        rk[r] = _mm_loadu_si128((const __m128i *)(aes->rk + 16 * r));
+    }
+    uint64_t hi = load_be64(v), lo = load_be64(v + 8);
+    size_t pos = 0;
+
+    /*Eight independent blocks keep the pipelined aesenc unit busy*/
+    for (; len - pos >= 16 * CTR_LANES; pos += 16 * CTR_LANES)
+    {
+        __m128i b[CTR_LANES];
+        for (unsigned int i = 0; i < CTR_LANES; i++)
+        {
+            hi += ++lo == 0;
+            b[i] = _mm_xor_si128(_mm_set_epi64x((long long)bswap64(lo), (long long)bswap64(hi)), rk[0]);
+        }
+        for (unsigned int r = 1; r < 14; r++)
+        {
+            for (unsigned int i = 0; i < CTR_LANES; i++)
+            {
+                b[i] = _mm_aesenc_si128(b[i], rk[r]);
+            }
+        }
+        for (unsigned int i = 0; i < CTR_LANES; i++)
+        {
+            _mm_storeu_si128((__m128i *)(out + pos + 16 * i), _mm_aesenclast_si128(b[i], rk[14]));
+        }
+    }
+    for (; pos < len; pos += 16)
+    {
+        hi += ++lo == 0;
+        __m128i b = _mm_xor_si128(_mm_set_epi64x((long long)bswap64(lo), (long long)bswap64(hi)), rk[0]);
+        for (unsigned int r = 1; r < 14; r++)
+        {
+            b = _mm_aesenc_si128(b, rk[r]);
+        }
+        b = _mm_aesenclast_si128(b, rk[14]);
+        if (len - pos >= 16)
+        {
+            _mm_storeu_si128((__m128i *)(out + pos), b);
+        }
+        else
+        {
+            uint8_t ks[16];
+            _mm_storeu_si128((__m128i *)ks, b);
+            memcpy(out + pos, ks, len - pos);
+            wipe(ks, sizeof(ks));
+        }
+    }
+    store_be64(v, hi);
+    store_be64(v + 8, lo);
+}
+#endif
+
+#if TRNG_AES_HAVE_ARMV8
+/*AESE adds the round key before SubBytes and ShiftRows, so the last two round keys go
+  into the last AESE and a plain XOR*/
+static inline uint8x16_t aes256_block_armv8(const uint8x16_t *rk, uint8x16_t b)
+{
+    for (unsigned int r = 0; r < 13; r++)
+    {
+        b = vaesmcq_u8(vaeseq_u8(b, rk[r]));
+    }
+    return veorq_u8(vaeseq_u8(b, rk[13]), rk[14]);
+}
+
+void trng_aes256_ctr_armv8(const trng_aes256 *aes, uint8_t v[16], uint8_t *out, size_t len)
+{
+    uint8x16_t rk[15];
+    for (unsigned int r = 0; r < 15; r++)
+    {
+        rk[r] = vld1q_u8(aes->rk + 16 * r);
+    }
+    uint64_t hi = load_be64(v), lo = load_be64(v + 8);
+    uint8_t block[16 * CTR_LANES];
+    size_t pos = 0;
+
+    for (; len - pos >= 16 * CTR_LANES; pos += 16 * CTR_LANES)
+    {
+        uint8x16_t b[CTR_LANES];
+        for (unsigned int i = 0; i < CTR_LANES; i++)
+        {
+            hi += ++lo == 0;
+            store_be64(block + 16 * i, hi);
+            store_be64(block + 16 * i + 8, lo);
+            b[i] = vld1q_u8(block + 16 * i);
+        }
+        for (unsigned int r = 0; r < 13; r++)
+        {
+            for (unsigned int i = 0; i < CTR_LANES; i++)
+            {
+                b[i] = vaesmcq_u8(vaeseq_u8(b[i], rk[r]));
+            }
+        }
+        for (unsigned int i = 0; i < CTR_LANES; i++)
+        {
+            vst1q_u8(out + pos + 16 * i, veorq_u8(vaeseq_u8(b[i], rk[13]), rk[14]));
+        }
+    }
+    for (; pos < len; pos += 16)
+    {
+        hi += ++lo == 0;
+        store_be64(block, hi);
+        store_be64(block + 8, lo);
+        vst1q_u8(block, aes256_block_armv8(rk, vld1q_u8(block)));
+        memcpy(out + pos, block, len - pos < 16 ? len - pos : 16);
+    }
+    wipe(block, sizeof(block));
+    store_be64(v, hi);
+    store_be64(v + 8, lo);
+}
+#endif
+
+void trng_aes256_ctr(const trng_aes256 *aes, uint8_t v[16], uint8_t *out, size_t len)
+{
+#if TRNG_AES_HAVE_AESNI
+    trng_aes256_ctr_aesni(aes, v, out, len);
+#elif TRNG_AES_HAVE_ARMV8
+    trng_aes256_ctr_armv8(aes, v, out, len);
+#else
+    trng_aes256_ctr_scalar(aes, v, out, len);
+#endif
+}
+
+void trng_aes256_encrypt(const trng_aes256 *aes, const uint8_t in[16], uint8_t out[16])
+{
+#if TRNG_AES_HAVE_AESNI
+    __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i *)in), _mm_loadu_si128((const __m128i *)aes->rk));
+    for (unsigned int r = 1; r < 14; r++)
+    {
+        b = _mm_aesenc_si128(b, _mm_loadu_si128((const __m128i *)(aes->rk + 16 * r)));
+    }
+    _mm_storeu_si128((__m128i *)out, _mm_aesenclast_si128(b, _mm_loadu_si128((const __m128i *)(aes->rk + 224))));
+#elif TRNG_AES_HAVE_ARMV8
+    uint8x16_t rk[15];
+    for (unsigned int r = 0; r < 15; r++)
+    {
+        rk[r] = vld1q_u8(aes->rk + 16 * r);
+    }
+    vst1q_u8(out, aes256_block_armv8(rk, vld1q_u8(in)));
+#else
+    aes256_block_scalar(aes, in, out);
+#endif
+}
+
+/*
+* SHA-256 and HMAC
+*/
+
+static void sha256_block(uint32_t h[8], const uint8_t *p)
+{
+    uint32_t w[64];
+    for (unsigned int i = 0; i < 16; i++)
+    {
+        w[i] = load_be32(p + 4 * i);
+    }
+    for (unsigned int i = 16; i < 64; i++)
+    {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (unsigned int i = 0; i < 64; i++)
+    {
+        uint32_t t1 = k + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+    h[5] += f;
+    h[6] += g;
+    h[7] += k;
+}
+
+void trng_sha256_init(trng_sha256 *sha)
+{
+    static const uint32_t iv[8] = {
+        0x6a09e667U, 0xbb67ae85U, 0x3c6ef372U, 0xa54ff53aU, 0x510e527fU, 0x9b05688cU, 0x1f83d9abU, 0x5be0cd19U,
+    };
+    memcpy(sha->h, iv, sizeof(iv));
+    sha->len = 0;
+    sha->fill = 0;
+}
+
+void trng_sha256_update(trng_sha256 *sha, const uint8_t *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    sha->len += len;
+    if (sha->fill != 0)
+    {
+        size_t n = 64 - sha->fill < len ? 64 - sha->fill : len;
+        memcpy(sha->buf + sha->fill, data, n);
+        sha->fill += n;
+        data += n;
+        len -= n;
+        if (sha->fill < 64)
+        {
+            return;
+        }
+        sha256_block(sha->h, sha->buf);
+        sha->fill = 0;
+    }
+    for (; len >= 64; data += 64, len -= 64)
+    {
+        sha256_block(sha->h, data);
+    }
+    memcpy(sha->buf, data, len);
+    sha->fill = len;
+}
+
+void trng_sha256_final(trng_sha256 *sha, uint8_t digest[32])
+{
+    uint64_t bits = sha->len * 8;
+    sha->buf[sha->fill++] = 0x80;
+    if (sha->fill > 56)
+    {
+        memset(sha->buf + sha->fill, 0, 64 - sha->fill);
+        sha256_block(sha->h, sha->buf);
+        sha->fill = 0;
+    }
+    memset(sha->buf + sha->fill, 0, 56 - sha->fill);
+    store_be64(sha->buf + 56, bits);
+    sha256_block(sha->h, sha->buf);
+    for (unsigned int i = 0; i < 8; i++)
+    {
+        store_be32(digest + 4 * i, sha->h[i]);
+    }
+    wipe(sha, sizeof(*sha));
+}
+
+void trng_hmac_sha256_init(trng_hmac_sha256 *hmac, const uint8_t *key, size_t len)
+{
+    uint8_t k0[64] = {0}, pad[64];
+
+    if (len > 64)
+    {
+        trng_sha256_init(&hmac->inner);
+        trng_sha256_update(&hmac->inner, key, len);
+        trng_sha256_final(&hmac->inner, k0);
+    }
+    else
+    {
+        memcpy(k0, key, len);
+    }
+
+    for (unsigned int i = 0; i < 64; i++)
+    {
+        pad[i] = k0[i] ^ 0x36;
+    }
+    trng_sha256_init(&hmac->inner);
+    trng_sha256_update(&hmac->inner, pad, 64);
+    for (unsigned int i = 0; i < 64; i++)
+    {
+        pad[i] = k0[i] ^ 0x5c;
+    }
+    trng_sha256_init(&hmac->outer);
+    trng_sha256_update(&hmac->outer, pad, 64);
+    wipe(k0, sizeof(k0));
+    wipe(pad, sizeof(pad));
+}
+
+void trng_hmac_sha256_mac(const trng_hmac_sha256 *hmac, const uint8_t *const *data, const size_t *len,
+                          unsigned int count, uint8_t mac[32])
+{
+    trng_sha256 sha = hmac->inner;
+    uint8_t inner[32];
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        trng_sha256_update(&sha, data[i], len[i]);
+    }
+    trng_sha256_final(&sha, inner);
+    sha = hmac->outer;
+    trng_sha256_update(&sha, inner, 32);
+    trng_sha256_final(&sha, mac);
+    wipe(inner, sizeof(inner));
+}
+
+/*
+* CTR_DRBG, 90A 10.2 with the derivation function
+*/
+
+/*Block_Cipher_df of 90A 10.3.2 returning SEEDLEN bytes. The BCC chains of the three output
+  blocks run side by side over S = L || N || input || 0x80 || 0 padding, so S is never built*/
+static void ctr_df(const uint8_t *const *data, const size_t *len, unsigned int count, uint8_t out[SEEDLEN])
+{
+    static const uint8_t df_key[32] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+    };
+    trng_aes256 aes;
+    uint8_t cv[SEEDLEN] = {0}, block[16] = {0};
+    size_t total = 0, fill = 8;
+
+    trng_aes256_init(&aes, df_key);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        total += len[i];
+    }
+
+    /*BCC starts from a chaining value of zero and the block IV = i || 0^96*/
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        uint8_t iv[16] = {0};
+        store_be32(iv, i);
+        trng_aes256_encrypt(&aes, iv, cv + 16 * i);
+    }
+    store_be32(block, (uint32_t)total);
+    store_be32(block + 4, SEEDLEN);
+
+    for (unsigned int i = 0; i <= count; i++)
+    {
+        /*The input parts, then the 0x80 marker as a last part of a byte*/
+        static const uint8_t marker = 0x80;
+        const uint8_t *p = i < count ? data[i] : &marker;
+        size_t n = i < count ? len[i] : 1;
+        while (n > 0 || (i == count && fill != 0))
+        {
+            size_t take = 16 - fill < n ? 16 - fill : n;
+            if (take != 0)
+            {
+                memcpy(block + fill, p, take);
+            }
+            p += take;
+            n -= take;
+            fill += take;
+            if (i == count && n == 0)
+            {
+                memset(block + fill, 0, 16 - fill);
+                fill = 16;
+            }
+            if (fill == 16)
+            {
+                for (unsigned int c = 0; c < 3; c++)
+                {
+                    for (unsigned int j = 0; j < 16; j++)
+                    {
+                        cv[16 * c + j] ^= block[j];
+                    }
+                    trng_aes256_encrypt(&aes, cv + 16 * c, cv + 16 * c);
+                }
+                fill = 0;
+            }
+        }
+    }
+
+    /*Key and X from the chains, then X encrypted in a chain of its own*/
+    trng_aes256_init(&aes, cv);
+    uint8_t *x = cv + 32;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+        trng_aes256_encrypt(&aes, x, out + 16 * i);
+        x = out + 16 * i;
+    }
+    wipe(&aes, sizeof(aes));
+    wipe(cv, sizeof(cv));
+    wipe(block, sizeof(block));
+}
+
+static void ctr_update(trng_drbg *drbg, const uint8_t provided[SEEDLEN])
+{
+    uint8_t temp[SEEDLEN];
+    trng_aes256_ctr(&drbg->aes, drbg->v, temp, SEEDLEN);
+    for (unsigned int i = 0; i < SEEDLEN; i++)
+    {
+        temp[i] ^= provided[i];
+    }
+    memcpy(drbg->key, temp, 32);
+    memcpy(drbg->v, temp + 32, 16);
+    trng_aes256_init(&drbg->aes, drbg->key);
+    wipe(temp, sizeof(temp));
+}
+
+static void ctr_generate(trng_drbg *drbg, uint8_t *out, size_t len, const uint8_t *additional, size_t additional_len)
+{
+    uint8_t provided[SEEDLEN] = {0};
+    if (additional_len != 0)
+    {
+        ctr_df(&additional, &additional_len, 1, provided);
+        ctr_update(drbg, provided);
+    }
+    trng_aes256_ctr(&drbg->aes, drbg->v, out, len);
+    ctr_update(drbg, provided);
+    wipe(provided, sizeof(provided));
+}
+
+/*
+* HMAC_DRBG, 90A 10.1.2
+*/
+
+static void hmac_update(trng_drbg *drbg, const uint8_t *const *data, const size_t *len, unsigned int count)
+{
+    static const uint8_t sep[2] = { 0x00, 0x01 };
+    const uint8_t *parts[5];
+    size_t lens[5], total = 0;
+
+    for (unsigned int i = 0; i < count; i++)
+    {
+        parts[i + 2] = data[i];
+        lens[i + 2] = len[i];
+        total += len[i];
+    }
+    parts[0] = drbg->hv;
+    lens[0] = 32;
+    lens[1] = 1;
+
+    for (unsigned int round = 0; round < (total != 0 ? 2U : 1U); round++)
+    {
+        const uint8_t *v = drbg->hv;
+        size_t vlen = 32;
+        parts[1] = &sep[round];
+        trng_hmac_sha256_mac(&drbg->hmac, parts, lens, count + 2, drbg->hkey);
+        trng_hmac_sha256_init(&drbg->hmac, drbg->hkey, 32);
+        trng_hmac_sha256_mac(&drbg->hmac, &v, &vlen, 1, drbg->hv);
+    }
+}
+
+static void hmac_generate(trng_drbg *drbg, uint8_t *out, size_t len, const uint8_t *additional, size_t additional_len)
+{
+    const uint8_t *v = drbg->hv;
+    size_t vlen = 32;
+
+    if (additional_len != 0)
+    {
+        hmac_update(drbg, &additional, &additional_len, 1);
+    }
+    for (; len >= 32; out += 32, len -= 32)
+    {
+        trng_hmac_sha256_mac(&drbg->hmac, &v, &vlen, 1, drbg->hv);
+        memcpy(out, drbg->hv, 32);
+    }
+    if (len > 0)
+    {
+        trng_hmac_sha256_mac(&drbg->hmac, &v, &vlen, 1, drbg->hv);
+        memcpy(out, drbg->hv, len);
+    }
+    hmac_update(drbg, &additional, &additional_len, additional_len != 0 ? 1 : 0);
+}
+
+/*
+* Instances
+*/
+
+void trng_drbg_config_default(trng_drbg_config *cfg, int mechanism, trng_drbg_entropy_cb entropy, void *ctx)
+{
+    cfg->mechanism = mechanism;
+    cfg->entropy_per_byte = 4;
+    cfg->reseed_interval = TRNG_DRBG_RESEED_INTERVAL;
+    cfg->prediction_resistance = 0;
+    cfg->entropy = entropy;
+    cfg->entropy_ctx = ctx;
+}
+
+/*Seed the state from entropy input for the strength, the nonce (instantiation only) and extra input*/
+static int seed(trng_drbg *drbg, int instantiate, const uint8_t *extra, size_t extra_len)
+{
+    uint8_t input[ENTROPY_MAX + ENTROPY_MAX / 2];
+    unsigned int epb = drbg->cfg.entropy_per_byte;
+    size_t entropy_len = (TRNG_DRBG_STRENGTH * 8 + epb - 1) / epb;
+    size_t nonce_len = instantiate ? (TRNG_DRBG_STRENGTH * 4 + epb - 1) / epb : 0;
+
+    if (drbg->cfg.entropy(drbg->cfg.entropy_ctx, input, entropy_len + nonce_len) != 0)
+    {
+        wipe(input, sizeof(input));
+        return TRNG_DRBG_ERR_SOURCE;
+    }
+
+    const uint8_t *parts[3] = { input, input + entropy_len, extra };
+    size_t lens[3] = { entropy_len, nonce_len, extra_len };
+    if (drbg->cfg.mechanism == TRNG_DRBG_CTR)
+    {
+        uint8_t seed_material[SEEDLEN];
+        ctr_df(parts, lens, 3, seed_material);
+        if (instantiate)
+        {
+            memset(drbg->key, 0, sizeof(drbg->key));
+            memset(drbg->v, 0, sizeof(drbg->v));
+            trng_aes256_init(&drbg->aes, drbg->key);
+        }
+        ctr_update(drbg, seed_material);
+        wipe(seed_material, sizeof(seed_material));
+    }
+    else
+    {
+        if (instantiate)
+        {
+            memset(drbg->hkey, 0x00, sizeof(drbg->hkey));
+            memset(drbg->hv, 0x01, sizeof(drbg->hv));
+            trng_hmac_sha256_init(&drbg->hmac, drbg->hkey, 32);
+        }
+        hmac_update(drbg, parts, lens, 3);
+    }
+    wipe(input, sizeof(input));
+
+    drbg->reseed_counter = 1;
+    drbg->reseeds++;
+    return 0;
+}
+
+int trng_drbg_init(trng_drbg *drbg, const trng_drbg_config *cfg, const uint8_t *personalization, size_t len)
+{
+    memset(drbg, 0, sizeof(*drbg));
+    if ((cfg->mechanism != TRNG_DRBG_CTR && cfg->mechanism != TRNG_DRBG_HMAC) ||
+        cfg->entropy_per_byte < 1 || cfg->entropy_per_byte > 8 || cfg->entropy == NULL)
+    {
+        return TRNG_DRBG_ERR_CONFIG;
+    }
+    drbg->cfg = *cfg;
+    if (drbg->cfg.reseed_interval == 0)
+    {
+        drbg->cfg.reseed_interval = 1;
+    }
+
+    int res = seed(drbg, 1, personalization, len);
+    drbg->seeded = res == 0;
+    return res;
+}
+
+int trng_drbg_reseed(trng_drbg *drbg, const uint8_t *additional, size_t additional_len)
+{
+    if (!drbg->seeded)
+    {
+        return TRNG_DRBG_ERR_SOURCE;
+    }
+    return seed(drbg, 0, additional, additional_len);
+}
+
+int trng_drbg_generate(trng_drbg *drbg, uint8_t *out, size_t len, const uint8_t *additional, size_t additional_len)
+{
+    if (!drbg->seeded)
+    {
+        return TRNG_DRBG_ERR_SOURCE;
+    }
+
+    do
+    {
+        size_t n = len < TRNG_DRBG_MAX_REQUEST ? len : TRNG_DRBG_MAX_REQUEST;
+        const uint8_t *addl = additional;
+        size_t addl_len = additional_len;
+
+        /*90A 9.3.1, the additional input goes into the reseed instead of the request*/
+        if (drbg->cfg.prediction_resistance || drbg->reseed_counter > drbg->cfg.reseed_interval)
+        {
+            if (seed(drbg, 0, addl, addl_len) != 0)
+            {
+                return TRNG_DRBG_ERR_SOURCE;
+            }
+            addl = NULL;
+            addl_len = 0;
+        }
+
+        if (drbg->cfg.mechanism == TRNG_DRBG_CTR)
+        {
+            ctr_generate(drbg, out, n, addl, addl_len);
+        }
+        else
+        {
+            hmac_generate(drbg, out, n, addl, addl_len);
+        }
+        drbg->reseed_counter++;
+        drbg->bytes += n;
+        out += n;
+        len -= n;
+    }
+    while (len > 0);
+    return 0;
+}
+
+int trng_drbg_fill(void *ctx, uint8_t *buf, size_t len)
+{
+    return trng_drbg_generate((trng_drbg *)ctx, buf, len, NULL, 0);
+}
+
+void trng_drbg_free(trng_drbg *drbg)
+{
+    wipe(drbg, sizeof(*drbg));
+}
+
+/*
+* Entropy sources
+*/
+
+int trng_drbg_entropy_trng(void *ctx, uint8_t *buf, size_t len)
+{
+    return trng_core_fill((trng_t *)ctx, buf, len);
+}
+
+int trng_drbg_entropy_health(void *ctx, uint8_t *buf, size_t len)
+{
+    return trng_health_fill((trng_health *)ctx, buf, len);
+}
+
+int trng_drbg_entropy_pool(void *ctx, uint8_t *buf, size_t len)
+{
+    trng_drbg_pool_source *src = (trng_drbg_pool_source *)ctx;
+    for (size_t pos = 0; pos < len;)
+    {
+        size_t got = trng_pool_read(src->pool, buf + pos, len - pos);
+        pos += got;
+        if (got == 0 && src->wait != NULL)
+        {
+            src->wait();
+        }
+    }
+    return 0;
+}
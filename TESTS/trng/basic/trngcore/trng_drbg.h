@@ -0,0 +1,167 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Deterministic random bit generators of NIST SP 800-90A seeded from the
+* trng, for randomness in amounts and at rates the trng can't deliver:
+*
+*   TRNG_DRBG_CTR   CTR_DRBG with AES-256 and the derivation function
+*   TRNG_DRBG_HMAC  HMAC_DRBG with SHA-256
+*
+* Entropy comes through a callback, the ones below read a trng_t, a
+* trng_health wrapper or a trng_pool. An instance is reseeded after
+* reseed_interval generate requests, or before every request in prediction
+* resistance mode. Instances hold no shared state: threads should have one
+* each, seeded from a trng_pool (the one source safe to share) rather than
+* share one behind a lock.
+*
+* AES runs on AES-NI or the ARMv8 crypto extension when the build enables
+* them, 8 counter blocks at a time, and through a table otherwise.
+*/
+
+#ifndef TRNG_DRBG_H
+#define TRNG_DRBG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hal/trng_api.h"
+#include "trng_health.h"
+#include "trng_pool.h"
+
+#define TRNG_DRBG_CTR               0
+#define TRNG_DRBG_HMAC              1
+
+#define TRNG_DRBG_ERR_CONFIG        -1          //bad mechanism or entropy claim
+#define TRNG_DRBG_ERR_SOURCE        -3          //the entropy source failed, nothing was generated
+
+#define TRNG_DRBG_STRENGTH          32          //security strength of both mechanisms in bytes
+#define TRNG_DRBG_MAX_REQUEST       65536       //bytes per generate request (2^19 bits), longer calls are split
+#define TRNG_DRBG_RESEED_INTERVAL   10000       //default requests between reseeds, as mbed TLS
+
+#if defined(__AES__) && (defined(__x86_64__) || defined(__i386__))
+# define TRNG_AES_HAVE_AESNI 1
+#endif
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_AES) || defined(__ARM_FEATURE_CRYPTO))
+# define TRNG_AES_HAVE_ARMV8 1
+#endif
+
+/*Fill buf with len bytes of entropy input, returns 0 or an error*/
+typedef int (*trng_drbg_entropy_cb)(void *ctx, uint8_t *buf, size_t len);
+
+typedef struct {
+    int mechanism;                      //TRNG_DRBG_CTR or TRNG_DRBG_HMAC
+    unsigned int entropy_per_byte;      //min-entropy claimed per byte of the source, 1 to 8 bits
+    uint32_t reseed_interval;           //generate requests between reseeds
+    int prediction_resistance;          //reseed before every request
+    trng_drbg_entropy_cb entropy;
+    void *entropy_ctx;
+} trng_drbg_config;
+
+/*Expanded AES-256 key, the 15 round keys in byte order*/
+typedef struct {
+    uint8_t rk[240];
+} trng_aes256;
+
+typedef struct {
+    uint32_t h[8];
+    uint64_t len;                       //bytes hashed
+    uint8_t buf[64];
+    size_t fill;
+} trng_sha256;
+
+/*HMAC-SHA256 with the padded key already hashed in both states, so a message costs the
+  compressions of its own blocks plus one for the outer hash*/
+typedef struct {
+    trng_sha256 inner;
+    trng_sha256 outer;
+} trng_hmac_sha256;
+
+typedef struct {
+    trng_drbg_config cfg;
+    int seeded;                         //instantiated, or reseeded after a failure of the source
+    uint64_t reseed_counter;            //requests since the last reseed, plus one, as 90A counts
+    uint64_t reseeds;                   //reseeds so far, instantiation included
+    uint64_t bytes;                     //bytes generated so far
+
+    /*CTR_DRBG*/
+    uint8_t key[32];
+    uint8_t v[16];
+    trng_aes256 aes;
+
+    /*HMAC_DRBG*/
+    uint8_t hkey[32];
+    uint8_t hv[32];
+    trng_hmac_sha256 hmac;
+} trng_drbg;
+
+/*Defaults: 4 bits of min-entropy per byte, TRNG_DRBG_RESEED_INTERVAL, no prediction resistance*/
+void trng_drbg_config_default(trng_drbg_config *cfg, int mechanism, trng_drbg_entropy_cb entropy, void *ctx);
+
+/*Instantiate from TRNG_DRBG_STRENGTH * 8 / entropy_per_byte bytes of entropy input and a nonce
+  of half as much, with an optional personalization string. Returns 0, TRNG_DRBG_ERR_CONFIG
+  or TRNG_DRBG_ERR_SOURCE, in which case generate calls fail until a reseed succeeds*/
+int trng_drbg_init(trng_drbg *drbg, const trng_drbg_config *cfg, const uint8_t *personalization, size_t len);
+
+/*Reseed from the entropy source with optional additional input. Returns 0 or TRNG_DRBG_ERR_SOURCE*/
+int trng_drbg_reseed(trng_drbg *drbg, const uint8_t *additional, size_t additional_len);
+
+/*Fill out with len bytes, in requests of at most TRNG_DRBG_MAX_REQUEST bytes, the additional
+  input (may be NULL) is applied to each. Reseeds as the policy requires. Returns 0 or
+  TRNG_DRBG_ERR_SOURCE, out is then left untouched from the failed request on*/
+int trng_drbg_generate(trng_drbg *drbg, uint8_t *out, size_t len, const uint8_t *additional, size_t additional_len);
+
+/*trng_drbg_generate without additional input, in the shape of trng_stream_config fill: ctx is the trng_drbg*/
+int trng_drbg_fill(void *ctx, uint8_t *buf, size_t len);
+
+/*Wipe the state*/
+void trng_drbg_free(trng_drbg *drbg);
+
+/*Entropy sources: ctx is a trng_t, a trng_health or a trng_drbg_pool_source*/
+int trng_drbg_entropy_trng(void *ctx, uint8_t *buf, size_t len);
+int trng_drbg_entropy_health(void *ctx, uint8_t *buf, size_t len);
+int trng_drbg_entropy_pool(void *ctx, uint8_t *buf, size_t len);
+
+typedef struct {
+    trng_pool *pool;
+    void (*wait)(void);                 //called while the pool is empty, may be NULL to spin
+} trng_drbg_pool_source;
+
+/*The primitives behind the mechanisms*/
+void trng_aes256_init(trng_aes256 *aes, const uint8_t key[32]);
+void trng_aes256_encrypt(const trng_aes256 *aes, const uint8_t in[16], uint8_t out[16]);
+
+/*Encrypt the big endian counter v incremented before every block into len bytes of out, a
+  partial last block takes its leading bytes, v is left at the last value used*/
+void trng_aes256_ctr(const trng_aes256 *aes, uint8_t v[16], uint8_t *out, size_t len);
+void trng_aes256_ctr_scalar(const trng_aes256 *aes, uint8_t v[16], uint8_t *out, size_t len);
+#if TRNG_AES_HAVE_AESNI
+void trng_aes256_ctr_aesni(const trng_aes256 *aes, uint8_t v[16], uint8_t *out, size_t len);
+#endif
+#if TRNG_AES_HAVE_ARMV8
+void trng_aes256_ctr_armv8(const trng_aes256 *aes, uint8_t v[16], uint8_t *out, size_t len);
+#endif
+
+void trng_sha256_init(trng_sha256 *sha);
+void trng_sha256_update(trng_sha256 *sha, const uint8_t *data, size_t len);
+void trng_sha256_final(trng_sha256 *sha, uint8_t digest[32]);
+
+void trng_hmac_sha256_init(trng_hmac_sha256 *hmac, const uint8_t *key, size_t len);
+
+/*HMAC of the concatenation of parts data[0..count-1] of len[0..count-1] bytes*/
+void trng_hmac_sha256_mac(const trng_hmac_sha256 *hmac, const uint8_t *const *data, const size_t *len,
+                          unsigned int count, uint8_t mac[32]);
+
+#endif
@@ -0,0 +1,964 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_entropy.h"
+
+#include <math.h>
+#include <string.h>
+
+#define Z_ALPHA                 2.576       //99% upper confidence bound, as 90B uses throughout
+#define TUPLE_MIN_COUNT         35          //t-tuple and LRS tuple lengths, 90B 6.3.5
+#define COMPRESSION_BITS        6           //symbol size of the compression estimate
+#define COMPRESSION_DICT        1000        //symbols that only fill its dictionary
+#define COMPRESSION_C           0.5907      //its standard deviation correction
+#define MARKOV_LENGTH           128         //sequence length of the Markov estimate
+#define MCW_WINDOWS             4
+#define LAG_DEPTH               128
+#define MMC_DEPTH               16
+#define MMC_MAX_ENTRIES         100000      //per model
+#define LZ78Y_DEPTH             16
+#define LZ78Y_MAX_CONTEXTS      65536
+#define LZ78Y_MAX_PAIRS         (1UL << 20) //bound of the successor counts, see lz78y_pairs
+
+static const unsigned int mcw_windows[MCW_WINDOWS] = { 63, 255, 1023, 4095 };
+
+static const char *const estimator_names[TRNG_ENTROPY_ESTIMATORS] = {
+    "most common value",
+    "collision",
+    "markov",
+    "compression",
+    "t-tuple",
+    "lrs",
+    "multi mcw",
+    "lag",
+    "multi mmc",
+    "lz78y",
+};
+
+/*Min-entropy of the upper bound of a probability estimated from n samples*/
+static double upper_bound_entropy(double p, double n)
+{
+    double pu = p + Z_ALPHA * sqrt(p * (1.0 - p) / (n - 1.0));
+    return -log2(pu < 1.0 ? pu : 1.0);
+}
+
+/*
+* Predictors: every prediction is tallied, the estimate is the larger of the
+* upper bound of the global success rate and the success rate that makes the
+* longest run of successes likely (90B 6.3.7 steps 4-6).
+*/
+
+typedef struct {
+    uint64_t predictions;
+    uint64_t correct;
+    uint64_t run;
+    uint64_t longest;
+} predictor_tally;
+
+static inline void tally(predictor_tally *t, int correct)
+{
+    t->predictions++;
+    t->correct += correct;
+    t->run = correct ? t->run + 1 : 0;
+    t->longest = t->run > t->longest ? t->run : t->longest;
+}
+
+/*Success probability at which no run of r successes in n trials has probability 0.99*/
+static double local_probability(uint64_t n, uint64_t r)
+{
+    double lo = 0.0, hi = 1.0, target = log(0.99);
+
+    for (int i = 0; i < 64; i++)
+    {
+        double p = 0.5 * (lo + hi), q = 1.0 - p, x = 1.0;
+        for (int j = 0; j < 10; j++)
+        {
+            x = 1.0 + q * pow(p, (double)r) * pow(x, (double)r + 1.0);
+        }
+        double l = log(1.0 - p * x) - log(((double)r + 1.0 - (double)r * x) * q) - ((double)n + 1.0) * log(x);
+        if (l > target)
+        {
+            lo = p;
+        }
+        else
+        {
+            hi = p;
+        }
+    }
+
+    return 0.5 * (lo + hi);
+}
+
+static double predictor_entropy(const predictor_tally *t, unsigned int bits)
+{
+    if (t->predictions < 2)
+    {
+        return TRNG_ENTROPY_NA;
+    }
+
+    double n = (double)t->predictions, p = (double)t->correct / n, global;
+    if (t->correct == 0)
+    {
+        global = 1.0 - pow(0.01, 1.0 / n);
+    }
+    else
+    {
+        global = p + Z_ALPHA * sqrt(p * (1.0 - p) / (n - 1.0));
+        global = global < 1.0 ? global : 1.0;
+    }
+
+    double local = local_probability(t->predictions, t->longest + 1);
+    double pmax = global > local ? global : local;
+    pmax = pmax > ldexp(1.0, -(int)bits) ? pmax : ldexp(1.0, -(int)bits);
+    return -log2(pmax);
+}
+
+/*Subpredictor scores, the winner makes the prediction (90B 6.3.7 step 3)*/
+typedef struct {
+    uint32_t score[LAG_DEPTH];
+    unsigned int winner;
+} scoreboard;
+
+static inline void score(scoreboard *b, const int *predictions, unsigned int count, int sample)
+{
+    for (unsigned int j = 0; j < count; j++)
+    {
+        b->score[j] += predictions[j] == sample;
+        if (b->score[j] >= b->score[b->winner])
+        {
+            b->winner = j;
+        }
+    }
+}
+
+/*6.3.1*/
+static double most_common_value(const uint8_t *s, size_t len)
+{
+    uint32_t counts[256] = {0};
+    uint32_t max = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        counts[s[i]]++;
+    }
+    for (int v = 0; v < 256; v++)
+    {
+        max = counts[v] > max ? counts[v] : max;
+    }
+
+    return upper_bound_entropy((double)max / (double)len, (double)len);
+}
+
+/*6.3.2, any three bits hold a collision, so the times are 2 and 3 and their expected value
+  for a bit with bias p reduces to 2 + 2p(1 - p)*/
+static double collision(const uint8_t *s, size_t len)
+{
+    double sum = 0.0, sum_sq = 0.0, v = 0.0;
+
+    for (size_t i = 0; i + 1 < len;)
+    {
+        double t;
+        if (s[i] == s[i + 1])
+        {
+            t = 2.0;
+        }
+        else if (i + 2 < len)
+        {
+            t = 3.0;
+        }
+        else
+        {
+            break;
+        }
+        i += (size_t)t;
+        sum += t;
+        sum_sq += t * t;
+        v += 1.0;
+    }
+    if (v < 2.0)
+    {
+        return TRNG_ENTROPY_NA;
+    }
+
+    double mean = sum / v;
+    double sigma = sqrt((sum_sq - v * mean * mean) / (v - 1.0));
+    double bound = mean - Z_ALPHA * sigma / sqrt(v);
+
+    if (bound >= 2.5)
+    {
+        return 1.0;
+    }
+    if (bound <= 2.0)
+    {
+        return 0.0;
+    }
+
+    double p = 0.5 * (1.0 + sqrt(1.0 - 2.0 * (bound - 2.0)));
+    return -log2(p);
+}
+
+/*6.3.3, log probability of the most likely of the 128 bit sequences the chain favours*/
+static double markov(const uint8_t *s, size_t len)
+{
+    uint64_t c[2][2] = { { 0, 0 }, { 0, 0 } }, ones = 0;
+
+    if (len < 2)
+    {
+        return TRNG_ENTROPY_NA;
+    }
+    for (size_t i = 0; i + 1 < len; i++)
+    {
+        c[s[i]][s[i + 1]]++;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        ones += s[i];
+    }
+
+    double p[2], t[2][2];
+    p[1] = (double)ones / (double)len;
+    p[0] = 1.0 - p[1];
+    for (int a = 0; a < 2; a++)
+    {
+        double row = (double)(c[a][0] + c[a][1]);
+        for (int b = 0; b < 2; b++)
+        {
+            t[a][b] = row > 0.0 ? (double)c[a][b] / row : 0.0;
+        }
+    }
+
+    /*log2 of a probability, -inf for 0*/
+    double lp0 = log2(p[0]), lp1 = log2(p[1]);
+    double l00 = log2(t[0][0]), l01 = log2(t[0][1]), l10 = log2(t[1][0]), l11 = log2(t[1][1]);
+    double n = MARKOV_LENGTH;
+    double candidates[6] = {
+        lp0 + (n - 1.0) * l00,                          //00...0
+        lp0 + n / 2.0 * l01 + (n / 2.0 - 1.0) * l10,    //0101...01
+        lp0 + l01 + (n - 2.0) * l11,                    //011...1
+        lp1 + l10 + (n - 2.0) * l00,                    //100...0
+        lp1 + n / 2.0 * l10 + (n / 2.0 - 1.0) * l01,    //1010...10
+        lp1 + (n - 1.0) * l11,                          //11...1
+    };
+
+    double best = -HUGE_VAL;
+    for (int i = 0; i < 6; i++)
+    {
+        /*NaN from 0 * -inf can't be the maximum*/
+        best = candidates[i] > best ? candidates[i] : best;
+    }
+
+    double h = -best / n;
+    return h < 1.0 ? h : 1.0;
+}
+
+/*Expected mean of log2 of the distances of the compression estimate for symbols of probability z,
+  the double sum of 90B 6.3.4 step 7 regrouped by distance u into a single one*/
+static double compression_g(double z, double symbols)
+{
+    double d = COMPRESSION_DICT, sum = 0.0, power = 1.0;
+
+    for (double u = 1.0; u <= symbols; u += 1.0)
+    {
+        if (u < symbols)
+        {
+            sum += log2(u) * z * z * power * (symbols - (u > d ? u : d));
+        }
+        if (u > d)
+        {
+            sum += log2(u) * z * power;
+        }
+        power *= 1.0 - z;
+        if (power < 1e-300)
+        {
+            break;
+        }
+    }
+
+    return sum / (symbols - d);
+}
+
+/*6.3.4, Maurer's test statistic on 6 bit symbols*/
+static double compression(const uint8_t *s, size_t len)
+{
+    size_t symbols = len / COMPRESSION_BITS;
+    uint32_t last[1 << COMPRESSION_BITS];
+    double sum = 0.0, sum_sq = 0.0;
+
+    if (symbols < COMPRESSION_DICT + 2)
+    {
+        return TRNG_ENTROPY_NA;
+    }
+
+    memset(last, 0, sizeof(last));
+    for (size_t i = 1; i <= symbols; i++)
+    {
+        unsigned int v = 0;
+        for (int b = 0; b < COMPRESSION_BITS; b++)
+        {
+            v = (v << 1) | s[(i - 1) * COMPRESSION_BITS + b];
+        }
+        if (i > COMPRESSION_DICT)
+        {
+            double dist = log2((double)(last[v] ? i - last[v] : i));
+            sum += dist;
+            sum_sq += dist * dist;
+        }
+        last[v] = (uint32_t)i;
+    }
+
+    double v = (double)(symbols - COMPRESSION_DICT);
+    double mean = sum / v;
+    double sigma = COMPRESSION_C * sqrt(sum_sq / (v - 1.0) - mean * mean);
+    double bound = mean - Z_ALPHA * sigma / sqrt(v);
+    double n = (double)symbols, k = (double)((1 << COMPRESSION_BITS) - 1);
+    double lo = ldexp(1.0, -COMPRESSION_BITS), hi = 1.0;
+
+    /*The expectation falls as p grows, from its value for uniform symbols*/
+    if (compression_g(lo, n) + k * compression_g((1.0 - lo) / k, n) <= bound)
+    {
+        return 1.0;
+    }
+    for (int i = 0; i < 64; i++)
+    {
+        double p = 0.5 * (lo + hi);
+        if (compression_g(p, n) + k * compression_g((1.0 - p) / k, n) > bound)
+        {
+            lo = p;
+        }
+        else
+        {
+            hi = p;
+        }
+    }
+
+    return -log2(0.5 * (lo + hi)) / COMPRESSION_BITS;
+}
+
+/*
+* Suffix array by prefix doubling, each round a radix sort of the pairs of
+* ranks, then the LCP array (Kasai). Every group of suffixes that share a
+* prefix of length W is an LCP interval with lcp >= W, which gives the count
+* of the most common W-tuple and the number of pairs of equal W-tuples for
+* every W from one pass over the intervals.
+*/
+
+typedef struct {
+    uint64_t *pairs;        //pairs of equal W-tuples at W, as differences over W
+    uint32_t *sa;
+    uint32_t *rank;
+    uint32_t *tmp;
+    uint32_t *cnt;          //max(n, 256) + 1 buckets
+} tuple_work;
+
+static size_t tuple_work_size(size_t n)
+{
+    size_t buckets = (n > 256 ? n : 256) + 1;
+    return sizeof(uint64_t) * (n + 2) + sizeof(uint32_t) * (3 * n + buckets);
+}
+
+static void tuple_work_init(tuple_work *w, void *work, size_t n)
+{
+    w->pairs = (uint64_t *)work;
+    w->sa = (uint32_t *)(w->pairs + n + 2);
+    w->rank = w->sa + n;
+    w->tmp = w->rank + n;
+    w->cnt = w->tmp + n;
+}
+
+static void suffix_array(tuple_work *w, const uint8_t *s, uint32_t n)
+{
+    uint32_t *sa = w->sa, *rank = w->rank, *tmp = w->tmp, *cnt = w->cnt;
+    uint32_t classes = 256;
+
+    memset(cnt, 0, sizeof(uint32_t) * 257);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        cnt[s[i] + 1]++;
+    }
+    for (uint32_t v = 1; v <= 256; v++)
+    {
+        cnt[v] += cnt[v - 1];
+    }
+    for (uint32_t i = 0; i < n; i++)
+    {
+        sa[cnt[s[i]]++] = i;
+        rank[i] = s[i];
+    }
+
+    for (uint32_t k = 1; k < n; k <<= 1)
+    {
+        /*Order by the rank k positions on, suffixes shorter than that first*/
+        uint32_t j = 0;
+        for (uint32_t i = n - k; i < n; i++)
+        {
+            tmp[j++] = i;
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            if (sa[i] >= k)
+            {
+                tmp[j++] = sa[i] - k;
+            }
+        }
+
+        /*Stable counting sort by the rank of the first half*/
+        memset(cnt, 0, sizeof(uint32_t) * (classes + 1));
+        for (uint32_t i = 0; i < n; i++)
+        {
+            cnt[rank[i] + 1]++;
+        }
+        for (uint32_t v = 1; v <= classes; v++)
+        {
+            cnt[v] += cnt[v - 1];
+        }
+        for (uint32_t i = 0; i < n; i++)
+        {
+            sa[cnt[rank[tmp[i]]]++] = tmp[i];
+        }
+
+        /*New ranks of the 2k prefixes*/
+        tmp[sa[0]] = 0;
+        classes = 1;
+        for (uint32_t i = 1; i < n; i++)
+        {
+            uint32_t a = sa[i - 1], b = sa[i];
+            uint32_t ra = a + k < n ? rank[a + k] + 1 : 0, rb = b + k < n ? rank[b + k] + 1 : 0;
+            classes += rank[a] != rank[b] || ra != rb;
+            tmp[b] = classes - 1;
+        }
+        memcpy(rank, tmp, sizeof(uint32_t) * n);
+        if (classes == n)
+        {
+            break;
+        }
+    }
+}
+
+/*lcp[i] = common prefix of suffixes sa[i - 1] and sa[i], written into tmp. rank is the inverse of sa*/
+static void lcp_array(tuple_work *w, const uint8_t *s, uint32_t n)
+{
+    uint32_t *sa = w->sa, *rank = w->rank, *lcp = w->tmp;
+    uint32_t h = 0;
+
+    lcp[0] = 0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+        if (rank[i] == 0)
+        {
+            h = 0;
+            continue;
+        }
+        uint32_t j = sa[rank[i] - 1];
+        while (i + h < n && j + h < n && s[i + h] == s[j + h])
+        {
+            h++;
+        }
+        lcp[rank[i]] = h;
+        h = h ? h - 1 : 0;
+    }
+}
+
+void trng_entropy_tuples(const uint8_t *samples, size_t len, unsigned int bits,
+                         void *work, size_t work_len, double *t_tuple, double *lrs)
+{
+    *t_tuple = TRNG_ENTROPY_NA;
+    *lrs = TRNG_ENTROPY_NA;
+    if (len < 2 || len >= 0xffffffffUL || work == NULL || work_len < tuple_work_size(len))
+    {
+        return;
+    }
+
+    uint32_t n = (uint32_t)len;
+    tuple_work w;
+    tuple_work_init(&w, work, n);
+    suffix_array(&w, samples, n);
+    lcp_array(&w, samples, n);
+
+    /*Bottom up over the LCP intervals with a stack of (lcp, left bound), in sa and rank which are
+      no longer needed. An interval of size c with lcp h inside one with lcp h' holds c equal
+      W-tuples for h' < W <= h. cnt[h] collects the largest interval with lcp h*/
+    uint32_t *lcp = w.tmp, *stack_h = w.sa, *stack_lb = w.rank, *largest = w.cnt;
+    uint64_t *pairs = w.pairs;
+    uint32_t top = 0, max_lcp = 0;
+
+    memset(pairs, 0, sizeof(uint64_t) * (n + 2));
+    memset(largest, 0, sizeof(uint32_t) * (n + 1));
+    stack_h[0] = 0;
+    stack_lb[0] = 0;
+    for (uint32_t i = 1; i <= n; i++)
+    {
+        uint32_t h = i < n ? lcp[i] : 0, lb = i - 1;
+        max_lcp = h > max_lcp ? h : max_lcp;
+        while (h < stack_h[top])
+        {
+            uint32_t ih = stack_h[top], size = i - stack_lb[top];
+            lb = stack_lb[top];
+            top--;
+            uint32_t parent = h > stack_h[top] ? h : stack_h[top];
+            uint64_t c = (uint64_t)size * (size - 1) / 2;
+            pairs[parent + 1] += c;
+            pairs[ih + 1] -= c;
+            largest[ih] = size > largest[ih] ? size : largest[ih];
+        }
+        if (h > stack_h[top])
+        {
+            stack_h[++top] = h;
+            stack_lb[top] = lb;
+        }
+    }
+
+    /*Most common W-tuple: the largest interval at lcp W or above, 0 where no W-tuple repeats*/
+    for (uint32_t h = max_lcp; h > 0; h--)
+    {
+        largest[h - 1] = largest[h] > largest[h - 1] ? largest[h] : largest[h - 1];
+    }
+
+    uint32_t t = 0;
+    while (t < max_lcp && largest[t + 1] >= TUPLE_MIN_COUNT)
+    {
+        t++;
+    }
+
+    double pmax = 0.0;
+    for (uint32_t i = 1; i <= t; i++)
+    {
+        double p = pow((double)largest[i] / (double)(n - i + 1), 1.0 / i);
+        pmax = p > pmax ? p : pmax;
+    }
+    if (t > 0)
+    {
+        *t_tuple = upper_bound_entropy(pmax, (double)n);
+    }
+
+    /*LRS from the shortest length with no tuple TUPLE_MIN_COUNT times up to the longest repeat*/
+    uint64_t sum = 0;
+    pmax = 0.0;
+    for (uint32_t i = 1; i <= max_lcp; i++)
+    {
+        sum += pairs[i];
+        if (i > t)
+        {
+            double m = (double)(n - i + 1);
+            double p = pow((double)sum / (m * (m - 1.0) / 2.0), 1.0 / i);
+            pmax = p > pmax ? p : pmax;
+        }
+    }
+    if (max_lcp > t)
+    {
+        *lrs = upper_bound_entropy(pmax, (double)n);
+    }
+    (void)bits;
+}
+
+/*6.3.7, the most common value in the last 63, 255, 1023 and 4095 samples, ties go to the
+  value seen last. Counts are kept per window, only losing the most common value makes the
+  window look for the next one*/
+typedef struct {
+    uint32_t count[256];
+    uint32_t last[256];
+    unsigned int mode;
+    uint32_t mode_count;
+} mcw_window;
+
+static double multi_mcw(const uint8_t *s, size_t len, unsigned int bits, void *work)
+{
+    mcw_window *win = (mcw_window *)work;
+    scoreboard board;
+    predictor_tally t;
+    unsigned int values = 1U << bits;
+
+    memset(win, 0, sizeof(mcw_window) * MCW_WINDOWS);
+    memset(&board, 0, sizeof(board));
+    memset(&t, 0, sizeof(t));
+
+    for (size_t i = 0; i < len; i++)
+    {
+        int sample = s[i];
+        if (i >= mcw_windows[0])
+        {
+            int predictions[MCW_WINDOWS];
+            for (int j = 0; j < MCW_WINDOWS; j++)
+            {
+                predictions[j] = i >= mcw_windows[j] ? (int)win[j].mode : -1;
+            }
+            tally(&t, predictions[board.winner] == sample);
+            score(&board, predictions, MCW_WINDOWS, sample);
+        }
+
+        for (int j = 0; j < MCW_WINDOWS; j++)
+        {
+            mcw_window *w = &win[j];
+            w->last[sample] = (uint32_t)i;
+            if (++w->count[sample] >= w->mode_count)
+            {
+                w->mode = sample;
+                w->mode_count = w->count[sample];
+            }
+            if (i >= mcw_windows[j])
+            {
+                unsigned int old = s[i - mcw_windows[j]];
+                w->count[old]--;
+                if (old == w->mode)
+                {
+                    w->mode_count = w->count[old];
+                    for (unsigned int v = 0; v < values; v++)
+                    {
+                        if (w->count[v] > w->mode_count ||
+                            (w->count[v] == w->mode_count && w->count[v] != 0 && w->last[v] > w->last[w->mode]))
+                        {
+                            w->mode = v;
+                            w->mode_count = w->count[v];
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return predictor_entropy(&t, bits);
+}
+
+/*6.3.8, the sample 1 to 128 positions back*/
+static double lag(const uint8_t *s, size_t len, unsigned int bits)
+{
+    scoreboard board;
+    predictor_tally t;
+    int predictions[LAG_DEPTH];
+
+    memset(&board, 0, sizeof(board));
+    memset(&t, 0, sizeof(t));
+
+    for (size_t i = 1; i < len; i++)
+    {
+        int sample = s[i];
+        for (unsigned int d = 0; d < LAG_DEPTH; d++)
+        {
+            predictions[d] = i > d ? s[i - d - 1] : -1;
+        }
+        tally(&t, predictions[board.winner] == sample);
+        score(&board, predictions, LAG_DEPTH, sample);
+    }
+
+    return predictor_entropy(&t, bits);
+}
+
+/*
+* Dictionaries of the MultiMMC and LZ78Y predictors. A string of the samples
+* is kept as its position and length, a context (the samples before a
+* prediction) with its most common successor, ties going to the greater
+* value, and a pair (a context and one successor, the context one sample
+* longer) with its count. Tables are open addressed and never more than 3/4
+* full, hashes of the strings ending at a position are computed together.
+*/
+
+typedef struct {
+    uint32_t start;
+    uint32_t count;
+    uint8_t len;                        //0 - empty slot
+    uint8_t best;
+} dict_slot;
+
+typedef struct {
+    dict_slot *slots;
+    uint32_t mask;
+    uint32_t used;
+} dict_table;
+
+static size_t dict_slots(size_t entries)
+{
+    size_t slots = 16;
+    while (slots * 3 < entries * 4)
+    {
+        slots <<= 1;
+    }
+    return slots;
+}
+
+static void *dict_init(dict_table *d, void *work, size_t entries)
+{
+    size_t slots = dict_slots(entries);
+    d->slots = (dict_slot *)work;
+    d->mask = (uint32_t)(slots - 1);
+    d->used = 0;
+    memset(d->slots, 0, sizeof(dict_slot) * slots);
+    return d->slots + slots;
+}
+
+/*Slot of the len samples at start, or the empty slot it would go to*/
+static inline dict_slot *dict_find(const dict_table *d, const uint8_t *s, uint32_t start, unsigned int len, uint32_t hash)
+{
+    for (uint32_t i = hash & d->mask; ; i = (i + 1) & d->mask)
+    {
+        dict_slot *slot = &d->slots[i];
+        if (slot->len == 0 || (slot->len == len && memcmp(s + slot->start, s + start, len) == 0))
+        {
+            return slot;
+        }
+    }
+}
+
+/*Hashes of the strings of 1 to max samples ending before position end*/
+static inline void dict_hashes(const uint8_t *s, size_t end, unsigned int max, uint32_t *hash)
+{
+    uint32_t h = 0x811c9dc5;
+    for (unsigned int l = 1; l <= max && l <= end; l++)
+    {
+        h = (h ^ s[end - l]) * 0x01000193;
+        uint32_t x = h ^ (l * 0x9e3779b9);
+        x ^= x >> 16;
+        x *= 0x85ebca6b;
+        x ^= x >> 13;
+        x *= 0xc2b2ae35;
+        x ^= x >> 16;
+        hash[l] = x;
+    }
+}
+
+/*Count successor y of a context that has a slot*/
+static inline void dict_count(dict_slot *ctx, dict_slot *pair, unsigned int y)
+{
+    pair->count++;
+    if (pair->count > ctx->count || (pair->count == ctx->count && y > ctx->best))
+    {
+        ctx->best = (uint8_t)y;
+        ctx->count = pair->count;
+    }
+}
+
+static size_t mmc_entries(size_t len)
+{
+    return MMC_DEPTH * (len < MMC_MAX_ENTRIES ? len : MMC_MAX_ENTRIES);
+}
+
+/*6.3.9, Markov models of order 1 to 16 each limited to 100000 entries*/
+static double multi_mmc(const uint8_t *s, size_t len, unsigned int bits, void *work)
+{
+    dict_table ctxs, pairs;
+    uint32_t entries[MMC_DEPTH + 1] = {0};
+    uint32_t hash[MMC_DEPTH + 2], prev[MMC_DEPTH + 2];
+    int predictions[MMC_DEPTH];
+    scoreboard board;
+    predictor_tally t;
+
+    work = dict_init(&ctxs, work, mmc_entries(len));
+    dict_init(&pairs, work, mmc_entries(len));
+    memset(&board, 0, sizeof(board));
+    memset(&t, 0, sizeof(t));
+    dict_hashes(s, 1, MMC_DEPTH + 1, prev);
+
+    for (size_t i = 2; i < len; i++)
+    {
+        unsigned int y = s[i - 1];
+        dict_hashes(s, i, MMC_DEPTH + 1, hash);
+
+        /*Models of order d learn that the d samples before s[i - 1] are followed by it*/
+        for (unsigned int d = 1; d <= MMC_DEPTH && d < i; d++)
+        {
+            uint32_t start = (uint32_t)(i - 1 - d);
+            dict_slot *pair = dict_find(&pairs, s, start, d + 1, hash[d + 1]);
+            if (pair->len == 0)
+            {
+                if (entries[d] >= MMC_MAX_ENTRIES)
+                {
+                    continue;
+                }
+                entries[d]++;
+                pairs.used++;
+                pair->start = start;
+                pair->len = (uint8_t)(d + 1);
+            }
+            dict_slot *ctx = dict_find(&ctxs, s, start, d, prev[d]);
+            if (ctx->len == 0)
+            {
+                ctxs.used++;
+                ctx->start = start;
+                ctx->len = (uint8_t)d;
+            }
+            dict_count(ctx, pair, y);
+        }
+
+        /*and predict the successor of the last d samples*/
+        for (unsigned int d = 1; d <= MMC_DEPTH; d++)
+        {
+            dict_slot *ctx = d <= i ? dict_find(&ctxs, s, (uint32_t)(i - d), d, hash[d]) : NULL;
+            predictions[d - 1] = ctx != NULL && ctx->len != 0 ? ctx->best : -1;
+        }
+        tally(&t, predictions[board.winner] == s[i]);
+        score(&board, predictions, MMC_DEPTH, s[i]);
+        memcpy(prev, hash, sizeof(hash));
+    }
+
+    return predictor_entropy(&t, bits);
+}
+
+/*Successor counts of LZ78Y, at most one per context and value and never more than the bound
+  (reached only by data far from random and far from constant, the counts then stop growing)*/
+static size_t lz78y_pairs(size_t len, unsigned int bits)
+{
+    size_t pairs = (size_t)LZ78Y_MAX_CONTEXTS << bits;
+    pairs = pairs < LZ78Y_DEPTH * len ? pairs : LZ78Y_DEPTH * len;
+    return pairs < LZ78Y_MAX_PAIRS ? pairs : LZ78Y_MAX_PAIRS;
+}
+
+/*6.3.10, a dictionary of up to 65536 contexts of 1 to 16 samples, the prediction is the most
+  common successor with the highest count over all contexts, longer contexts first*/
+static double lz78y(const uint8_t *s, size_t len, unsigned int bits, void *work)
+{
+    dict_table ctxs, pairs;
+    uint32_t hash[LZ78Y_DEPTH + 2], prev[LZ78Y_DEPTH + 2];
+    size_t max_pairs = lz78y_pairs(len, bits);
+    predictor_tally t;
+
+    work = dict_init(&ctxs, work, LZ78Y_MAX_CONTEXTS);
+    dict_init(&pairs, work, max_pairs);
+    memset(&t, 0, sizeof(t));
+    dict_hashes(s, LZ78Y_DEPTH, LZ78Y_DEPTH + 1, prev);
+
+    for (size_t i = LZ78Y_DEPTH + 1; i < len; i++)
+    {
+        unsigned int y = s[i - 1];
+        dict_hashes(s, i, LZ78Y_DEPTH + 1, hash);
+
+        for (unsigned int j = LZ78Y_DEPTH; j >= 1; j--)
+        {
+            uint32_t start = (uint32_t)(i - 1 - j);
+            dict_slot *ctx = dict_find(&ctxs, s, start, j, prev[j]);
+            if (ctx->len == 0)
+            {
+                if (ctxs.used >= LZ78Y_MAX_CONTEXTS)
+                {
+                    continue;
+                }
+                ctxs.used++;
+                ctx->start = start;
+                ctx->len = (uint8_t)j;
+            }
+            dict_slot *pair = dict_find(&pairs, s, start, j + 1, hash[j + 1]);
+            if (pair->len == 0)
+            {
+                if (pairs.used >= max_pairs)
+                {
+                    continue;
+                }
+                pairs.used++;
+                pair->start = start;
+                pair->len = (uint8_t)(j + 1);
+            }
+            dict_count(ctx, pair, y);
+        }
+
+        int prediction = -1;
+        uint32_t max_count = 0;
+        for (unsigned int j = LZ78Y_DEPTH; j >= 1; j--)
+        {
+            dict_slot *ctx = dict_find(&ctxs, s, (uint32_t)(i - j), j, hash[j]);
+            if (ctx->len != 0 && ctx->count > max_count)
+            {
+                prediction = ctx->best;
+                max_count = ctx->count;
+            }
+        }
+        tally(&t, prediction == s[i]);
+        memcpy(prev, hash, sizeof(hash));
+    }
+
+    return predictor_entropy(&t, bits);
+}
+
+size_t trng_entropy_work_size(int estimator, size_t len, unsigned int bits)
+{
+    switch (estimator)
+    {
+    case TRNG_ENTROPY_TTUPLE:
+    case TRNG_ENTROPY_LRS:
+        return tuple_work_size(len);
+    case TRNG_ENTROPY_MULTI_MCW:
+        return sizeof(mcw_window) * MCW_WINDOWS;
+    case TRNG_ENTROPY_MULTI_MMC:
+        return 2 * sizeof(dict_slot) * dict_slots(mmc_entries(len));
+    case TRNG_ENTROPY_LZ78Y:
+        return sizeof(dict_slot) * (dict_slots(LZ78Y_MAX_CONTEXTS) + dict_slots(lz78y_pairs(len, bits)));
+    default:
+        return 0;
+    }
+}
+
+double trng_entropy_estimate(int estimator, const uint8_t *samples, size_t len, unsigned int bits,
+                             void *work, size_t work_len)
+{
+    if (bits < 1 || bits > 8 || len < 2 || len >= 0xffffffffUL ||
+        (trng_entropy_binary_only(estimator) && bits != 1) ||
+        (trng_entropy_work_size(estimator, len, bits) != 0 &&
+         (work == NULL || work_len < trng_entropy_work_size(estimator, len, bits))))
+    {
+        return TRNG_ENTROPY_NA;
+    }
+
+    double t_tuple, lrs;
+
+    switch (estimator)
+    {
+    case TRNG_ENTROPY_MCV:
+        return most_common_value(samples, len);
+    case TRNG_ENTROPY_COLLISION:
+        return collision(samples, len);
+    case TRNG_ENTROPY_MARKOV:
+        return markov(samples, len);
+    case TRNG_ENTROPY_COMPRESSION:
+        return compression(samples, len);
+    case TRNG_ENTROPY_TTUPLE:
+    case TRNG_ENTROPY_LRS:
+        trng_entropy_tuples(samples, len, bits, work, work_len, &t_tuple, &lrs);
+        return estimator == TRNG_ENTROPY_TTUPLE ? t_tuple : lrs;
+    case TRNG_ENTROPY_MULTI_MCW:
+        return multi_mcw(samples, len, bits, work);
+    case TRNG_ENTROPY_LAG:
+        return lag(samples, len, bits);
+    case TRNG_ENTROPY_MULTI_MMC:
+        return multi_mmc(samples, len, bits, work);
+    case TRNG_ENTROPY_LZ78Y:
+        return lz78y(samples, len, bits, work);
+    default:
+        return TRNG_ENTROPY_NA;
+    }
+}
+
+size_t trng_entropy_bitstring(const uint8_t *samples, size_t len, unsigned int bits,
+                              uint8_t *out, size_t max_bits)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < len && n < max_bits; i++)
+    {
+        for (int b = (int)bits - 1; b >= 0 && n < max_bits; b--)
+        {
+            out[n++] = (samples[i] >> b) & 1;
+        }
+    }
+
+    return n;
+}
+
+int trng_entropy_binary_only(int estimator)
+{
+    return estimator == TRNG_ENTROPY_COLLISION || estimator == TRNG_ENTROPY_MARKOV ||
+           estimator == TRNG_ENTROPY_COMPRESSION;
+}
+
+const char *trng_entropy_name(int estimator)
+{
+    return estimator >= 0 && estimator < TRNG_ENTROPY_ESTIMATORS ? estimator_names[estimator] : "";
+}
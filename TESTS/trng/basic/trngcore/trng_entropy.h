@@ -0,0 +1,84 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Min-entropy estimators of NIST SP 800-90B section 6.3 for non-IID sources,
+* run on a buffer of samples of 1 to 8 bits (one sample per byte, as read
+* from trng_get_bytes and masked to the sample size):
+*
+*   most common value, collision, Markov, compression, t-tuple, longest
+*   repeated substring (LRS) and the MultiMCW, Lag, MultiMMC and LZ78Y
+*   predictors.
+*
+* Collision, Markov and compression only apply to binary samples, 90B runs
+* them on the bit string of wider samples (trng_entropy_bitstring) and takes
+* the smaller of the estimate per sample and bits times the estimate per bit.
+*
+* Nothing is allocated, every estimator works in a caller supplied buffer of
+* trng_entropy_work_size bytes. The t-tuple and LRS counts come from one
+* suffix array and its LCP intervals (O(n log n) instead of counting every
+* tuple length), the MultiMMC and LZ78Y dictionaries are open addressed hash
+* tables of positions in the samples. Estimators are independent, so hosts
+* can run them on separate threads.
+*/
+
+#ifndef TRNG_ENTROPY_H
+#define TRNG_ENTROPY_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+enum {
+    TRNG_ENTROPY_MCV,
+    TRNG_ENTROPY_COLLISION,
+    TRNG_ENTROPY_MARKOV,
+    TRNG_ENTROPY_COMPRESSION,
+    TRNG_ENTROPY_TTUPLE,
+    TRNG_ENTROPY_LRS,
+    TRNG_ENTROPY_MULTI_MCW,
+    TRNG_ENTROPY_LAG,
+    TRNG_ENTROPY_MULTI_MMC,
+    TRNG_ENTROPY_LZ78Y,
+    TRNG_ENTROPY_ESTIMATORS
+};
+
+#define TRNG_ENTROPY_NA             -1.0        //estimator does not apply or there are too few samples
+
+/*Bytes of work buffer estimator needs for len samples of bits bits, aligned for a uint64_t*/
+size_t trng_entropy_work_size(int estimator, size_t len, unsigned int bits);
+
+/*Min-entropy in bits per sample of len samples by estimator, TRNG_ENTROPY_NA if it does not
+  apply (collision, Markov and compression on samples of more than a bit), the samples are too
+  few for it or work_len is below trng_entropy_work_size*/
+double trng_entropy_estimate(int estimator, const uint8_t *samples, size_t len, unsigned int bits,
+                             void *work, size_t work_len);
+
+/*The t-tuple and LRS estimates from a single suffix array, work as for TRNG_ENTROPY_TTUPLE*/
+void trng_entropy_tuples(const uint8_t *samples, size_t len, unsigned int bits,
+                         void *work, size_t work_len, double *t_tuple, double *lrs);
+
+/*Write the bits of the samples, most significant first, one per byte into out, at most
+  max_bits of them. Returns the number written*/
+size_t trng_entropy_bitstring(const uint8_t *samples, size_t len, unsigned int bits,
+                              uint8_t *out, size_t max_bits);
+
+/*Nonzero for the estimators that only apply to binary samples*/
+int trng_entropy_binary_only(int estimator);
+
+/*Name of estimator*/
+const char *trng_entropy_name(int estimator);
+
+#endif
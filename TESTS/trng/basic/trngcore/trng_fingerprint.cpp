@@ -0,0 +1,192 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_fingerprint.h"
+
+#include <math.h>
+#include <string.h>
+
+#define HASH_BASE       0x100000001b3ULL
+#define PROBE_MUL       6364136223846793005ULL
+#define PROBE_ADD       1442695040888963407ULL
+
+/*Finalizer of MurmurHash3, the polynomial hash alone has weak low bits*/
+static uint64_t mix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/*Bit positions are the top bits of a linear congruential sequence started at the hash, so
+  every probe has log2_bits bits of its own (double hashing would leave two windows colliding
+  in all probes as soon as two probes collide)*/
+static bool filter_test(const trng_fingerprint *fp, const uint8_t *filter, uint64_t h)
+{
+    uint32_t shift = 64 - fp->header->cfg.log2_bits;
+    for (uint32_t i = 0; i < fp->header->cfg.hashes; i++)
+    {
+        uint32_t bit = (uint32_t)(h >> shift);
+        if (!(filter[bit >> 3] & (1 << (bit & 7))))
+        {
+            return false;
+        }
+        h = h * PROBE_MUL + PROBE_ADD;
+    }
+    return true;
+}
+
+static void filter_set(const trng_fingerprint *fp, uint8_t *filter, uint64_t h)
+{
+    uint32_t shift = 64 - fp->header->cfg.log2_bits;
+    for (uint32_t i = 0; i < fp->header->cfg.hashes; i++)
+    {
+        uint32_t bit = (uint32_t)(h >> shift);
+        filter[bit >> 3] |= (uint8_t)(1 << (bit & 7));
+        h = h * PROBE_MUL + PROBE_ADD;
+    }
+}
+
+void trng_fingerprint_config_default(trng_fingerprint_config *cfg)
+{
+    cfg->window = 16;
+    cfg->stride = 8;
+    cfg->log2_bits = 12;
+    cfg->hashes = 16;
+    cfg->generation_boots = 16;
+}
+
+size_t trng_fingerprint_size(const trng_fingerprint_config *cfg)
+{
+    if (cfg->window < 4 || cfg->stride < 1 || cfg->stride > cfg->window ||
+        cfg->log2_bits < 6 || cfg->log2_bits > 24 || cfg->hashes < 1 || cfg->hashes > 16 ||
+        cfg->generation_boots < 1)
+    {
+        return 0;
+    }
+    return TRNG_FINGERPRINT_SIZE(cfg->log2_bits);
+}
+
+double trng_fingerprint_false_positive(const trng_fingerprint_config *cfg, size_t boot_len)
+{
+    if (boot_len < cfg->window)
+    {
+        return 0.0;
+    }
+
+    /*A window is reported when all its bits are set in either filter*/
+    double windows = (double)cfg->generation_boots * (double)((boot_len - cfg->window) / cfg->stride + 1);
+    double bits = (double)((uint32_t)1 << cfg->log2_bits);
+    double one = pow(1.0 - exp(-(double)cfg->hashes * windows / bits), (double)cfg->hashes);
+    return 1.0 - (1.0 - one) * (1.0 - one);
+}
+
+int trng_fingerprint_open(trng_fingerprint *fp, const trng_fingerprint_config *cfg, void *image, size_t len)
+{
+    size_t size = trng_fingerprint_size(cfg);
+    if (size == 0 || len < size)
+    {
+        return -1;
+    }
+
+    trng_fingerprint_header *header = (trng_fingerprint_header *)image;
+    size_t filter_len = ((size_t)1 << cfg->log2_bits) / 8;
+    fp->header = header;
+    fp->filter[0] = (uint8_t *)image + sizeof(*header);
+    fp->filter[1] = fp->filter[0] + filter_len;
+    fp->mask = ((uint32_t)1 << cfg->log2_bits) - 1;
+    fp->top = 1;
+    for (uint32_t i = 1; i < cfg->window; i++)
+    {
+        fp->top *= HASH_BASE;
+    }
+
+    if (header->magic == TRNG_FINGERPRINT_MAGIC && memcmp(&header->cfg, cfg, sizeof(*cfg)) == 0 &&
+        header->active < 2 && header->boots[0] <= cfg->generation_boots && header->boots[1] <= cfg->generation_boots)
+    {
+        return TRNG_FINGERPRINT_LOADED;
+    }
+
+    memset(image, 0, size);
+    header->magic = TRNG_FINGERPRINT_MAGIC;
+    header->cfg = *cfg;
+    return 0;
+}
+
+uint32_t trng_fingerprint_check(const trng_fingerprint *fp, const uint8_t *data, size_t len, size_t *first_match)
+{
+    const trng_fingerprint_header *header = fp->header;
+    uint32_t window = header->cfg.window, matches = 0;
+    bool have0 = header->boots[0] != 0, have1 = header->boots[1] != 0;
+    uint64_t h = 0;
+
+    if (first_match != NULL)
+    {
+        *first_match = len;
+    }
+    if (len < window || (!have0 && !have1))
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < window - 1; i++)
+    {
+        h = h * HASH_BASE + data[i];
+    }
+    for (size_t pos = 0; pos + window <= len; pos++)
+    {
+        h = h * HASH_BASE + data[pos + window - 1];
+        uint64_t m = mix(h);
+        if ((have0 && filter_test(fp, fp->filter[0], m)) || (have1 && filter_test(fp, fp->filter[1], m)))
+        {
+            if (matches++ == 0 && first_match != NULL)
+            {
+                *first_match = pos;
+            }
+        }
+        h -= data[pos] * fp->top;
+    }
+    return matches;
+}
+
+void trng_fingerprint_add(trng_fingerprint *fp, const uint8_t *data, size_t len)
+{
+    trng_fingerprint_header *header = fp->header;
+    uint32_t window = header->cfg.window, stride = header->cfg.stride;
+
+    if (header->boots[header->active] == header->cfg.generation_boots)
+    {
+        header->active ^= 1;
+        header->boots[header->active] = 0;
+        memset(fp->filter[header->active], 0, (size_t)(fp->mask + 1) / 8);
+    }
+
+    uint8_t *filter = fp->filter[header->active];
+    for (size_t pos = 0; pos + window <= len; pos += stride)
+    {
+        uint64_t h = 0;
+        for (uint32_t i = 0; i < window; i++)
+        {
+            h = h * HASH_BASE + data[pos + i];
+        }
+        filter_set(fp, filter, mix(h));
+    }
+    header->boots[header->active]++;
+    header->total_boots++;
+}
@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Fingerprint index of the trng output of previous boots, to find a source
+* that comes back to a seed it had some boots ago. The output of a boot is
+* cut into windows of a few bytes, a rolling hash of every window is
+* recorded in a Bloom filter, and the output of a new boot is looked up
+* window by window against it before it is added: one hash update and a few
+* bit tests per byte, however many boots are recorded.
+*
+* Windows starting every stride bytes are recorded and windows at every
+* offset are looked up, so a repeated run of window + stride - 1 bytes or
+* more is found wherever it sits in the output. There are two filters of a
+* fixed size: boots are added to one until it holds generation_boots of
+* them, then the other one is cleared and takes its place. Lookups test both,
+* the index remembers the last generation_boots + 1 to 2 * generation_boots
+* boots, and neither the size nor the false positive rate grow with the
+* number of boots.
+*
+* All of the state (a header and the two filters) is a caller supplied image
+* that can be stored as it is, the device test keeps it in NVStore.
+*/
+
+#ifndef TRNG_FINGERPRINT_H
+#define TRNG_FINGERPRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRNG_FINGERPRINT_MAGIC      0x31504654  //"TFP1"
+#define TRNG_FINGERPRINT_LOADED     1           //trng_fingerprint_open found an index recorded with the same config
+
+typedef struct {
+    uint32_t window;                    //bytes per window, at least 4
+    uint32_t stride;                    //distance of the windows recorded, 1 to window
+    uint32_t log2_bits;                 //log2 of the bits of each filter, 6 to 24
+    uint32_t hashes;                    //bits per window in a filter, 1 to 16
+    uint32_t generation_boots;          //boots per filter
+} trng_fingerprint_config;
+
+/*Start of the image, every field is stored*/
+typedef struct {
+    uint32_t magic;
+    trng_fingerprint_config cfg;
+    uint32_t active;                    //filter boots are added to
+    uint32_t boots[2];                  //boots recorded in each filter
+    uint32_t total_boots;               //boots added since the image was formatted
+} trng_fingerprint_header;
+
+typedef struct {
+    trng_fingerprint_header *header;
+    uint8_t *filter[2];
+    uint32_t mask;                      //bits per filter - 1
+    uint64_t top;                       //weight of the byte leaving the window
+} trng_fingerprint;
+
+/*Image size for filters of 2^log2_bits bits, and a static arena of that size:
+*   TRNG_FINGERPRINT_ARENA(arena, 12);
+*/
+#define TRNG_FINGERPRINT_SIZE(log2_bits) \
+    (sizeof(trng_fingerprint_header) + 2 * (((size_t)1 << (log2_bits)) / 8))
+#define TRNG_FINGERPRINT_ARENA(name, log2_bits) \
+    static uint32_t name[(TRNG_FINGERPRINT_SIZE(log2_bits) + sizeof(uint32_t) - 1) / sizeof(uint32_t)]
+
+/*Windows of 16 bytes recorded every 8, 16 boots per generation and filters of 4096 bits with
+  16 bits per window (about 1 KB of image)*/
+void trng_fingerprint_config_default(trng_fingerprint_config *cfg);
+
+/*Image size needed for cfg, 0 if cfg is not supported*/
+size_t trng_fingerprint_size(const trng_fingerprint_config *cfg);
+
+/*Probability that a window no boot had is reported as seen, when both filters are full with
+  boots of boot_len bytes each*/
+double trng_fingerprint_false_positive(const trng_fingerprint_config *cfg, size_t boot_len);
+
+/*Attach fp to image (len bytes, 4 byte aligned). An image that holds an index recorded with the
+  same config is kept and TRNG_FINGERPRINT_LOADED returned, anything else (an empty or erased
+  image, another config) is formatted to an empty index and 0 returned. Returns -1 if cfg is not
+  supported or len is too small*/
+int trng_fingerprint_open(trng_fingerprint *fp, const trng_fingerprint_config *cfg, void *image, size_t len);
+
+/*Number of windows of data (every offset) found in the recorded boots, false positives
+  included. *first_match (may be NULL) is set to the offset of the first one, or len*/
+uint32_t trng_fingerprint_check(const trng_fingerprint *fp, const uint8_t *data, size_t len, size_t *first_match);
+
+/*Record data as the output of one more boot, retiring the oldest generation when the
+  current one is full*/
+void trng_fingerprint_add(trng_fingerprint *fp, const uint8_t *data, size_t len);
+
+#endif
@@ -0,0 +1,305 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_health.h"
+#include "trng_trace.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__aarch64__)
+# include <arm_neon.h>
+#endif
+
+#define STARTUP_CHUNK       64          //bytes drawn at a time for the start up tests
+
+void trng_health_config_default(trng_health_config *cfg, double h, unsigned int alpha_log2)
+{
+    /*90B 4.4.1, a run of C values has probability 2^-(h (C - 1)) <= alpha*/
+    cfg->rct_cutoff = 1 + (uint32_t)ceil((double)alpha_log2 / h);
+    cfg->apt_window = TRNG_HEALTH_WINDOW;
+    cfg->apt_cutoff = trng_health_apt_cutoff(cfg->apt_window, h, alpha_log2);
+    cfg->startup_bytes = TRNG_HEALTH_STARTUP_BYTES;
+    cfg->on_failure = NULL;
+    cfg->ctx = NULL;
+}
+
+uint32_t trng_health_apt_cutoff(uint32_t window, double h, unsigned int alpha_log2)
+{
+    /*Smallest k with P(X <= k) >= 1 - alpha for X ~ B(window, p), the probability mass summed in
+      logs from k = 0 so probabilities close to 1 don't underflow*/
+    double p = pow(2.0, -h), alpha = ldexp(1.0, -(int)alpha_log2);
+    if (p >= 1.0)
+    {
+        return window;
+    }
+
+    double log_mass = window * log1p(-p), log_odds = log(p) - log1p(-p), cdf = 0.0;
+    for (uint32_t k = 0; k < window; k++)
+    {
+        cdf += exp(log_mass);
+        if (cdf >= 1.0 - alpha)
+        {
+            return 1 + k;
+        }
+        log_mass += log((double)(window - k) / (double)(k + 1)) + log_odds;
+    }
+
+    return window;
+}
+
+void trng_health_start(trng_health *h, const trng_health_config *cfg)
+{
+    h->cfg = *cfg;
+    h->rct_value = 0;
+    h->rct_run = 0;
+    h->apt_value = 0;
+    h->apt_count = 0;
+    h->apt_left = 0;
+    memset(&h->counters, 0, sizeof(h->counters));
+}
+
+int trng_health_init(trng_health *h, const trng_health_config *cfg)
+{
+    uint8_t chunk[STARTUP_CHUNK];
+    int res = 0;
+
+    trng_init(&h->trng);
+    trng_health_start(h, cfg);
+    for (uint32_t done = 0; done < cfg->startup_bytes; done += sizeof(chunk))
+    {
+        size_t len = cfg->startup_bytes - done < sizeof(chunk) ? cfg->startup_bytes - done : sizeof(chunk);
+        int fill = trng_health_fill(h, chunk, len);
+        res = res ? res : fill;
+        if (fill != 0 && fill != TRNG_HEALTH_FAILED)
+        {
+            break;
+        }
+    }
+
+    return res;
+}
+
+static void report(trng_health *h, int test)
+{
+    if (test == TRNG_HEALTH_RCT)
+    {
+        h->counters.rct_failures++;
+    }
+    else
+    {
+        h->counters.apt_failures++;
+    }
+    if (h->cfg.on_failure != NULL)
+    {
+        h->cfg.on_failure(test, &h->counters, h->cfg.ctx);
+    }
+}
+
+/*
+* Both tests go over the input in blocks of BLOCK bytes, compared with SSE2
+* or NEON where the target has them. A block inside a window, with no three
+* equal bytes in a row and too few bytes to bring the window count to the
+* cutoff only ends the current run and adds to the count. The rest (blocks
+* with a longer repeat or close to the cutoff, bytes up to a block boundary
+* of the window) is walked byte by byte. A failing run or window is reported
+* once, when it reaches the cutoff.
+*/
+
+#define BLOCK               16
+
+#define REPEAT_PAIR         1           //a byte of the block equals the one before it
+#define REPEAT_TRIPLE       2           //and that one the byte before it, both in the block
+#define REPEAT_FIRST        4           //the first byte equals the byte before the block
+#define REPEAT_LAST         8           //the last byte equals the one before it
+
+static inline unsigned int repeat_flags(uint32_t pairs, uint32_t triples, uint32_t first, uint32_t last)
+{
+    return (pairs ? REPEAT_PAIR : 0) | (triples ? REPEAT_TRIPLE : 0) | (first ? REPEAT_FIRST : 0) | (last ? REPEAT_LAST : 0);
+}
+
+static inline unsigned int block_repeats(const uint8_t *p)
+{
+#if defined(__SSE2__)
+    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), _mm_loadu_si128((const __m128i *)(p - 1)));
+    uint32_t m = (uint32_t)_mm_movemask_epi8(eq);
+    return m ? repeat_flags(m, m & (m << 1), m & 1, m & 0x8000) : 0;
+#elif defined(__aarch64__)
+    /*4 bits per byte*/
+    uint8x16_t eq = vceqq_u8(vld1q_u8(p), vld1q_u8(p - 1));
+    uint64_t m = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(eq), 4)), 0);
+    return m ? repeat_flags(1, (m & (m << 4)) != 0, m & 0xf, (m >> 60) != 0) : 0;
+#else
+    uint32_t m = 0;
+    for (int j = 0; j < BLOCK; j++)
+    {
+        m |= (uint32_t)(p[j] == p[j - 1]) << j;
+    }
+    return m ? repeat_flags(m, m & (m << 1), m & 1, m & 0x8000) : 0;
+#endif
+}
+
+/*Bytes of the block equal to value*/
+static inline unsigned int block_count(const uint8_t *p, uint8_t value)
+{
+#if defined(__SSE2__)
+    __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), _mm_set1_epi8((char)value));
+    __m128i sum = _mm_sad_epu8(_mm_sub_epi8(_mm_setzero_si128(), eq), _mm_setzero_si128());
+    return (unsigned int)(_mm_cvtsi128_si32(sum) + _mm_extract_epi16(sum, 4));
+#elif defined(__aarch64__)
+    return vaddvq_u8(vandq_u8(vceqq_u8(vld1q_u8(p), vdupq_n_u8(value)), vdupq_n_u8(1)));
+#else
+    unsigned int count = 0;
+    for (int j = 0; j < BLOCK; j++)
+    {
+        count += p[j] == value;
+    }
+    return count;
+#endif
+}
+
+int trng_health_feed(trng_health *h, const uint8_t *buf, size_t len)
+{
+    const uint32_t rct_cutoff = h->cfg.rct_cutoff, apt_cutoff = h->cfg.apt_cutoff, window = h->cfg.apt_window;
+    uint8_t rct_value = h->rct_value, apt_value = h->apt_value;
+    uint32_t run = h->rct_run, count = h->apt_count, left = h->apt_left;
+    uint32_t longest = h->counters.longest_run, highest = h->counters.highest_count;
+    uint64_t start = h->counters.bytes;
+    int res = 0;
+
+    for (size_t i = 0; i < len;)
+    {
+        unsigned int repeats;
+        if (i > 0 && len - i >= BLOCK &&
+            (left == 0 ? window >= BLOCK && apt_cutoff > BLOCK : left >= BLOCK && count + BLOCK < apt_cutoff) &&
+            ((repeats = block_repeats(buf + i)) == 0 ||
+             (!(repeats & REPEAT_TRIPLE) && rct_cutoff > 2 && (!(repeats & REPEAT_FIRST) || run + 1 < rct_cutoff))))
+        {
+            /*No run of three inside the block, the run before it grows by at most one*/
+            run += (repeats & REPEAT_FIRST) ? 1 : 0;
+            longest = run > longest ? run : longest;
+            longest = (repeats & REPEAT_PAIR) && longest < 2 ? 2 : longest;
+            rct_value = buf[i + BLOCK - 1];
+            run = (repeats & REPEAT_LAST) ? 2 : 1;
+
+            if (left == 0)
+            {
+                highest = count > highest ? count : highest;
+                apt_value = buf[i];
+                count = 0;
+                left = window;
+                h->counters.apt_windows++;
+            }
+            count += block_count(buf + i, apt_value);
+            left -= BLOCK;
+            i += BLOCK;
+            continue;
+        }
+
+        /*Byte by byte through the block, or up to where the window is a whole number of blocks
+          from its end*/
+        size_t n = left % BLOCK ? left % BLOCK : BLOCK;
+        for (size_t end = i + (n < len - i ? n : len - i); i < end; i++)
+        {
+            uint8_t b = buf[i];
+
+            if (b != rct_value)
+            {
+                longest = run > longest ? run : longest;
+                rct_value = b;
+                run = 1;
+            }
+            else if (++run == rct_cutoff)
+            {
+                h->counters.bytes = start + i + 1;
+                h->counters.longest_run = run > longest ? run : longest;
+                h->counters.highest_count = count > highest ? count : highest;
+                report(h, TRNG_HEALTH_RCT);
+                res = TRNG_HEALTH_FAILED;
+            }
+
+            if (left == 0)
+            {
+                highest = count > highest ? count : highest;
+                apt_value = b;
+                count = 1;
+                left = window - 1;
+                h->counters.apt_windows++;
+            }
+            else
+            {
+                left--;
+                if (b == apt_value && ++count == apt_cutoff)
+                {
+                    h->counters.bytes = start + i + 1;
+                    h->counters.longest_run = run > longest ? run : longest;
+                    h->counters.highest_count = count > highest ? count : highest;
+                    report(h, TRNG_HEALTH_APT);
+                    res = TRNG_HEALTH_FAILED;
+                }
+            }
+        }
+    }
+
+    h->rct_value = rct_value;
+    h->rct_run = run;
+    h->apt_value = apt_value;
+    h->apt_count = count;
+    h->apt_left = left;
+    h->counters.bytes = start + len;
+    h->counters.longest_run = run > longest ? run : longest;
+    h->counters.highest_count = count > highest ? count : highest;
+    return res;
+}
+
+int trng_health_get_bytes(trng_health *h, uint8_t *output, size_t length, size_t *output_length)
+{
+    TRNG_TRACE_BEGIN(start);
+    int res = trng_get_bytes(&h->trng, output, length, output_length);
+    TRNG_TRACE_END(TRNG_TRACE_GET_BYTES, start, res == 0 ? *output_length : 0);
+    if (res != 0)
+    {
+        return res;
+    }
+
+    return trng_health_feed(h, output, *output_length);
+}
+
+int trng_health_fill(trng_health *h, uint8_t *buf, size_t len)
+{
+    int failed = 0;
+
+    for (size_t pos = 0; pos < len;)
+    {
+        size_t got = 0;
+        int res = trng_health_get_bytes(h, buf + pos, len - pos, &got);
+        if (res != 0 && res != TRNG_HEALTH_FAILED)
+        {
+            return res;
+        }
+        failed |= res == TRNG_HEALTH_FAILED;
+        pos += got;
+    }
+
+    return failed ? TRNG_HEALTH_FAILED : 0;
+}
+
+void trng_health_free(trng_health *h)
+{
+    trng_free(&h->trng);
+}
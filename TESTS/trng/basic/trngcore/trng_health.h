@@ -0,0 +1,109 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Continuous health tests of NIST SP 800-90B section 4.4 on the trng output,
+* as a wrapper of trng_init, trng_get_bytes and trng_free. Every byte
+* produced is one sample of the repetition count test (a run of the same
+* value) and of the adaptive proportion test (the first value of a window
+* showing up too often in it). Both are a few compares per byte with a
+* constant amount of state, 0.2 to 0.7 ns per byte on an x86-64 host. That
+* is 7 to 17% more time than reading /dev/urandom and 6 to 10 times a copy
+* from memory, and about 0.1% of a trng delivering 2 MB/s (trng_bench
+* health).
+*
+* Cutoffs follow from the min-entropy claimed for the source and the false
+* positive rate alpha = 2^-alpha_log2, trng_health_config_default computes
+* them as 90B does. On a failure the callback is called, the counters record
+* it and the call producing the sample returns TRNG_HEALTH_FAILED, the bytes
+* it delivered should be discarded.
+*/
+
+#ifndef TRNG_HEALTH_H
+#define TRNG_HEALTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hal/trng_api.h"
+
+#define TRNG_HEALTH_RCT             0           //repetition count test
+#define TRNG_HEALTH_APT             1           //adaptive proportion test
+
+#define TRNG_HEALTH_FAILED          -2          //a health test failed on the bytes of the call
+
+#define TRNG_HEALTH_STARTUP_BYTES   1024        //samples the start up tests of 90B 4.3 run on
+#define TRNG_HEALTH_WINDOW          512         //adaptive proportion window for non binary samples
+
+typedef struct {
+    uint64_t bytes;                     //samples tested
+    uint64_t rct_failures;
+    uint64_t apt_failures;
+    uint64_t apt_windows;               //adaptive proportion windows completed
+    uint32_t longest_run;               //longest run of one value
+    uint32_t highest_count;             //highest count of the first value in a window
+} trng_health_counters;
+
+typedef void (*trng_health_cb)(int test, const trng_health_counters *counters, void *ctx);
+
+typedef struct {
+    uint32_t rct_cutoff;                //run length that fails the repetition count test
+    uint32_t apt_cutoff;                //count in a window that fails the adaptive proportion test
+    uint32_t apt_window;                //samples per window
+    uint32_t startup_bytes;             //samples tested and discarded by trng_health_init
+    trng_health_cb on_failure;          //may be NULL
+    void *ctx;
+} trng_health_config;
+
+typedef struct {
+    trng_t trng;
+    trng_health_config cfg;
+    uint8_t rct_value;
+    uint32_t rct_run;
+    uint8_t apt_value;
+    uint32_t apt_count;
+    uint32_t apt_left;                  //samples left in the window, 0 - the next one starts one
+    trng_health_counters counters;
+} trng_health;
+
+/*Cutoffs for h bits of min-entropy per byte (0 < h <= 8) and a false positive rate of
+  2^-alpha_log2 per test (90B recommends 20 to 40), window of TRNG_HEALTH_WINDOW and
+  TRNG_HEALTH_STARTUP_BYTES start up samples, no callback*/
+void trng_health_config_default(trng_health_config *cfg, double h, unsigned int alpha_log2);
+
+/*Adaptive proportion cutoff of 90B 4.4.2, 1 + the critical binomial value of window samples of
+  probability 2^-h at 1 - 2^-alpha_log2*/
+uint32_t trng_health_apt_cutoff(uint32_t window, double h, unsigned int alpha_log2);
+
+/*Reset the tests and counters of h to cfg without touching the trng, for trng_health_feed*/
+void trng_health_start(trng_health *h, const trng_health_config *cfg);
+
+/*trng_init the trng of h, start the tests and run the start up tests on cfg->startup_bytes of output, which is dropped.
+  Returns 0, the trng_get_bytes error or TRNG_HEALTH_FAILED*/
+int trng_health_init(trng_health *h, const trng_health_config *cfg);
+
+/*trng_get_bytes through the health tests. Returns 0, the trng_get_bytes error or
+  TRNG_HEALTH_FAILED if a test failed on the bytes delivered*/
+int trng_health_get_bytes(trng_health *h, uint8_t *output, size_t length, size_t *output_length);
+
+/*Fill buf with len bytes as trng_core_fill does, through the health tests*/
+int trng_health_fill(trng_health *h, uint8_t *buf, size_t len);
+
+/*Run len bytes obtained elsewhere through the tests of h, returns 0 or TRNG_HEALTH_FAILED*/
+int trng_health_feed(trng_health *h, const uint8_t *buf, size_t len);
+
+void trng_health_free(trng_health *h);
+
+#endif
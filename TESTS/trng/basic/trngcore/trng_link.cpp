@@ -0,0 +1,201 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_link.h"
+#include "trng_core.h"
+
+#include <string.h>
+
+/*Header offsets*/
+#define FRAME_MAGIC     0
+#define FRAME_TYPE      2
+#define FRAME_FLAGS     3
+#define FRAME_SEQ       4
+#define FRAME_LEN       8
+#define FRAME_CRC       12
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint32_t frame_crc(const uint8_t *frame, uint32_t payload)
+{
+    return trng_core_crc32(trng_core_crc32(0, frame, FRAME_CRC), frame + TRNG_LINK_HEADER, payload);
+}
+
+static void frame_seal(uint8_t *frame, uint8_t type, uint32_t seq, uint32_t payload)
+{
+    frame[FRAME_MAGIC] = (uint8_t)TRNG_LINK_MAGIC;
+    frame[FRAME_MAGIC + 1] = (uint8_t)(TRNG_LINK_MAGIC >> 8);
+    frame[FRAME_TYPE] = type;
+    frame[FRAME_FLAGS] = 0;
+    put32(frame + FRAME_SEQ, seq);
+    put32(frame + FRAME_LEN, payload);
+    put32(frame + FRAME_CRC, frame_crc(frame, payload));
+}
+
+/*Payload length of a valid frame of type, -1 if it is not one*/
+static int frame_check(const uint8_t *frame, size_t len, uint8_t type)
+{
+    if (len < TRNG_LINK_HEADER || (frame[FRAME_MAGIC] | frame[FRAME_MAGIC + 1] << 8) != TRNG_LINK_MAGIC ||
+        frame[FRAME_TYPE] != type || get32(frame + FRAME_LEN) != len - TRNG_LINK_HEADER ||
+        get32(frame + FRAME_CRC) != frame_crc(frame, (uint32_t)(len - TRNG_LINK_HEADER)))
+    {
+        return -1;
+    }
+    return (int)(len - TRNG_LINK_HEADER);
+}
+
+static uint8_t *slot(const trng_link_tx *tx, uint32_t seq)
+{
+    return tx->frames + (size_t)(seq % tx->cfg.window) * (TRNG_LINK_HEADER + tx->cfg.frame_len);
+}
+
+static int send_slot(trng_link_tx *tx, uint32_t seq)
+{
+    uint8_t *frame = slot(tx, seq);
+    tx->stats.frames++;
+    return tx->cfg.send(tx->cfg.ctx, frame, TRNG_LINK_HEADER + get32(frame + FRAME_LEN)) == 0 ? 0 : TRNG_LINK_ERR_SEND;
+}
+
+int trng_link_tx_init(trng_link_tx *tx, const trng_link_tx_config *cfg, uint8_t *buf, size_t buf_len)
+{
+    if (cfg->frame_len == 0 || cfg->frame_len > 0xffff || cfg->window == 0 || cfg->send == NULL ||
+        buf == NULL || buf_len < TRNG_LINK_TX_SIZE(cfg->window, cfg->frame_len))
+    {
+        return TRNG_LINK_ERR_CONFIG;
+    }
+    memset(tx, 0, sizeof(*tx));
+    tx->cfg = *cfg;
+    tx->frames = buf;
+    return 0;
+}
+
+uint32_t trng_link_tx_in_flight(const trng_link_tx *tx)
+{
+    return tx->next - tx->acked;
+}
+
+int trng_link_tx_window_full(const trng_link_tx *tx)
+{
+    return tx->next - tx->acked == tx->cfg.window;
+}
+
+int trng_link_tx_flush(trng_link_tx *tx)
+{
+    if (tx->fill == 0)
+    {
+        return 0;
+    }
+    frame_seal(slot(tx, tx->next), TRNG_LINK_DATA, tx->next, tx->fill);
+    tx->fill = 0;
+    return send_slot(tx, tx->next++);
+}
+
+int trng_link_tx_write(trng_link_tx *tx, const uint8_t *data, size_t len)
+{
+    size_t taken = 0;
+    while (taken < len && !trng_link_tx_window_full(tx))
+    {
+        size_t n = tx->cfg.frame_len - tx->fill;
+        n = n < len - taken ? n : len - taken;
+        memcpy(slot(tx, tx->next) + TRNG_LINK_HEADER + tx->fill, data + taken, n);
+        tx->fill += (uint32_t)n;
+        taken += n;
+        if (tx->fill == tx->cfg.frame_len && trng_link_tx_flush(tx) != 0)
+        {
+            return TRNG_LINK_ERR_SEND;
+        }
+    }
+    return (int)taken;
+}
+
+int trng_link_tx_ack(trng_link_tx *tx, const uint8_t *frame, size_t len)
+{
+    if (frame_check(frame, len, TRNG_LINK_ACK) != 0)
+    {
+        return TRNG_LINK_ERR_FRAME;
+    }
+
+    /*The receiver can't be behind what was acknowledged or ahead of what was sent*/
+    uint32_t expected = get32(frame + FRAME_SEQ);
+    if (expected - tx->acked > tx->next - tx->acked)
+    {
+        return TRNG_LINK_ERR_ACK;
+    }
+    for (; tx->acked != expected; tx->acked++)
+    {
+        tx->stats.bytes += get32(slot(tx, tx->acked) + FRAME_LEN);
+    }
+    tx->stats.acks++;
+
+    /*Everything sent before the ACK was asked for has arrived or is lost*/
+    int resent = 0;
+    for (uint32_t seq = expected; seq != tx->next; seq++, resent++)
+    {
+        tx->stats.resent++;
+        if (send_slot(tx, seq) != 0)
+        {
+            return TRNG_LINK_ERR_SEND;
+        }
+    }
+    return resent;
+}
+
+void trng_link_rx_init(trng_link_rx *rx, trng_link_deliver_fn deliver, void *ctx)
+{
+    memset(rx, 0, sizeof(*rx));
+    rx->deliver = deliver;
+    rx->ctx = ctx;
+}
+
+int trng_link_rx_frame(trng_link_rx *rx, const uint8_t *frame, size_t len)
+{
+    int payload = frame_check(frame, len, TRNG_LINK_DATA);
+    if (payload < 0)
+    {
+        rx->damaged++;
+        return TRNG_LINK_ERR_FRAME;
+    }
+    if (get32(frame + FRAME_SEQ) != rx->expected)
+    {
+        rx->out_of_sequence++;
+        return TRNG_LINK_ERR_SEQUENCE;
+    }
+
+    rx->expected++;
+    rx->frames++;
+    rx->bytes += (uint32_t)payload;
+    if (rx->deliver != NULL)
+    {
+        rx->deliver(rx->ctx, frame + TRNG_LINK_HEADER, (size_t)payload);
+    }
+    return 0;
+}
+
+void trng_link_rx_ack(const trng_link_rx *rx, uint8_t *out)
+{
+    frame_seal(out, TRNG_LINK_ACK, rx->expected, 0);
+}
@@ -0,0 +1,128 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Framed transport of bulk trng output from the device to the host. Data is
+* cut into frames of up to frame_len bytes, each with a 16 byte little
+* endian header (magic, type, sequence number, length and the CRC-32 of
+* header and payload), and up to window frames are sent before the sender
+* asks for an acknowledgement. The receiver takes frames in sequence only,
+* drops anything damaged or out of order, and answers with an ACK frame
+* carrying the sequence number it expects next. As the channel keeps order,
+* every frame sent before the ACK was asked for has arrived by then, so the
+* sender resends everything from the acknowledged sequence number on at once
+* (go back N) and needs no timers.
+*
+* Frames are handed to a send callback and ACKs come back through
+* trng_link_tx_ack, so the transport underneath can be anything: the device
+* test carries frames base64 encoded in greentea messages of a few KB, the
+* host checks a lossy loopback. The sender keeps the frames of a window in a
+* caller supplied buffer for resending.
+*/
+
+#ifndef TRNG_LINK_H
+#define TRNG_LINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRNG_LINK_MAGIC             0x4c54      //"TL"
+#define TRNG_LINK_HEADER            16          //bytes of the frame header
+#define TRNG_LINK_DATA              1           //frame types
+#define TRNG_LINK_ACK               2
+
+#define TRNG_LINK_ERR_CONFIG        -1          //bad config or buffer too small
+#define TRNG_LINK_ERR_SEND          -2          //the send callback failed
+#define TRNG_LINK_ERR_FRAME         -3          //bad magic, length or CRC
+#define TRNG_LINK_ERR_SEQUENCE      -4          //frame out of sequence, dropped
+#define TRNG_LINK_ERR_ACK           -5          //ACK of a sequence number never sent
+
+/*Buffer of a sender of window frames of frame_len bytes*/
+#define TRNG_LINK_TX_SIZE(window, frame_len)    ((size_t)(window) * (TRNG_LINK_HEADER + (size_t)(frame_len)))
+
+/*Hands a frame to the transport, returns 0 when it was sent*/
+typedef int (*trng_link_send_fn)(void *ctx, const uint8_t *frame, size_t len);
+
+/*Receives the payload of every frame accepted, in order*/
+typedef void (*trng_link_deliver_fn)(void *ctx, const uint8_t *data, size_t len);
+
+typedef struct {
+    uint32_t frame_len;                 //payload bytes per frame, up to 65535
+    uint32_t window;                    //frames sent before an ACK is needed
+    trng_link_send_fn send;
+    void *ctx;
+} trng_link_tx_config;
+
+typedef struct {
+    uint64_t frames;                    //frames sent, resent ones included
+    uint64_t resent;                    //frames sent again after an ACK
+    uint64_t bytes;                     //payload bytes acknowledged
+    uint64_t acks;
+} trng_link_tx_stats;
+
+typedef struct {
+    trng_link_tx_config cfg;
+    uint8_t *frames;                    //window slots of TRNG_LINK_HEADER + frame_len bytes
+    uint32_t acked;                     //oldest sequence number not acknowledged
+    uint32_t next;                      //sequence number of the frame being filled
+    uint32_t fill;                      //payload bytes in the frame being filled
+    trng_link_tx_stats stats;
+} trng_link_tx;
+
+typedef struct {
+    uint32_t expected;                  //sequence number the receiver takes next
+    uint64_t frames;                    //frames accepted
+    uint64_t bytes;                     //payload bytes delivered
+    uint64_t damaged;                   //frames dropped for a bad header or CRC
+    uint64_t out_of_sequence;           //frames dropped for their sequence number
+    trng_link_deliver_fn deliver;
+    void *ctx;
+} trng_link_rx;
+
+/*Set up a sender over buf (TRNG_LINK_TX_SIZE(cfg->window, cfg->frame_len) bytes). Returns 0 or
+  TRNG_LINK_ERR_CONFIG*/
+int trng_link_tx_init(trng_link_tx *tx, const trng_link_tx_config *cfg, uint8_t *buf, size_t buf_len);
+
+/*Copy up to len bytes of data into frames, sending each one as it fills. Returns the number of
+  bytes taken, fewer than len when the window is full (an ACK is needed before the rest can be
+  taken), or TRNG_LINK_ERR_SEND*/
+int trng_link_tx_write(trng_link_tx *tx, const uint8_t *data, size_t len);
+
+/*Send the frame being filled, if it holds any data. Returns 0, or TRNG_LINK_ERR_SEND*/
+int trng_link_tx_flush(trng_link_tx *tx);
+
+/*Frames sent and not acknowledged yet*/
+uint32_t trng_link_tx_in_flight(const trng_link_tx *tx);
+
+/*Whether the window is full and trng_link_tx_write takes no more data before an ACK*/
+int trng_link_tx_window_full(const trng_link_tx *tx);
+
+/*Take an ACK frame of the receiver, asked for after the last frame was sent: frames before its
+  sequence number are released and the ones from it on are sent again. Returns the number of
+  frames resent, TRNG_LINK_ERR_FRAME, TRNG_LINK_ERR_ACK or TRNG_LINK_ERR_SEND*/
+int trng_link_tx_ack(trng_link_tx *tx, const uint8_t *frame, size_t len);
+
+/*Set up a receiver delivering to deliver*/
+void trng_link_rx_init(trng_link_rx *rx, trng_link_deliver_fn deliver, void *ctx);
+
+/*Take a frame: the payload of the frame expected next is delivered and 0 returned, anything
+  else is dropped with TRNG_LINK_ERR_FRAME or TRNG_LINK_ERR_SEQUENCE*/
+int trng_link_rx_frame(trng_link_rx *rx, const uint8_t *frame, size_t len);
+
+/*Write the ACK frame of the receiver's state (TRNG_LINK_HEADER bytes) to out*/
+void trng_link_rx_ack(const trng_link_rx *rx, uint8_t *out);
+
+#endif
@@ -0,0 +1,77 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_lzf.h"
+#include <string.h>
+
+extern "C" {
+#include "lzfP.h"
+}
+
+/*The switches of lzfP.h as this build sets them, for the default variant*/
+#if ULTRA_FAST
+#define TRNG_LZF_BUILD_SPEED            TRNG_LZF_ULTRA_FAST
+#elif VERY_FAST
+#define TRNG_LZF_BUILD_SPEED            TRNG_LZF_VERY_FAST
+#else
+#define TRNG_LZF_BUILD_SPEED            TRNG_LZF_NORMAL
+#endif
+#if STRICT_ALIGN
+#define TRNG_LZF_BUILD_UNALIGNED        false
+#else
+#define TRNG_LZF_BUILD_UNALIGNED        true
+#endif
+#if INIT_HTAB
+#define TRNG_LZF_BUILD_CLEAR            true
+#else
+#define TRNG_LZF_BUILD_CLEAR            false
+#endif
+
+typedef trng_lzf_variant<8, TRNG_LZF_VERY_FAST, false, false> trng_lzf_device;
+typedef trng_lzf_variant<HLOG, TRNG_LZF_BUILD_SPEED, TRNG_LZF_BUILD_UNALIGNED, TRNG_LZF_BUILD_CLEAR> trng_lzf_default;
+typedef trng_lzf_variant<14, TRNG_LZF_ULTRA_FAST, true, false> trng_lzf_fast;
+typedef trng_lzf_variant<16, TRNG_LZF_NORMAL, true, true> trng_lzf_ratio;
+
+static const trng_lzf_info trng_lzf_variants[TRNG_LZF_VARIANTS] = {
+    { "device",  trng_lzf_device::hlog,  trng_lzf_device::state_size,  trng_lzf_device::compress },
+    { "default", trng_lzf_default::hlog, trng_lzf_default::state_size, trng_lzf_default::compress },
+    { "fast",    trng_lzf_fast::hlog,    trng_lzf_fast::state_size,    trng_lzf_fast::compress },
+    { "ratio",   trng_lzf_ratio::hlog,   trng_lzf_ratio::state_size,   trng_lzf_ratio::compress },
+};
+
+const trng_lzf_info *trng_lzf_variant_info(int id)
+{
+    return id >= 0 && id < TRNG_LZF_VARIANTS ? &trng_lzf_variants[id] : NULL;
+}
+
+int trng_lzf_variant_find(const char *name)
+{
+    for (int id = 0; id < TRNG_LZF_VARIANTS; id++)
+    {
+        if (strcmp(trng_lzf_variants[id].name, name) == 0)
+        {
+            return id;
+        }
+    }
+    return -1;
+}
+
+unsigned int trng_lzf_compress(int id, const uint8_t *in, unsigned int in_len,
+                               uint8_t *out, unsigned int out_len, uint32_t *htab)
+{
+    const trng_lzf_info *info = trng_lzf_variant_info(id);
+    return info != NULL ? info->compress(in, in_len, out, out_len, htab) : 0;
+}
@@ -0,0 +1,250 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Compressor variants: the lzf_compress algorithm of lzf_c.c as a template,
+* with the switches lzfP.h sets once per build (HLOG, VERY_FAST, ULTRA_FAST,
+* STRICT_ALIGN, INIT_HTAB) as template arguments, so differently tuned
+* compressors live in one binary and are picked per call. Every variant
+* writes the lzf format, lzf_decompress reads all of them; the default one
+* gives the output of lzf_compress byte for byte.
+*
+* The table holds 32 bit offsets into the input whatever the pointer size,
+* TRNG_LZF_STATE_SIZE(hlog) bytes.
+*/
+
+#ifndef TRNG_LZF_H
+#define TRNG_LZF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+extern "C" {
+#include "lzf_match.h"
+}
+
+#define TRNG_LZF_STATE_SIZE(hlog)       ((size_t)4 << (hlog))
+
+/*How much of a match goes back into the table, and the hash that goes with it, as lzfP.h*/
+#define TRNG_LZF_NORMAL                 0       //every position of the match
+#define TRNG_LZF_VERY_FAST              1       //its last two positions
+#define TRNG_LZF_ULTRA_FAST             2       //its last position, and a cheaper hash
+
+/*Variants selectable per call*/
+#define TRNG_LZF_DEVICE                 0       //256 slots, no unaligned loads, for small inputs in little RAM
+#define TRNG_LZF_DEFAULT                1       //the lzf_compress of this build
+#define TRNG_LZF_FAST                   2       //ULTRA_FAST with unaligned loads, for throughput
+#define TRNG_LZF_RATIO                  3       //64K slots and every match position hashed, for ratio
+#define TRNG_LZF_VARIANTS               4
+
+/*
+* HLOG           log2 of the table slots
+* SPEED          one of TRNG_LZF_NORMAL, TRNG_LZF_VERY_FAST, TRNG_LZF_ULTRA_FAST
+* UNALIGNED      compare the first two bytes with one 16 bit load and extend matches with the
+*                kernel of lzf_match.h (STRICT_ALIGN 0), else byte by byte (STRICT_ALIGN 1)
+* CLEAR          clear the table on every call (INIT_HTAB 1), else slots of earlier calls are
+*                left to the offset checks and the output depends on them
+*/
+template <unsigned int HLOG, int SPEED, bool UNALIGNED, bool CLEAR>
+struct trng_lzf_variant
+{
+    enum { hlog = HLOG, hsize = 1 << HLOG, state_size = 4 << HLOG };
+
+    static unsigned int index(unsigned int h)
+    {
+        if (SPEED == TRNG_LZF_ULTRA_FAST)
+        {
+            return ((h >> (3 * 8 - HLOG)) - h) & (hsize - 1);
+        }
+        if (SPEED == TRNG_LZF_VERY_FAST)
+        {
+            return ((h >> (3 * 8 - HLOG)) - h * 5) & (hsize - 1);
+        }
+        return (((h ^ (h << 5)) >> (3 * 8 - HLOG)) - h * 5) & (hsize - 1);
+    }
+
+    static bool same2(const uint8_t *a, const uint8_t *b)
+    {
+        if (UNALIGNED)
+        {
+            uint16_t x, y;
+            memcpy(&x, a, 2);
+            memcpy(&y, b, 2);
+            return x == y;
+        }
+        return a[0] == b[0] && a[1] == b[1];
+    }
+
+    /*lzf_compress with a table of hsize 32 bit slots*/
+    static unsigned int compress(const uint8_t *in, unsigned int in_len,
+                                 uint8_t *out, unsigned int out_len, uint32_t *htab)
+    {
+        const unsigned int max_lit = 1 << 5, max_off = 1 << 13, max_ref = (1 << 8) + (1 << 3);
+        const uint8_t *ip = in;
+        const uint8_t *in_end = in + in_len;
+        uint8_t *op = out;
+        uint8_t *out_end = out + out_len;
+        unsigned int hval;
+        unsigned int lit = 0;
+
+        if (in_len == 0 || out_len == 0)
+        {
+            return 0;
+        }
+        if (CLEAR)
+        {
+            memset(htab, 0, state_size);
+        }
+
+        op++; //start run
+        hval = in_len > 1 ? (unsigned int)((ip[0] << 8) | ip[1]) : 0;
+        while (in_len > 2 && ip < in_end - 2)
+        {
+            hval = (hval << 8) | ip[2];
+            unsigned int hidx = index(hval);
+            const uint8_t *ref = in + htab[hidx];
+            htab[hidx] = (uint32_t)(ip - in);
+            unsigned long off = (unsigned long)(ip - ref - 1);
+
+            /*Stale slots point at or past ip, off wraps and the first test drops them*/
+            if (off < max_off && ref > in && ref[2] == ip[2] && same2(ref, ip))
+            {
+                unsigned int maxlen = (unsigned int)(in_end - ip) - 2;
+                maxlen = maxlen > max_ref ? max_ref : maxlen;
+
+                if (op + 3 + 1 >= out_end && op - !lit + 3 + 1 >= out_end)
+                {
+                    return 0;
+                }
+
+                op[-(int)lit - 1] = (uint8_t)(lit - 1); //stop run
+                op -= !lit;                             //undo run if length is zero
+
+                unsigned int len = UNALIGNED ? lzf_match_len(ref, ip, maxlen)
+                                             : lzf_match_len_unrolled(ref, ip, maxlen);
+                len -= 2;                               //len is now #octets - 1
+                ip++;
+
+                if (len < 7)
+                {
+                    *op++ = (uint8_t)((off >> 8) + (len << 5));
+                }
+                else
+                {
+                    *op++ = (uint8_t)((off >> 8) + (7 << 5));
+                    *op++ = (uint8_t)(len - 7);
+                }
+                *op++ = (uint8_t)off;
+
+                lit = 0;
+                op++; //start run
+                ip += len + 1;
+
+                if (ip >= in_end - 2)
+                {
+                    break;
+                }
+
+                /*Positions inside the match go back into the table as SPEED says*/
+                if (SPEED == TRNG_LZF_NORMAL)
+                {
+                    ip -= len + 1;
+                    do
+                    {
+                        hval = (hval << 8) | ip[2];
+                        htab[index(hval)] = (uint32_t)(ip - in);
+                        ip++;
+                    }
+                    while (len--);
+                }
+                else
+                {
+                    ip -= SPEED == TRNG_LZF_VERY_FAST ? 2 : 1;
+                    hval = (unsigned int)((ip[0] << 8) | ip[1]);
+                    hval = (hval << 8) | ip[2];
+                    htab[index(hval)] = (uint32_t)(ip - in);
+                    ip++;
+                    if (SPEED == TRNG_LZF_VERY_FAST)
+                    {
+                        hval = (hval << 8) | ip[2];
+                        htab[index(hval)] = (uint32_t)(ip - in);
+                        ip++;
+                    }
+                }
+            }
+            else
+            {
+                if (op >= out_end)
+                {
+                    return 0;
+                }
+
+                lit++;
+                *op++ = *ip++;
+                if (lit == max_lit)
+                {
+                    op[-(int)lit - 1] = (uint8_t)(lit - 1);
+                    lit = 0;
+                    op++;
+                }
+            }
+        }
+
+        if (op + 3 > out_end) //at most 3 bytes can be missing here
+        {
+            return 0;
+        }
+
+        while (ip < in_end)
+        {
+            lit++;
+            *op++ = *ip++;
+            if (lit == max_lit)
+            {
+                op[-(int)lit - 1] = (uint8_t)(lit - 1);
+                lit = 0;
+                op++;
+            }
+        }
+
+        op[-(int)lit - 1] = (uint8_t)(lit - 1); //end run
+        op -= !lit;
+        return (unsigned int)(op - out);
+    }
+};
+
+typedef struct {
+    const char *name;
+    unsigned int hlog;
+    size_t state_size;                  //bytes of table the variant needs
+    unsigned int (*compress)(const uint8_t *in, unsigned int in_len,
+                             uint8_t *out, unsigned int out_len, uint32_t *htab);
+} trng_lzf_info;
+
+/*The variant with the id, NULL for an unknown one*/
+const trng_lzf_info *trng_lzf_variant_info(int id);
+
+/*Id of the variant called name, -1 if there is none*/
+int trng_lzf_variant_find(const char *name);
+
+/*Compress in_len bytes into at most out_len bytes of out with the variant id, htab holds the
+  state_size bytes of the variant aligned for a uint32_t. Returns the compressed size, or 0
+  if the data does not fit (the data looks random) or id is unknown*/
+unsigned int trng_lzf_compress(int id, const uint8_t *in, unsigned int in_len,
+                               uint8_t *out, unsigned int out_len, uint32_t *htab);
+
+#endif
@@ -0,0 +1,418 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_model.h"
+#include "trng_bits.h"
+
+#include <math.h>
+#include <string.h>
+
+#define RANS_SCALE_BITS                 12
+#define RANS_SCALE                      (1U << RANS_SCALE_BITS)
+#define RANS_L                          (1U << 23)          //lower end of the coder state
+
+#define MODEL_ONE                       65536               //probabilities of the context model, 16 bit
+#define MODEL_COUNT_MAX                 127                 //rate stops falling at 1 / (count + 1.5)
+#define MODEL_RANGE_BITS                47                  //the coded range is kept in [2^47, 2^48)
+
+/*65536 / (count + 1.5), the step of a slot seen count times before*/
+static const uint16_t rate_table[MODEL_COUNT_MAX + 1] = {
+    43691, 26214, 18725, 14564, 11916, 10082, 8738, 7710, 6899, 6242, 5699, 5243, 4855, 4520, 4228, 3972,
+    3745, 3542, 3361, 3197, 3048, 2913, 2789, 2675, 2570, 2473, 2383, 2300, 2222, 2149, 2081, 2016,
+    1956, 1900, 1846, 1796, 1748, 1702, 1659, 1618, 1579, 1542, 1507, 1473, 1440, 1409, 1380, 1351,
+    1324, 1298, 1273, 1248, 1225, 1202, 1181, 1160, 1140, 1120, 1101, 1083, 1066, 1049, 1032, 1016,
+    1001, 986, 971, 957, 943, 930, 917, 904, 892, 880, 868, 857, 846, 835, 824, 814,
+    804, 794, 785, 776, 767, 758, 749, 741, 732, 724, 716, 708, 701, 694, 686, 679,
+    672, 665, 659, 652, 646, 639, 633, 627, 621, 615, 610, 604, 599, 593, 588, 583,
+    577, 572, 567, 563, 558, 553, 548, 544, 539, 535, 531, 526, 522, 518, 514, 510
+};
+
+size_t trng_model_state_size(int kind, unsigned int hlog, unsigned int max_len)
+{
+    switch (kind)
+    {
+    case TRNG_MODEL_ORDER0:
+        return 5 * 256 * sizeof(uint32_t);
+    case TRNG_MODEL_ORDERK:
+        return hlog >= TRNG_MODEL_HLOG_MIN && hlog <= TRNG_MODEL_HLOG_MAX ? sizeof(uint32_t) << hlog : 0;
+    case TRNG_MODEL_RANS:
+        return ((size_t)TRNG_RANS_BOUND(max_len) + 3) & ~(size_t)3;
+    default:
+        return 0;
+    }
+}
+
+int trng_model_init(trng_model *model, int kind, unsigned int order, unsigned int hlog,
+                    unsigned int max_len, void *arena, size_t arena_len)
+{
+    size_t size = trng_model_state_size(kind, hlog, max_len);
+    if (size == 0 || arena == NULL || arena_len < size || (kind == TRNG_MODEL_ORDERK && order > TRNG_MODEL_ORDER_MAX))
+    {
+        return -1;
+    }
+
+    model->kind = kind;
+    model->order = order;
+    model->hlog = hlog;
+    model->state = (uint32_t *)arena;
+    model->state_len = size;
+    return 0;
+}
+
+void trng_model_histogram(const uint8_t *in, size_t len, uint32_t *lanes, uint32_t hist[256])
+{
+    uint32_t *l0 = lanes, *l1 = lanes + 256, *l2 = lanes + 512, *l3 = lanes + 768;
+    size_t i = 0;
+
+    memset(lanes, 0, 4 * 256 * sizeof(uint32_t));
+    for (; i + 8 <= len; i += 8)
+    {
+        uint32_t a, b;
+        memcpy(&a, in + i, 4);
+        memcpy(&b, in + i + 4, 4);
+        l0[a & 0xff]++;
+        l1[(a >> 8) & 0xff]++;
+        l2[(a >> 16) & 0xff]++;
+        l3[a >> 24]++;
+        l0[b & 0xff]++;
+        l1[(b >> 8) & 0xff]++;
+        l2[(b >> 16) & 0xff]++;
+        l3[b >> 24]++;
+    }
+    for (; i < len; i++)
+    {
+        l0[in[i]]++;
+    }
+    for (int s = 0; s < 256; s++)
+    {
+        hist[s] = l0[s] + l1[s] + l2[s] + l3[s];
+    }
+}
+
+double trng_model_order0_bits(const uint32_t hist[256], uint64_t len)
+{
+    /*Code length of the Krichevsky-Trofimov estimator over 256 symbols, -log2 of the probability
+      the Dirichlet(1/2) mixture gives the counts*/
+    double nats = lgamma((double)len + 128.0) - lgamma(128.0);
+    for (int s = 0; s < 256; s++)
+    {
+        if (hist[s] != 0)
+        {
+            nats -= lgamma((double)hist[s] + 0.5) - lgamma(0.5);
+        }
+    }
+    return nats / log(2.0);
+}
+
+static unsigned int screen_order0(trng_model *model, const uint8_t *in, unsigned int in_len, unsigned int out_len)
+{
+    uint32_t *hist = model->state + 4 * 256;
+    trng_model_histogram(in, in_len, model->state, hist);
+    double bits = trng_model_order0_bits(hist, in_len);
+    double est = ceil(bits / 8.0) + TRNG_MODEL_FLUSH;
+    return est <= (double)out_len ? (unsigned int)est : 0;
+}
+
+/*Codes one bit with the probability of slot, shrinking range by it, and moves the slot toward the bit*/
+static inline void orderk_bit(uint32_t *slot, uint32_t bit, uint64_t *range)
+{
+    uint32_t mask = 0 - bit;
+    uint32_t p = *slot & 0xffff;
+    uint32_t n = *slot >> 16;
+
+    /*Masks, not branches, which would mispredict every other bit of random data. p if the bit is 1,
+      MODEL_ONE - p if 0, and the step is rate of 65535 - p up or of p down*/
+    *range = (*range * ((p ^ ~mask) - ~mask + (~mask & MODEL_ONE))) >> 16;
+    uint32_t step = (((p ^ mask) & 0xffff) * rate_table[n]) >> 16;
+    p += (step ^ ~mask) - ~mask;
+    n += n < MODEL_COUNT_MAX;
+    *slot = (n << 16) | p;
+}
+
+/*Scales range back up to MODEL_RANGE_BITS, returns the whole bits taken out*/
+static inline uint32_t orderk_renorm(uint64_t *range)
+{
+    uint32_t s = (uint32_t)trng_clz64(*range) - (63 - MODEL_RANGE_BITS);
+    *range <<= s;
+    return s;
+}
+
+static unsigned int screen_orderk(trng_model *model, const uint8_t *in, unsigned int in_len, unsigned int out_len)
+{
+    uint32_t *slots = model->state;
+    uint32_t slot_count = 1U << model->hlog;
+    uint32_t ctx_bits = model->hlog - 8;
+    uint32_t ctx_mask = model->order >= 4 ? 0xffffffffU : (1U << (8 * model->order)) - 1;
+    uint64_t limit = out_len > TRNG_MODEL_FLUSH ? (uint64_t)(out_len - TRNG_MODEL_FLUSH) * 8 : 0;
+    uint64_t r0 = 1ULL << MODEL_RANGE_BITS, r1 = r0, r2 = r0, r3 = r0;
+    uint64_t shifts = 0;
+    uint32_t history = 0;
+
+    if (limit == 0)
+    {
+        return 0;
+    }
+
+    /*p = 1/2, not seen yet*/
+    for (uint32_t i = 0; i < slot_count; i++)
+    {
+        slots[i] = MODEL_ONE / 2;
+    }
+
+    /*The cost is taken as an arithmetic coder would: a range shrinks by the probability of every
+      bit and is scaled back up by whole bits, the cost is the bits shifted less log2 of what is
+      left, no logarithm per bit. One range would chain the multiply of every bit to the next, so
+      four take two bits of each byte apiece and are scaled once a byte; two bits take at most 32
+      of the 48, p being at least 1 / 65536. Each leaves under a bit uncounted until the end*/
+    for (unsigned int i = 0; i < in_len; i++)
+    {
+        uint32_t c = in[i];
+        uint32_t t = c | 0x100;
+        uint32_t base = ctx_bits != 0 ? (((history & ctx_mask) * 0x9e3779b1U) >> (32 - ctx_bits)) << 8 : 0;
+
+        /*The bits of a byte from the top, each under the bits above it: node t >> (b + 1) for bit b*/
+        orderk_bit(&slots[base | (t >> 8)], (c >> 7) & 1, &r0);
+        orderk_bit(&slots[base | (t >> 7)], (c >> 6) & 1, &r1);
+        orderk_bit(&slots[base | (t >> 6)], (c >> 5) & 1, &r2);
+        orderk_bit(&slots[base | (t >> 5)], (c >> 4) & 1, &r3);
+        orderk_bit(&slots[base | (t >> 4)], (c >> 3) & 1, &r0);
+        orderk_bit(&slots[base | (t >> 3)], (c >> 2) & 1, &r1);
+        orderk_bit(&slots[base | (t >> 2)], (c >> 1) & 1, &r2);
+        orderk_bit(&slots[base | (t >> 1)], c & 1, &r3);
+        shifts += orderk_renorm(&r0) + orderk_renorm(&r1) + orderk_renorm(&r2) + orderk_renorm(&r3);
+
+        history = (history << 8) | c;
+        if (shifts > limit + 4)
+        {
+            return 0;
+        }
+    }
+
+    double left = log2((double)r0) + log2((double)r1) + log2((double)r2) + log2((double)r3) - 4.0 * MODEL_RANGE_BITS;
+    double est = ceil(((double)shifts - left) / 8.0) + TRNG_MODEL_FLUSH;
+    return est <= (double)out_len ? (unsigned int)est : 0;
+}
+
+unsigned int trng_model_screen(trng_model *model, const uint8_t *in, unsigned int in_len, unsigned int out_len)
+{
+    if (in_len == 0 || out_len == 0)
+    {
+        return 0;
+    }
+
+    switch (model->kind)
+    {
+    case TRNG_MODEL_ORDER0:
+        return screen_order0(model, in, in_len, out_len);
+    case TRNG_MODEL_ORDERK:
+        return screen_orderk(model, in, in_len, out_len);
+    case TRNG_MODEL_RANS:
+        if (TRNG_RANS_BOUND((size_t)in_len) > model->state_len)
+        {
+            return 0;
+        }
+        return trng_rans_encode(in, in_len, (uint8_t *)model->state,
+                                out_len < model->state_len ? out_len : (unsigned int)model->state_len);
+    default:
+        return 0;
+    }
+}
+
+/*Scale the counts of len bytes to frequencies summing to RANS_SCALE, every byte seen keeps at least 1*/
+static void rans_normalize(const uint32_t hist[256], uint32_t len, uint16_t freq[256])
+{
+    int32_t sum = 0;
+    int largest = 0;
+
+    for (int s = 0; s < 256; s++)
+    {
+        uint32_t f = hist[s] ? (uint32_t)(((uint64_t)hist[s] * RANS_SCALE) / len) : 0;
+        freq[s] = (uint16_t)(hist[s] && f == 0 ? 1 : f);
+        sum += freq[s];
+        largest = freq[s] > freq[largest] ? s : largest;
+    }
+
+    /*Rounding left a few out or put a few too many in, the largest take them from the rest*/
+    int32_t diff = (int32_t)RANS_SCALE - sum;
+    while (diff < 0)
+    {
+        int32_t take = -diff < freq[largest] / 2 ? -diff : freq[largest] / 2;
+        freq[largest] = (uint16_t)(freq[largest] - take);
+        diff += take;
+        for (int s = 0; s < 256; s++)
+        {
+            largest = freq[s] > freq[largest] ? s : largest;
+        }
+    }
+    freq[largest] = (uint16_t)(freq[largest] + diff);
+}
+
+unsigned int trng_rans_encode(const uint8_t *in, unsigned int in_len, uint8_t *out, unsigned int out_len)
+{
+    uint32_t hist[256];
+    uint16_t freq[256], cum[256];
+    unsigned int pos = 32;
+
+    if (in_len == 0 || out_len < 32)
+    {
+        return 0;
+    }
+
+    memset(hist, 0, sizeof(hist));
+    for (unsigned int i = 0; i < in_len; i++)
+    {
+        hist[in[i]]++;
+    }
+    rans_normalize(hist, in_len, freq);
+
+    /*Table: a bitmap of the bytes seen, then their frequencies less 1 in one or two bytes*/
+    memset(out, 0, 32);
+    uint16_t start = 0;
+    for (int s = 0; s < 256; s++)
+    {
+        cum[s] = start;
+        start = (uint16_t)(start + freq[s]);
+        if (freq[s] == 0)
+        {
+            continue;
+        }
+
+        unsigned int v = freq[s] - 1u;
+        out[s >> 3] |= (uint8_t)(1 << (s & 7));
+        if (pos + 2 > out_len)
+        {
+            return 0;
+        }
+        if (v < 0x80)
+        {
+            out[pos++] = (uint8_t)v;
+        }
+        else
+        {
+            out[pos++] = (uint8_t)(0x80 | (v & 0x7f));
+            out[pos++] = (uint8_t)(v >> 7);
+        }
+    }
+
+    /*rANS codes backwards, the output grows down from the end of the buffer towards the table*/
+    uint8_t *lo = out + pos;
+    uint8_t *ptr = out + out_len;
+    uint32_t x = RANS_L;
+    for (unsigned int i = in_len; i-- > 0;)
+    {
+        uint32_t f = freq[in[i]];
+        uint32_t x_max = ((RANS_L >> RANS_SCALE_BITS) << 8) * f;
+        while (x >= x_max)
+        {
+            if (ptr == lo)
+            {
+                return 0;
+            }
+            *--ptr = (uint8_t)x;
+            x >>= 8;
+        }
+        x = ((x / f) << RANS_SCALE_BITS) + (x % f) + cum[in[i]];
+    }
+
+    if (ptr - lo < TRNG_MODEL_FLUSH)
+    {
+        return 0;
+    }
+    ptr -= 4;
+    ptr[0] = (uint8_t)x;
+    ptr[1] = (uint8_t)(x >> 8);
+    ptr[2] = (uint8_t)(x >> 16);
+    ptr[3] = (uint8_t)(x >> 24);
+
+    unsigned int len = (unsigned int)(out + out_len - ptr);
+    memmove(lo, ptr, len);
+    return pos + len;
+}
+
+unsigned int trng_rans_decode(const uint8_t *in, unsigned int in_len, uint8_t *out, unsigned int out_len)
+{
+    uint8_t slot_sym[RANS_SCALE];
+    uint16_t freq[256], cum[256];
+    const uint8_t *ip = in + 32;
+    const uint8_t *end = in + in_len;
+    uint32_t start = 0;
+
+    if (in_len < 32 + TRNG_MODEL_FLUSH || out_len == 0)
+    {
+        return 0;
+    }
+
+    for (int s = 0; s < 256; s++)
+    {
+        freq[s] = 0;
+        cum[s] = (uint16_t)start;
+        if ((in[s >> 3] >> (s & 7) & 1) == 0)
+        {
+            continue;
+        }
+
+        if (ip >= end)
+        {
+            return 0;
+        }
+        uint32_t v = *ip++;
+        if (v & 0x80)
+        {
+            if (ip >= end)
+            {
+                return 0;
+            }
+            v = (v & 0x7f) | ((uint32_t)*ip++ << 7);
+        }
+        if (start + v + 1 > RANS_SCALE)
+        {
+            return 0;
+        }
+        freq[s] = (uint16_t)(v + 1);
+        memset(slot_sym + start, s, freq[s]);
+        start += freq[s];
+    }
+    if (start != RANS_SCALE || end - ip < TRNG_MODEL_FLUSH)
+    {
+        return 0;
+    }
+
+    uint32_t x = ip[0] | (uint32_t)ip[1] << 8 | (uint32_t)ip[2] << 16 | (uint32_t)ip[3] << 24;
+    ip += 4;
+    if (x < RANS_L)
+    {
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < out_len; i++)
+    {
+        uint32_t slot = x & (RANS_SCALE - 1);
+        uint8_t s = slot_sym[slot];
+        out[i] = s;
+        x = freq[s] * (x >> RANS_SCALE_BITS) + slot - cum[s];
+        while (x < RANS_L)
+        {
+            if (ip >= end)
+            {
+                return 0;
+            }
+            x = (x << 8) | *ip++;
+        }
+    }
+
+    /*The encoder started from RANS_L and every byte of it was read*/
+    return x == RANS_L && ip == end ? out_len : 0;
+}
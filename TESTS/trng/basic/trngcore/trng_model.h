@@ -0,0 +1,104 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Compressibility by entropy coding, a second checker next to lzf. LZF only
+* finds strings of 3 or more bytes repeated within 8 KB, a source with
+* biased bits and no repeated strings goes through it. The models here give
+* the size an entropy coder would write for a chunk and take the same
+* threshold as trng_core_screen: the estimate is returned when it fits
+* out_len, 0 when it does not (the data looks random).
+*
+*   TRNG_MODEL_ORDER0   byte histogram, priced as an adaptive order-0 coder
+*                       (Krichevsky-Trofimov) would code it, with no table
+*                       to send. The histogram is taken 8 bytes at a time
+*                       into 4 interleaved tables, so repeated bytes don't
+*                       stall on the same counter.
+*   TRNG_MODEL_ORDERK   adaptive binary context model: every bit is coded
+*                       with the probability of the bits above it in the
+*                       byte and of the last order bytes (hashed into a
+*                       table of 1 << hlog slots), which learns with a
+*                       rate of 1 / (count + 1.5) down to 1/128. Catches
+*                       dependence between bytes as well as bias, at a
+*                       price: 8 coded bits a byte, each a load, two
+*                       multiplies and a store, against a hash and a
+*                       compare a byte for lzf. trng_bench model measures
+*                       it at 17-34 MB/s on 4 KB chunks next to 105-160
+*                       MB/s for trng_core_screen, 5-7 times slower, so
+*                       it is a check for sampled chunks, not every one.
+*   TRNG_MODEL_RANS     a table driven static order-0 rANS coder run for
+*                       real, its frequency table included in the size.
+*
+* Every call starts from an empty model, the verdict of a chunk does not
+* depend on the chunks before it. State lives in caller supplied memory of
+* trng_model_state_size bytes.
+*/
+
+#ifndef TRNG_MODEL_H
+#define TRNG_MODEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRNG_MODEL_ORDER0               0
+#define TRNG_MODEL_ORDERK               1
+#define TRNG_MODEL_RANS                 2
+#define TRNG_MODEL_KINDS                3
+
+#define TRNG_MODEL_ORDER_MAX            4           //context bytes of TRNG_MODEL_ORDERK
+#define TRNG_MODEL_HLOG_MIN             8           //a slot for every bit position of a byte
+#define TRNG_MODEL_HLOG_MAX             22
+#define TRNG_MODEL_FLUSH                4           //bytes a coder needs to end its output
+
+/*Output of trng_rans_encode for any len bytes: frequency table, coder state and a byte per byte*/
+#define TRNG_RANS_BOUND(len)            ((len) + 32 + 2 * 256 + TRNG_MODEL_FLUSH)
+
+typedef struct {
+    int kind;
+    unsigned int order;                 //context bytes of TRNG_MODEL_ORDERK
+    unsigned int hlog;                  //log2 of its slots
+    uint32_t *state;                    //histograms, slots or rANS output
+    size_t state_len;                   //bytes of state
+} trng_model;
+
+/*Bytes of state kind needs, for chunks of up to max_len bytes with TRNG_MODEL_RANS and 1 << hlog
+  slots with TRNG_MODEL_ORDERK. 0 if kind or hlog is out of range*/
+size_t trng_model_state_size(int kind, unsigned int hlog, unsigned int max_len);
+
+/*Bind model to arena (aligned for a uint32_t). order and hlog are used by TRNG_MODEL_ORDERK only.
+  Returns 0, or -1 if a parameter is out of range or the arena is too small*/
+int trng_model_init(trng_model *model, int kind, unsigned int order, unsigned int hlog,
+                    unsigned int max_len, void *arena, size_t arena_len);
+
+/*Estimated compressed size of in_len bytes, or 0 if it is larger than out_len (the data looks
+  random) or in_len is above the max_len of a TRNG_MODEL_RANS model*/
+unsigned int trng_model_screen(trng_model *model, const uint8_t *in, unsigned int in_len, unsigned int out_len);
+
+/*Byte histogram of len bytes into hist, lanes holds 4 * 256 counters of scratch*/
+void trng_model_histogram(const uint8_t *in, size_t len, uint32_t *lanes, uint32_t hist[256]);
+
+/*Coding cost in bits of in_len bytes under the adaptive order-0 coder of TRNG_MODEL_ORDER0*/
+double trng_model_order0_bits(const uint32_t hist[256], uint64_t len);
+
+/*Order-0 rANS coding of in_len bytes into at most out_len bytes. Returns the size written or 0
+  if it does not fit, TRNG_RANS_BOUND(in_len) always does*/
+unsigned int trng_rans_encode(const uint8_t *in, unsigned int in_len, uint8_t *out, unsigned int out_len);
+
+/*Decode in_len bytes of trng_rans_encode output into the out_len bytes it was made of. Returns
+  out_len, or 0 if the input is malformed. Uses 4 KB of stack for the slot table*/
+unsigned int trng_rans_decode(const uint8_t *in, unsigned int in_len, uint8_t *out, unsigned int out_len);
+
+#endif
@@ -0,0 +1,802 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_nist.h"
+#include "trng_bits.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX__)
+# include <immintrin.h>
+#elif defined(__SSE2__)
+# include <emmintrin.h>
+#elif defined(__aarch64__)
+# include <arm_neon.h>
+#endif
+
+#define DFT_THRESHOLD_FACTOR    2.995732273553991       //ln(1 / 0.05), peaks below sqrt(this * n) count
+#define IGAM_EPSILON            1.11022302462515654042e-16
+#define IGAM_MAXLOG             7.09782712893383996843e2
+#define IGAM_BIG                4.503599627370496e15
+#define IGAM_BIGINV             2.22044604925031308085e-16
+
+/*Set bits of a byte*/
+static const uint8_t ones_in[256] = {
+     0,  1,  1,  2,  1,  2,  2,  3,  1,  2,  2,  3,  2,  3,  3,  4,
+     1,  2,  2,  3,  2,  3,  3,  4,  2,  3,  3,  4,  3,  4,  4,  5,
+     1,  2,  2,  3,  2,  3,  3,  4,  2,  3,  3,  4,  3,  4,  4,  5,
+     2,  3,  3,  4,  3,  4,  4,  5,  3,  4,  4,  5,  4,  5,  5,  6,
+     1,  2,  2,  3,  2,  3,  3,  4,  2,  3,  3,  4,  3,  4,  4,  5,
+     2,  3,  3,  4,  3,  4,  4,  5,  3,  4,  4,  5,  4,  5,  5,  6,
+     2,  3,  3,  4,  3,  4,  4,  5,  3,  4,  4,  5,  4,  5,  5,  6,
+     3,  4,  4,  5,  4,  5,  5,  6,  4,  5,  5,  6,  5,  6,  6,  7,
+     1,  2,  2,  3,  2,  3,  3,  4,  2,  3,  3,  4,  3,  4,  4,  5,
+     2,  3,  3,  4,  3,  4,  4,  5,  3,  4,  4,  5,  4,  5,  5,  6,
+     2,  3,  3,  4,  3,  4,  4,  5,  3,  4,  4,  5,  4,  5,  5,  6,
+     3,  4,  4,  5,  4,  5,  5,  6,  4,  5,  5,  6,  5,  6,  6,  7,
+     2,  3,  3,  4,  3,  4,  4,  5,  3,  4,  4,  5,  4,  5,  5,  6,
+     3,  4,  4,  5,  4,  5,  5,  6,  4,  5,  5,  6,  5,  6,  6,  7,
+     3,  4,  4,  5,  4,  5,  5,  6,  4,  5,  5,  6,  5,  6,  6,  7,
+     4,  5,  5,  6,  5,  6,  6,  7,  5,  6,  6,  7,  6,  7,  7,  8
+};
+
+/*Longest run of ones inside a byte*/
+static const uint8_t run_max[256] = {
+     0,  1,  1,  2,  1,  1,  2,  3,  1,  1,  1,  2,  2,  2,  3,  4,
+     1,  1,  1,  2,  1,  1,  2,  3,  2,  2,  2,  2,  3,  3,  4,  5,
+     1,  1,  1,  2,  1,  1,  2,  3,  1,  1,  1,  2,  2,  2,  3,  4,
+     2,  2,  2,  2,  2,  2,  2,  3,  3,  3,  3,  3,  4,  4,  5,  6,
+     1,  1,  1,  2,  1,  1,  2,  3,  1,  1,  1,  2,  2,  2,  3,  4,
+     1,  1,  1,  2,  1,  1,  2,  3,  2,  2,  2,  2,  3,  3,  4,  5,
+     2,  2,  2,  2,  2,  2,  2,  3,  2,  2,  2,  2,  2,  2,  3,  4,
+     3,  3,  3,  3,  3,  3,  3,  3,  4,  4,  4,  4,  5,  5,  6,  7,
+     1,  1,  1,  2,  1,  1,  2,  3,  1,  1,  1,  2,  2,  2,  3,  4,
+     1,  1,  1,  2,  1,  1,  2,  3,  2,  2,  2,  2,  3,  3,  4,  5,
+     1,  1,  1,  2,  1,  1,  2,  3,  1,  1,  1,  2,  2,  2,  3,  4,
+     2,  2,  2,  2,  2,  2,  2,  3,  3,  3,  3,  3,  4,  4,  5,  6,
+     2,  2,  2,  2,  2,  2,  2,  3,  2,  2,  2,  2,  2,  2,  3,  4,
+     2,  2,  2,  2,  2,  2,  2,  3,  2,  2,  2,  2,  3,  3,  4,  5,
+     3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  3,  4,
+     4,  4,  4,  4,  4,  4,  4,  4,  5,  5,  5,  5,  6,  6,  7,  8
+};
+
+/*Highest and lowest partial sum of the +1/-1 walk over the bits of a byte*/
+static const int8_t walk_max[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,
+    -1, -1, -1, -1, -1, -1, -1,  0, -1, -1, -1,  0,  0,  0,  1,  2,
+    -1, -1, -1, -1, -1, -1, -1,  0, -1, -1, -1,  0,  0,  0,  1,  2,
+     0,  0,  0,  0,  0,  0,  1,  2,  1,  1,  1,  2,  2,  2,  3,  4,
+     0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  1,  2,
+     0,  0,  0,  0,  0,  0,  1,  2,  1,  1,  1,  2,  2,  2,  3,  4,
+     1,  1,  1,  1,  1,  1,  1,  2,  1,  1,  1,  2,  2,  2,  3,  4,
+     2,  2,  2,  2,  2,  2,  3,  4,  3,  3,  3,  4,  4,  4,  5,  6,
+     1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  2,
+     1,  1,  1,  1,  1,  1,  1,  2,  1,  1,  1,  2,  2,  2,  3,  4,
+     1,  1,  1,  1,  1,  1,  1,  2,  1,  1,  1,  2,  2,  2,  3,  4,
+     2,  2,  2,  2,  2,  2,  3,  4,  3,  3,  3,  4,  4,  4,  5,  6,
+     2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  3,  4,
+     2,  2,  2,  2,  2,  2,  3,  4,  3,  3,  3,  4,  4,  4,  5,  6,
+     3,  3,  3,  3,  3,  3,  3,  4,  3,  3,  3,  4,  4,  4,  5,  6,
+     4,  4,  4,  4,  4,  4,  5,  6,  5,  5,  5,  6,  6,  6,  7,  8
+};
+
+static const int8_t walk_min[256] = {
+    -8, -7, -6, -6, -6, -5, -5, -5, -6, -5, -4, -4, -4, -4, -4, -4,
+    -6, -5, -4, -4, -4, -3, -3, -3, -4, -3, -3, -3, -3, -3, -3, -3,
+    -6, -5, -4, -4, -4, -3, -3, -3, -4, -3, -2, -2, -2, -2, -2, -2,
+    -4, -3, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2, -2,
+    -6, -5, -4, -4, -4, -3, -3, -3, -4, -3, -2, -2, -2, -2, -2, -2,
+    -4, -3, -2, -2, -2, -1, -1, -1, -2, -1, -1, -1, -1, -1, -1, -1,
+    -4, -3, -2, -2, -2, -1, -1, -1, -2, -1, -1, -1, -1, -1, -1, -1,
+    -2, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -6, -5, -4, -4, -4, -3, -3, -3, -4, -3, -2, -2, -2, -2, -2, -2,
+    -4, -3, -2, -2, -2, -1, -1, -1, -2, -1, -1, -1, -1, -1, -1, -1,
+    -4, -3, -2, -2, -2, -1, -1, -1, -2, -1,  0,  0,  0,  0,  0,  0,
+    -2, -1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+    -4, -3, -2, -2, -2, -1, -1, -1, -2, -1,  0,  0,  0,  0,  0,  0,
+    -2, -1,  0,  0,  0,  1,  1,  1,  0,  1,  1,  1,  1,  1,  1,  1,
+    -2, -1,  0,  0,  0,  1,  1,  1,  0,  1,  1,  1,  1,  1,  1,  1,
+     0,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1,  1
+};
+
+/*Longest run categories of SP 800-22 2.4.4: upper bound of the first category and probabilities*/
+static const double lr_pi_8[4] = { 0.2148, 0.3672, 0.2305, 0.1875 };
+static const double lr_pi_128[6] = { 0.1174, 0.2430, 0.2493, 0.1752, 0.1027, 0.1124 };
+static const double lr_pi_10000[7] = { 0.0882, 0.2092, 0.2483, 0.1933, 0.1208, 0.0675, 0.0727 };
+
+static const char *const test_names[TRNG_NIST_TESTS] = {
+    "monobit",
+    "block frequency",
+    "runs",
+    "longest run",
+    "serial 1",
+    "serial 2",
+    "approximate entropy",
+    "cusum forward",
+    "cusum backward",
+    "dft",
+};
+
+static double igamc(double a, double x);
+
+/*Regularized lower incomplete gamma function, series expansion*/
+static double igam(double a, double x)
+{
+    if (x <= 0.0 || a <= 0.0)
+    {
+        return 0.0;
+    }
+    if (x > 1.0 && x > a)
+    {
+        return 1.0 - igamc(a, x);
+    }
+
+    double ax = a * log(x) - x - lgamma(a);
+    if (ax < -IGAM_MAXLOG)
+    {
+        return 0.0;
+    }
+
+    double r = a, c = 1.0, ans = 1.0;
+    do
+    {
+        r += 1.0;
+        c *= x / r;
+        ans += c;
+    } while (c / ans > IGAM_EPSILON);
+
+    return ans * exp(ax) / a;
+}
+
+/*Regularized upper incomplete gamma function, continued fraction (as in Cephes)*/
+static double igamc(double a, double x)
+{
+    if (x <= 0.0 || a <= 0.0)
+    {
+        return 1.0;
+    }
+    if (x < 1.0 || x < a)
+    {
+        return 1.0 - igam(a, x);
+    }
+
+    double ax = a * log(x) - x - lgamma(a);
+    if (ax < -IGAM_MAXLOG)
+    {
+        return 0.0;
+    }
+
+    double y = 1.0 - a, z = x + y + 1.0, c = 0.0;
+    double pkm2 = 1.0, qkm2 = x, pkm1 = x + 1.0, qkm1 = z * x;
+    double ans = pkm1 / qkm1, t;
+    do
+    {
+        c += 1.0;
+        y += 1.0;
+        z += 2.0;
+        double yc = y * c;
+        double pk = pkm1 * z - pkm2 * yc;
+        double qk = qkm1 * z - qkm2 * yc;
+        if (qk != 0.0)
+        {
+            double r = pk / qk;
+            t = fabs((ans - r) / r);
+            ans = r;
+        }
+        else
+        {
+            t = 1.0;
+        }
+        pkm2 = pkm1;
+        pkm1 = pk;
+        qkm2 = qkm1;
+        qkm1 = qk;
+        if (fabs(pk) > IGAM_BIG)
+        {
+            pkm2 *= IGAM_BIGINV;
+            pkm1 *= IGAM_BIGINV;
+            qkm2 *= IGAM_BIGINV;
+            qkm1 *= IGAM_BIGINV;
+        }
+    } while (t > IGAM_EPSILON);
+
+    return ans * exp(ax);
+}
+
+/*Standard normal distribution function*/
+static double normal_cdf(double x)
+{
+    return 0.5 * erfc(-x / sqrt(2.0));
+}
+
+/*Bit i of the stream is bit 63 - i of the word, whatever the byte order of the target*/
+static inline uint64_t load_be64(const uint8_t *p)
+{
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return __builtin_bswap64(v);
+#elif defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+#else
+    return (uint64_t)p[0] << 56 | (uint64_t)p[1] << 48 | (uint64_t)p[2] << 40 | (uint64_t)p[3] << 32 |
+           (uint64_t)p[4] << 24 | (uint64_t)p[5] << 16 | (uint64_t)p[6] << 8 | (uint64_t)p[7];
+#endif
+}
+
+static unsigned int pattern_bits_for(const trng_nist_config *cfg)
+{
+    unsigned int m = cfg->apen_m + 1;
+    return cfg->serial_m > m ? cfg->serial_m : m;
+}
+
+static unsigned int longest_run_classes(unsigned int m)
+{
+    return m == 8 ? 4 : m == 128 ? 6 : m == 10000 ? 7 : 0;
+}
+
+void trng_nist_config_default(trng_nist_config *cfg)
+{
+    cfg->block_frequency_bits = 128;
+    cfg->longest_run_bits = 10000;
+    cfg->serial_m = 16;
+    cfg->apen_m = 10;
+    cfg->dft_block_bits = 4096;
+}
+
+size_t trng_nist_state_size(const trng_nist_config *cfg)
+{
+    unsigned int m = pattern_bits_for(cfg);
+
+    if (cfg->block_frequency_bits == 0 || cfg->block_frequency_bits % 8 != 0 ||
+        longest_run_classes(cfg->longest_run_bits) == 0 ||
+        cfg->serial_m < 2 || cfg->apen_m < 1 || m > TRNG_NIST_MAX_PATTERN_BITS)
+    {
+        return 0;
+    }
+
+    size_t size = sizeof(uint32_t) << m;
+
+    if (cfg->dft_block_bits != 0)
+    {
+        if (cfg->dft_block_bits < 64 || (cfg->dft_block_bits & (cfg->dft_block_bits - 1)) != 0)
+        {
+            return 0;
+        }
+        /*Transform buffer, twiddles of its stages and of the final split, all complex*/
+        size = (size + sizeof(double) - 1) / sizeof(double) * sizeof(double);
+        size += sizeof(double) * 2 * (cfg->dft_block_bits + cfg->dft_block_bits / 2);
+    }
+
+    return size;
+}
+
+int trng_nist_init(trng_nist *t, const trng_nist_config *cfg, void *arena, size_t arena_len)
+{
+    size_t size = trng_nist_state_size(cfg);
+
+    if (size == 0 || arena == NULL || arena_len < size)
+    {
+        return -1;
+    }
+
+    memset(t, 0, sizeof(*t));
+    t->cfg = *cfg;
+    t->pattern_bits = pattern_bits_for(cfg);
+    t->patterns = (uint32_t *)arena;
+    memset(t->patterns, 0, sizeof(uint32_t) << t->pattern_bits);
+
+    if (cfg->dft_block_bits != 0)
+    {
+        size_t offset = ((sizeof(uint32_t) << t->pattern_bits) + sizeof(double) - 1) / sizeof(double);
+        unsigned int n = cfg->dft_block_bits / 2;
+        t->dft = (double *)arena + offset;
+
+        /*Twiddles of the n point transform, stage by stage, then those of the final split*/
+        double *tw = t->dft + 2 * n, *split = t->dft + 4 * n;
+        for (unsigned int half = 1; half < n; half <<= 1)
+        {
+            for (unsigned int k = 0; k < half; k++)
+            {
+                tw[half + k] = cos(-M_PI * k / half);
+                tw[n + half + k] = sin(-M_PI * k / half);
+            }
+        }
+        for (unsigned int j = 0; j < n; j++)
+        {
+            split[j] = cos(-M_PI * j / n);
+            split[n + j] = sin(-M_PI * j / n);
+        }
+    }
+
+    t->walk_max = 0;
+    t->walk_min = 0;
+    return 0;
+}
+
+/*count radix 2 butterflies b = a - w * b, a = a + w * b over contiguous arrays, two or four
+  at a time where the target has double precision vectors*/
+static inline void butterflies(double *__restrict ar, double *__restrict ai, double *__restrict br,
+                               double *__restrict bi, const double *wr, const double *wi, unsigned int count)
+{
+    unsigned int k = 0;
+
+#if defined(__AVX__)
+    for (; k + 4 <= count; k += 4)
+    {
+        __m256d xr = _mm256_loadu_pd(br + k), xi = _mm256_loadu_pd(bi + k);
+        __m256d cr = _mm256_loadu_pd(wr + k), ci = _mm256_loadu_pd(wi + k);
+        __m256d tr = _mm256_sub_pd(_mm256_mul_pd(xr, cr), _mm256_mul_pd(xi, ci));
+        __m256d ti = _mm256_add_pd(_mm256_mul_pd(xr, ci), _mm256_mul_pd(xi, cr));
+        __m256d yr = _mm256_loadu_pd(ar + k), yi = _mm256_loadu_pd(ai + k);
+        _mm256_storeu_pd(br + k, _mm256_sub_pd(yr, tr));
+        _mm256_storeu_pd(bi + k, _mm256_sub_pd(yi, ti));
+        _mm256_storeu_pd(ar + k, _mm256_add_pd(yr, tr));
+        _mm256_storeu_pd(ai + k, _mm256_add_pd(yi, ti));
+    }
+#elif defined(__SSE2__)
+    for (; k + 2 <= count; k += 2)
+    {
+        __m128d xr = _mm_loadu_pd(br + k), xi = _mm_loadu_pd(bi + k);
+        __m128d cr = _mm_loadu_pd(wr + k), ci = _mm_loadu_pd(wi + k);
+        __m128d tr = _mm_sub_pd(_mm_mul_pd(xr, cr), _mm_mul_pd(xi, ci));
+        __m128d ti = _mm_add_pd(_mm_mul_pd(xr, ci), _mm_mul_pd(xi, cr));
+        __m128d yr = _mm_loadu_pd(ar + k), yi = _mm_loadu_pd(ai + k);
+        _mm_storeu_pd(br + k, _mm_sub_pd(yr, tr));
+        _mm_storeu_pd(bi + k, _mm_sub_pd(yi, ti));
+        _mm_storeu_pd(ar + k, _mm_add_pd(yr, tr));
+        _mm_storeu_pd(ai + k, _mm_add_pd(yi, ti));
+    }
+#elif defined(__aarch64__)
+    for (; k + 2 <= count; k += 2)
+    {
+        float64x2_t xr = vld1q_f64(br + k), xi = vld1q_f64(bi + k);
+        float64x2_t cr = vld1q_f64(wr + k), ci = vld1q_f64(wi + k);
+        float64x2_t tr = vsubq_f64(vmulq_f64(xr, cr), vmulq_f64(xi, ci));
+        float64x2_t ti = vaddq_f64(vmulq_f64(xr, ci), vmulq_f64(xi, cr));
+        float64x2_t yr = vld1q_f64(ar + k), yi = vld1q_f64(ai + k);
+        vst1q_f64(br + k, vsubq_f64(yr, tr));
+        vst1q_f64(bi + k, vsubq_f64(yi, ti));
+        vst1q_f64(ar + k, vaddq_f64(yr, tr));
+        vst1q_f64(ai + k, vaddq_f64(yi, ti));
+    }
+#endif
+
+    for (; k < count; k++)
+    {
+        double tr = br[k] * wr[k] - bi[k] * wi[k];
+        double ti = br[k] * wi[k] + bi[k] * wr[k];
+        br[k] = ar[k] - tr;
+        bi[k] = ai[k] - ti;
+        ar[k] += tr;
+        ai[k] += ti;
+    }
+}
+
+/*In place radix 2 transform of n complex values held as separate real and imaginary parts,
+  so the butterflies of a group run over contiguous arrays*/
+static void fft(double *__restrict re, double *__restrict im, const double *__restrict tw, unsigned int n)
+{
+    for (unsigned int i = 1, j = 0; i < n; i++)
+    {
+        unsigned int bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j)
+        {
+            double r = re[i], m = im[i];
+            re[i] = re[j];
+            im[i] = im[j];
+            re[j] = r;
+            im[j] = m;
+        }
+    }
+
+    for (unsigned int i = 0; i < n; i += 2)
+    {
+        double r = re[i + 1], m = im[i + 1];
+        re[i + 1] = re[i] - r;
+        im[i + 1] = im[i] - m;
+        re[i] += r;
+        im[i] += m;
+    }
+
+    for (unsigned int half = 2; half < n; half <<= 1)
+    {
+        for (unsigned int i = 0; i < n; i += 2 * half)
+        {
+            butterflies(re + i, im + i, re + i + half, im + i + half, tw + half, tw + n + half, half);
+        }
+    }
+}
+
+/*Transform a full block and count the peaks of its first half below the threshold. The
+  dft_block_bits real values went in as n = dft_block_bits / 2 complex ones, even bits in the
+  real and odd bits in the imaginary parts, the spectrum is split back out of that transform*/
+static void dft_block(trng_nist *t)
+{
+    unsigned int n = t->cfg.dft_block_bits / 2;
+    double threshold_sq = DFT_THRESHOLD_FACTOR * 2 * n;
+    double *re = t->dft, *im = t->dft + n;
+    const double *sr = t->dft + 4 * n, *si = t->dft + 5 * n;
+    uint64_t below = 0;
+
+    fft(re, im, t->dft + 2 * n, n);
+    for (unsigned int j = 0; j < n; j++)
+    {
+        unsigned int k = (n - j) & (n - 1);
+        double er = 0.5 * (re[j] + re[k]), ei = 0.5 * (im[j] - im[k]);
+        double or_ = 0.5 * (im[j] + im[k]), oi = 0.5 * (re[k] - re[j]);
+        double xr = er + or_ * sr[j] - oi * si[j];
+        double xi = ei + or_ * si[j] + oi * sr[j];
+        below += xr * xr + xi * xi < threshold_sq;
+    }
+    t->dft_below += below;
+    t->dft_blocks++;
+    t->dft_fill = 0;
+}
+
+/*Count the longest run of a block in its category*/
+static inline void longest_run_block(trng_nist *t, unsigned int best)
+{
+    unsigned int classes = longest_run_classes(t->cfg.longest_run_bits);
+    unsigned int low = t->cfg.longest_run_bits == 8 ? 1 : t->cfg.longest_run_bits == 128 ? 4 : 10;
+    unsigned int c = best <= low ? 0 : best - low;
+
+    t->lr_count[c < classes ? c : classes - 1]++;
+}
+
+/*Block frequency, longest run and cumulative sums, a byte at a time through tables.
+  Blocks of the longest run test (8, 128 or 10000 bits) end on a byte boundary*/
+static void update_blocks(trng_nist *t, const uint8_t *data, size_t len)
+{
+    unsigned int bf_block = t->cfg.block_frequency_bits / 8, lr_block = t->cfg.longest_run_bits / 8;
+    unsigned int bf_ones = t->bf_ones, bf_bytes = t->bf_bytes;
+    unsigned int lr_run = t->lr_run, lr_best = t->lr_best, lr_bytes = t->lr_bytes;
+    int64_t walk = t->walk, walk_hi = t->walk_max, walk_lo = t->walk_min;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned int b = data[i];
+        unsigned int ones = ones_in[b];
+
+        bf_ones += ones;
+        if (++bf_bytes == bf_block)
+        {
+            int64_t d = 2 * (int64_t)bf_ones - (int64_t)t->cfg.block_frequency_bits;
+            t->bf_sum += (uint64_t)(d * d);
+            t->bf_blocks++;
+            bf_ones = 0;
+            bf_bytes = 0;
+        }
+
+        /*A run that goes on from the previous byte ends at the first zero of this one*/
+        if (b == 0xff)
+        {
+            lr_run += 8;
+        }
+        else
+        {
+            unsigned int inv = ~b & 0xff;
+            unsigned int run = lr_run + trng_clz32(inv << 24);
+            lr_best = run > lr_best ? run : lr_best;
+            lr_best = run_max[b] > lr_best ? run_max[b] : lr_best;
+            lr_run = trng_ctz32(inv);
+        }
+        if (++lr_bytes == lr_block)
+        {
+            longest_run_block(t, lr_run > lr_best ? lr_run : lr_best);
+            lr_run = 0;
+            lr_best = 0;
+            lr_bytes = 0;
+        }
+
+        walk_hi = walk + walk_max[b] > walk_hi ? walk + walk_max[b] : walk_hi;
+        walk_lo = walk + walk_min[b] < walk_lo ? walk + walk_min[b] : walk_lo;
+        walk += 2 * (int)ones - 8;
+    }
+
+    t->bf_ones = bf_ones;
+    t->bf_bytes = bf_bytes;
+    t->lr_run = lr_run;
+    t->lr_best = lr_best;
+    t->lr_bytes = lr_bytes;
+    t->walk = walk;
+    t->walk_max = walk_hi;
+    t->walk_min = walk_lo;
+}
+
+/*Overlapping patterns of the serial and approximate entropy tests, one count for every bit
+  once the first pattern is complete*/
+static void update_patterns(trng_nist *t, const uint8_t *data, size_t len)
+{
+    unsigned int pattern_bits = t->pattern_bits;
+    uint32_t mask = (1UL << pattern_bits) - 1;
+    uint32_t window = t->window;
+    uint32_t *patterns = t->patterns;
+    uint64_t bits = t->bits;
+    size_t i = 0;
+
+    for (; i < len && bits + 1 < pattern_bits; i++, bits += 8)
+    {
+        window = (window << 8) | data[i];
+        for (int j = 7; j >= 0; j--)
+        {
+            if (bits + 8 - j >= pattern_bits)
+            {
+                patterns[(window >> j) & mask]++;
+            }
+        }
+    }
+
+    for (; i < len; i++)
+    {
+        window = (window << 8) | data[i];
+        patterns[(window >> 7) & mask]++;
+        patterns[(window >> 6) & mask]++;
+        patterns[(window >> 5) & mask]++;
+        patterns[(window >> 4) & mask]++;
+        patterns[(window >> 3) & mask]++;
+        patterns[(window >> 2) & mask]++;
+        patterns[(window >> 1) & mask]++;
+        patterns[window & mask]++;
+    }
+
+    t->window = window;
+}
+
+/*Discrete Fourier transform, bits go into the current block as +1/-1, even ones into the real
+  and odd ones into the imaginary parts*/
+static void update_dft(trng_nist *t, const uint8_t *data, size_t len)
+{
+    unsigned int n = t->cfg.dft_block_bits / 2;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        unsigned int b = data[i];
+        double *re = t->dft + t->dft_fill / 2, *im = re + n;
+        for (int j = 0; j < 4; j++)
+        {
+            re[j] = (double)((int)((b >> (7 - 2 * j)) & 1) * 2 - 1);
+            im[j] = (double)((int)((b >> (6 - 2 * j)) & 1) * 2 - 1);
+        }
+        t->dft_fill += 8;
+        if (t->dft_fill == t->cfg.dft_block_bits)
+        {
+            dft_block(t);
+        }
+    }
+}
+
+void trng_nist_update(trng_nist *t, const uint8_t *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+
+    /*Frequency and runs a word at a time, a transition is a set bit of w ^ (w >> 1)*/
+    uint64_t ones = 0, transitions = 0;
+    unsigned int prev = t->bits != 0 ? t->last & 1 : (data[0] >> 7);
+    size_t i = 0;
+
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t w = load_be64(data + i);
+        ones += trng_popcount64(w);
+        transitions += trng_popcount64((w ^ (w >> 1)) & 0x7fffffffffffffffULL) + (prev ^ (unsigned int)(w >> 63));
+        prev = (unsigned int)w & 1;
+    }
+    for (; i < len; i++)
+    {
+        unsigned int b = data[i];
+        ones += trng_popcount32(b);
+        transitions += trng_popcount32((b ^ (b >> 1)) & 0x7f) + (prev ^ (b >> 7));
+        prev = b & 1;
+    }
+
+    t->ones += ones;
+    t->transitions += transitions;
+    t->last = data[len - 1];
+
+    /*The first bits close the cycle of the patterns at the end*/
+    for (size_t j = 0; j < len && t->bits + 8 * j < 32; j++)
+    {
+        t->head |= (uint32_t)data[j] << (24 - t->bits - 8 * j);
+    }
+
+    update_blocks(t, data, len);
+    update_patterns(t, data, len);
+    if (t->dft != NULL)
+    {
+        update_dft(t, data, len);
+    }
+    t->bits += (uint64_t)len * 8;
+}
+
+/*Sum of squared counts and sum of c * ln(c / n) of the pattern table folded to order m*/
+static void pattern_sums(const uint32_t *patterns, unsigned int m, double n, double *squares, double *phi)
+{
+    double sq = 0.0, ph = 0.0;
+
+    for (uint32_t p = 0; p < (1UL << m); p++)
+    {
+        double c = (double)patterns[p];
+        sq += c * c;
+        if (c > 0.0)
+        {
+            ph += c * log(c / n);
+        }
+    }
+
+    *squares = sq;
+    *phi = ph / n;
+}
+
+void trng_nist_final(trng_nist *t, trng_nist_result *res)
+{
+    double n = (double)t->bits;
+    double sqrt_n = sqrt(n);
+
+    for (int i = 0; i < TRNG_NIST_TESTS; i++)
+    {
+        res->p[i] = -1.0;
+    }
+    res->bits = t->bits;
+
+    if (t->bits >= 100)
+    {
+        /*Monobit*/
+        double s = fabs(2.0 * (double)t->ones - n);
+        res->p[TRNG_NIST_MONOBIT] = erfc(s / sqrt_n / sqrt(2.0));
+
+        /*Runs, not applicable when the monobit test already fails*/
+        double pi = (double)t->ones / n;
+        if (fabs(pi - 0.5) >= 2.0 / sqrt_n)
+        {
+            res->p[TRNG_NIST_RUNS] = 0.0;
+        }
+        else
+        {
+            double v = (double)t->transitions + 1.0;
+            double e = 2.0 * n * pi * (1.0 - pi);
+            res->p[TRNG_NIST_RUNS] = erfc(fabs(v - e) / (2.0 * sqrt(2.0 * n) * pi * (1.0 - pi)));
+        }
+
+        /*Cumulative sums, the backward walk runs from S(n) down to S(0) = 0*/
+        double z_fwd = (double)(t->walk_max > -t->walk_min ? t->walk_max : -t->walk_min);
+        double z_bwd = (double)(t->walk - t->walk_min > t->walk_max - t->walk ? t->walk - t->walk_min : t->walk_max - t->walk);
+        for (int dir = 0; dir < 2; dir++)
+        {
+            double z = dir == 0 ? z_fwd : z_bwd;
+            double sum1 = 0.0, sum2 = 0.0;
+            long nz = (long)(n / z);
+            for (long k = (-nz + 1) / 4; k <= (nz - 1) / 4; k++)
+            {
+                sum1 += normal_cdf((4 * k + 1) * z / sqrt_n) - normal_cdf((4 * k - 1) * z / sqrt_n);
+            }
+            for (long k = (-nz - 3) / 4; k <= (nz - 1) / 4; k++)
+            {
+                sum2 += normal_cdf((4 * k + 3) * z / sqrt_n) - normal_cdf((4 * k + 1) * z / sqrt_n);
+            }
+            res->p[TRNG_NIST_CUSUM_FORWARD + dir] = 1.0 - sum1 + sum2;
+        }
+    }
+
+    /*Block frequency*/
+    if (t->bf_blocks != 0)
+    {
+        double chi = (double)t->bf_sum / t->cfg.block_frequency_bits;
+        res->p[TRNG_NIST_BLOCK_FREQUENCY] = igamc((double)t->bf_blocks / 2.0, chi / 2.0);
+    }
+
+    /*Longest run*/
+    unsigned int classes = longest_run_classes(t->cfg.longest_run_bits);
+    const double *lr_pi = classes == 4 ? lr_pi_8 : classes == 6 ? lr_pi_128 : lr_pi_10000;
+    uint64_t blocks = 0;
+    for (unsigned int c = 0; c < classes; c++)
+    {
+        blocks += t->lr_count[c];
+    }
+    if (blocks != 0)
+    {
+        double chi = 0.0;
+        for (unsigned int c = 0; c < classes; c++)
+        {
+            double e = (double)blocks * lr_pi[c];
+            chi += ((double)t->lr_count[c] - e) * ((double)t->lr_count[c] - e) / e;
+        }
+        res->p[TRNG_NIST_LONGEST_RUN] = igamc((classes - 1) / 2.0, chi / 2.0);
+    }
+
+    /*Serial and approximate entropy. The patterns wrap around to the first bits of the
+      sequence, then the table is folded order by order, dropping the last bit of a pattern*/
+    if (t->bits >= t->pattern_bits)
+    {
+        unsigned int mmax = t->pattern_bits;
+        uint32_t mask = (1UL << mmax) - 1;
+        uint32_t window = t->window;
+        double squares[TRNG_NIST_MAX_PATTERN_BITS + 1], phi[TRNG_NIST_MAX_PATTERN_BITS + 1];
+
+        for (unsigned int j = 0; j + 1 < mmax; j++)
+        {
+            window = (window << 1) | ((t->head >> (31 - j)) & 1);
+            t->patterns[window & mask]++;
+        }
+
+        for (unsigned int m = mmax; ; m--)
+        {
+            pattern_sums(t->patterns, m, n, &squares[m], &phi[m]);
+            if (m == 0)
+            {
+                break;
+            }
+            for (uint32_t p = 0; p < (1UL << (m - 1)); p++)
+            {
+                t->patterns[p] = t->patterns[2 * p] + t->patterns[2 * p + 1];
+            }
+        }
+
+        unsigned int m = t->cfg.serial_m;
+        double psi0 = squares[m] * ldexp(1.0, m) / n - n;
+        double psi1 = squares[m - 1] * ldexp(1.0, m - 1) / n - n;
+        double psi2 = squares[m - 2] * ldexp(1.0, m - 2) / n - n;
+        res->p[TRNG_NIST_SERIAL_1] = igamc(ldexp(1.0, m - 2), (psi0 - psi1) / 2.0);
+        res->p[TRNG_NIST_SERIAL_2] = igamc(ldexp(1.0, (int)m - 3), (psi0 - 2.0 * psi1 + psi2) / 2.0);
+
+        m = t->cfg.apen_m;
+        double apen = phi[m] - phi[m + 1];
+        double chi = 2.0 * n * (log(2.0) - apen);
+        res->p[TRNG_NIST_APPROXIMATE_ENTROPY] = igamc(ldexp(1.0, m - 1), chi / 2.0);
+    }
+
+    /*Discrete Fourier transform, the peak counts of all blocks pooled*/
+    if (t->dft_blocks != 0)
+    {
+        double blocks_bits = (double)t->dft_blocks * t->cfg.dft_block_bits;
+        double expected = 0.95 * blocks_bits / 2.0;
+        double d = ((double)t->dft_below - expected) / sqrt(blocks_bits * 0.95 * 0.05 / 4.0);
+        res->p[TRNG_NIST_DFT] = erfc(fabs(d) / sqrt(2.0));
+    }
+}
+
+double trng_nist_igamc(double a, double x)
+{
+    return igamc(a, x);
+}
+
+const char *trng_nist_test_name(unsigned int i)
+{
+    return i < TRNG_NIST_TESTS ? test_names[i] : "";
+}
+
+unsigned int trng_nist_failures(const trng_nist_result *res, double alpha)
+{
+    unsigned int failures = 0;
+
+    for (int i = 0; i < TRNG_NIST_TESTS; i++)
+    {
+        failures += res->p[i] >= 0.0 && res->p[i] < alpha;
+    }
+
+    return failures;
+}
@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Statistical tests of NIST SP 800-22 rev 1a run in one pass over a stream
+* of trng output: frequency (monobit), frequency within a block, runs,
+* longest run of ones in a block, serial, approximate entropy, cumulative
+* sums (forward and backward) and the discrete Fourier transform test.
+*
+* Bits are taken most significant first. Data is fed with trng_nist_update
+* in slices of any size, the state is bounded by the caller supplied arena:
+* 2^m pattern counters for the serial and approximate entropy tests (one
+* table serves both, lower orders are folded out of it at the end) and the
+* transform buffer of the DFT test. The DFT test is applied to consecutive
+* blocks of dft_block_bits and the peak counts of all blocks are pooled,
+* as the whole sequence can't be held in memory.
+*/
+
+#ifndef TRNG_NIST_H
+#define TRNG_NIST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRNG_NIST_MAX_PATTERN_BITS      20          //largest serial m or approximate entropy m + 1
+
+enum {
+    TRNG_NIST_MONOBIT,
+    TRNG_NIST_BLOCK_FREQUENCY,
+    TRNG_NIST_RUNS,
+    TRNG_NIST_LONGEST_RUN,
+    TRNG_NIST_SERIAL_1,
+    TRNG_NIST_SERIAL_2,
+    TRNG_NIST_APPROXIMATE_ENTROPY,
+    TRNG_NIST_CUSUM_FORWARD,
+    TRNG_NIST_CUSUM_BACKWARD,
+    TRNG_NIST_DFT,
+    TRNG_NIST_TESTS
+};
+
+typedef struct {
+    unsigned int block_frequency_bits;  //M of the block frequency test, a multiple of 8 (128)
+    unsigned int longest_run_bits;      //M of the longest run test: 8, 128 or 10000
+    unsigned int serial_m;              //pattern length of the serial test, at least 2
+    unsigned int apen_m;                //pattern length of the approximate entropy test, at least 1
+    unsigned int dft_block_bits;        //DFT block, a power of 2 of at least 64, 0 - no DFT test
+} trng_nist_config;
+
+typedef struct {
+    trng_nist_config cfg;
+    uint64_t bits;                      //bits consumed
+    uint64_t ones;
+    uint64_t transitions;               //adjacent bits that differ
+    uint8_t last;                       //previous byte, for runs that cross slices
+    uint64_t bf_sum;                    //sum of (2 * ones - M)^2 over complete blocks
+    uint64_t bf_blocks;
+    unsigned int bf_ones;               //ones in the current block
+    unsigned int bf_bytes;
+    uint64_t lr_count[7];               //blocks per longest run category
+    unsigned int lr_run;                //run of ones reaching the end of the previous byte
+    unsigned int lr_best;               //longest run of the current block
+    unsigned int lr_bytes;
+    int64_t walk;                       //+1/-1 partial sum
+    int64_t walk_max;
+    int64_t walk_min;
+    unsigned int pattern_bits;          //m of the pattern table
+    uint32_t *patterns;                 //2^pattern_bits counters of cyclic overlapping patterns
+    uint32_t window;                    //last bits, for the patterns
+    uint32_t head;                      //first pattern_bits - 1 bits, closing the cycle
+    double *dft;                        //dft_block_bits / 2 complex values and the twiddles
+    unsigned int dft_fill;
+    uint64_t dft_below;                 //peaks below the threshold, all blocks
+    uint64_t dft_blocks;
+} trng_nist;
+
+typedef struct {
+    uint64_t bits;
+    double p[TRNG_NIST_TESTS];          //p-values, -1 for tests without enough data
+} trng_nist_result;
+
+/*
+* Upper bound of the arena for a pattern table of pattern_bits (the larger of
+* serial_m and apen_m + 1) and a DFT block of dft_bits, usable for static arenas:
+*
+*   TRNG_NIST_ARENA(arena, 8, 256);
+*/
+#define TRNG_NIST_STATE_SIZE(pattern_bits, dft_bits) \
+    ((sizeof(uint32_t) << (pattern_bits)) + sizeof(double) * (3 * (size_t)(dft_bits) + 1))
+#define TRNG_NIST_ARENA(name, pattern_bits, dft_bits) \
+    static double name[(TRNG_NIST_STATE_SIZE(pattern_bits, dft_bits) + sizeof(double) - 1) / sizeof(double)]
+
+/*Defaults of SP 800-22 for sequences of a million bits and more*/
+void trng_nist_config_default(trng_nist_config *cfg);
+
+/*Arena size needed for cfg, 0 if cfg is not supported*/
+size_t trng_nist_state_size(const trng_nist_config *cfg);
+
+/*Start a sequence, arena holds trng_nist_state_size(cfg) bytes aligned for a double.
+  Returns 0 or -1 if cfg is not supported or the arena is too small*/
+int trng_nist_init(trng_nist *t, const trng_nist_config *cfg, void *arena, size_t arena_len);
+
+/*Append len bytes to the sequence*/
+void trng_nist_update(trng_nist *t, const uint8_t *data, size_t len);
+
+/*Compute the p-values of the sequence. The pattern table is folded in the process,
+  so the sequence is finished and t has to be initialized again for another one*/
+void trng_nist_final(trng_nist *t, trng_nist_result *res);
+
+/*Regularized upper incomplete gamma function Q(a, x), the chi square tail the tests use*/
+double trng_nist_igamc(double a, double x);
+
+/*Name of test i*/
+const char *trng_nist_test_name(unsigned int i);
+
+/*Number of tests with a p-value below alpha, tests that did not run do not count*/
+unsigned int trng_nist_failures(const trng_nist_result *res, double alpha);
+
+#endif
@@ -0,0 +1,144 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_pool.h"
+#include "trng_atomic.h"
+
+#include <string.h>
+
+int trng_pool_init(trng_pool *pool, const trng_pool_config *cfg, uint8_t *ring)
+{
+    if (cfg->capacity == 0 || (cfg->capacity & (cfg->capacity - 1)) != 0 || cfg->capacity > 0x80000000UL ||
+        cfg->batch == 0 || cfg->batch > cfg->capacity)
+    {
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(*pool));
+    pool->ring = ring;
+    pool->mask = cfg->capacity - 1;
+    pool->batch = cfg->batch;
+    pool->trng = cfg->trng;
+    pool->health = cfg->health;
+    pool->now_ns = cfg->now_ns;
+    return 0;
+}
+
+int trng_pool_refill(trng_pool *pool)
+{
+    uint32_t head = pool->head;
+    uint32_t room = pool->mask + 1 - (head - LOAD_ACQUIRE(&pool->tail));
+    if (room < pool->batch)
+    {
+        return 0;
+    }
+
+    /*One call per batch, into the ring up to its end. The bytes past head are not visible to
+      the consumers before the release store publishes them*/
+    uint32_t pos = head & pool->mask;
+    size_t len = pool->mask + 1 - pos < pool->batch ? pool->mask + 1 - pos : pool->batch;
+    size_t got = 0;
+    uint64_t start = pool->now_ns ? pool->now_ns() : 0;
+    int res = pool->health ? trng_health_get_bytes(pool->health, pool->ring + pos, len, &got)
+                           : trng_get_bytes(pool->trng, pool->ring + pos, len, &got);
+    uint64_t elapsed = pool->now_ns ? pool->now_ns() - start : 0;
+
+    if (res != 0)
+    {
+        got = 0;
+    }
+    got = got < len ? got : len;
+
+    /*The 64 bit counters can't be atomic on every target, readers retry around an update*/
+    STORE_RELAXED(&pool->stats_seq, pool->stats_seq + 1);
+    FENCE_RELEASE();
+    pool->refills++;
+    pool->refill_bytes += got;
+    pool->refill_errors += res != 0;
+    pool->refill_ns += elapsed;
+    pool->refill_max_ns = elapsed > pool->refill_max_ns ? elapsed : pool->refill_max_ns;
+    STORE_RELEASE(&pool->stats_seq, pool->stats_seq + 1);
+
+    if (res != 0)
+    {
+        return res;
+    }
+    STORE_RELEASE(&pool->head, head + (uint32_t)got);
+    return (int)got;
+}
+
+size_t trng_pool_read(trng_pool *pool, uint8_t *out, size_t len)
+{
+    uint32_t tail = LOAD_RELAXED(&pool->tail);
+    size_t take;
+
+    for (;;)
+    {
+        uint32_t level = LOAD_ACQUIRE(&pool->head) - tail;
+        take = len < level ? len : level;
+
+        /*Copy first, then claim. If another consumer claimed the bytes meanwhile the producer may
+          have written over them, the swap fails and the copy is thrown away*/
+        uint32_t pos = tail & pool->mask;
+        size_t first = pool->mask + 1 - pos < take ? pool->mask + 1 - pos : take;
+        memcpy(out, pool->ring + pos, first);
+        memcpy(out + first, pool->ring, take - first);
+
+        if (take == 0 || CAS_ACQ_REL(&pool->tail, &tail, tail + (uint32_t)take))
+        {
+            break;
+        }
+    }
+
+    ADD_RELAXED(&pool->reads, 1UL);
+    ADD_RELAXED(take == len ? &pool->hits : &pool->short_reads, 1UL);
+    ADD_RELAXED(&pool->bytes_served, (unsigned long)take);
+    return take;
+}
+
+int trng_pool_get_bytes(trng_pool *pool, uint8_t *output, size_t length, size_t *output_length)
+{
+    *output_length = trng_pool_read(pool, output, length);
+    return 0;
+}
+
+uint32_t trng_pool_level(const trng_pool *pool)
+{
+    uint32_t tail = LOAD_ACQUIRE(&pool->tail);
+    return LOAD_ACQUIRE(&pool->head) - tail;
+}
+
+void trng_pool_get_stats(const trng_pool *pool, trng_pool_stats *stats)
+{
+    uint32_t seq;
+    do
+    {
+        seq = LOAD_ACQUIRE(&pool->stats_seq);
+        const volatile trng_pool *p = pool;
+        stats->refills = p->refills;
+        stats->refill_bytes = p->refill_bytes;
+        stats->refill_errors = p->refill_errors;
+        stats->refill_ns = p->refill_ns;
+        stats->refill_max_ns = p->refill_max_ns;
+        FENCE_ACQUIRE();
+    }
+    while ((seq & 1) != 0 || seq != LOAD_RELAXED(&pool->stats_seq));
+    stats->reads = LOAD_RELAXED(&pool->reads);
+    stats->hits = LOAD_RELAXED(&pool->hits);
+    stats->short_reads = LOAD_RELAXED(&pool->short_reads);
+    stats->bytes_served = LOAD_RELAXED(&pool->bytes_served);
+    stats->level = trng_pool_level(pool);
+}
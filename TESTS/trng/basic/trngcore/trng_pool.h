@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Entropy pool: trng output buffered in a ring that one thread refills in
+* large batches through trng_get_bytes and any number of threads read from
+* in small amounts without calling the driver.
+*
+* The ring is lock free for a single producer and many consumers. The
+* producer owns the write index and only publishes bytes it has written, a
+* consumer copies the bytes at the read index and claims them with a compare
+* and swap of it, retrying when another consumer was faster, so every byte
+* is served exactly once. Indexes are 32 bit and wrap, the ring holds up to
+* 2^31 bytes. Atomics are those of trng_atomic.h, critical sections on mbed
+* targets.
+*/
+
+#ifndef TRNG_POOL_H
+#define TRNG_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hal/trng_api.h"
+#include "trng_health.h"
+
+#define TRNG_POOL_LINE          64          //indexes written by different threads are kept this far apart
+
+typedef struct {
+    uint32_t capacity;                  //bytes in the ring, a power of 2
+    uint32_t batch;                     //bytes asked of trng_get_bytes per refill, at most capacity
+    trng_t *trng;                       //source, used by the refilling thread only
+    trng_health *health;                //refill through its health tests instead of trng (may be NULL)
+    uint64_t (*now_ns)(void);           //time source of the refill latencies (may be NULL)
+} trng_pool_config;
+
+typedef struct {
+    uint64_t refills;                   //trng_get_bytes calls
+    uint64_t refill_bytes;
+    uint64_t refill_errors;             //calls that failed, health test failures included
+    uint64_t refill_ns;                 //time spent in them
+    uint64_t refill_max_ns;             //slowest of them
+    unsigned long reads;                //trng_pool_read calls, counters of the consumers are words
+    unsigned long hits;                 //reads served in full
+    unsigned long short_reads;          //reads served in part or not at all
+    unsigned long bytes_served;
+    uint32_t level;                     //bytes in the ring when the statistics were taken
+} trng_pool_stats;
+
+typedef struct {
+    uint8_t *ring;
+    uint32_t mask;
+    uint32_t batch;
+    trng_t *trng;
+    trng_health *health;
+    uint64_t (*now_ns)(void);
+
+    /*Producer side*/
+    uint8_t pad0[TRNG_POOL_LINE];
+    uint32_t head;                      //write index, written by the producer only
+    uint32_t stats_seq;                 //odd while the producer updates the counters below
+    uint64_t refills;
+    uint64_t refill_bytes;
+    uint64_t refill_errors;
+    uint64_t refill_ns;
+    uint64_t refill_max_ns;
+
+    /*Consumer side*/
+    uint8_t pad1[TRNG_POOL_LINE];
+    uint32_t tail;                      //read index, claimed by compare and swap
+    unsigned long reads;
+    unsigned long hits;
+    unsigned long short_reads;
+    unsigned long bytes_served;
+    uint8_t pad2[TRNG_POOL_LINE];
+} trng_pool;
+
+/*Set up pool over ring (cfg->capacity bytes). Returns 0, or -1 if the capacity is not a power of 2
+  up to 2^31 or the batch is 0 or larger than the ring*/
+int trng_pool_init(trng_pool *pool, const trng_pool_config *cfg, uint8_t *ring);
+
+/*Producer: if there is room for a batch, ask the trng for it (once, trng_get_bytes may return
+  less) and publish what it returned. Returns the number of bytes added, 0 if the ring has no room
+  for a batch, or the trng_get_bytes (or trng_health_get_bytes) error, the bytes of a call whose
+  health tests failed are dropped*/
+int trng_pool_refill(trng_pool *pool);
+
+/*Consumer: copy up to len bytes out of the pool. Returns the number of bytes served, fewer than
+  len when the pool runs low, never blocks and never calls the driver*/
+size_t trng_pool_read(trng_pool *pool, uint8_t *out, size_t len);
+
+/*trng_get_bytes over the pool, for code written against hal/trng_api.h. Always returns 0,
+  *output_length may be 0 when the pool is empty*/
+int trng_pool_get_bytes(trng_pool *pool, uint8_t *output, size_t length, size_t *output_length);
+
+/*Bytes available to consumers*/
+uint32_t trng_pool_level(const trng_pool *pool);
+
+/*Snapshot of the counters, the producer ones consistent with each other*/
+void trng_pool_get_stats(const trng_pool *pool, trng_pool_stats *stats);
+
+#endif
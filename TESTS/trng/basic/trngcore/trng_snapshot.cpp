@@ -0,0 +1,214 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_snapshot.h"
+#include "trng_core.h"
+
+#include <string.h>
+
+extern "C" {
+#include "lzf.h"
+}
+
+/*Header offsets*/
+#define REC_MAGIC       0
+#define REC_SEQ         4
+#define REC_SAMPLE_LEN  8
+#define REC_META_LEN    10
+#define REC_STORED_META 12
+#define REC_FLAGS       14
+#define REC_CRC         16
+
+static void put16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    put16(p, (uint16_t)v);
+    put16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | p[1] << 8);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return get16(p) | (uint32_t)get16(p + 2) << 16;
+}
+
+/*Read the key of seq into snap->record, returns the record length or 0 if the key does not
+  hold a valid record of that sequence number (any sequence number for seq 0)*/
+static uint16_t load(trng_snapshot *snap, uint16_t slot, uint32_t seq)
+{
+    uint16_t actual = 0;
+    uint8_t *rec = snap->record;
+    if (snap->cfg.store.get(snap->cfg.store.ctx, (uint16_t)(snap->cfg.first_key + slot), snap->cfg.max_record,
+                            rec, &actual) != 0 || actual == 0)
+    {
+        return 0;
+    }
+
+    uint32_t rec_seq = actual >= TRNG_SNAPSHOT_HEADER ? get32(rec + REC_SEQ) : 0;
+    if (actual < TRNG_SNAPSHOT_HEADER || get32(rec + REC_MAGIC) != TRNG_SNAPSHOT_MAGIC ||
+        actual != TRNG_SNAPSHOT_HEADER + get16(rec + REC_SAMPLE_LEN) + get16(rec + REC_STORED_META) ||
+        get32(rec + REC_CRC) != trng_core_crc32(trng_core_crc32(0, rec, REC_CRC),
+                                                     rec + TRNG_SNAPSHOT_HEADER, actual - TRNG_SNAPSHOT_HEADER) ||
+        rec_seq == 0 || rec_seq % snap->cfg.slots != slot)
+    {
+        snap->damaged += seq == 0;
+        return 0;
+    }
+    return seq == 0 || rec_seq == seq ? actual : 0;
+}
+
+int trng_snapshot_open(trng_snapshot *snap, const trng_snapshot_config *cfg, uint8_t *work, size_t work_len)
+{
+    if (cfg->slots == 0 || (uint32_t)cfg->first_key + cfg->slots > 0x10000 ||
+        cfg->max_record <= TRNG_SNAPSHOT_HEADER || cfg->store.get == NULL || cfg->store.set == NULL ||
+        work == NULL || work_len < TRNG_SNAPSHOT_WORK_SIZE(cfg->max_record))
+    {
+        return TRNG_SNAPSHOT_ERR_CONFIG;
+    }
+
+    memset(snap, 0, sizeof(*snap));
+    snap->cfg = *cfg;
+    snap->record = work;
+    snap->meta = work + cfg->max_record;
+
+    uint32_t newest = 0;
+    for (uint16_t slot = 0; slot < cfg->slots; slot++)
+    {
+        if (load(snap, slot, 0) != 0)
+        {
+            uint32_t seq = get32(snap->record + REC_SEQ);
+            newest = seq > newest ? seq : newest;
+            snap->found++;
+        }
+    }
+    snap->next_seq = newest + 1;
+    return 0;
+}
+
+int trng_snapshot_append(trng_snapshot *snap, const uint8_t *sample, uint16_t sample_len,
+                         const uint8_t *meta, uint16_t meta_len, lzf_ctx *lzf)
+{
+    uint8_t *rec = snap->record;
+    uint32_t room = snap->cfg.max_record - TRNG_SNAPSHOT_HEADER;
+    if (sample_len > room || meta_len > snap->cfg.max_record)
+    {
+        return TRNG_SNAPSHOT_ERR_SIZE;
+    }
+
+    /*Compressed only when it saves at least a byte and fits*/
+    uint16_t flags = 0;
+    unsigned int stored = 0;
+    room -= sample_len;
+    if (lzf != NULL && meta_len > 1)
+    {
+        unsigned int out_len = (unsigned int)meta_len - 1 < room ? (unsigned int)meta_len - 1 : room;
+        stored = trng_core_compress(meta, meta_len, rec + TRNG_SNAPSHOT_HEADER + sample_len, out_len, lzf);
+        flags = stored != 0 ? TRNG_SNAPSHOT_META_LZF : 0;
+    }
+    if (stored == 0)
+    {
+        if (meta_len > room)
+        {
+            return TRNG_SNAPSHOT_ERR_SIZE;
+        }
+        if (meta_len != 0)
+        {
+            memcpy(rec + TRNG_SNAPSHOT_HEADER + sample_len, meta, meta_len);
+        }
+        stored = meta_len;
+    }
+    if (sample_len != 0)
+    {
+        memcpy(rec + TRNG_SNAPSHOT_HEADER, sample, sample_len);
+    }
+
+    uint32_t seq = snap->next_seq;
+    uint16_t len = (uint16_t)(TRNG_SNAPSHOT_HEADER + sample_len + stored);
+    put32(rec + REC_MAGIC, TRNG_SNAPSHOT_MAGIC);
+    put32(rec + REC_SEQ, seq);
+    put16(rec + REC_SAMPLE_LEN, sample_len);
+    put16(rec + REC_META_LEN, meta_len);
+    put16(rec + REC_STORED_META, (uint16_t)stored);
+    put16(rec + REC_FLAGS, flags);
+    put32(rec + REC_CRC, trng_core_crc32(trng_core_crc32(0, rec, REC_CRC),
+                                             rec + TRNG_SNAPSHOT_HEADER, len - TRNG_SNAPSHOT_HEADER));
+
+    snap->writes++;
+    if (snap->cfg.store.set(snap->cfg.store.ctx, (uint16_t)(snap->cfg.first_key + seq % snap->cfg.slots), len, rec) != 0)
+    {
+        return TRNG_SNAPSHOT_ERR_STORE;
+    }
+    snap->next_seq++;
+    return 0;
+}
+
+uint32_t trng_snapshot_read(trng_snapshot *snap, trng_snapshot_cb cb, void *ctx)
+{
+    uint32_t seq = snap->next_seq > snap->cfg.slots ? snap->next_seq - snap->cfg.slots : 1;
+    uint32_t passed = 0;
+
+    for (; seq < snap->next_seq; seq++)
+    {
+        uint16_t len = load(snap, (uint16_t)(seq % snap->cfg.slots), seq);
+        if (len == 0)
+        {
+            continue;
+        }
+
+        const uint8_t *rec = snap->record;
+        trng_snapshot_record record;
+        record.seq = seq;
+        record.sample_len = get16(rec + REC_SAMPLE_LEN);
+        record.meta_len = get16(rec + REC_META_LEN);
+        record.stored_len = len;
+        record.flags = get16(rec + REC_FLAGS);
+        record.sample = rec + TRNG_SNAPSHOT_HEADER;
+        record.meta = record.sample + record.sample_len;
+
+        uint16_t stored_meta = get16(rec + REC_STORED_META);
+        if (record.flags & TRNG_SNAPSHOT_META_LZF)
+        {
+            if (record.meta_len > snap->cfg.max_record ||
+                lzf_decompress(record.meta, stored_meta, snap->meta, record.meta_len) != record.meta_len)
+            {
+                snap->damaged++;
+                continue;
+            }
+            record.meta = snap->meta;
+        }
+        else if (stored_meta != record.meta_len)
+        {
+            snap->damaged++;
+            continue;
+        }
+
+        passed++;
+        if (cb(&record, ctx) != 0)
+        {
+            break;
+        }
+    }
+    return passed;
+}
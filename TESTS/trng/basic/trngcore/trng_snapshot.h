@@ -0,0 +1,113 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* History of trng samples across boots, as a ring of records over a range of
+* NVStore keys. Every boot appends one record (a sample and optional
+* metadata) to the key after the last one written, overwriting the oldest
+* once the ring is full, with a single set call. NVStore writes every set
+* as a new record in its log, so keeping the history in one key would write
+* all of it on every boot; here a boot writes one record whatever the length
+* of the history.
+*
+* A record is a 20 byte little endian header (magic, sequence number,
+* lengths, flags and the CRC-32 of the rest) followed by the sample and the
+* metadata, LZF compressed when that makes it shorter. trng_snapshot_open
+* reads every key once to find the newest sequence number, appends are then
+* O(1), and trng_snapshot_read streams the history from the oldest record to
+* the newest through a work buffer of two records. Records that are missing,
+* torn or from another ring are skipped.
+*
+* The keys are reached through get and set callbacks with the NVStore
+* signatures, so the format can be used with other stores and on the host.
+*/
+
+#ifndef TRNG_SNAPSHOT_H
+#define TRNG_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+extern "C" {
+#include "lzf_ctx.h"
+}
+
+#define TRNG_SNAPSHOT_MAGIC         0x31534e54  //"TNS1"
+#define TRNG_SNAPSHOT_HEADER        20          //bytes of the record header
+#define TRNG_SNAPSHOT_META_LZF      1           //flag: the metadata is stored LZF compressed
+
+#define TRNG_SNAPSHOT_ERR_CONFIG    -1          //bad config or work buffer too small
+#define TRNG_SNAPSHOT_ERR_STORE     -2          //the set callback failed, the record may be missing
+#define TRNG_SNAPSHOT_ERR_SIZE      -3          //the record would not fit in max_record bytes
+
+/*Work buffer of trng_snapshot_open for records of up to max_record bytes*/
+#define TRNG_SNAPSHOT_WORK_SIZE(max_record)     (2 * (size_t)(max_record))
+
+typedef struct {
+    /*Returns 0 and the length of the key in *actual when it was read, anything else when it is
+      missing or could not be read*/
+    int (*get)(void *ctx, uint16_t key, uint16_t buf_size, void *buf, uint16_t *actual);
+    /*Returns 0 when the key was written*/
+    int (*set)(void *ctx, uint16_t key, uint16_t size, const void *buf);
+    void *ctx;
+} trng_snapshot_store;
+
+typedef struct {
+    uint16_t first_key;                 //the ring is keys first_key to first_key + slots - 1
+    uint16_t slots;                     //records kept
+    uint16_t max_record;                //largest record, header included, and largest metadata
+    trng_snapshot_store store;
+} trng_snapshot_config;
+
+typedef struct {
+    uint32_t seq;                       //sequence number, the first record appended is 1
+    uint16_t sample_len;
+    uint16_t meta_len;
+    uint16_t stored_len;                //bytes the record takes in the store
+    uint16_t flags;
+    const uint8_t *sample;              //valid during the callback only
+    const uint8_t *meta;
+} trng_snapshot_record;
+
+/*Called for every record by trng_snapshot_read, a non zero return stops the read*/
+typedef int (*trng_snapshot_cb)(const trng_snapshot_record *record, void *ctx);
+
+typedef struct {
+    trng_snapshot_config cfg;
+    uint8_t *record;                    //max_record bytes for a record as stored
+    uint8_t *meta;                      //max_record bytes for decompressed metadata
+    uint32_t next_seq;                  //sequence number of the next append
+    uint32_t found;                     //valid records found by trng_snapshot_open
+    uint32_t damaged;                   //records found with a bad header or CRC
+    uint32_t writes;                    //set calls since trng_snapshot_open
+} trng_snapshot;
+
+/*Attach snap to the ring described by cfg and find its newest record with one get per key.
+  work (TRNG_SNAPSHOT_WORK_SIZE(cfg->max_record) bytes) must outlive snap. Returns 0, or
+  TRNG_SNAPSHOT_ERR_CONFIG*/
+int trng_snapshot_open(trng_snapshot *snap, const trng_snapshot_config *cfg, uint8_t *work, size_t work_len);
+
+/*Write a record of sample and meta (may be NULL, meta_len 0) to the oldest key of the ring with
+  one set call. The metadata is compressed with the hash table of lzf when it gets shorter, lzf
+  may be NULL to store it as it is. Returns 0, TRNG_SNAPSHOT_ERR_SIZE or TRNG_SNAPSHOT_ERR_STORE*/
+int trng_snapshot_append(trng_snapshot *snap, const uint8_t *sample, uint16_t sample_len,
+                         const uint8_t *meta, uint16_t meta_len, lzf_ctx *lzf);
+
+/*Call cb for every valid record of the ring from the oldest to the newest, one get per key.
+  Returns the number of records passed to cb*/
+uint32_t trng_snapshot_read(trng_snapshot *snap, trng_snapshot_cb cb, void *ctx);
+
+#endif
@@ -0,0 +1,220 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_stream.h"
+#include "trng_core.h"
+#include "trng_bits.h"
+
+#include <math.h>
+#include <string.h>
+
+void trng_stream_stats_init(trng_stream_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+void trng_stream_stats_update(trng_stream_stats *stats, const uint8_t *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+
+    uint64_t ones = 0, sum = 0, sum_sq = 0, sum_lag = 0;
+    uint32_t prev = stats->last;
+
+    if (stats->bytes == 0)
+    {
+        stats->first = data[0];
+        prev = data[0];
+        stats->histogram[data[0]]++;
+        ones += trng_popcount32(data[0]);
+        sum += data[0];
+        sum_sq += (uint32_t)data[0] * data[0];
+        data++;
+        len--;
+        stats->bytes++;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        uint32_t v = data[i];
+        stats->histogram[v]++;
+        ones += trng_popcount32(v);
+        sum += v;
+        sum_sq += v * v;
+        sum_lag += prev * v;
+        prev = v;
+    }
+
+    stats->ones += ones;
+    stats->sum += sum;
+    stats->sum_sq += sum_sq;
+    stats->sum_lag += sum_lag;
+    stats->last = (uint8_t)prev;
+    stats->bytes += len;
+}
+
+void trng_stream_stats_merge(trng_stream_stats *stats, const trng_stream_stats *next)
+{
+    /*Only the product of the bytes on either side of the seam is missing from the sums*/
+    if (next->bytes != 0)
+    {
+        if (stats->bytes == 0)
+        {
+            stats->first = next->first;
+        }
+        else
+        {
+            stats->sum_lag += (uint64_t)stats->last * next->first;
+        }
+        stats->last = next->last;
+    }
+
+    stats->bytes += next->bytes;
+    stats->chunks += next->chunks;
+    stats->compressible_chunks += next->compressible_chunks;
+    stats->compressed_bytes += next->compressed_bytes;
+    stats->scanned_bytes += next->scanned_bytes;
+    stats->matched_bytes += next->matched_bytes;
+    stats->verified_chunks += next->verified_chunks;
+    stats->verify_failures += next->verify_failures;
+    stats->model_chunks += next->model_chunks;
+    stats->model_bytes += next->model_bytes;
+    stats->ones += next->ones;
+    stats->sum += next->sum;
+    stats->sum_sq += next->sum_sq;
+    stats->sum_lag += next->sum_lag;
+    for (int i = 0; i < 256; i++)
+    {
+        stats->histogram[i] += next->histogram[i];
+    }
+    stats->elapsed_us = next->elapsed_us > stats->elapsed_us ? next->elapsed_us : stats->elapsed_us;
+}
+
+void trng_stream_summarize(const trng_stream_stats *stats, trng_stream_summary *summary)
+{
+    memset(summary, 0, sizeof(*summary));
+    if (stats->bytes == 0)
+    {
+        return;
+    }
+
+    double n = (double)stats->bytes;
+    double expected = n / 256.0;
+
+    summary->mean = (double)stats->sum / n;
+    summary->bit_bias = (double)stats->ones / (n * 8.0);
+    summary->compression_ratio = (double)stats->compressed_bytes / n;
+    summary->throughput = stats->elapsed_us ? n * 1e6 / (double)stats->elapsed_us : 0.0;
+
+    for (int i = 0; i < 256; i++)
+    {
+        double count = (double)stats->histogram[i];
+        summary->chi_square += (count - expected) * (count - expected) / expected;
+        if (count > 0)
+        {
+            double p = count / n;
+            summary->entropy -= p * log2(p);
+        }
+    }
+
+    /*Serial correlation of the cyclic sequence, as computed by the ent tool*/
+    double t1 = (double)stats->sum_lag + (double)stats->last * stats->first;
+    double t2 = (double)stats->sum * (double)stats->sum;
+    double t3 = (double)stats->sum_sq;
+    double denom = n * t3 - t2;
+    summary->serial_correlation = denom != 0.0 ? (n * t1 - t2) / denom : 1.0;
+}
+
+int trng_stream_qualify(trng_t *obj, const trng_stream_config *cfg,
+                        uint8_t *chunk_buf, uint8_t *comp_buf, lzf_ctx *ctx,
+                        trng_stream_stats *stats)
+{
+    uint64_t start = cfg->now_us ? cfg->now_us() : 0;
+    uint64_t next_progress = cfg->progress_interval;
+    unsigned int out_len = trng_core_threshold(cfg->chunk_len, cfg->percentage);
+    int trng_res = 0;
+
+    trng_stream_stats_init(stats);
+    if (cfg->chunk_len == 0)
+    {
+        return TRNG_STREAM_ERR_CONFIG;
+    }
+
+    while (stats->bytes + cfg->chunk_len <= cfg->total_bytes)
+    {
+        trng_res = cfg->fill ? cfg->fill(cfg->fill_ctx, chunk_buf, cfg->chunk_len)
+                             : trng_core_fill(obj, chunk_buf, cfg->chunk_len);
+        if (trng_res != 0)
+        {
+            break;
+        }
+
+        unsigned int comp_res;
+
+        if (cfg->verify_buf == NULL && cfg->stream != NULL)
+        {
+            /*Looked at in full, the history has to take every byte*/
+            comp_res = lzf_stream_compress(cfg->stream, chunk_buf, cfg->chunk_len, NULL, out_len);
+            stats->scanned_bytes += cfg->chunk_len;
+        }
+        else if (cfg->verify_buf == NULL)
+        {
+            lzf_screen_stats screen;
+            comp_res = trng_core_screen(chunk_buf, cfg->chunk_len, out_len, ctx, &screen);
+            stats->scanned_bytes += screen.scanned;
+            stats->matched_bytes += screen.match_bytes;
+        }
+        else
+        {
+            /*Compressed in full, the threshold is applied to the size*/
+            comp_res = trng_core_compress(chunk_buf, cfg->chunk_len, comp_buf, LZF_COMPRESS_BOUND(cfg->chunk_len), ctx);
+            stats->verified_chunks++;
+            if (comp_res == 0 ||
+                trng_core_verify(comp_buf, comp_res, chunk_buf, cfg->chunk_len, cfg->verify_buf) != 0)
+            {
+                stats->verify_failures++;
+            }
+            comp_res = comp_res <= out_len ? comp_res : 0;
+        }
+
+        stats->compressible_chunks += comp_res != 0;
+        stats->compressed_bytes += comp_res != 0 ? comp_res : cfg->chunk_len;
+        stats->chunks++;
+        if (cfg->model != NULL)
+        {
+            unsigned int model_res = trng_model_screen(cfg->model, chunk_buf, cfg->chunk_len, out_len);
+            stats->model_chunks += model_res != 0;
+            stats->model_bytes += model_res != 0 ? model_res : cfg->chunk_len;
+        }
+        trng_stream_stats_update(stats, chunk_buf, cfg->chunk_len);
+        if (cfg->nist != NULL)
+        {
+            trng_nist_update(cfg->nist, chunk_buf, cfg->chunk_len);
+        }
+
+        if (cfg->progress != NULL && next_progress != 0 && stats->bytes >= next_progress)
+        {
+            stats->elapsed_us = cfg->now_us ? cfg->now_us() - start : 0;
+            cfg->progress(stats, cfg->progress_ctx);
+            next_progress += cfg->progress_interval;
+        }
+    }
+
+    stats->elapsed_us = cfg->now_us ? cfg->now_us() - start : 0;
+    return trng_res;
+}
@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Streaming qualification of a trng: pulls total_bytes through trng_get_bytes
+* in chunk_len steps, screens every chunk against the compression threshold
+* (or compresses it in full when verifying) and keeps running statistics so
+* memory use is bounded by the caller supplied buffers whatever the amount
+* of data is.
+*/
+
+#ifndef TRNG_STREAM_H
+#define TRNG_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "trng_core.h"
+#include "trng_nist.h"
+#include "trng_model.h"
+
+#define TRNG_STREAM_ERR_CONFIG      -1000       //chunk_len of 0, out of the range of trng_get_bytes errors
+
+typedef struct {
+    uint64_t bytes;                     //bytes consumed so far
+    uint64_t chunks;                    //chunks consumed so far
+    uint64_t compressible_chunks;       //chunks that compressed below the threshold
+    uint64_t compressed_bytes;          //running compressed size, incompressible chunks count in full
+    uint64_t scanned_bytes;             //bytes the screening looked at before settling the chunks
+    uint64_t matched_bytes;             //bytes covered by the back references it found
+    uint64_t verified_chunks;           //chunks that went through a compress/decompress round trip
+    uint64_t verify_failures;           //round trips that did not reproduce the chunk
+    uint64_t model_chunks;              //chunks the entropy coding model put below the threshold
+    uint64_t model_bytes;               //running size by the model, chunks above the threshold count in full
+    uint64_t ones;                      //number of set bits
+    uint64_t sum;                       //sum of all bytes
+    uint64_t sum_sq;                    //sum of squared bytes
+    uint64_t sum_lag;                   //sum of products of adjacent bytes
+    uint32_t histogram[256];
+    uint8_t first;                      //first and last byte, used to close the serial correlation
+    uint8_t last;
+    uint64_t elapsed_us;                //time spent since trng_stream_qualify started
+} trng_stream_stats;
+
+typedef struct {
+    double mean;                        //127.5 for random data
+    double bit_bias;                    //fraction of set bits, 0.5 for random data
+    double chi_square;                  //byte distribution, 255 degrees of freedom
+    double entropy;                     //Shannon entropy in bits per byte
+    double serial_correlation;          //close to 0 for random data
+    double compression_ratio;           //compressed_bytes / bytes
+    double throughput;                  //bytes per second
+} trng_stream_summary;
+
+typedef void (*trng_stream_progress_cb)(const trng_stream_stats *stats, void *ctx);
+
+typedef struct {
+    uint64_t total_bytes;               //amount of data to qualify, rounded down to chunk_len
+    unsigned int chunk_len;             //bytes taken from the trng per step
+    unsigned int percentage;            //compression threshold, as COMPRESS_TEST_PERCENTAGE
+    uint64_t progress_interval;         //bytes between progress calls, 0 - never
+    trng_stream_progress_cb progress;
+    void *progress_ctx;
+    uint64_t (*now_us)(void);           //time source, may be NULL
+    uint8_t *verify_buf;                //chunk_len bytes, when set every chunk is round tripped
+    trng_nist *nist;                    //initialized battery fed with every chunk, may be NULL
+    int (*fill)(void *ctx, uint8_t *buf, size_t len);   //source of the chunks in place of obj, may be NULL
+    void *fill_ctx;
+    lzf_stream *stream;                 //screens every chunk against the ones before it in place of ctx, may be NULL
+    trng_model *model;                  //second checker next to lzf, every chunk is priced by it too, may be NULL
+} trng_stream_config;
+
+/*Reset stats to an empty stream*/
+void trng_stream_stats_init(trng_stream_stats *stats);
+
+/*Account len bytes of data in stats*/
+void trng_stream_stats_update(trng_stream_stats *stats, const uint8_t *data, size_t len);
+
+/*Append the stats of the data following stats, as if it had gone through the same stream. Merging
+  is associative, so stats of consecutive pieces can be combined in any grouping but must keep their
+  order. elapsed_us takes the larger of the two*/
+void trng_stream_stats_merge(trng_stream_stats *stats, const trng_stream_stats *next);
+
+/*Derive the summary of stats*/
+void trng_stream_summarize(const trng_stream_stats *stats, trng_stream_summary *summary);
+
+/*Qualify cfg->total_bytes of trng output. chunk_buf holds cfg->chunk_len bytes, comp_buf is only
+  used with cfg->verify_buf set and holds LZF_COMPRESS_BOUND(cfg->chunk_len) bytes, as every chunk is
+  then compressed in full and decompressed back, otherwise chunks are only screened (compressed_bytes
+  then counts the size bound of compressible chunks) and comp_buf may be NULL. ctx is the lzf compressor
+  context. With cfg->stream set (and no verify_buf) chunks are screened in one stream, so data
+  repeating within its window is caught across chunks in constant memory. With cfg->model set every
+  chunk is also priced by the entropy coding model against the same threshold (model_chunks). With
+  cfg->nist set every chunk is also run through the SP 800-22 battery, trng_nist_final
+  is left to the caller. Chunks come from cfg->fill when set (a DRBG for instance) and obj is then
+  not used. Returns 0, TRNG_STREAM_ERR_CONFIG (with stats zeroed) if cfg->chunk_len is 0, or the
+  trng_get_bytes (or fill) error that stopped the stream*/
+int trng_stream_qualify(trng_t *obj, const trng_stream_config *cfg,
+                        uint8_t *chunk_buf, uint8_t *comp_buf, lzf_ctx *ctx,
+                        trng_stream_stats *stats);
+
+#endif
@@ -0,0 +1,258 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "trng_trace.h"
+#include "trng_atomic.h"
+#include "trng_bits.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*Thread local storage of the hosted GCC and clang targets, the mbed toolchains have none*/
+#if defined(__GNUC__) && (defined(__linux__) || defined(__APPLE__))
+#define TRACE_PER_THREAD        1
+#else
+#define TRACE_PER_THREAD        0
+#endif
+
+/*A block shared by every thread adds to the tick sum atomically, 64 bit only where that
+  takes no lock or the adds are critical sections anyway. The 32 bit sum of us_ticker ticks
+  wraps after 71 minutes*/
+#if TRACE_PER_THREAD || TRNG_ATOMIC_CRITICAL || __GCC_ATOMIC_LLONG_LOCK_FREE == 2
+typedef uint64_t trace_sum;
+#else
+typedef uint32_t trace_sum;
+#endif
+
+#define REC_MAGIC       0
+#define REC_SITE        2
+#define REC_BUCKETS     3
+#define REC_HZ          4
+#define REC_CALLS       8
+#define REC_UNITS       12
+#define REC_TICKS       16
+#define REC_MAX         24
+#define REC_HISTOGRAM   28
+
+typedef struct {
+    uint32_t calls;
+    uint32_t units;
+    trace_sum ticks;
+    uint32_t max;
+    uint32_t buckets[TRNG_TRACE_BUCKETS];
+} trace_counters;
+
+typedef struct trace_block {
+    trace_counters site[TRNG_TRACE_SITES];
+    struct trace_block *next;           //blocks of the other threads
+} trace_block;
+
+static const char *const site_names[TRNG_TRACE_SITES] = {
+    "trng_get_bytes", "fill", "lzf", "base64", "nvstore"
+};
+
+static trng_trace_now_fn trace_now = NULL;
+static uint32_t trace_hz = 0;
+
+#if TRACE_PER_THREAD
+static trace_block *trace_blocks = NULL;
+static __thread trace_block *trace_own = NULL;
+
+/*Block of the calling thread, made and put on the list on its first record. Blocks outlive
+  their threads so the counts of the threads that ended stay in the snapshots*/
+static trace_block *trace_local(void)
+{
+    trace_block *b = trace_own;
+    if (b == NULL)
+    {
+        b = (trace_block *)calloc(1, sizeof(*b));
+        if (b == NULL)
+        {
+            return NULL;
+        }
+        b->next = LOAD_RELAXED(&trace_blocks);
+        while (!CAS_RELEASE(&trace_blocks, &b->next, b))
+        {
+        }
+        trace_own = b;
+    }
+    return b;
+}
+
+static trace_block *trace_first(void)
+{
+    return LOAD_ACQUIRE(&trace_blocks);
+}
+#else
+static trace_block trace_shared;
+
+static trace_block *trace_first(void)
+{
+    return &trace_shared;
+}
+#endif
+
+void trng_trace_clock(trng_trace_now_fn now, uint32_t hz)
+{
+    STORE_RELAXED(&trace_now, now);
+    STORE_RELAXED(&trace_hz, now ? hz : 0);
+}
+
+uint32_t trng_trace_now(void)
+{
+    trng_trace_now_fn now = LOAD_RELAXED(&trace_now);
+    return now ? now() : 0;
+}
+
+unsigned int trng_trace_bucket(uint32_t ticks)
+{
+    unsigned int b = ticks ? 32 - trng_clz32(ticks) : 0;
+    return b < TRNG_TRACE_BUCKETS ? b : TRNG_TRACE_BUCKETS - 1;
+}
+
+void trng_trace_record(unsigned int site, uint32_t ticks, uint32_t units)
+{
+    if (site >= TRNG_TRACE_SITES)
+    {
+        return;
+    }
+
+#if TRACE_PER_THREAD
+    /*Only this thread writes the block, the stores are atomic for the snapshots alone*/
+    trace_block *b = trace_local();
+    if (b == NULL)
+    {
+        return;
+    }
+    trace_counters *c = &b->site[site];
+    uint32_t *bucket = &c->buckets[trng_trace_bucket(ticks)];
+    STORE_RELAXED(&c->calls, LOAD_RELAXED(&c->calls) + 1);
+    STORE_RELAXED(&c->units, LOAD_RELAXED(&c->units) + units);
+    STORE_RELAXED(&c->ticks, LOAD_RELAXED(&c->ticks) + ticks);
+    STORE_RELAXED(bucket, LOAD_RELAXED(bucket) + 1);
+    if (ticks > LOAD_RELAXED(&c->max))
+    {
+        STORE_RELAXED(&c->max, ticks);
+    }
+#else
+    trace_counters *c = &trace_shared.site[site];
+    ADD_RELAXED(&c->calls, 1);
+    ADD_RELAXED(&c->units, units);
+    ADD_RELAXED(&c->ticks, (trace_sum)ticks);
+    ADD_RELAXED(&c->buckets[trng_trace_bucket(ticks)], 1);
+    uint32_t max = LOAD_RELAXED(&c->max);
+    while (ticks > max &&
+           !CAS_RELAXED(&c->max, &max, ticks))
+    {
+    }
+#endif
+}
+
+void trng_trace_snapshot(trng_trace *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->hz = LOAD_RELAXED(&trace_hz);
+
+    for (trace_block *b = trace_first(); b != NULL; b = b->next)
+    {
+        for (unsigned int s = 0; s < TRNG_TRACE_SITES; s++)
+        {
+            trace_counters *c = &b->site[s];
+            trng_trace_site *o = &out->site[s];
+            uint32_t max = LOAD_RELAXED(&c->max);
+            o->calls += LOAD_RELAXED(&c->calls);
+            o->units += LOAD_RELAXED(&c->units);
+            o->ticks += LOAD_RELAXED(&c->ticks);
+            o->max = max > o->max ? max : o->max;
+            for (unsigned int i = 0; i < TRNG_TRACE_BUCKETS; i++)
+            {
+                o->buckets[i] += LOAD_RELAXED(&c->buckets[i]);
+            }
+        }
+    }
+}
+
+void trng_trace_reset(void)
+{
+    for (trace_block *b = trace_first(); b != NULL; b = b->next)
+    {
+        memset(b->site, 0, sizeof(b->site));
+    }
+}
+
+const char *trng_trace_site_name(unsigned int site)
+{
+    return site < TRNG_TRACE_SITES ? site_names[site] : NULL;
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+size_t trng_trace_pack(const trng_trace *trace, unsigned int site, uint8_t *out, size_t len)
+{
+    if (site >= TRNG_TRACE_SITES || len < TRNG_TRACE_RECORD)
+    {
+        return 0;
+    }
+
+    const trng_trace_site *s = &trace->site[site];
+    out[REC_MAGIC] = (uint8_t)TRNG_TRACE_MAGIC;
+    out[REC_MAGIC + 1] = (uint8_t)(TRNG_TRACE_MAGIC >> 8);
+    out[REC_SITE] = (uint8_t)site;
+    out[REC_BUCKETS] = TRNG_TRACE_BUCKETS;
+    put32(out + REC_HZ, trace->hz);
+    put32(out + REC_CALLS, s->calls);
+    put32(out + REC_UNITS, s->units);
+    put32(out + REC_TICKS, (uint32_t)s->ticks);
+    put32(out + REC_TICKS + 4, (uint32_t)(s->ticks >> 32));
+    put32(out + REC_MAX, s->max);
+    for (unsigned int i = 0; i < TRNG_TRACE_BUCKETS; i++)
+    {
+        put32(out + REC_HISTOGRAM + 4 * i, s->buckets[i]);
+    }
+    return TRNG_TRACE_RECORD;
+}
+
+int trng_trace_unpack(const uint8_t *in, size_t len, trng_trace *trace)
+{
+    if (len != TRNG_TRACE_RECORD || (in[REC_MAGIC] | in[REC_MAGIC + 1] << 8) != TRNG_TRACE_MAGIC ||
+        in[REC_SITE] >= TRNG_TRACE_SITES || in[REC_BUCKETS] != TRNG_TRACE_BUCKETS)
+    {
+        return -1;
+    }
+
+    trng_trace_site *s = &trace->site[in[REC_SITE]];
+    trace->hz = get32(in + REC_HZ);
+    s->calls = get32(in + REC_CALLS);
+    s->units = get32(in + REC_UNITS);
+    s->ticks = get32(in + REC_TICKS) | (uint64_t)get32(in + REC_TICKS + 4) << 32;
+    s->max = get32(in + REC_MAX);
+    for (unsigned int i = 0; i < TRNG_TRACE_BUCKETS; i++)
+    {
+        s->buckets[i] = get32(in + REC_HISTOGRAM + 4 * i);
+    }
+    return in[REC_SITE];
+}
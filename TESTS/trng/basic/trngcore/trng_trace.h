@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Latency and throughput counters of the hot paths: every trng_get_bytes
+* call, every trng_core_fill (with the number of reads it took), the lzf
+* screening and the base64 and NVStore transfers of the test. A site counts
+* its calls, the units it moved (bytes, or reads for a fill), the sum and
+* the highest of its latencies, and the latencies in log2 buckets of clock
+* ticks. The clock is whatever the platform hands to trng_trace_clock: the
+* device test uses us_ticker, the host tools the monotonic clock in ticks of
+* 64 ns.
+*
+* The sites are compiled in only when TRNG_TRACE is defined to 1 (e.g. in
+* the macros of mbed_app.json), otherwise TRNG_TRACE_BEGIN and
+* TRNG_TRACE_END expand to nothing. Where the compiler has thread local
+* storage every thread records into a block of its own with plain relaxed
+* stores, and trng_trace_snapshot adds the blocks up; elsewhere (the mbed
+* targets) every thread records into one block with relaxed atomic adds.
+* Neither takes a lock. A snapshot packs into a record of
+* TRNG_TRACE_RECORD bytes per site, small enough to go to the host base64
+* encoded in one greentea message.
+*/
+
+#ifndef TRNG_TRACE_H
+#define TRNG_TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef TRNG_TRACE
+#define TRNG_TRACE                  0           //1 - compile the sites of the hot paths in
+#endif
+
+#define TRNG_TRACE_GET_BYTES        0           //one trng_get_bytes call, units are bytes returned
+#define TRNG_TRACE_FILL             1           //one trng_core_fill, units are trng_get_bytes calls
+#define TRNG_TRACE_LZF              2           //lzf screening or compression, units are bytes in
+#define TRNG_TRACE_BASE64           3           //base64 encoding or decoding, units are binary bytes
+#define TRNG_TRACE_NVSTORE          4           //NVStore get or set, units are bytes
+#define TRNG_TRACE_SITES            5
+
+#define TRNG_TRACE_BUCKETS          16          //bucket b > 0 holds [2^(b-1), 2^b) ticks, the last one the rest
+#define TRNG_TRACE_MAGIC            0x5454      //"TT"
+#define TRNG_TRACE_RECORD           92          //bytes of the packed record of a site
+
+typedef struct {
+    uint32_t calls;
+    uint32_t units;
+    uint64_t ticks;                     //sum of the latencies
+    uint32_t max;                       //highest latency
+    uint32_t buckets[TRNG_TRACE_BUCKETS];
+} trng_trace_site;
+
+typedef struct {
+    uint32_t hz;                        //ticks per second of the clock, 0 - no clock
+    trng_trace_site site[TRNG_TRACE_SITES];
+} trng_trace;
+
+/*Latency clock, returns ticks of a counter wrapping at 2^32*/
+typedef uint32_t (*trng_trace_now_fn)(void);
+
+/*Take latencies from now, hz ticks per second. Without a clock only calls and units are counted*/
+void trng_trace_clock(trng_trace_now_fn now, uint32_t hz);
+
+/*Current tick of the clock, 0 without one*/
+uint32_t trng_trace_now(void);
+
+/*Count a call of site that took ticks and moved units*/
+void trng_trace_record(unsigned int site, uint32_t ticks, uint32_t units);
+
+/*Bucket of a latency of ticks*/
+unsigned int trng_trace_bucket(uint32_t ticks);
+
+/*Counters of every thread added up into out. Sites running meanwhile may or may not be in*/
+void trng_trace_snapshot(trng_trace *out);
+
+/*Zero the counters of every thread, while no site is running*/
+void trng_trace_reset(void);
+
+/*Name of a site, NULL if there is none*/
+const char *trng_trace_site_name(unsigned int site);
+
+/*Pack site of trace into TRNG_TRACE_RECORD little endian bytes of out. Returns the record
+  size, or 0 if the site does not exist or len is too small*/
+size_t trng_trace_pack(const trng_trace *trace, unsigned int site, uint8_t *out, size_t len);
+
+/*Unpack a record into site of trace (hz included). Returns the site, or -1 if the record is
+  damaged*/
+int trng_trace_unpack(const uint8_t *in, size_t len, trng_trace *trace);
+
+#if TRNG_TRACE
+#define TRNG_TRACE_BEGIN(t)                 uint32_t t = trng_trace_now()
+#define TRNG_TRACE_END(site, t, units)      trng_trace_record(site, trng_trace_now() - (t), (uint32_t)(units))
+#else
+#define TRNG_TRACE_BEGIN(t)
+#define TRNG_TRACE_END(site, t, units)      ((void)(units))
+#endif
+
+#endif
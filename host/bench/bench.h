@@ -0,0 +1,64 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Shared helpers of the host benchmark driver, every suite is a function
+* registered in bench_main.cpp and reports its stages with bench_report().
+*/
+
+#ifndef TRNG_BENCH_H
+#define TRNG_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "host_util.h"
+
+/*Print one result line: bytes processed by a stage in ns nanoseconds*/
+void bench_report(const char *suite, const char *stage, uint64_t bytes, uint64_t ns);
+
+/*Same as bench_report for a stage made of calls, adds the latency per call*/
+void bench_report_calls(const char *suite, const char *stage, uint64_t calls, uint64_t bytes, uint64_t ns);
+
+/*Fill buf with len bytes from the selected trng source, returns 0 on success*/
+int bench_acquire(uint8_t *buf, size_t len);
+
+/*Derive data.size() bytes of biased (every bit set with probability 7/8) or
+  repetitive (random 256 byte blocks repeated with a changed byte) data from noise*/
+void bench_make_biased(std::vector<uint8_t> &data, const std::vector<uint8_t> &noise);
+void bench_make_repetitive(std::vector<uint8_t> &data, const std::vector<uint8_t> &noise);
+
+/*Benchmark suites*/
+int bench_pipeline(int argc, char **argv);
+int bench_htab(int argc, char **argv);
+int bench_match(int argc, char **argv);
+int bench_screen(int argc, char **argv);
+int bench_base64(int argc, char **argv);
+int bench_nist(int argc, char **argv);
+int bench_entropy(int argc, char **argv);
+int bench_health(int argc, char **argv);
+int bench_pool(int argc, char **argv);
+int bench_drbg(int argc, char **argv);
+int bench_parallel(int argc, char **argv);
+int bench_fingerprint(int argc, char **argv);
+int bench_snapshot(int argc, char **argv);
+int bench_lzfstream(int argc, char **argv);
+int bench_variant(int argc, char **argv);
+int bench_model(int argc, char **argv);
+int bench_trace(int argc, char **argv);
+int bench_async(int argc, char **argv);
+
+#endif
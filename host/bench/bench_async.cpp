@@ -0,0 +1,223 @@
+/*
+* Acquisition through trng_async.h against the synchronous loop, with the
+* stand-in made slow (by default 50 us per trng_get_bytes call plus 20 ns
+* per byte, --call-delay and --byte-delay override it). Chunks of --chunk
+* bytes are read and screened one after the other with trng_core_fill,
+* then double buffered: chunk k+1 is submitted before chunk k is screened,
+* so screening overlaps the read. --requests small reads of --read bytes
+* are made one trng_core_fill each, then submitted at once to a draining
+* thread with a stage of --stage bytes, which batches them into a few
+* driver calls. Timings are the best of 8 passes.
+*/
+
+#include "bench.h"
+#include "trng_async.h"
+#include "trng_core.h"
+#include "trng_host.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+struct drain_thread {
+    trng_async async;
+    std::mutex lock;
+    std::condition_variable cv;         //work for the drain, or a completion for the submitter
+    bool stop;
+    unsigned int completed;
+};
+
+static void wake(void *ctx)
+{
+    drain_thread *d = (drain_thread *)ctx;
+    std::lock_guard<std::mutex> guard(d->lock);
+    d->cv.notify_all();
+}
+
+static void signal_done(trng_async_request *req, void *ctx)
+{
+    (void)req;
+    drain_thread *d = (drain_thread *)ctx;
+    std::lock_guard<std::mutex> guard(d->lock);
+    d->completed++;
+    d->cv.notify_all();
+}
+
+static void drain_loop(drain_thread *d)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> guard(d->lock);
+            d->cv.wait(guard, [d] { return d->stop || trng_async_pending(&d->async); });
+            if (d->stop)
+            {
+                return;
+            }
+        }
+        trng_async_drain(&d->async);
+    }
+}
+
+static void wait_completed(drain_thread *d, unsigned int completed)
+{
+    std::unique_lock<std::mutex> guard(d->lock);
+    d->cv.wait(guard, [d, completed] { return d->completed >= completed; });
+}
+
+static void start_drain(drain_thread *d, trng_t *trng_obj, uint8_t *stage, size_t stage_len, std::thread *drainer)
+{
+    trng_async_config cfg;
+    memset(&cfg, 0, sizeof(cfg));
+    cfg.trng = trng_obj;
+    cfg.stage = stage;
+    cfg.stage_len = stage_len;
+    cfg.wake = wake;
+    cfg.wake_ctx = d;
+    trng_async_init(&d->async, &cfg);
+    d->stop = false;
+    d->completed = 0;
+    *drainer = std::thread(drain_loop, d);
+}
+
+static void stop_drain(drain_thread *d, std::thread *drainer)
+{
+    {
+        std::lock_guard<std::mutex> guard(d->lock);
+        d->stop = true;
+        d->cv.notify_all();
+    }
+    drainer->join();
+}
+
+/*Returns the number of chunks screened compressible, which should be 0*/
+static unsigned int chunks_sync(trng_t *trng_obj, uint8_t *buf, size_t chunk, size_t chunks, lzf_ctx *lzf)
+{
+    unsigned int compressible = 0;
+    for (size_t k = 0; k < chunks; k++)
+    {
+        trng_core_fill(trng_obj, buf, chunk);
+        compressible += trng_core_screen(buf, (unsigned int)chunk, trng_core_threshold((unsigned int)chunk, 99), lzf, NULL) != 0;
+    }
+    return compressible;
+}
+
+static unsigned int chunks_async(drain_thread *d, uint8_t *bufs, size_t chunk, size_t chunks, lzf_ctx *lzf)
+{
+    trng_async_request req[2];
+    unsigned int compressible = 0;
+    memset(req, 0, sizeof(req));
+    trng_async_submit(&d->async, &req[0], bufs, chunk, signal_done, d);
+    for (size_t k = 0; k < chunks; k++)
+    {
+        wait_completed(d, (unsigned int)k + 1);
+        if (k + 1 < chunks)
+        {
+            trng_async_submit(&d->async, &req[(k + 1) % 2], bufs + (k + 1) % 2 * chunk, chunk, signal_done, d);
+        }
+        uint8_t *buf = bufs + k % 2 * chunk;
+        compressible += trng_core_screen(buf, (unsigned int)chunk, trng_core_threshold((unsigned int)chunk, 99), lzf, NULL) != 0;
+    }
+    return compressible;
+}
+
+static void small_sync(trng_t *trng_obj, uint8_t *out, size_t read_len, size_t requests)
+{
+    for (size_t r = 0; r < requests; r++)
+    {
+        trng_core_fill(trng_obj, out + r * read_len, read_len);
+    }
+}
+
+static void small_async(drain_thread *d, trng_async_request *req, uint8_t *out, size_t read_len, size_t requests)
+{
+    memset(req, 0, requests * sizeof(*req));
+    for (size_t r = 0; r < requests; r++)
+    {
+        trng_async_submit(&d->async, &req[r], out + r * read_len, read_len, signal_done, d);
+    }
+    wait_completed(d, (unsigned int)requests);
+}
+
+int bench_async(int argc, char **argv)
+{
+    size_t chunk = (size_t)host_size_arg(argc, argv, "chunk", 4096);
+    size_t chunks = (size_t)host_size_arg(argc, argv, "chunks", 64);
+    size_t read_len = (size_t)host_size_arg(argc, argv, "read", 16);
+    size_t requests = (size_t)host_size_arg(argc, argv, "requests", 1024);
+    size_t stage_len = (size_t)host_size_arg(argc, argv, "stage", 4096);
+    uint32_t call_ns = (uint32_t)host_size_arg(argc, argv, "call-delay", 50000);
+    uint32_t byte_ns = (uint32_t)host_size_arg(argc, argv, "byte-delay", 20);
+    if (chunk < 2 || chunks == 0 || read_len == 0 || requests == 0 || stage_len == 0)
+    {
+        fprintf(stderr, "async: --chunk must be at least 2, --chunks, --read, --requests and --stage at least 1\n");
+        return 1;
+    }
+
+    std::vector<uint8_t> bufs(2 * chunk), out(requests * read_len), stage(stage_len);
+    unsigned int hlog = (unsigned int)host_size_arg(argc, argv, "hlog", 12);
+    std::vector<uint8_t> arena(lzf_ctx_state_size(hlog));
+    std::vector<trng_async_request> req(requests);
+    lzf_ctx lzf;
+    lzf_ctx_init(&lzf, hlog, &arena[0], arena.size());
+
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    trng_host_set_delay(call_ns, byte_ns);
+    uint64_t best[4] = { UINT64_MAX, UINT64_MAX, UINT64_MAX, UINT64_MAX };
+    unsigned int compressible = 0;
+    trng_async_stats stats;
+    memset(&stats, 0, sizeof(stats));
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t pass[4];
+        drain_thread d;
+        std::thread drainer;
+
+        uint64_t start = host_now_ns();
+        compressible += chunks_sync(&trng_obj, &bufs[0], chunk, chunks, &lzf);
+        pass[0] = host_now_ns() - start;
+
+        start_drain(&d, &trng_obj, NULL, 0, &drainer);
+        start = host_now_ns();
+        compressible += chunks_async(&d, &bufs[0], chunk, chunks, &lzf);
+        pass[1] = host_now_ns() - start;
+        stop_drain(&d, &drainer);
+
+        start = host_now_ns();
+        small_sync(&trng_obj, &out[0], read_len, requests);
+        pass[2] = host_now_ns() - start;
+
+        start_drain(&d, &trng_obj, &stage[0], stage_len, &drainer);
+        start = host_now_ns();
+        small_async(&d, &req[0], &out[0], read_len, requests);
+        pass[3] = host_now_ns() - start;
+        stop_drain(&d, &drainer);
+        trng_async_get_stats(&d.async, &stats);
+
+        for (int s = 0; s < 4; s++)
+        {
+            best[s] = pass[s] < best[s] ? pass[s] : best[s];
+        }
+    }
+    trng_host_set_delay(0, 0);
+    trng_free(&trng_obj);
+
+    char name[48];
+    snprintf(name, sizeof(name), "fill+screen/%zu", chunk);
+    bench_report_calls("async", name, chunks, chunks * chunk, best[0]);
+    snprintf(name, sizeof(name), "async+screen/%zu", chunk);
+    bench_report_calls("async", name, chunks, chunks * chunk, best[1]);
+    snprintf(name, sizeof(name), "fill/%zu", read_len);
+    bench_report_calls("async", name, requests, requests * read_len, best[2]);
+    snprintf(name, sizeof(name), "async/%zu", read_len);
+    bench_report_calls("async", name, requests, requests * read_len, best[3]);
+    printf("async: overlap %.2fx on %zu byte chunks, batching %.2fx on %zu byte reads (%llu reads, %llu drains "
+           "for %zu requests), %u compressible chunks\n", (double)best[0] / best[1], chunk,
+           (double)best[2] / best[3], read_len, (unsigned long long)stats.reads, (unsigned long long)stats.drains,
+           requests, compressible);
+    return 0;
+}
@@ -0,0 +1,241 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Base64 throughput of the string returning base64_encode/b64decode, of
+* every kernel built into the binary writing into a preallocated buffer and
+* of b64decode_strict (with the kernel selected at build time), over trng
+* data cut in --chunk sized messages (the whole buffer by default), and of
+* the incremental codec fed in --slice pieces into --window sized messages.
+* Throughput is counted in raw bytes for both directions.
+* Timings are the best of 8 passes.
+*
+* Build with ARCH=-march=native (or -mssse3, -mavx2) to get the x86 vector
+* kernels.
+*/
+
+#include "bench.h"
+#include "base64b.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+typedef size_t (*encode_kernel)(const unsigned char *src, size_t len, char *out);
+typedef size_t (*decode_kernel)(const void *src, size_t len, unsigned char *out);
+
+static const struct {
+    const char *name;
+    encode_kernel encode;
+    decode_kernel decode;
+} kernels[] = {
+    { "scalar", base64_encode_scalar, b64decode_scalar },
+#if BASE64_HAVE_SSSE3
+    { "ssse3",  base64_encode_ssse3,  b64decode_ssse3 },
+#endif
+#if BASE64_HAVE_AVX2
+    { "avx2",   base64_encode_avx2,   b64decode_avx2 },
+#endif
+#if BASE64_HAVE_NEON
+    { "neon",   base64_encode_neon,   b64decode_neon },
+#endif
+};
+
+struct stream_sink {
+    uint8_t *out;
+    size_t len;
+};
+
+static void stream_collect(const void *window, size_t len, void *ctx)
+{
+    stream_sink *sink = (stream_sink *)ctx;
+    memcpy(sink->out + sink->len, window, len);
+    sink->len += len;
+}
+
+int bench_base64(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 4 << 20);
+    size_t chunk = (size_t)host_size_arg(argc, argv, "chunk", len);
+    std::vector<uint8_t> data(len), back(len);
+
+    if (chunk == 0 || chunk > len || bench_acquire(&data[0], len) != 0)
+    {
+        fprintf(stderr, "base64: cannot acquire %zu bytes of input\n", len);
+        return 1;
+    }
+
+    size_t chunks = len / chunk;
+    size_t total = chunks * chunk;
+    size_t enc_chunk = base64_encoded_len(chunk);
+    std::vector<char> text(chunks * enc_chunk);
+    char stage[48];
+    int res = 0;
+
+    /*String returning functions, one allocation per message*/
+    size_t sink = 0;
+    uint64_t ns = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        for (size_t i = 0; i < chunks; i++)
+        {
+            sink += base64_encode(&data[i * chunk], chunk).size();
+        }
+        uint64_t pass = host_now_ns() - start;
+        ns = pass < ns ? pass : ns;
+    }
+    bench_report_calls("base64", "encode/string", chunks, total, ns);
+
+    for (size_t i = 0; i < chunks; i++)
+    {
+        base64_encode_to(&data[i * chunk], chunk, &text[i * enc_chunk], enc_chunk);
+    }
+
+    ns = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        for (size_t i = 0; i < chunks; i++)
+        {
+            sink += b64decode(&text[i * enc_chunk], enc_chunk).size();
+        }
+        uint64_t pass = host_now_ns() - start;
+        ns = pass < ns ? pass : ns;
+    }
+    bench_report_calls("base64", "decode/string", chunks, total, ns);
+
+    /*Strict decoding with the kernel selected at build time*/
+    ns = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        for (size_t i = 0; i < chunks; i++)
+        {
+            size_t decoded = 0, error_pos = 0;
+            res |= b64decode_strict(&text[i * enc_chunk], enc_chunk, &back[i * chunk], chunk, &decoded, &error_pos) != BASE64_OK;
+            sink += decoded;
+        }
+        uint64_t pass = host_now_ns() - start;
+        ns = pass < ns ? pass : ns;
+    }
+    bench_report_calls("base64", "decode/strict", chunks, total, ns);
+    if (res != 0 || memcmp(&back[0], &data[0], total) != 0)
+    {
+        fprintf(stderr, "base64: strict decoding does not round trip\n");
+        res = 1;
+    }
+
+    /*Streams fed in --slice sized pieces into --window sized messages, as over greentea*/
+    size_t slice = (size_t)host_size_arg(argc, argv, "slice", 61);
+    size_t window_len = (size_t)host_size_arg(argc, argv, "window", 128);
+    std::vector<char> window(window_len);
+    std::vector<unsigned char> byte_window(window_len);
+    base64_encoder enc;
+    base64_decoder dec;
+    stream_sink ssink;
+
+    ns = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        ssink.out = (uint8_t *)&text[0];
+        ssink.len = 0;
+        uint64_t start = host_now_ns();
+        base64_encoder_init(&enc, &window[0], window_len, stream_collect, &ssink);
+        for (size_t pos = 0; pos < total; pos += slice)
+        {
+            base64_encoder_update(&enc, &data[pos], slice < total - pos ? slice : total - pos);
+        }
+        base64_encoder_final(&enc);
+        uint64_t pass = host_now_ns() - start;
+        ns = pass < ns ? pass : ns;
+    }
+    snprintf(stage, sizeof(stage), "encode/stream%zu", window_len);
+    bench_report_calls("base64", stage, (total + slice - 1) / slice, total, ns);
+    size_t stream_len = ssink.len;
+
+    ns = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        ssink.out = &back[0];
+        ssink.len = 0;
+        uint64_t start = host_now_ns();
+        base64_decoder_init(&dec, &byte_window[0], window_len, stream_collect, &ssink);
+        for (size_t pos = 0; pos < stream_len; pos += window_len)
+        {
+            base64_decoder_update(&dec, &text[pos], window_len < stream_len - pos ? window_len : stream_len - pos);
+        }
+        res |= base64_decoder_final(&dec) != BASE64_OK;
+        uint64_t pass = host_now_ns() - start;
+        ns = pass < ns ? pass : ns;
+    }
+    snprintf(stage, sizeof(stage), "decode/stream%zu", window_len);
+    bench_report_calls("base64", stage, (stream_len + window_len - 1) / window_len, total, ns);
+    if (res != 0 || ssink.len != total || memcmp(&back[0], &data[0], total) != 0)
+    {
+        fprintf(stderr, "base64: the stream does not round trip\n");
+        res = 1;
+    }
+
+    /*The stream of one message and the messages encoded on their own differ, restore the latter*/
+    for (size_t i = 0; i < chunks; i++)
+    {
+        base64_encode_to(&data[i * chunk], chunk, &text[i * enc_chunk], enc_chunk);
+    }
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        std::vector<char> out(text.size());
+
+        ns = UINT64_MAX;
+        for (int rep = 0; rep < 8; rep++)
+        {
+            uint64_t start = host_now_ns();
+            for (size_t i = 0; i < chunks; i++)
+            {
+                kernels[k].encode(&data[i * chunk], chunk, &out[i * enc_chunk]);
+            }
+            uint64_t pass = host_now_ns() - start;
+            ns = pass < ns ? pass : ns;
+        }
+        snprintf(stage, sizeof(stage), "encode/%s", kernels[k].name);
+        bench_report_calls("base64", stage, chunks, total, ns);
+
+        ns = UINT64_MAX;
+        for (int rep = 0; rep < 8; rep++)
+        {
+            uint64_t start = host_now_ns();
+            for (size_t i = 0; i < chunks; i++)
+            {
+                kernels[k].decode(&out[i * enc_chunk], enc_chunk, &back[i * chunk]);
+            }
+            uint64_t pass = host_now_ns() - start;
+            ns = pass < ns ? pass : ns;
+        }
+        snprintf(stage, sizeof(stage), "decode/%s", kernels[k].name);
+        bench_report_calls("base64", stage, chunks, total, ns);
+
+        if (memcmp(&out[0], &text[0], text.size()) != 0 || memcmp(&back[0], &data[0], total) != 0)
+        {
+            fprintf(stderr, "base64: %s kernel does not round trip\n", kernels[k].name);
+            res = 1;
+        }
+    }
+
+    printf("base64: %zu messages of %zu bytes, %zu chars each\n", chunks, chunk, enc_chunk);
+    return sink != 0 ? res : 1;
+}
@@ -0,0 +1,210 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Throughput of the DRBGs (trng_drbg.h) against the source they are seeded
+* from: the AES counter kernels alone, CTR_DRBG and HMAC_DRBG with large and
+* small requests and with prediction resistance, and 2 threads generating
+* small requests from an instance each against one shared behind a mutex.
+* Timings are the best of 4 passes.
+*/
+
+#include "bench.h"
+#include "trng_core.h"
+#include "trng_drbg.h"
+
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+static uint64_t source_pass(std::vector<uint8_t> &buf, size_t len)
+{
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    uint64_t start = host_now_ns();
+    for (size_t pos = 0; pos + buf.size() <= len; pos += buf.size())
+    {
+        trng_core_fill(&trng_obj, &buf[0], buf.size());
+    }
+    uint64_t pass = host_now_ns() - start;
+    trng_free(&trng_obj);
+    return pass;
+}
+
+typedef void (*ctr_kernel)(const trng_aes256 *, uint8_t *, uint8_t *, size_t);
+
+static uint64_t kernel_pass(ctr_kernel kernel, std::vector<uint8_t> &buf, size_t len)
+{
+    uint8_t key[32] = {1}, v[16] = {0};
+    trng_aes256 aes;
+    trng_aes256_init(&aes, key);
+    uint64_t start = host_now_ns();
+    for (size_t pos = 0; pos + buf.size() <= len; pos += buf.size())
+    {
+        kernel(&aes, v, &buf[0], buf.size());
+    }
+    return host_now_ns() - start;
+}
+
+static uint64_t drbg_pass(trng_drbg *drbg, std::vector<uint8_t> &buf, size_t len, size_t request)
+{
+    uint64_t start = host_now_ns();
+    for (size_t pos = 0; pos + request <= len; pos += request)
+    {
+        trng_drbg_generate(drbg, &buf[0], request, NULL, 0);
+    }
+    return host_now_ns() - start;
+}
+
+static void bench_mechanism(int mechanism, std::vector<uint8_t> &buf, size_t len)
+{
+    const char *name = mechanism == TRNG_DRBG_CTR ? "ctr" : "hmac";
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+
+    size_t requests[2] = { buf.size(), 64 };
+    for (int pr = 0; pr < 2; pr++)
+    {
+        for (int r = 0; r < 2; r++)
+        {
+            trng_drbg_config cfg;
+            trng_drbg_config_default(&cfg, mechanism, trng_drbg_entropy_trng, &trng_obj);
+            cfg.prediction_resistance = pr;
+            trng_drbg drbg;
+            trng_drbg_init(&drbg, &cfg, NULL, 0);
+
+            /*Prediction resistance pays a reseed per request, a smaller run keeps it short*/
+            size_t run = pr ? len / 16 : r ? len / 4 : len;
+            uint64_t best = UINT64_MAX;
+            for (int rep = 0; rep < 4; rep++)
+            {
+                uint64_t pass = drbg_pass(&drbg, buf, run, requests[r]);
+                best = pass < best ? pass : best;
+            }
+            char stage[64];
+            snprintf(stage, sizeof(stage), "%s %zu%s", name, requests[r], pr ? " pr" : "");
+            bench_report_calls("drbg", stage, run / requests[r], run / requests[r] * requests[r], best);
+            trng_drbg_free(&drbg);
+        }
+    }
+    trng_free(&trng_obj);
+}
+
+/*Small requests from 2 threads, each with an instance or both on one behind a lock*/
+static void bench_threads(size_t len, bool shared)
+{
+    const unsigned int threads = 2;
+    const size_t request = 64;
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    std::mutex lock;
+    std::vector<trng_drbg> drbg(threads);
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        trng_drbg_config cfg;
+        trng_drbg_config_default(&cfg, TRNG_DRBG_CTR, trng_drbg_entropy_trng, &trng_obj);
+        trng_drbg_init(&drbg[t], &cfg, NULL, 0);
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (int rep = 0; rep < 4; rep++)
+    {
+        uint64_t start = host_now_ns();
+        std::vector<std::thread> workers;
+        for (unsigned int t = 0; t < threads; t++)
+        {
+            workers.push_back(std::thread([&, t]() {
+                uint8_t out[request];
+                for (size_t pos = 0; pos < len / threads; pos += request)
+                {
+                    if (shared)
+                    {
+                        std::lock_guard<std::mutex> guard(lock);
+                        trng_drbg_generate(&drbg[0], out, request, NULL, 0);
+                    }
+                    else
+                    {
+                        trng_drbg_generate(&drbg[t], out, request, NULL, 0);
+                    }
+                }
+            }));
+        }
+        for (unsigned int t = 0; t < threads; t++)
+        {
+            workers[t].join();
+        }
+        uint64_t pass = host_now_ns() - start;
+        best = pass < best ? pass : best;
+    }
+    bench_report_calls("drbg", shared ? "ctr 64, 2 threads, shared" : "ctr 64, 2 threads, own", len / request,
+                       len / request * request, best);
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        trng_drbg_free(&drbg[t]);
+    }
+    trng_free(&trng_obj);
+}
+
+int bench_drbg(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 64 << 20);
+    size_t chunk = (size_t)host_size_arg(argc, argv, "chunk", 4096);
+    std::vector<uint8_t> buf(chunk);
+
+    if (chunk < 64 || len < chunk)
+    {
+        fprintf(stderr, "drbg: --chunk must be at least 64 and --bytes at least a chunk\n");
+        return 1;
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (int rep = 0; rep < 4; rep++)
+    {
+        uint64_t pass = source_pass(buf, len / 16);
+        best = pass < best ? pass : best;
+    }
+    bench_report("drbg", "source", len / 16 / chunk * chunk, best);
+
+    struct {
+        const char *name;
+        ctr_kernel kernel;
+    } kernels[] = {
+        { "aes-ctr scalar", trng_aes256_ctr_scalar },
+#if TRNG_AES_HAVE_AESNI
+        { "aes-ctr aesni", trng_aes256_ctr_aesni },
+#endif
+#if TRNG_AES_HAVE_ARMV8
+        { "aes-ctr armv8", trng_aes256_ctr_armv8 },
+#endif
+    };
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        best = UINT64_MAX;
+        for (int rep = 0; rep < 4; rep++)
+        {
+            uint64_t pass = kernel_pass(kernels[k].kernel, buf, len);
+            best = pass < best ? pass : best;
+        }
+        bench_report("drbg", kernels[k].name, len / chunk * chunk, best);
+    }
+
+    bench_mechanism(TRNG_DRBG_CTR, buf, len);
+    bench_mechanism(TRNG_DRBG_HMAC, buf, len / 8);
+    bench_threads(len / 8, false);
+    bench_threads(len / 8, true);
+    return 0;
+}
@@ -0,0 +1,72 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Time of every SP 800-90B estimator (trng_entropy.h) on samples from the
+* selected source, 8 bit samples and the bit string of their first 1M bits,
+* the 90B recommended dataset sizes. Timings are the best of 3 passes, the
+* slower estimators take a good part of a second each.
+*/
+
+#include "bench.h"
+#include "trng_entropy.h"
+
+#include <stdio.h>
+#include <vector>
+
+static void run_estimators(const char *on, const std::vector<uint8_t> &s, unsigned int bits)
+{
+    for (int e = 0; e < TRNG_ENTROPY_ESTIMATORS; e++)
+    {
+        if (trng_entropy_binary_only(e) && bits != 1)
+        {
+            continue;
+        }
+        std::vector<uint64_t> work(trng_entropy_work_size(e, s.size(), bits) / sizeof(uint64_t) + 1);
+        uint64_t best = UINT64_MAX;
+        double h = 0.0;
+        for (int rep = 0; rep < 3; rep++)
+        {
+            uint64_t start = host_now_ns();
+            h = trng_entropy_estimate(e, &s[0], s.size(), bits, &work[0], work.size() * sizeof(uint64_t));
+            uint64_t pass = host_now_ns() - start;
+            best = pass < best ? pass : best;
+        }
+
+        char stage[64];
+        snprintf(stage, sizeof(stage), "%s %s", trng_entropy_name(e), on);
+        bench_report("entropy", stage, s.size(), best);
+        printf("entropy: %s, %.6f bits per sample, %zu bytes of work\n", stage, h, work.size() * sizeof(uint64_t));
+    }
+}
+
+int bench_entropy(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 1 << 20);
+    std::vector<uint8_t> samples(len), bits;
+
+    if (len < 2 || bench_acquire(&samples[0], len) != 0)
+    {
+        fprintf(stderr, "entropy: cannot acquire %zu bytes of input\n", len);
+        return 1;
+    }
+
+    bits.resize(len < (1 << 17) ? len * 8 : 1 << 20);
+    trng_entropy_bitstring(&samples[0], len, 8, &bits[0], bits.size());
+    run_estimators("bytes", samples, 8);
+    run_estimators("bits", bits, 1);
+    return 0;
+}
@@ -0,0 +1,115 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Cost of looking a boot up in the fingerprint index (trng_fingerprint.h)
+* as the number of recorded boots grows, against screening the boot together
+* with every stored previous boot the way step 2 of the device test does with
+* one, which grows with every boot kept. Boots are 64 bytes of the selected
+* source like the step buffers, timings are the best of 8 passes.
+*/
+
+#include "bench.h"
+#include "trng_core.h"
+#include "trng_fingerprint.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define BOOT_LEN        64
+
+int bench_fingerprint(int argc, char **argv)
+{
+    size_t max_boots = (size_t)host_size_arg(argc, argv, "boots", 1024);
+    std::vector<uint8_t> data((max_boots + 1) * BOOT_LEN);
+    if (max_boots == 0 || bench_acquire(&data[0], data.size()) != 0)
+    {
+        fprintf(stderr, "fingerprint: cannot acquire %zu boots of input\n", max_boots + 1);
+        return 1;
+    }
+
+    trng_fingerprint_config cfg;
+    trng_fingerprint_config_default(&cfg);
+    std::vector<uint32_t> image(trng_fingerprint_size(&cfg) / 4);
+    trng_fingerprint fp;
+    trng_fingerprint_open(&fp, &cfg, &image[0], image.size() * 4);
+    printf("fingerprint: %zu byte image, %.2g false positives per window of a new boot\n",
+           trng_fingerprint_size(&cfg), trng_fingerprint_false_positive(&cfg, BOOT_LEN));
+
+    std::vector<uint8_t> arena(lzf_ctx_state_size(8));
+    lzf_ctx lzf;
+    lzf_ctx_init(&lzf, 8, &arena[0], arena.size());
+    unsigned int out_len = trng_core_threshold(2 * BOOT_LEN, 99);
+    const uint8_t *boot = &data[max_boots * BOOT_LEN];
+    uint8_t pair[2 * BOOT_LEN];
+    memcpy(pair + BOOT_LEN, boot, BOOT_LEN);
+
+    size_t recorded = 0;
+    for (size_t boots = 1; boots <= max_boots; boots *= 4)
+    {
+        for (; recorded < boots; recorded++)
+        {
+            trng_fingerprint_add(&fp, &data[recorded * BOOT_LEN], BOOT_LEN);
+        }
+
+        uint64_t lookup = UINT64_MAX, screen = UINT64_MAX;
+        uint32_t seen = 0, compressible = 0;
+        for (int rep = 0; rep < 8; rep++)
+        {
+            uint64_t start = host_now_ns();
+            for (int i = 0; i < 64; i++)
+            {
+                seen += trng_fingerprint_check(&fp, boot, BOOT_LEN, NULL);
+            }
+            uint64_t pass = host_now_ns() - start;
+            lookup = pass < lookup ? pass : lookup;
+
+            start = host_now_ns();
+            for (size_t b = 0; b < boots; b++)
+            {
+                memcpy(pair, &data[b * BOOT_LEN], BOOT_LEN);
+                compressible += trng_core_screen(pair, sizeof(pair), out_len, &lzf, NULL) != 0;
+            }
+            pass = host_now_ns() - start;
+            screen = pass < screen ? pass : screen;
+        }
+
+        char stage[64];
+        snprintf(stage, sizeof(stage), "lookup, %zu boots", boots);
+        bench_report_calls("fingerprint", stage, 64, 64 * BOOT_LEN, lookup);
+        snprintf(stage, sizeof(stage), "screen pairs, %zu boots", boots);
+        bench_report_calls("fingerprint", stage, 1, BOOT_LEN, screen);
+        if (seen != 0 || compressible != 0)
+        {
+            printf("fingerprint: %u windows seen, %u pairs compressible\n", seen, compressible);
+        }
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        for (size_t b = 0; b < max_boots; b++)
+        {
+            trng_fingerprint_add(&fp, &data[b * BOOT_LEN], BOOT_LEN);
+        }
+        uint64_t pass = host_now_ns() - start;
+        best = pass < best ? pass : best;
+    }
+    bench_report_calls("fingerprint", "add", max_boots, max_boots * BOOT_LEN, best);
+    return 0;
+}
@@ -0,0 +1,141 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Cost of the SP 800-90B health tests (trng_health.h): trng_core_fill
+* against trng_health_fill on the selected source and on an in memory
+* replay of its output, the fastest source there is and so the worst case
+* for the overhead, and the tests alone on data in memory. The device case
+* replays --device-bytes (1M) with trng_get_bytes slowed down to the rate of
+* a device trng: --byte-delay ns per byte (250, 4 MB/s at most), --call-delay ns per
+* call (0) and at most --max-chunk bytes a call (256). Timings are the best
+* of 8 passes, the default cutoffs of 4 bits per byte are used.
+*/
+
+#include "bench.h"
+#include "trng_core.h"
+#include "trng_health.h"
+#include "trng_host.h"
+
+#include <stdio.h>
+#include <vector>
+
+static uint64_t fill_pass(std::vector<uint8_t> &buf, size_t len, size_t chunk)
+{
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    uint64_t start = host_now_ns();
+    for (size_t pos = 0; pos + chunk <= len; pos += chunk)
+    {
+        trng_core_fill(&trng_obj, &buf[0], chunk);
+    }
+    uint64_t pass = host_now_ns() - start;
+    trng_free(&trng_obj);
+    return pass;
+}
+
+static uint64_t health_fill_pass(std::vector<uint8_t> &buf, size_t len, size_t chunk, trng_health_counters *counters)
+{
+    trng_health_config cfg;
+    trng_health_config_default(&cfg, 4.0, 30);
+    cfg.startup_bytes = 0;
+    trng_health h;
+    trng_health_init(&h, &cfg);
+    uint64_t start = host_now_ns();
+    for (size_t pos = 0; pos + chunk <= len; pos += chunk)
+    {
+        trng_health_fill(&h, &buf[0], chunk);
+    }
+    uint64_t pass = host_now_ns() - start;
+    *counters = h.counters;
+    trng_health_free(&h);
+    return pass;
+}
+
+/*Passes with and without the tests alternate, so a noisy host slows both alike. Returns the
+  best pass without the tests*/
+static uint64_t compare(const char *source, std::vector<uint8_t> &buf, size_t len, size_t chunk)
+{
+    trng_health_counters counters;
+    uint64_t plain = UINT64_MAX, health = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t pass = fill_pass(buf, len, chunk);
+        plain = pass < plain ? pass : plain;
+        pass = health_fill_pass(buf, len, chunk, &counters);
+        health = pass < health ? pass : health;
+    }
+
+    char stage[64];
+    snprintf(stage, sizeof(stage), "%s fill", source);
+    bench_report("health", stage, len / chunk * chunk, plain);
+    snprintf(stage, sizeof(stage), "%s health fill", source);
+    bench_report("health", stage, len / chunk * chunk, health);
+    printf("health: %s, %+.1f%% time, %llu/%llu failures, longest run %u, highest count %u\n", source,
+           plain ? 100.0 * ((double)health - (double)plain) / (double)plain : 0.0,
+           (unsigned long long)counters.rct_failures, (unsigned long long)counters.apt_failures,
+           counters.longest_run, counters.highest_count);
+    return plain;
+}
+
+int bench_health(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 16 << 20);
+    size_t chunk = (size_t)host_size_arg(argc, argv, "chunk", 4096);
+    std::vector<uint8_t> data(len), buf(chunk);
+
+    if (chunk == 0 || len < chunk || bench_acquire(&data[0], len) != 0)
+    {
+        fprintf(stderr, "health: cannot acquire %zu bytes of input\n", len);
+        return 1;
+    }
+
+    compare("source", buf, len, chunk);
+    trng_host_use_replay(&data[0], len);
+    compare("replay", buf, len, chunk);
+
+    size_t device_len = (size_t)host_size_arg(argc, argv, "device-bytes", 1 << 20);
+    device_len = device_len < len ? device_len : len;
+    trng_host_use_replay(&data[0], device_len);
+    trng_host_set_max_chunk((size_t)host_size_arg(argc, argv, "max-chunk", 256));
+    trng_host_set_delay((uint32_t)host_size_arg(argc, argv, "call-delay", 0),
+                        (uint32_t)host_size_arg(argc, argv, "byte-delay", 250));
+    uint64_t device = compare("device", buf, device_len, chunk);
+    host_select_source(argc, argv);
+
+    trng_health_config cfg;
+    trng_health_config_default(&cfg, 4.0, 30);
+    uint64_t best = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        trng_health h;
+        trng_health_start(&h, &cfg);
+        uint64_t start = host_now_ns();
+        for (size_t pos = 0; pos + chunk <= len; pos += chunk)
+        {
+            trng_health_feed(&h, &data[pos], chunk);
+        }
+        uint64_t pass = host_now_ns() - start;
+        best = pass < best ? pass : best;
+    }
+    bench_report("health", "tests only", len / chunk * chunk, best);
+
+    /*The device figures above are within the jitter of the sleeps, this is what the tests add*/
+    double tests_ns = (double)best / (double)(len / chunk * chunk);
+    double device_ns = (double)device / (double)(device_len / chunk * chunk);
+    printf("health: tests only, %.2f%% of the device fill time\n", device_ns > 0 ? 100.0 * tests_ns / device_ns : 0.0);
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Per call latency of lzf_ctx_compress for small inputs (64 B - 4 KB by
+* default) with the three ways of handling a reused hash table: as is
+* (LZF_CTX_REUSE), cleared per call (LZF_CTX_CLEAR) and generation tagged
+* (LZF_CTX_TAGGED).
+*/
+
+#include "bench.h"
+
+extern "C" {
+#include "lzf_ctx.h"
+}
+
+#include <stdio.h>
+#include <vector>
+
+int bench_htab(int argc, char **argv)
+{
+    unsigned int hlog = (unsigned int)host_size_arg(argc, argv, "hlog", 14);
+    size_t min_len = (size_t)host_size_arg(argc, argv, "min", 64);
+    size_t max_len = (size_t)host_size_arg(argc, argv, "max", 4096);
+    uint64_t calls = host_size_arg(argc, argv, "calls", 20000);
+    size_t pool_len = 1 << 20;
+
+    static const struct {
+        int mode;
+        const char *name;
+    } modes[] = {
+        { LZF_CTX_REUSE,  "reuse" },
+        { LZF_CTX_CLEAR,  "clear" },
+        { LZF_CTX_TAGGED, "tagged" },
+    };
+
+    std::vector<uint8_t> pool(pool_len), out(max_len + max_len / 16 + 64);
+    if (min_len == 0 || max_len > pool_len || bench_acquire(&pool[0], pool_len) != 0)
+    {
+        fprintf(stderr, "htab: cannot acquire %zu bytes of input\n", pool_len);
+        return 1;
+    }
+
+    for (size_t len = min_len; len <= max_len; len *= 2)
+    {
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++)
+        {
+            std::vector<uint8_t> arena(lzf_ctx_state_size_mode(hlog, modes[m].mode));
+            lzf_ctx lzf;
+            if (lzf_ctx_init_mode(&lzf, hlog, modes[m].mode, arena.data(), arena.size()) != 0)
+            {
+                fprintf(stderr, "htab: unsupported --hlog %u\n", hlog);
+                return 1;
+            }
+
+            size_t pos = 0;
+            unsigned int sink = 0;
+            uint64_t start = host_now_ns();
+            for (uint64_t i = 0; i < calls; i++)
+            {
+                if (pos + len > pool_len)
+                {
+                    pos = 0;
+                }
+                sink += lzf_ctx_compress(&lzf, &pool[pos], (unsigned int)len, &out[0], (unsigned int)out.size());
+                pos += len;
+            }
+            uint64_t ns = host_now_ns() - start;
+
+            char stage[32];
+            snprintf(stage, sizeof(stage), "%s/%zu", modes[m].name, len);
+            bench_report_calls("htab", stage, calls, calls * len, ns);
+            if (sink == 0)
+            {
+                fprintf(stderr, "htab: nothing compressed\n");
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,197 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Screening with the streaming compressor (lzf_stream.h) against screening
+* every chunk on its own with a cleared table (trng_core_screen). Step 2 of
+* the device test is run both ways: the step 1 and step 2 buffers copied
+* into one and screened, and the step 2 buffer screened in a stream that
+* holds the step 1 buffer. Chunks of a capture are run both ways on random,
+* biased and repetitive data and on recurring data, random chunks of which
+* every other one repeats the one before it with a changed byte, which only
+* a stream sees. Timings are the best of 8 passes.
+*/
+
+#include "bench.h"
+#include "trng_core.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static uint64_t best_of(uint64_t best, uint64_t start)
+{
+    uint64_t pass = host_now_ns() - start;
+    return pass < best ? pass : best;
+}
+
+static int run_pairs(const std::vector<uint8_t> &data, size_t pair, unsigned int percentage, unsigned int hlog)
+{
+    size_t pairs = data.size() / (pair * 2);
+    unsigned int wlog = LZF_STREAM_WLOG_MIN;
+    while ((1U << wlog) < pair && wlog < LZF_STREAM_WLOG_MAX)
+    {
+        wlog++;
+    }
+    unsigned int out_len = trng_core_threshold((unsigned int)pair, percentage);
+    unsigned int concat_out_len = trng_core_threshold((unsigned int)pair * 2, percentage);
+    std::vector<uint8_t> arena(lzf_ctx_state_size(hlog)), input(pair * 2);
+    std::vector<unsigned int> stream_arena(LZF_STREAM_STATE_SIZE(hlog, wlog) / sizeof(unsigned int) + 1);
+    lzf_ctx lzf;
+    lzf_stream stream;
+    if (lzf_ctx_init(&lzf, hlog, &arena[0], arena.size()) != 0 ||
+        lzf_stream_init(&stream, hlog, wlog, &stream_arena[0], stream_arena.size() * sizeof(unsigned int)) != 0)
+    {
+        fprintf(stderr, "lzfstream: unsupported --hlog %u for %zu byte pairs\n", hlog, pair);
+        return 1;
+    }
+
+    std::vector<unsigned int> concat(pairs), streamed(pairs);
+    uint64_t concat_ns = UINT64_MAX, stream_ns = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        for (size_t i = 0; i < pairs; i++)
+        {
+            memcpy(&input[0], &data[i * pair * 2], pair * 2);
+            concat[i] = trng_core_screen(&input[0], (unsigned int)pair * 2, concat_out_len, &lzf, NULL);
+        }
+        concat_ns = best_of(concat_ns, start);
+
+        start = host_now_ns();
+        for (size_t i = 0; i < pairs; i++)
+        {
+            lzf_stream_init(&stream, hlog, wlog, &stream_arena[0], stream_arena.size() * sizeof(unsigned int));
+            lzf_stream_compress(&stream, &data[i * pair * 2], (unsigned int)pair, NULL, 0);
+            streamed[i] = lzf_stream_compress(&stream, &data[i * pair * 2 + pair], (unsigned int)pair, NULL, out_len);
+        }
+        stream_ns = best_of(stream_ns, start);
+    }
+
+    size_t agree = 0;
+    for (size_t i = 0; i < pairs; i++)
+    {
+        agree += (concat[i] != 0) == (streamed[i] != 0);
+    }
+    bench_report_calls("lzfstream", "pair/concat", pairs, pairs * pair * 2, concat_ns);
+    bench_report_calls("lzfstream", "pair/stream", pairs, pairs * pair * 2, stream_ns);
+    printf("lzfstream: %zu byte pairs, %zu of %zu verdicts agree, state %zu bytes against %zu, %.2fx\n",
+           pair, agree, pairs, (size_t)LZF_STREAM_STATE_SIZE(hlog, wlog), arena.size() + input.size(),
+           stream_ns ? (double)concat_ns / (double)stream_ns : 0.0);
+    return 0;
+}
+
+static int run_set(const char *set, const std::vector<uint8_t> &data, size_t chunk,
+                   unsigned int percentage, unsigned int hlog, unsigned int wlog)
+{
+    size_t chunks = data.size() / chunk;
+    unsigned int out_len = trng_core_threshold((unsigned int)chunk, percentage);
+    std::vector<uint8_t> arena(lzf_ctx_state_size(hlog)), out(out_len + 1);
+    std::vector<unsigned int> stream_arena(LZF_STREAM_STATE_SIZE(hlog, wlog) / sizeof(unsigned int) + 1);
+    lzf_ctx lzf;
+    lzf_stream stream;
+    if (lzf_ctx_init(&lzf, hlog, &arena[0], arena.size()) != 0 ||
+        lzf_stream_init(&stream, hlog, wlog, &stream_arena[0], stream_arena.size() * sizeof(unsigned int)) != 0)
+    {
+        fprintf(stderr, "lzfstream: unsupported --hlog %u or --wlog %u\n", hlog, wlog);
+        return 1;
+    }
+
+    std::vector<unsigned int> screened(chunks), streamed(chunks), compressed(chunks);
+    uint64_t screen_ns = UINT64_MAX, stream_ns = UINT64_MAX, compress_ns = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        for (size_t i = 0; i < chunks; i++)
+        {
+            screened[i] = trng_core_screen(&data[i * chunk], (unsigned int)chunk, out_len, &lzf, NULL);
+        }
+        screen_ns = best_of(screen_ns, start);
+
+        lzf_stream_init(&stream, hlog, wlog, &stream_arena[0], stream_arena.size() * sizeof(unsigned int));
+        start = host_now_ns();
+        for (size_t i = 0; i < chunks; i++)
+        {
+            streamed[i] = lzf_stream_compress(&stream, &data[i * chunk], (unsigned int)chunk, NULL, out_len);
+        }
+        stream_ns = best_of(stream_ns, start);
+
+        lzf_stream_init(&stream, hlog, wlog, &stream_arena[0], stream_arena.size() * sizeof(unsigned int));
+        start = host_now_ns();
+        for (size_t i = 0; i < chunks; i++)
+        {
+            compressed[i] = lzf_stream_compress(&stream, &data[i * chunk], (unsigned int)chunk, &out[0], out_len);
+        }
+        compress_ns = best_of(compress_ns, start);
+    }
+
+    int res = 0;
+    size_t screen_hits = 0, stream_hits = 0;
+    for (size_t i = 0; i < chunks; i++)
+    {
+        if (streamed[i] != compressed[i])
+        {
+            fprintf(stderr, "lzfstream: %s chunk %zu sized to %u, compressed to %u\n", set, i, streamed[i], compressed[i]);
+            res = 1;
+        }
+        screen_hits += screened[i] != 0;
+        stream_hits += streamed[i] != 0;
+    }
+
+    char stage[32];
+    snprintf(stage, sizeof(stage), "%s/screen", set);
+    bench_report_calls("lzfstream", stage, chunks, chunks * chunk, screen_ns);
+    snprintf(stage, sizeof(stage), "%s/stream", set);
+    bench_report_calls("lzfstream", stage, chunks, chunks * chunk, stream_ns);
+    snprintf(stage, sizeof(stage), "%s/stream-out", set);
+    bench_report_calls("lzfstream", stage, chunks, chunks * chunk, compress_ns);
+    printf("lzfstream: %s, %zu of %zu chunks compressible on their own, %zu in the stream, %.2fx\n",
+           set, screen_hits, chunks, stream_hits, stream_ns ? (double)screen_ns / (double)stream_ns : 0.0);
+    return res;
+}
+
+int bench_lzfstream(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 4 << 20);
+    size_t chunk = (size_t)host_size_arg(argc, argv, "chunk", 4096);
+    size_t pair = (size_t)host_size_arg(argc, argv, "pair", 128);
+    unsigned int percentage = (unsigned int)host_size_arg(argc, argv, "percentage", 99);
+    unsigned int hlog = (unsigned int)host_size_arg(argc, argv, "hlog", lzf_ctx_hlog_for((unsigned int)chunk, 14));
+    unsigned int wlog = (unsigned int)host_size_arg(argc, argv, "wlog", LZF_STREAM_WLOG_MAX);
+    std::vector<uint8_t> noise(len + 256), data(len);
+
+    if (chunk == 0 || pair == 0 || len < chunk || len < pair * 2 || bench_acquire(&noise[0], noise.size()) != 0)
+    {
+        fprintf(stderr, "lzfstream: cannot acquire %zu bytes of input\n", noise.size());
+        return 1;
+    }
+
+    int res = 0;
+    memcpy(&data[0], &noise[0], len);
+    res |= run_pairs(data, pair, percentage, lzf_ctx_hlog_for((unsigned int)pair * 2, 14));
+    res |= run_set("random", data, chunk, percentage, hlog, wlog);
+    for (size_t i = chunk; i + chunk <= len; i += chunk * 2)
+    {
+        memcpy(&data[i], &data[i - chunk], chunk);
+        data[i + noise[i] % chunk] ^= 1;
+    }
+    res |= run_set("recurring", data, chunk, percentage, hlog, wlog);
+    bench_make_biased(data, noise);
+    res |= run_set("biased", data, chunk, percentage, hlog, wlog);
+    bench_make_repetitive(data, noise);
+    res |= run_set("repetitive", data, chunk, percentage, hlog, wlog);
+    return res;
+}
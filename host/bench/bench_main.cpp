@@ -0,0 +1,141 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "bench.h"
+#include "trng_core.h"
+
+#include <stdio.h>
+#include <string.h>
+
+struct bench_suite {
+    const char *name;
+    const char *help;
+    int (*run)(int argc, char **argv);
+};
+
+static const bench_suite suites[] = {
+    { "pipeline", "acquire, compress and encode stages of the trng test core", bench_pipeline },
+    { "htab",     "per call lzf latency with reused, cleared and generation tagged tables", bench_htab },
+    { "match",    "lzf match extension kernels on biased, repetitive and random data", bench_match },
+    { "screen",   "pass/fail check by full compression and by early exit screening", bench_screen },
+    { "base64",   "base64 into strings and into caller buffers with the scalar and vector kernels", bench_base64 },
+    { "nist",     "SP 800-22 battery against the running statistics and a plain copy", bench_nist },
+    { "entropy",  "SP 800-90B estimators on 1M samples and 1M bits", bench_entropy },
+    { "health",   "trng_get_bytes with and without the SP 800-90B health tests", bench_health },
+    { "pool",     "small reads from the entropy pool against trng_get_bytes", bench_pool },
+    { "drbg",     "CTR_DRBG and HMAC_DRBG against their source, kernels and threads", bench_drbg },
+    { "parallel", "qualification pipeline on 1 to 2x the cores in threads", bench_parallel },
+    { "fingerprint", "lookup of a boot in the fingerprint index against screening every stored boot", bench_fingerprint },
+    { "snapshot", "snapshot ring open, append and read, bytes written per boot", bench_snapshot },
+    { "lzfstream", "screening in one lzf stream against screening every chunk on its own", bench_lzfstream },
+    { "variant",  "compressor variants of trng_lzf.h against lzf_compress on 256 byte and larger chunks", bench_variant },
+    { "model",    "entropy coding estimators against lzf screening, on slightly biased data too", bench_model },
+    { "trace",    "cost of the trace sites, bare, timed and in the fills of trng_core_fill", bench_trace },
+    { "async",    "asynchronous acquisition against the synchronous loop on a slow trng", bench_async },
+};
+
+void bench_report(const char *suite, const char *stage, uint64_t bytes, uint64_t ns)
+{
+    double mbps = ns ? ((double)bytes / (1024.0 * 1024.0)) / ((double)ns / 1e9) : 0.0;
+    double nspb = bytes ? (double)ns / (double)bytes : 0.0;
+    printf("%-10s %-24s %12llu bytes %10.2f MB/s %10.3f ns/byte\n",
+           suite, stage, (unsigned long long)bytes, mbps, nspb);
+}
+
+void bench_report_calls(const char *suite, const char *stage, uint64_t calls, uint64_t bytes, uint64_t ns)
+{
+    double mbps = ns ? ((double)bytes / (1024.0 * 1024.0)) / ((double)ns / 1e9) : 0.0;
+    double nspc = calls ? (double)ns / (double)calls : 0.0;
+    printf("%-10s %-24s %12llu calls %10.2f MB/s %10.1f ns/call\n",
+           suite, stage, (unsigned long long)calls, mbps, nspc);
+}
+
+int bench_acquire(uint8_t *buf, size_t len)
+{
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    int res = trng_core_fill(&trng_obj, buf, len);
+    trng_free(&trng_obj);
+    return res;
+}
+
+/*Every bit set with probability 7/8*/
+void bench_make_biased(std::vector<uint8_t> &data, const std::vector<uint8_t> &noise)
+{
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        uint8_t v = 0;
+        for (int b = 0; b < 8; b++)
+        {
+            v |= (uint8_t)(((noise[(i * 8 + b) % noise.size()] & 7) != 0) << b);
+        }
+        data[i] = v;
+    }
+}
+
+/*Random 256 byte blocks, each repeated a few times with a changed byte*/
+void bench_make_repetitive(std::vector<uint8_t> &data, const std::vector<uint8_t> &noise)
+{
+    for (size_t i = 0; i < data.size(); i += 256)
+    {
+        size_t n = data.size() - i < 256 ? data.size() - i : 256;
+        size_t src = (i / 1024) * 1024;
+        memcpy(&data[i], &noise[src % (noise.size() - 256)], n);
+        data[i + (noise[i % noise.size()] % n)] ^= 1;
+    }
+}
+
+static void usage(const char *prog)
+{
+    printf("usage: %s <suite|all> [--source urandom|file:<path>|replay:<path>] [--max-chunk N] [suite options]\n", prog);
+    for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++)
+    {
+        printf("  %-10s %s\n", suites[i].name, suites[i].help);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (host_select_source(argc, argv) != 0)
+    {
+        return 1;
+    }
+
+    bool all = strcmp(argv[1], "all") == 0;
+    bool found = false;
+    int res = 0;
+    for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++)
+    {
+        if (all || strcmp(argv[1], suites[i].name) == 0)
+        {
+            found = true;
+            res |= suites[i].run(argc, argv);
+        }
+    }
+
+    if (!found)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    return res;
+}
@@ -0,0 +1,196 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Match extension kernels of lzf_compress (lzf_match.h) on biased,
+* repetitive and random data. The candidate matches are collected the way
+* the compressor finds them (3 byte hash, offset below 8 KB), every kernel
+* built into the binary extends all of them and must agree with the
+* original unrolled loop. Timings are the best of 8 passes.
+*
+* The compress stage runs lzf_compress with the kernel selected at build
+* time; build with ARCH=-mavx2 (or OPT="-O2 -DLZF_MATCH_KERNEL=0" for the
+* original loop) to compare.
+*/
+
+#include "bench.h"
+
+extern "C" {
+#include "lzf_ctx.h"
+#include "lzf_match.h"
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#define MATCH_MAX_OFF           (1 << 13)
+#define MATCH_MAX_REF           ((1 << 8) + (1 << 3))
+
+struct match_pair {
+    uint32_t pos;
+    uint32_t ref;
+    uint32_t maxlen;
+};
+
+typedef unsigned int (*match_kernel)(const unsigned char *ref, const unsigned char *ip, unsigned int maxlen);
+
+static const struct {
+    const char *name;
+    match_kernel kernel;
+} kernels[] = {
+    { "unrolled", lzf_match_len_unrolled },
+#if LZF_MATCH_HAVE_WORD
+    { "word",     lzf_match_len_word },
+#endif
+#if LZF_MATCH_HAVE_SSE2
+    { "sse2",     lzf_match_len_sse2 },
+#endif
+#if LZF_MATCH_HAVE_AVX2
+    { "avx2",     lzf_match_len_avx2 },
+#endif
+#if LZF_MATCH_HAVE_NEON
+    { "neon",     lzf_match_len_neon },
+#endif
+};
+
+static const char *kernel_names[] = { "unrolled", "word", "sse2", "avx2", "neon" };
+
+static void collect_pairs(const std::vector<uint8_t> &data, std::vector<match_pair> &pairs)
+{
+    std::vector<uint32_t> last(1 << 16, 0xffffffffu);
+    size_t len = data.size();
+
+    for (size_t i = 0; i + 3 <= len; i++)
+    {
+        uint32_t h = ((data[i] << 16) | (data[i + 1] << 8) | data[i + 2]) * 2654435761u >> 16;
+        uint32_t ref = last[h];
+        last[h] = (uint32_t)i;
+
+        if (ref == 0xffffffffu || ref == 0 || i - ref - 1 >= MATCH_MAX_OFF ||
+            memcmp(&data[ref], &data[i], 3) != 0)
+        {
+            continue;
+        }
+
+        match_pair p;
+        p.pos = (uint32_t)i;
+        p.ref = ref;
+        p.maxlen = (uint32_t)(len - i - 2);
+        p.maxlen = p.maxlen > MATCH_MAX_REF ? MATCH_MAX_REF : p.maxlen;
+        pairs.push_back(p);
+    }
+}
+
+static int run_set(const char *set, const std::vector<uint8_t> &data)
+{
+    std::vector<match_pair> pairs;
+    collect_pairs(data, pairs);
+
+    std::vector<uint32_t> expected(pairs.size());
+    uint64_t matched = 0;
+    for (size_t i = 0; i < pairs.size(); i++)
+    {
+        expected[i] = lzf_match_len_unrolled(&data[pairs[i].ref], &data[pairs[i].pos], pairs[i].maxlen);
+        matched += expected[i];
+    }
+
+    printf("match: %s, %zu candidate matches, %.1f bytes average\n",
+           set, pairs.size(), pairs.empty() ? 0.0 : (double)matched / (double)pairs.size());
+
+    int res = 0;
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        for (size_t i = 0; i < pairs.size(); i++)
+        {
+            if (kernels[k].kernel(&data[pairs[i].ref], &data[pairs[i].pos], pairs[i].maxlen) != expected[i])
+            {
+                fprintf(stderr, "match: %s kernel differs from the unrolled loop at %u\n",
+                        kernels[k].name, pairs[i].pos);
+                res = 1;
+                break;
+            }
+        }
+
+        /*Best of a few passes, the shortest pass is the least disturbed one*/
+        unsigned int sink = 0;
+        uint64_t ns = UINT64_MAX;
+        for (int rep = 0; rep < 8; rep++)
+        {
+            uint64_t start = host_now_ns();
+            for (size_t i = 0; i < pairs.size(); i++)
+            {
+                sink += kernels[k].kernel(&data[pairs[i].ref], &data[pairs[i].pos], pairs[i].maxlen);
+            }
+            uint64_t pass = host_now_ns() - start;
+            ns = pass < ns ? pass : ns;
+        }
+
+        char stage[32];
+        snprintf(stage, sizeof(stage), "%s/%s", set, kernels[k].name);
+        bench_report_calls("match", stage, pairs.size(), matched, ns);
+        if (sink == 0 && !pairs.empty())
+        {
+            res = 1;
+        }
+    }
+
+    unsigned int hlog = 14;
+    std::vector<uint8_t> arena(lzf_ctx_state_size_mode(hlog, LZF_CTX_TAGGED));
+    std::vector<uint8_t> out(LZF_COMPRESS_BOUND(data.size()));
+    lzf_ctx lzf;
+    lzf_ctx_init_mode(&lzf, hlog, LZF_CTX_TAGGED, &arena[0], arena.size());
+
+    unsigned int comp_len = 0;
+    uint64_t ns = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        comp_len = lzf_ctx_compress(&lzf, &data[0], (unsigned int)data.size(), &out[0], (unsigned int)out.size());
+        uint64_t pass = host_now_ns() - start;
+        ns = pass < ns ? pass : ns;
+    }
+
+    char stage[32];
+    snprintf(stage, sizeof(stage), "%s/compress", set);
+    bench_report("match", stage, data.size(), ns);
+    printf("match: %s compressed to %.1f%%\n", set, 100.0 * comp_len / (double)data.size());
+    return res;
+}
+
+int bench_match(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 4 << 20);
+    std::vector<uint8_t> noise(len + 256), data(len);
+
+    if (len < 4096 || bench_acquire(&noise[0], noise.size()) != 0)
+    {
+        fprintf(stderr, "match: cannot acquire %zu bytes of input\n", noise.size());
+        return 1;
+    }
+
+    printf("match: lzf_compress built with the %s kernel\n", kernel_names[LZF_MATCH_KERNEL]);
+
+    int res = 0;
+    bench_make_biased(data, noise);
+    res |= run_set("biased", data);
+    bench_make_repetitive(data, noise);
+    res |= run_set("repetitive", data);
+    memcpy(&data[0], &noise[0], len);
+    res |= run_set("random", data);
+    return res;
+}
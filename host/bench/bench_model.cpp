@@ -0,0 +1,136 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The entropy coding estimators of trng_model.h next to lzf screening
+* (trng_core_screen) on random, biased and repetitive data and on slightly
+* biased data (every bit set with probability 0.6), which has few repeated
+* strings for lzf to find. Chunks of --chunk bytes and of 64 KB, timings
+* are the best of 8 passes.
+*/
+
+#include "bench.h"
+#include "trng_core.h"
+#include "trng_model.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+typedef struct {
+    const char *name;
+    int kind;                           //-1 for lzf
+    unsigned int order;
+    unsigned int hlog;
+} model_stage;
+
+static const model_stage stages[] = {
+    { "lzf",     -1,                0, 0 },
+    { "order0",  TRNG_MODEL_ORDER0, 0, 0 },
+    { "orderk0", TRNG_MODEL_ORDERK, 0, 8 },
+    { "orderk1", TRNG_MODEL_ORDERK, 1, 16 },
+    { "orderk2", TRNG_MODEL_ORDERK, 2, 16 },
+    { "rans",    TRNG_MODEL_RANS,   0, 0 },
+};
+
+static int run_set(const char *set, const std::vector<uint8_t> &data, size_t chunk, unsigned int percentage)
+{
+    size_t chunks = data.size() / chunk;
+    unsigned int out_len = trng_core_threshold((unsigned int)chunk, percentage);
+    std::vector<uint8_t> lzf_arena(lzf_ctx_state_size(lzf_ctx_hlog_for((unsigned int)chunk, 14)));
+    std::vector<unsigned int> res(chunks);
+    lzf_ctx lzf;
+    lzf_ctx_init(&lzf, lzf_ctx_hlog_for((unsigned int)chunk, 14), &lzf_arena[0], lzf_arena.size());
+
+    for (size_t st = 0; st < sizeof(stages) / sizeof(stages[0]); st++)
+    {
+        const model_stage *stage = &stages[st];
+        std::vector<uint32_t> arena;
+        trng_model model;
+        if (stage->kind >= 0)
+        {
+            arena.resize(trng_model_state_size(stage->kind, stage->hlog, (unsigned int)chunk) / sizeof(uint32_t));
+            if (trng_model_init(&model, stage->kind, stage->order, stage->hlog, (unsigned int)chunk,
+                                &arena[0], arena.size() * sizeof(uint32_t)) != 0)
+            {
+                fprintf(stderr, "model: cannot set up %s\n", stage->name);
+                return 1;
+            }
+        }
+
+        uint64_t best = UINT64_MAX;
+        for (int rep = 0; rep < 8; rep++)
+        {
+            uint64_t start = host_now_ns();
+            for (size_t i = 0; i < chunks; i++)
+            {
+                res[i] = stage->kind < 0 ? trng_core_screen(&data[i * chunk], (unsigned int)chunk, out_len, &lzf, NULL)
+                                         : trng_model_screen(&model, &data[i * chunk], (unsigned int)chunk, out_len);
+            }
+            uint64_t pass = host_now_ns() - start;
+            best = pass < best ? pass : best;
+        }
+
+        size_t below = 0;
+        for (size_t i = 0; i < chunks; i++)
+        {
+            below += res[i] != 0;
+        }
+        char name[48];
+        snprintf(name, sizeof(name), "%s/%zu/%s", set, chunk, stage->name);
+        bench_report_calls("model", name, chunks, chunks * chunk, best);
+        printf("model: %s, %zu byte chunks, %s: %zu of %zu below the threshold\n", set, chunk, stage->name, below, chunks);
+    }
+    return 0;
+}
+
+int bench_model(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 4 << 20);
+    size_t chunk = (size_t)host_size_arg(argc, argv, "chunk", 4096);
+    unsigned int percentage = (unsigned int)host_size_arg(argc, argv, "percentage", 99);
+    std::vector<uint8_t> noise(len + 256), data(len), more(len);
+
+    if (chunk == 0 || len < 65536 || len < chunk || bench_acquire(&noise[0], noise.size()) != 0 ||
+        bench_acquire(&more[0], more.size()) != 0)
+    {
+        fprintf(stderr, "model: cannot acquire %zu bytes of input\n", noise.size());
+        return 1;
+    }
+
+    int res = 0;
+    memcpy(&data[0], &noise[0], len);
+    res |= run_set("random", data, chunk, percentage);
+    res |= run_set("random", data, 65536, percentage);
+
+    /*A bit is set when a byte of noise is below 154, 0.6 of the time*/
+    for (size_t i = 0; i < len; i++)
+    {
+        uint8_t v = 0;
+        for (int b = 0; b < 8; b++)
+        {
+            v = (uint8_t)(v << 1 | ((noise[(i * 8 + b) % noise.size()] ^ more[(i * 8 + b) % len]) < 154));
+        }
+        data[i] = v;
+    }
+    res |= run_set("slight", data, chunk, percentage);
+    res |= run_set("slight", data, 65536, percentage);
+    bench_make_biased(data, noise);
+    res |= run_set("biased", data, chunk, percentage);
+    bench_make_repetitive(data, noise);
+    res |= run_set("repetitive", data, chunk, percentage);
+    return res;
+}
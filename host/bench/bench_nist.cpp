@@ -0,0 +1,108 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Throughput of the SP 800-22 battery (trng_nist.h) fed in chunks, next to
+* the running statistics of trng_stream and a plain copy of the data as the
+* memory bandwidth reference, for the host defaults, without the DFT test
+* and with the small configuration the device test uses. Timings are the
+* best of 8 passes.
+*/
+
+#include "bench.h"
+#include "trng_nist.h"
+#include "trng_stream.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static void run_config(const char *stage, const std::vector<uint8_t> &data, size_t chunk, const trng_nist_config *cfg)
+{
+    std::vector<double> arena(trng_nist_state_size(cfg) / sizeof(double) + 1);
+    trng_nist t;
+    trng_nist_result res;
+    uint64_t best = UINT64_MAX;
+
+    for (int rep = 0; rep < 8; rep++)
+    {
+        trng_nist_init(&t, cfg, &arena[0], arena.size() * sizeof(double));
+        uint64_t start = host_now_ns();
+        for (size_t pos = 0; pos + chunk <= data.size(); pos += chunk)
+        {
+            trng_nist_update(&t, &data[pos], chunk);
+        }
+        trng_nist_final(&t, &res);
+        uint64_t pass = host_now_ns() - start;
+        best = pass < best ? pass : best;
+    }
+
+    bench_report("nist", stage, data.size() / chunk * chunk, best);
+    printf("nist: %s, %u of %d p-values below 0.01, %zu bytes of state\n",
+           stage, trng_nist_failures(&res, 0.01), TRNG_NIST_TESTS, trng_nist_state_size(cfg));
+}
+
+int bench_nist(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 16 << 20);
+    size_t chunk = (size_t)host_size_arg(argc, argv, "chunk", 4096);
+    std::vector<uint8_t> data(len), copy(len);
+
+    if (chunk == 0 || len < chunk || bench_acquire(&data[0], len) != 0)
+    {
+        fprintf(stderr, "nist: cannot acquire %zu bytes of input\n", len);
+        return 1;
+    }
+
+    uint64_t best = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        memcpy(&copy[0], &data[0], len);
+        uint64_t pass = host_now_ns() - start;
+        best = pass < best ? pass : best;
+    }
+    bench_report("nist", "memcpy", len, best);
+
+    best = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        trng_stream_stats stats;
+        trng_stream_stats_init(&stats);
+        uint64_t start = host_now_ns();
+        for (size_t pos = 0; pos + chunk <= len; pos += chunk)
+        {
+            trng_stream_stats_update(&stats, &data[pos], chunk);
+        }
+        uint64_t pass = host_now_ns() - start;
+        best = pass < best ? pass : best;
+    }
+    bench_report("nist", "stream stats", len / chunk * chunk, best);
+
+    trng_nist_config cfg;
+    trng_nist_config_default(&cfg);
+    run_config("default", data, chunk, &cfg);
+    cfg.dft_block_bits = 0;
+    run_config("no dft", data, chunk, &cfg);
+
+    /*As in main.cpp*/
+    cfg.longest_run_bits = 128;
+    cfg.serial_m = 8;
+    cfg.apen_m = 7;
+    cfg.dft_block_bits = 256;
+    run_config("device", data, chunk, &cfg);
+    return 0;
+}
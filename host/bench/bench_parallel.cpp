@@ -0,0 +1,80 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Scaling of the parallel qualification pipeline (qualify_pipeline.h) over
+* the number of threads, from 1 to twice the number of cores: throughput,
+* speed up against 1 thread and the steals that balanced the load. Timings
+* are the best of 4 passes over a capture in memory.
+*/
+
+#include "bench.h"
+#include "qualify_pipeline.h"
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+int bench_parallel(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 64 << 20);
+    unsigned int cores = std::thread::hardware_concurrency();
+    unsigned int max_threads = (unsigned int)host_size_arg(argc, argv, "threads", 2 * (cores ? cores : 1));
+    pipeline_config cfg;
+    cfg.chunk_len = (unsigned int)host_size_arg(argc, argv, "chunk", 4096);
+    cfg.percentage = 99;
+    cfg.task_chunks = 0;
+    cfg.transcode = 1;
+
+    std::vector<uint8_t> capture(len);
+    if (cfg.chunk_len == 0 || len < cfg.chunk_len || bench_acquire(&capture[0], len) != 0)
+    {
+        fprintf(stderr, "parallel: cannot acquire %zu bytes of input\n", len);
+        return 1;
+    }
+
+    printf("parallel: %u cores\n", cores);
+    uint64_t single = 0;
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2)
+    {
+        cfg.threads = threads;
+        pipeline_result res, best_res = pipeline_result();
+        uint64_t best = UINT64_MAX;
+        for (int rep = 0; rep < 4; rep++)
+        {
+            pipeline_qualify(&capture[0], len, &cfg, &res);
+            if (res.elapsed_ns < best)
+            {
+                best = res.elapsed_ns;
+                best_res = res;
+            }
+        }
+        single = threads == 1 ? best : single;
+
+        uint64_t steals = 0;
+        for (size_t t = 0; t < best_res.threads.size(); t++)
+        {
+            steals += best_res.threads[t].steals;
+        }
+        char stage[64];
+        snprintf(stage, sizeof(stage), "%u thread%s", threads, threads > 1 ? "s" : "");
+        bench_report("parallel", stage, best_res.stats.bytes, best);
+        printf("parallel: %u threads, %.2fx speed up, %.0f%% efficiency, %llu tasks, %llu steals\n", threads,
+               (double)single / (double)best, 100.0 * (double)single / (double)best / threads,
+               (unsigned long long)best_res.tasks, (unsigned long long)steals);
+    }
+    return 0;
+}
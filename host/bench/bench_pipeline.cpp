@@ -0,0 +1,117 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Runs the stages of the trng test core one after the other over --bytes of
+* trng output taken in --chunk sized steps (BUFFER_LEN of main.cpp by default).
+*/
+
+#include "bench.h"
+#include "trng_core.h"
+#include "base64b.h"
+
+#include <stdio.h>
+#include <vector>
+
+int bench_pipeline(int argc, char **argv)
+{
+    uint64_t total = host_size_arg(argc, argv, "bytes", 16 << 20);
+    size_t chunk = (size_t)host_size_arg(argc, argv, "chunk", 64);
+    unsigned int percentage = (unsigned int)host_size_arg(argc, argv, "percentage", 99);
+    unsigned int hlog = (unsigned int)host_size_arg(argc, argv, "hlog", lzf_ctx_hlog_for((unsigned int)chunk, 14));
+
+    if (chunk == 0 || total < chunk)
+    {
+        fprintf(stderr, "pipeline: --bytes must be at least --chunk\n");
+        return 1;
+    }
+    size_t chunks = (size_t)(total / chunk);
+    total = (uint64_t)chunks * chunk;
+
+    std::vector<uint8_t> capture((size_t)total);
+    std::vector<uint8_t> out(chunk);
+    std::vector<uint8_t> arena(lzf_ctx_state_size(hlog));
+    lzf_ctx lzf;
+    trng_t trng_obj;
+
+    if (lzf_ctx_init(&lzf, hlog, arena.data(), arena.size()) != 0)
+    {
+        fprintf(stderr, "pipeline: unsupported --hlog %u\n", hlog);
+        return 1;
+    }
+
+    uint64_t start = host_now_ns();
+    trng_init(&trng_obj);
+    for (size_t i = 0; i < chunks; i++)
+    {
+        if (trng_core_fill(&trng_obj, &capture[i * chunk], chunk) != 0)
+        {
+            trng_free(&trng_obj);
+            fprintf(stderr, "pipeline: trng_get_bytes error after %zu chunks\n", i);
+            return 1;
+        }
+    }
+    trng_free(&trng_obj);
+    bench_report("pipeline", "acquire", total, host_now_ns() - start);
+
+    unsigned int out_len = trng_core_threshold((unsigned int)chunk, percentage);
+    size_t compressible = 0;
+    start = host_now_ns();
+    for (size_t i = 0; i < chunks; i++)
+    {
+        if (trng_core_compress(&capture[i * chunk], (unsigned int)chunk, &out[0], out_len, &lzf) != 0)
+        {
+            compressible++;
+        }
+    }
+    bench_report("pipeline", "compress", total, host_now_ns() - start);
+
+    /*Round trip of every chunk, compressed in full so random chunks are decompressed too*/
+    std::vector<uint8_t> packed(chunks * LZF_COMPRESS_BOUND(chunk)), scratch(chunk);
+    std::vector<unsigned int> packed_len(chunks);
+    for (size_t i = 0; i < chunks; i++)
+    {
+        packed_len[i] = trng_core_compress(&capture[i * chunk], (unsigned int)chunk,
+                                           &packed[i * LZF_COMPRESS_BOUND(chunk)],
+                                           (unsigned int)LZF_COMPRESS_BOUND(chunk), &lzf);
+    }
+    size_t failures = 0;
+    start = host_now_ns();
+    for (size_t i = 0; i < chunks; i++)
+    {
+        failures += trng_core_verify(&packed[i * LZF_COMPRESS_BOUND(chunk)], packed_len[i],
+                                     &capture[i * chunk], (unsigned int)chunk, &scratch[0]) != 0;
+    }
+    bench_report("pipeline", "decompress+verify", total, host_now_ns() - start);
+
+    size_t encoded = 0;
+    start = host_now_ns();
+    for (size_t i = 0; i < chunks; i++)
+    {
+        encoded += base64_encode(&capture[i * chunk], chunk).size();
+    }
+    bench_report("pipeline", "encode", total, host_now_ns() - start);
+
+    if (failures != 0)
+    {
+        fprintf(stderr, "pipeline: %zu chunks failed the round trip\n", failures);
+        return 1;
+    }
+
+    printf("pipeline: %zu of %zu chunks of %zu bytes compressed below %u%% (hlog %u), %zu base64 chars\n",
+           compressible, chunks, chunk, percentage, hlog, encoded);
+    return 0;
+}
@@ -0,0 +1,168 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Small reads served by the entropy pool (trng_pool.h) against the same
+* reads made with trng_get_bytes: a refill thread keeps the pool topped up
+* with calls of --batch bytes while 1 or 2 consumer threads read --read
+* bytes at a time, waiting out short reads. Besides the time per read the
+* pool reports its hit rate and the latency of the refills.
+*/
+
+#include "bench.h"
+#include "trng_pool.h"
+#include "trng_host.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+static uint64_t direct_pass(size_t reads, size_t read_len)
+{
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    uint8_t out[256];
+    uint64_t start = host_now_ns();
+    for (size_t i = 0; i < reads; i++)
+    {
+        size_t got = 0;
+        for (size_t pos = 0; pos < read_len; pos += got)
+        {
+            if (trng_get_bytes(&trng_obj, out + pos, read_len - pos, &got) != 0)
+            {
+                break;
+            }
+        }
+    }
+    uint64_t pass = host_now_ns() - start;
+    trng_free(&trng_obj);
+    return pass;
+}
+
+static uint64_t pool_pass(size_t reads, size_t read_len, unsigned int consumers, uint32_t capacity,
+                          uint32_t batch, trng_pool_stats *stats)
+{
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    trng_pool_config cfg;
+    cfg.capacity = capacity;
+    cfg.batch = batch;
+    cfg.trng = &trng_obj;
+    cfg.health = NULL;
+    cfg.now_ns = host_now_ns;
+    std::vector<uint8_t> ring(capacity);
+    trng_pool pool;
+    trng_pool_init(&pool, &cfg, &ring[0]);
+
+    /*The pool starts full, as it would be after idling*/
+    while (trng_pool_refill(&pool) > 0)
+    {
+    }
+
+    std::atomic<bool> done(false);
+    std::thread refill([&]() {
+        while (!done.load(std::memory_order_relaxed))
+        {
+            if (trng_pool_refill(&pool) <= 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint64_t start = host_now_ns();
+    std::vector<std::thread> threads;
+    for (unsigned int c = 0; c < consumers; c++)
+    {
+        threads.push_back(std::thread([&]() {
+            uint8_t out[256];
+            for (size_t i = 0; i < reads / consumers; i++)
+            {
+                for (size_t pos = 0; pos < read_len;)
+                {
+                    size_t got = trng_pool_read(&pool, out + pos, read_len - pos);
+                    pos += got;
+                    if (got == 0)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+        }));
+    }
+    for (size_t c = 0; c < threads.size(); c++)
+    {
+        threads[c].join();
+    }
+    uint64_t pass = host_now_ns() - start;
+    done = true;
+    refill.join();
+    trng_free(&trng_obj);
+    trng_pool_get_stats(&pool, stats);
+    return pass;
+}
+
+int bench_pool(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 16 << 20);
+    size_t read_len = (size_t)host_size_arg(argc, argv, "read", 32);
+    uint32_t capacity = (uint32_t)host_size_arg(argc, argv, "capacity", 64 << 10);
+    uint32_t batch = (uint32_t)host_size_arg(argc, argv, "batch", 4096);
+    trng_pool_config probe = { capacity, batch, NULL, NULL, NULL };
+    trng_pool pool;
+
+    if (read_len == 0 || read_len > 256 || len < read_len || trng_pool_init(&pool, &probe, NULL) != 0)
+    {
+        fprintf(stderr, "pool: --read must be 1 to 256, --capacity a power of 2 and --batch at most the capacity\n");
+        return 1;
+    }
+    size_t reads = len / read_len / 2 * 2;
+
+    uint64_t direct = UINT64_MAX;
+    for (int rep = 0; rep < 4; rep++)
+    {
+        uint64_t pass = direct_pass(reads, read_len);
+        direct = pass < direct ? pass : direct;
+    }
+    char stage[64];
+    snprintf(stage, sizeof(stage), "trng_get_bytes %zu", read_len);
+    bench_report_calls("pool", stage, reads, reads * read_len, direct);
+
+    for (unsigned int consumers = 1; consumers <= 2; consumers++)
+    {
+        trng_pool_stats stats, best_stats = trng_pool_stats();
+        uint64_t best = UINT64_MAX;
+        for (int rep = 0; rep < 4; rep++)
+        {
+            uint64_t pass = pool_pass(reads, read_len, consumers, capacity, batch, &stats);
+            if (pass < best)
+            {
+                best = pass;
+                best_stats = stats;
+            }
+        }
+        snprintf(stage, sizeof(stage), "pool read %zu, %u thread%s", read_len, consumers, consumers > 1 ? "s" : "");
+        bench_report_calls("pool", stage, reads, reads * read_len, best);
+        printf("pool: %u thread%s, %.1f%% hits, %lu short reads, %llu refills of %.1f us (max %.1f us), %llu errors\n",
+               consumers, consumers > 1 ? "s" : "",
+               best_stats.reads ? 100.0 * (double)best_stats.hits / (double)best_stats.reads : 0.0,
+               best_stats.short_reads, (unsigned long long)best_stats.refills,
+               best_stats.refills ? (double)best_stats.refill_ns / (double)best_stats.refills / 1e3 : 0.0,
+               (double)best_stats.refill_max_ns / 1e3, (unsigned long long)best_stats.refill_errors);
+    }
+    return 0;
+}
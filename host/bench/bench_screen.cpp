@@ -0,0 +1,121 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Pass/fail check of the trng test done by compressing every chunk into the
+* threshold (trng_core_compress) and by screening it (trng_core_screen), on
+* random, biased and repetitive data. Both must give the same verdict for
+* every chunk. Timings are the best of 8 passes.
+*/
+
+#include "bench.h"
+#include "trng_core.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+static int run_set(const char *set, const std::vector<uint8_t> &data, size_t chunk,
+                   unsigned int percentage, unsigned int hlog)
+{
+    size_t chunks = data.size() / chunk;
+    unsigned int out_len = trng_core_threshold((unsigned int)chunk, percentage);
+    std::vector<uint8_t> arena(lzf_ctx_state_size(hlog)), out(out_len + 1);
+    lzf_ctx lzf;
+    if (lzf_ctx_init(&lzf, hlog, &arena[0], arena.size()) != 0)
+    {
+        fprintf(stderr, "screen: unsupported --hlog %u\n", hlog);
+        return 1;
+    }
+
+    std::vector<unsigned int> comp(chunks);
+    uint64_t compress_ns = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        for (size_t i = 0; i < chunks; i++)
+        {
+            comp[i] = trng_core_compress(&data[i * chunk], (unsigned int)chunk, &out[0], out_len, &lzf);
+        }
+        uint64_t pass = host_now_ns() - start;
+        compress_ns = pass < compress_ns ? pass : compress_ns;
+    }
+
+    std::vector<unsigned int> screened(chunks);
+    uint64_t screen_ns = UINT64_MAX;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        for (size_t i = 0; i < chunks; i++)
+        {
+            screened[i] = trng_core_screen(&data[i * chunk], (unsigned int)chunk, out_len, &lzf, NULL);
+        }
+        uint64_t pass = host_now_ns() - start;
+        screen_ns = pass < screen_ns ? pass : screen_ns;
+    }
+
+    int res = 0;
+    size_t compressible = 0;
+    uint64_t scanned = 0, matched = 0;
+    for (size_t i = 0; i < chunks; i++)
+    {
+        lzf_screen_stats stats;
+        unsigned int bound = trng_core_screen(&data[i * chunk], (unsigned int)chunk, out_len, &lzf, &stats);
+        if ((bound != 0) != (comp[i] != 0) || bound != screened[i] || (bound != 0 && bound < comp[i]))
+        {
+            fprintf(stderr, "screen: %s chunk %zu screened to %u, compressed to %u\n", set, i, bound, comp[i]);
+            res = 1;
+        }
+        compressible += comp[i] != 0;
+        scanned += stats.scanned;
+        matched += stats.match_bytes;
+    }
+
+    char stage[32];
+    snprintf(stage, sizeof(stage), "%s/compress", set);
+    bench_report_calls("screen", stage, chunks, chunks * chunk, compress_ns);
+    snprintf(stage, sizeof(stage), "%s/screen", set);
+    bench_report_calls("screen", stage, chunks, chunks * chunk, screen_ns);
+    printf("screen: %s, %zu of %zu chunks compressible, %.1f%% screened, %.1f%% matched, %.2fx\n",
+           set, compressible, chunks, 100.0 * scanned / (double)(chunks * chunk),
+           100.0 * matched / (double)(chunks * chunk),
+           screen_ns ? (double)compress_ns / (double)screen_ns : 0.0);
+    return res;
+}
+
+int bench_screen(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 4 << 20);
+    size_t chunk = (size_t)host_size_arg(argc, argv, "chunk", 4096);
+    unsigned int percentage = (unsigned int)host_size_arg(argc, argv, "percentage", 99);
+    unsigned int hlog = (unsigned int)host_size_arg(argc, argv, "hlog", lzf_ctx_hlog_for((unsigned int)chunk, 14));
+    std::vector<uint8_t> noise(len + 256), data(len);
+
+    if (chunk == 0 || len < chunk || bench_acquire(&noise[0], noise.size()) != 0)
+    {
+        fprintf(stderr, "screen: cannot acquire %zu bytes of input\n", noise.size());
+        return 1;
+    }
+
+    int res = 0;
+    memcpy(&data[0], &noise[0], len);
+    res |= run_set("random", data, chunk, percentage, hlog);
+    bench_make_biased(data, noise);
+    res |= run_set("biased", data, chunk, percentage, hlog);
+    bench_make_repetitive(data, noise);
+    res |= run_set("repetitive", data, chunk, percentage, hlog);
+    return res;
+}
@@ -0,0 +1,140 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Cost of keeping a history of boots in the snapshot ring (trng_snapshot.h)
+* over an in memory key store: open, append and a read of the whole history
+* per boot, and the bytes handed to the store per boot against keeping the
+* same history in a single key rewritten on every boot. Samples are 64 bytes
+* of the selected source with a line of text as metadata, timings are the
+* best of 8 passes.
+*/
+
+#include "bench.h"
+#include "trng_snapshot.h"
+
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define SAMPLE_LEN      64
+
+struct mem_store {
+    std::map<uint16_t, std::vector<uint8_t> > keys;
+    uint64_t bytes_set;
+};
+
+static int mem_get(void *ctx, uint16_t key, uint16_t buf_size, void *buf, uint16_t *actual)
+{
+    mem_store *store = (mem_store *)ctx;
+    std::map<uint16_t, std::vector<uint8_t> >::const_iterator it = store->keys.find(key);
+    if (it == store->keys.end() || it->second.size() > buf_size)
+    {
+        return -1;
+    }
+    memcpy(buf, it->second.data(), it->second.size());
+    *actual = (uint16_t)it->second.size();
+    return 0;
+}
+
+static int mem_set(void *ctx, uint16_t key, uint16_t size, const void *buf)
+{
+    mem_store *store = (mem_store *)ctx;
+    store->bytes_set += size;
+    store->keys[key].assign((const uint8_t *)buf, (const uint8_t *)buf + size);
+    return 0;
+}
+
+static int count_record(const trng_snapshot_record *record, void *ctx)
+{
+    *(uint64_t *)ctx += record->sample_len;
+    return 0;
+}
+
+int bench_snapshot(int argc, char **argv)
+{
+    unsigned int slots = (unsigned int)host_size_arg(argc, argv, "slots", 32);
+    size_t boots = (size_t)host_size_arg(argc, argv, "boots", 1024);
+    std::vector<uint8_t> data(boots * SAMPLE_LEN);
+    if (slots == 0 || slots > 4096 || boots == 0 || bench_acquire(&data[0], data.size()) != 0)
+    {
+        fprintf(stderr, "snapshot: cannot acquire %zu boots of input\n", boots);
+        return 1;
+    }
+
+    std::vector<uint8_t> arena(lzf_ctx_state_size(8));
+    lzf_ctx lzf;
+    lzf_ctx_init(&lzf, 8, &arena[0], arena.size());
+
+    trng_snapshot_config cfg;
+    cfg.first_key = 3;
+    cfg.slots = (uint16_t)slots;
+    cfg.max_record = 160;
+    cfg.store.get = mem_get;
+    cfg.store.set = mem_set;
+    std::vector<uint8_t> work(TRNG_SNAPSHOT_WORK_SIZE(cfg.max_record));
+
+    uint64_t open_ns = UINT64_MAX, append_ns = UINT64_MAX, read_ns = UINT64_MAX, bytes_set = 0, stored = 0;
+    for (int rep = 0; rep < 8; rep++)
+    {
+        mem_store store;
+        store.bytes_set = 0;
+        cfg.store.ctx = &store;
+        uint64_t open_pass = 0, append_pass = 0, read_pass = 0, sample_bytes = 0;
+        for (size_t b = 0; b < boots; b++)
+        {
+            char meta[96];
+            int meta_len = snprintf(meta, sizeof(meta), "boot %zu step %zu: not compressible, fingerprints of %zu previous boots not seen",
+                                    b, b % 2 + 1, b);
+            trng_snapshot snap;
+            uint64_t start = host_now_ns();
+            trng_snapshot_open(&snap, &cfg, &work[0], work.size());
+            uint64_t opened = host_now_ns();
+            trng_snapshot_append(&snap, &data[b * SAMPLE_LEN], SAMPLE_LEN, (const uint8_t *)meta, (uint16_t)meta_len, &lzf);
+            uint64_t appended = host_now_ns();
+            trng_snapshot_read(&snap, count_record, &sample_bytes);
+            uint64_t read = host_now_ns();
+            open_pass += opened - start;
+            append_pass += appended - opened;
+            read_pass += read - appended;
+        }
+        open_ns = open_pass < open_ns ? open_pass : open_ns;
+        append_ns = append_pass < append_ns ? append_pass : append_ns;
+        read_ns = read_pass < read_ns ? read_pass : read_ns;
+        bytes_set = store.bytes_set;
+        stored = 0;
+        for (std::map<uint16_t, std::vector<uint8_t> >::const_iterator it = store.keys.begin(); it != store.keys.end(); ++it)
+        {
+            stored += it->second.size();
+        }
+    }
+
+    bench_report_calls("snapshot", "open", boots, boots * SAMPLE_LEN, open_ns);
+    bench_report_calls("snapshot", "append", boots, boots * SAMPLE_LEN, append_ns);
+    bench_report_calls("snapshot", "read history", boots, boots * SAMPLE_LEN, read_ns);
+
+    /*One key holding the last slots samples is rewritten in full on every boot*/
+    uint64_t single_key = 0;
+    for (size_t b = 0; b < boots; b++)
+    {
+        single_key += (b + 1 < slots ? b + 1 : slots) * SAMPLE_LEN;
+    }
+    printf("snapshot: %zu boots into %u slots, %.1f bytes set per boot, %.1f for a single key of raw samples, "
+           "%llu bytes in the ring\n", boots, slots, (double)bytes_set / (double)boots, (double)single_key / (double)boots,
+           (unsigned long long)stored);
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Cost of the trace sites of trng_trace.h: a bare trng_trace_record, from
+* 1 and 4 threads at once, a site timed with the host clock, and fills of
+* --read bytes (64 by default, the buffer of the device test) through
+* trng_core_fill against the same reads made with trng_get_bytes, which
+* is what the fill costs with the sites compiled out. Built with TRACE=0
+* the fill stages show no sites at all. Timings are the best of 8 passes.
+*/
+
+#include "bench.h"
+#include "trng_core.h"
+#include "trng_trace.h"
+
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+static void record_pass(size_t calls)
+{
+    for (size_t i = 0; i < calls; i++)
+    {
+        trng_trace_record(TRNG_TRACE_LZF, (uint32_t)i, 64);
+    }
+}
+
+static void timed_pass(size_t calls)
+{
+    for (size_t i = 0; i < calls; i++)
+    {
+        uint32_t start = trng_trace_now();
+        trng_trace_record(TRNG_TRACE_LZF, trng_trace_now() - start, 64);
+    }
+}
+
+static uint64_t threads_pass(size_t calls, unsigned int threads)
+{
+    std::vector<std::thread> workers;
+    uint64_t start = host_now_ns();
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        workers.push_back(std::thread(record_pass, calls / threads));
+    }
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        workers[t].join();
+    }
+    return host_now_ns() - start;
+}
+
+static uint64_t read_pass(size_t reads, size_t read_len, bool fill)
+{
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    uint8_t out[4096];
+    uint64_t start = host_now_ns();
+    for (size_t i = 0; i < reads; i++)
+    {
+        if (fill)
+        {
+            trng_core_fill(&trng_obj, out, read_len);
+            continue;
+        }
+        size_t got = 0;
+        for (size_t pos = 0; pos < read_len; pos += got)
+        {
+            if (trng_get_bytes(&trng_obj, out + pos, read_len - pos, &got) != 0)
+            {
+                break;
+            }
+        }
+    }
+    uint64_t pass = host_now_ns() - start;
+    trng_free(&trng_obj);
+    return pass;
+}
+
+int bench_trace(int argc, char **argv)
+{
+    size_t calls = (size_t)host_size_arg(argc, argv, "calls", 1 << 20);
+    size_t reads = (size_t)host_size_arg(argc, argv, "reads", 1 << 15);
+    size_t read_len = (size_t)host_size_arg(argc, argv, "read", 64);
+    if (read_len == 0 || read_len > 4096)
+    {
+        fprintf(stderr, "trace: --read must be 1 to 4096\n");
+        return 1;
+    }
+
+    uint64_t best[7];
+    for (int s = 0; s < 7; s++)
+    {
+        best[s] = UINT64_MAX;
+    }
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t pass[7];
+        trng_trace_clock(NULL, 0);
+        uint64_t start = host_now_ns();
+        record_pass(calls);
+        pass[0] = host_now_ns() - start;
+        pass[1] = threads_pass(calls, 4);
+
+        host_trace_start();
+        start = host_now_ns();
+        timed_pass(calls);
+        pass[2] = host_now_ns() - start;
+
+        trng_trace_clock(NULL, 0);
+        pass[3] = read_pass(reads, read_len, false);
+        pass[4] = read_pass(reads, read_len, true);
+        host_trace_start();
+        pass[5] = read_pass(reads, read_len, false);
+        pass[6] = read_pass(reads, read_len, true);
+        for (int s = 0; s < 7; s++)
+        {
+            best[s] = pass[s] < best[s] ? pass[s] : best[s];
+        }
+    }
+    trng_trace_clock(NULL, 0);
+    trng_trace_reset();
+
+    char name[48];
+    bench_report_calls("trace", "record", calls, 0, best[0]);
+    bench_report_calls("trace", "record/4 threads", calls, 0, best[1]);
+    bench_report_calls("trace", "timed site", calls, 0, best[2]);
+    snprintf(name, sizeof(name), "trng_get_bytes/%zu", read_len);
+    bench_report_calls("trace", name, reads, reads * read_len, best[3]);
+    snprintf(name, sizeof(name), "fill/%zu", read_len);
+    bench_report_calls("trace", name, reads, reads * read_len, best[4]);
+    snprintf(name, sizeof(name), "trng_get_bytes/%zu/clock", read_len);
+    bench_report_calls("trace", name, reads, reads * read_len, best[5]);
+    snprintf(name, sizeof(name), "fill/%zu/clock", read_len);
+    bench_report_calls("trace", name, reads, reads * read_len, best[6]);
+    printf("trace: sites of a fill of %zu bytes cost %.1f ns counted, %.1f ns timed (TRNG_TRACE %d)\n", read_len,
+           ((double)best[4] - (double)best[3]) / reads, ((double)best[6] - (double)best[5]) / reads, TRNG_TRACE);
+    return 0;
+}
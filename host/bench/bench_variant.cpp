@@ -0,0 +1,127 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The compressor variants of trng_lzf.h on random, biased and repetitive
+* data, in 256 byte chunks as on the device and in --chunk byte chunks, next
+* to lzf_compress itself. Every variant keeps its table across calls, as
+* the device test does. Timings are the best of 8 passes.
+*/
+
+#include "bench.h"
+#include "trng_core.h"
+#include "trng_lzf.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "lzf.h"
+#include "lzfP.h"
+}
+
+static void report(const char *set, size_t chunk, const char *name, size_t table, size_t chunks,
+                   uint64_t ns, uint64_t out_bytes, size_t compressible)
+{
+    char stage[48];
+    snprintf(stage, sizeof(stage), "%s/%zu/%s", set, chunk, name);
+    bench_report_calls("variant", stage, chunks, chunks * chunk, ns);
+    printf("variant: %s, %zu byte chunks, %s: %zu byte table, %zu of %zu compressible, %.3f of the input\n",
+           set, chunk, name, table, compressible, chunks, (double)out_bytes / (double)(chunks * chunk));
+}
+
+static void run_set(const char *set, const std::vector<uint8_t> &data, size_t chunk, unsigned int percentage)
+{
+    size_t chunks = data.size() / chunk;
+    unsigned int out_len = trng_core_threshold((unsigned int)chunk, percentage);
+    std::vector<uint8_t> out(out_len + 1);
+    std::vector<unsigned int> comp(chunks);
+
+    /*lzf_compress as every other tool calls it, for the cost of the selection*/
+    static LZF_STATE htab;
+    uint64_t best = UINT64_MAX;
+    memset(htab, 0, sizeof(htab));
+    for (int rep = 0; rep < 8; rep++)
+    {
+        uint64_t start = host_now_ns();
+        for (size_t i = 0; i < chunks; i++)
+        {
+            comp[i] = lzf_compress(&data[i * chunk], (unsigned int)chunk, &out[0], out_len, (unsigned char **)htab);
+        }
+        uint64_t pass = host_now_ns() - start;
+        best = pass < best ? pass : best;
+    }
+    uint64_t out_bytes = 0;
+    size_t compressible = 0;
+    for (size_t i = 0; i < chunks; i++)
+    {
+        out_bytes += comp[i] ? comp[i] : chunk;
+        compressible += comp[i] != 0;
+    }
+    report(set, chunk, "lzf_compress", sizeof(htab), chunks, best, out_bytes, compressible);
+
+    for (int id = 0; id < TRNG_LZF_VARIANTS; id++)
+    {
+        const trng_lzf_info *info = trng_lzf_variant_info(id);
+        std::vector<uint32_t> table(info->state_size / sizeof(uint32_t), 0);
+        best = UINT64_MAX;
+        for (int rep = 0; rep < 8; rep++)
+        {
+            uint64_t start = host_now_ns();
+            for (size_t i = 0; i < chunks; i++)
+            {
+                comp[i] = trng_lzf_compress(id, &data[i * chunk], (unsigned int)chunk, &out[0], out_len, &table[0]);
+            }
+            uint64_t pass = host_now_ns() - start;
+            best = pass < best ? pass : best;
+        }
+
+        out_bytes = 0;
+        compressible = 0;
+        for (size_t i = 0; i < chunks; i++)
+        {
+            out_bytes += comp[i] ? comp[i] : chunk;
+            compressible += comp[i] != 0;
+        }
+        report(set, chunk, info->name, info->state_size, chunks, best, out_bytes, compressible);
+    }
+}
+
+int bench_variant(int argc, char **argv)
+{
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 4 << 20);
+    size_t chunk = (size_t)host_size_arg(argc, argv, "chunk", 4096);
+    unsigned int percentage = (unsigned int)host_size_arg(argc, argv, "percentage", 99);
+    std::vector<uint8_t> noise(len + 256), data(len);
+
+    if (chunk == 0 || len < chunk || len < 256 || bench_acquire(&noise[0], noise.size()) != 0)
+    {
+        fprintf(stderr, "variant: cannot acquire %zu bytes of input\n", noise.size());
+        return 1;
+    }
+
+    memcpy(&data[0], &noise[0], len);
+    run_set("random", data, 256, percentage);
+    run_set("random", data, chunk, percentage);
+    bench_make_biased(data, noise);
+    run_set("biased", data, 256, percentage);
+    run_set("biased", data, chunk, percentage);
+    bench_make_repetitive(data, noise);
+    run_set("repetitive", data, 256, percentage);
+    run_set("repetitive", data, chunk, percentage);
+    return 0;
+}
@@ -0,0 +1,629 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "capture_server.h"
+#include "host_util.h"
+#include "base64b.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define CAPTURE_GROW        (64ull << 20)      //the capture file grows in steps of this
+#define CAPTURE_READ        65536
+#define CAPTURE_LINE_MAX    (2 * TRNG_LINK_HEADER + 2 * 65535 + 64)
+
+struct capture_state {
+    const capture_config *cfg;
+    capture_result *res;
+    int ack_fd;
+    int error;
+    bool ended;                         //{{link_end;...}} arrived
+    uint64_t start;
+
+    /*Receive side*/
+    uint8_t *map;
+    size_t map_len;
+    int fd;
+    uint64_t file_len;
+    FILE *index;
+    std::string line;
+    std::vector<uint8_t> frame;
+
+    /*Shared with the analysis threads, under lock*/
+    std::mutex lock;
+    std::condition_variable published_cv;
+    uint64_t published;                 //chunks the threads may take
+    uint64_t published_bytes;
+    bool done;
+    uint64_t taken;                     //next chunk for an analysis thread
+    uint64_t nist_next;                 //next chunk for the SP 800-22 thread
+    std::map<uint64_t, trng_stream_stats> ready;    //analysed out of order, waiting to be merged
+};
+
+/*Chunk c of the published ones, called under lock*/
+static size_t chunk_len_of(const capture_state *s, uint64_t c)
+{
+    uint64_t left = s->published_bytes - c * s->cfg->chunk_len;
+    return left < s->cfg->chunk_len ? (size_t)left : s->cfg->chunk_len;
+}
+
+static void analysis_thread(capture_state *s)
+{
+    const capture_config *cfg = s->cfg;
+    pipeline_thread *t = pipeline_thread_new(&cfg->qualify);
+    std::unique_lock<std::mutex> l(s->lock);
+
+    for (;;)
+    {
+        s->published_cv.wait(l, [s] { return s->taken < s->published || s->done; });
+        if (s->taken == s->published)
+        {
+            break;
+        }
+        uint64_t c = s->taken++;
+        size_t len = chunk_len_of(s, c);
+        l.unlock();
+
+        /*A short last chunk is counted in the statistics without a verdict on its tail*/
+        const uint8_t *data = s->map + c * cfg->chunk_len;
+        size_t whole = len / cfg->qualify.chunk_len;
+        trng_stream_stats stats;
+        trng_stream_stats_init(&stats);
+        uint64_t failures = pipeline_chunks(t, data, whole, &stats);
+        trng_stream_stats_update(&stats, data + whole * cfg->qualify.chunk_len, len - whole * cfg->qualify.chunk_len);
+
+        l.lock();
+        s->res->transcode_failures += failures;
+        s->ready[c] = stats;
+        for (std::map<uint64_t, trng_stream_stats>::iterator it = s->ready.begin();
+             it != s->ready.end() && it->first == s->res->analysed_chunks; it = s->ready.erase(it))
+        {
+            trng_stream_stats_merge(&s->res->stats, &it->second);
+            s->res->analysed_chunks++;
+        }
+    }
+    l.unlock();
+    pipeline_thread_delete(t);
+}
+
+static void nist_thread(capture_state *s)
+{
+    std::unique_lock<std::mutex> l(s->lock);
+    for (;;)
+    {
+        s->published_cv.wait(l, [s] { return s->nist_next < s->published || s->done; });
+        if (s->nist_next == s->published)
+        {
+            break;
+        }
+        uint64_t c = s->nist_next++;
+        size_t len = chunk_len_of(s, c);
+        l.unlock();
+        trng_nist_update(s->cfg->nist, s->map + c * s->cfg->chunk_len, len);
+        l.lock();
+    }
+}
+
+/*Index the chunk that ends at the capture's current end and hand it to the analysis threads*/
+static void publish(capture_state *s, bool last)
+{
+    uint64_t bytes = s->res->bytes;
+    uint64_t first = s->res->chunks * s->cfg->chunk_len;
+    capture_index_entry entry;
+    entry.offset = first;
+    entry.length = (uint32_t)(bytes - first);
+    entry.reserved = 0;
+    entry.time_ns = host_now_ns() - s->start;
+    if (fwrite(&entry, sizeof(entry), 1, s->index) != 1 || fflush(s->index) != 0)
+    {
+        s->error = CAPTURE_ERR_FILE;
+    }
+    s->res->chunks++;
+
+    std::lock_guard<std::mutex> l(s->lock);
+    s->published = s->res->chunks;
+    s->published_bytes = bytes;
+    s->done = last;
+    uint64_t backlog = s->published - s->res->analysed_chunks;
+    s->res->backlog_max = backlog > s->res->backlog_max ? backlog : s->res->backlog_max;
+    s->published_cv.notify_all();
+}
+
+static void append(capture_state *s, const uint8_t *data, size_t len)
+{
+    const capture_config *cfg = s->cfg;
+    capture_result *res = s->res;
+    if (cfg->limit != 0 && len > cfg->limit - res->bytes)
+    {
+        len = (size_t)(cfg->limit - res->bytes);
+    }
+    if (s->error != 0 || len > s->map_len - res->bytes)
+    {
+        s->error = s->error != 0 ? s->error : CAPTURE_ERR_FULL;
+        return;
+    }
+    if (res->bytes + len > s->file_len)
+    {
+        uint64_t grow = res->bytes + len + CAPTURE_GROW - 1;
+        grow -= grow % CAPTURE_GROW;
+        s->file_len = grow < s->map_len ? grow : s->map_len;
+        if (ftruncate(s->fd, (off_t)s->file_len) != 0)
+        {
+            s->error = CAPTURE_ERR_FILE;
+            return;
+        }
+    }
+
+    while (len > 0)
+    {
+        uint64_t chunk_end = (res->chunks + 1) * cfg->chunk_len;
+        size_t n = len < chunk_end - res->bytes ? len : (size_t)(chunk_end - res->bytes);
+        memcpy(s->map + res->bytes, data, n);
+        res->bytes += n;
+        data += n;
+        len -= n;
+        if (res->bytes == chunk_end)
+        {
+            publish(s, false);
+        }
+    }
+}
+
+static void deliver(void *ctx, const uint8_t *data, size_t len)
+{
+    append((capture_state *)ctx, data, len);
+}
+
+static int write_all(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = write(fd, data, len);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/*Value of a {{key;value}} line, NULL if the line is not a message with key*/
+static const char *message_value(const std::string &line, const char *key, size_t *value_len)
+{
+    size_t open = line.find("{{");
+    size_t key_len = strlen(key);
+    if (open == std::string::npos || line.compare(open + 2, key_len, key) != 0 || line.size() < open + 2 + key_len + 3 ||
+        line[open + 2 + key_len] != ';')
+    {
+        return NULL;
+    }
+    size_t value = open + 3 + key_len;
+    size_t close = line.find("}}", value);
+    if (close == std::string::npos)
+    {
+        return NULL;
+    }
+    *value_len = close - value;
+    return line.c_str() + value;
+}
+
+static void link_line(capture_state *s, const std::string &line)
+{
+    size_t value_len;
+    const char *value = message_value(line, "link_frame", &value_len);
+    if (value != NULL)
+    {
+        size_t decoded = 0, error_pos = 0;
+        if (b64decode_strict(value, value_len, &s->frame[0], s->frame.size(), &decoded, &error_pos) != BASE64_OK)
+        {
+            decoded = 0;
+        }
+        trng_link_rx_frame(&s->res->link, decoded != 0 ? &s->frame[0] : NULL, decoded);
+    }
+    else if (message_value(line, "link_sync", &value_len) != NULL)
+    {
+        uint8_t ack[TRNG_LINK_HEADER];
+        char msg[64];
+        trng_link_rx_ack(&s->res->link, ack);
+        int n = snprintf(msg, sizeof(msg), "{{link_ack;");
+        n += (int)base64_encode_to(ack, sizeof(ack), msg + n, sizeof(msg) - n);
+        n += snprintf(msg + n, sizeof(msg) - n, "}}\n");
+        if (s->ack_fd >= 0 && write_all(s->ack_fd, msg, (size_t)n) != 0)
+        {
+            s->error = CAPTURE_ERR_READ;
+        }
+        s->res->acks++;
+    }
+    else if (message_value(line, "link_end", &value_len) != NULL)
+    {
+        s->ended = true;
+    }
+    else
+    {
+        s->res->skipped_lines++;
+    }
+}
+
+static void link_input(capture_state *s, const uint8_t *data, size_t len)
+{
+    size_t start = 0;
+    for (size_t i = 0; i < len && !s->ended; i++)
+    {
+        if (data[i] != '\n')
+        {
+            continue;
+        }
+        s->line.append((const char *)data + start, i - start);
+        link_line(s, s->line);
+        s->line.clear();
+        start = i + 1;
+    }
+    /*A line longer than any message is noise, it is cut so memory stays bounded*/
+    s->line.append((const char *)data + start, len - start);
+    if (s->line.size() > CAPTURE_LINE_MAX)
+    {
+        s->line.clear();
+        s->res->skipped_lines++;
+    }
+}
+
+static void progress_call(capture_state *s)
+{
+    capture_result snapshot;
+    {
+        std::lock_guard<std::mutex> l(s->lock);
+        snapshot = *s->res;
+    }
+    snapshot.elapsed_ns = host_now_ns() - s->start;
+    snapshot.stats.elapsed_us = snapshot.elapsed_ns / 1000;
+    s->cfg->progress(&snapshot, s->cfg->progress_ctx);
+}
+
+static int open_capture(capture_state *s)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    uint64_t map_len = s->cfg->max_bytes + (uint64_t)page - 1;
+    map_len -= map_len % (uint64_t)page;
+    if (map_len == 0 || map_len > (uint64_t)SIZE_MAX)
+    {
+        return CAPTURE_ERR_CONFIG;
+    }
+
+    std::string index_path = std::string(s->cfg->path) + ".idx";
+    s->fd = open(s->cfg->path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    s->index = fopen(index_path.c_str(), "wb");
+    if (s->fd < 0 || s->index == NULL)
+    {
+        return CAPTURE_ERR_FILE;
+    }
+
+    /*Pages past the end of the file are only touched once ftruncate has grown it over them*/
+    void *map = mmap(NULL, (size_t)map_len, PROT_READ | PROT_WRITE, MAP_SHARED, s->fd, 0);
+    if (map == MAP_FAILED)
+    {
+        return CAPTURE_ERR_FILE;
+    }
+    s->map = (uint8_t *)map;
+    s->map_len = (size_t)s->cfg->max_bytes;
+    return 0;
+}
+
+static int receive(capture_state *s, int in_fd)
+{
+    const capture_config *cfg = s->cfg;
+    std::vector<uint8_t> buf(CAPTURE_READ);
+    uint64_t next_progress = cfg->progress_ms ? s->start + cfg->progress_ms * 1000000ull : UINT64_MAX;
+    struct pollfd pfd;
+    pfd.fd = in_fd;
+    pfd.events = POLLIN;
+
+    while (s->error == 0 && !s->ended && (cfg->limit == 0 || s->res->bytes < cfg->limit) &&
+           (cfg->stop == NULL || *cfg->stop == 0))
+    {
+        if (cfg->progress != NULL && host_now_ns() >= next_progress)
+        {
+            progress_call(s);
+            next_progress += cfg->progress_ms * 1000000ull;
+        }
+
+        /*Woken every 100 ms to look at stop and progress while the line is quiet*/
+        int ready = poll(&pfd, 1, 100);
+        if (ready == 0 || (ready < 0 && errno == EINTR))
+        {
+            continue;
+        }
+        ssize_t n = ready < 0 ? -1 : read(in_fd, &buf[0], buf.size());
+        if (n < 0 && (errno == EINTR || errno == EAGAIN))
+        {
+            continue;
+        }
+        if (n == 0 || (n < 0 && errno == EIO))
+        {
+            /*End of a pipe or file, or the other side of a pseudo terminal hung up*/
+            break;
+        }
+        if (n < 0)
+        {
+            return CAPTURE_ERR_READ;
+        }
+
+        uint64_t t0 = host_now_ns();
+        if (cfg->format == CAPTURE_RAW)
+        {
+            append(s, &buf[0], (size_t)n);
+        }
+        else
+        {
+            link_input(s, &buf[0], (size_t)n);
+        }
+        uint64_t spent = host_now_ns() - t0;
+        s->res->reads++;
+        s->res->receive_ns += spent;
+        s->res->receive_max_ns = spent > s->res->receive_max_ns ? spent : s->res->receive_max_ns;
+    }
+    return s->error;
+}
+
+int capture_run(int in_fd, int ack_fd, const capture_config *cfg, capture_result *res)
+{
+    memset(res, 0, sizeof(*res));
+    trng_stream_stats_init(&res->stats);
+    if (cfg->path == NULL || (cfg->format != CAPTURE_RAW && cfg->format != CAPTURE_LINK) || cfg->chunk_len == 0 ||
+        cfg->qualify.chunk_len == 0 || cfg->chunk_len % cfg->qualify.chunk_len != 0 || cfg->qualify.percentage == 0 ||
+        cfg->qualify.percentage > 100)
+    {
+        return CAPTURE_ERR_CONFIG;
+    }
+
+    capture_state s;
+    s.cfg = cfg;
+    s.res = res;
+    s.ack_fd = ack_fd;
+    s.error = 0;
+    s.ended = false;
+    s.start = host_now_ns();
+    s.map = NULL;
+    s.map_len = 0;
+    s.fd = -1;
+    s.file_len = 0;
+    s.index = NULL;
+    s.frame.resize(TRNG_LINK_HEADER + 65535 + 3);
+    s.published = s.published_bytes = s.taken = s.nist_next = 0;
+    s.done = false;
+    trng_link_rx_init(&res->link, deliver, &s);
+
+    int err = open_capture(&s);
+    std::vector<std::thread> threads;
+    if (err == 0)
+    {
+        unsigned int n = cfg->qualify.threads ? cfg->qualify.threads : 1;
+        for (unsigned int t = 0; t < n; t++)
+        {
+            threads.push_back(std::thread(analysis_thread, &s));
+        }
+        if (cfg->nist != NULL)
+        {
+            threads.push_back(std::thread(nist_thread, &s));
+        }
+
+        err = receive(&s, in_fd);
+        if (res->bytes > res->chunks * (uint64_t)cfg->chunk_len)
+        {
+            publish(&s, true);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> l(s.lock);
+            s.done = true;
+            s.published_cv.notify_all();
+        }
+        for (size_t t = 0; t < threads.size(); t++)
+        {
+            threads[t].join();
+        }
+        err = err != 0 ? err : s.error;
+    }
+
+    /*The file ends where the data does*/
+    if (s.map != NULL)
+    {
+        munmap(s.map, s.map_len);
+    }
+    if (s.fd >= 0)
+    {
+        err = ftruncate(s.fd, (off_t)res->bytes) != 0 && err == 0 ? CAPTURE_ERR_FILE : err;
+        close(s.fd);
+    }
+    if (s.index != NULL)
+    {
+        fclose(s.index);
+    }
+    res->link.deliver = NULL;
+    res->link.ctx = NULL;
+    res->elapsed_ns = host_now_ns() - s.start;
+    res->stats.elapsed_us = res->elapsed_ns / 1000;
+    return err;
+}
+
+struct device_state {
+    int fd;
+    const capture_device_config *cfg;
+    uint32_t rng;
+    std::string out;
+    std::string in;                     //received and not taken as a line yet
+};
+
+/*Writes of random length, as a serial driver hands them over*/
+static int device_write(device_state *d, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        d->rng = d->rng * 1664525u + 1013904223u;
+        size_t n = d->cfg->write_max > 1 ? 1 + (d->rng >> 8) % d->cfg->write_max : len;
+        n = n < len ? n : len;
+        if (write_all(d->fd, data, n) != 0)
+        {
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int device_send(void *ctx, const uint8_t *frame, size_t len)
+{
+    device_state *d = (device_state *)ctx;
+    d->out.assign("{{link_frame;");
+    size_t head = d->out.size();
+    d->out.resize(head + base64_encoded_len(len));
+    d->out.resize(head + base64_encode_to(frame, len, &d->out[head], d->out.size() - head));
+    d->out.append("}}\n");
+    return device_write(d, d->out.data(), d->out.size());
+}
+
+/*{{link_sync;0}} out, then lines in until the {{link_ack;...}} of the host*/
+static int device_sync(device_state *d, trng_link_tx *tx)
+{
+    static const char sync[] = "{{link_sync;0}}\n";
+    if (device_write(d, sync, sizeof(sync) - 1) != 0)
+    {
+        return -1;
+    }
+    for (;;)
+    {
+        size_t end = d->in.find('\n');
+        if (end == std::string::npos)
+        {
+            char buf[256];
+            ssize_t n = read(d->fd, buf, sizeof(buf));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                return -1;
+            }
+            d->in.append(buf, (size_t)n);
+            continue;
+        }
+
+        std::string line = d->in.substr(0, end);
+        d->in.erase(0, end + 1);
+        size_t value_len;
+        const char *value = message_value(line, "link_ack", &value_len);
+        if (value != NULL)
+        {
+            uint8_t ack[TRNG_LINK_HEADER + 3];
+            size_t decoded = 0, error_pos = 0;
+            if (b64decode_strict(value, value_len, ack, sizeof(ack), &decoded, &error_pos) != BASE64_OK)
+            {
+                decoded = 0;
+            }
+            /*A damaged ACK is asked for again*/
+            int res = trng_link_tx_ack(tx, ack, decoded);
+            if (res != TRNG_LINK_ERR_FRAME || device_write(d, sync, sizeof(sync) - 1) != 0)
+            {
+                return res;
+            }
+        }
+    }
+}
+
+int capture_device(int fd, const capture_device_config *cfg, trng_link_tx_stats *stats)
+{
+    device_state d;
+    d.fd = fd;
+    d.cfg = cfg;
+    d.rng = cfg->seed;
+
+    trng_link_tx tx;
+    trng_link_tx_config link_cfg;
+    std::vector<uint8_t> frames;
+    if (cfg->format == CAPTURE_LINK)
+    {
+        link_cfg.frame_len = cfg->frame_len;
+        link_cfg.window = cfg->window;
+        link_cfg.send = device_send;
+        link_cfg.ctx = &d;
+        frames.resize(TRNG_LINK_TX_SIZE(cfg->window, cfg->frame_len) + 1);
+        int res = trng_link_tx_init(&tx, &link_cfg, &frames[0], frames.size());
+        if (res != 0)
+        {
+            return res;
+        }
+    }
+
+    std::vector<uint8_t> chunk(16384);
+    int res = 0;
+    for (uint64_t sent = 0; sent < cfg->bytes && res >= 0;)
+    {
+        size_t n = cfg->bytes - sent < chunk.size() ? (size_t)(cfg->bytes - sent) : chunk.size();
+        if (cfg->fill(cfg->fill_ctx, &chunk[0], n) != 0)
+        {
+            return -1;
+        }
+        sent += n;
+        if (cfg->format == CAPTURE_RAW)
+        {
+            res = device_write(&d, (const char *)&chunk[0], n);
+            continue;
+        }
+        for (size_t pos = 0; pos < n && res >= 0;)
+        {
+            res = trng_link_tx_write(&tx, &chunk[pos], n - pos);
+            pos += res > 0 ? (size_t)res : 0;
+            while (res >= 0 && trng_link_tx_window_full(&tx))
+            {
+                res = device_sync(&d, &tx);
+            }
+        }
+    }
+
+    if (cfg->format == CAPTURE_LINK)
+    {
+        static const char end[] = "{{link_end;0}}\n";
+        res = res >= 0 ? trng_link_tx_flush(&tx) : res;
+        while (res >= 0 && trng_link_tx_in_flight(&tx) != 0)
+        {
+            res = device_sync(&d, &tx);
+        }
+        res = res >= 0 ? device_write(&d, end, sizeof(end) - 1) : res;
+        if (stats != NULL)
+        {
+            *stats = tx.stats;
+        }
+    }
+    return res < 0 ? res : 0;
+}
@@ -0,0 +1,119 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Capture server: takes a continuous stream of trng output from a serial
+* line, a pseudo terminal or a pipe, writes it to an append only capture
+* file and qualifies it while it arrives.
+*
+* The receive thread only reads, copies into the capture and indexes. The
+* capture file is mapped once for the most it may grow to, so nothing is
+* remapped or copied again as it grows. Every chunk_len bytes received (the
+* last chunk may be shorter) an entry with the offset, length and time of
+* arrival is appended to the index file (path + ".idx") and the chunk is
+* published to the analysis threads by bumping a counter. They read chunks
+* straight from the mapping, run them through pipeline_chunks
+* (qualify_pipeline.h) and merge the stats in capture order, and optionally
+* the SP 800-22 battery takes the chunks in order on a thread of its own.
+* When analysis falls behind the chunks wait in the page cache, the receive
+* path never waits for it.
+*
+* The stream is either raw bytes, or the greentea lines of the framed
+* transport (trng_link.h) as the device test sends them to trng_reset.py:
+* {{link_frame;...}} lines are taken in, {{link_sync;...}} is answered with
+* {{link_ack;...}} on ack_fd and {{link_end;...}} ends the capture, other
+* lines are skipped. capture_device is the board's end of either format,
+* for pseudo terminal and pipe stand-ins.
+*/
+
+#ifndef TRNG_CAPTURE_SERVER_H
+#define TRNG_CAPTURE_SERVER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include "qualify_pipeline.h"
+#include "trng_link.h"
+#include "trng_nist.h"
+#include "trng_stream.h"
+
+#define CAPTURE_RAW                 0           //formats of the stream
+#define CAPTURE_LINK                1
+
+#define CAPTURE_ERR_CONFIG          -1          //bad config
+#define CAPTURE_ERR_FILE            -2          //capture or index file can't be created or grown
+#define CAPTURE_ERR_READ            -3          //reading the input or writing an ACK failed
+#define CAPTURE_ERR_FULL            -4          //more than max_bytes arrived
+
+/*Entry of the index file, in host byte order*/
+typedef struct {
+    uint64_t offset;                    //of the chunk in the capture
+    uint32_t length;
+    uint32_t reserved;
+    uint64_t time_ns;                   //the chunk was complete, since the capture started
+} capture_index_entry;
+
+typedef struct {
+    uint64_t bytes;                     //written to the capture
+    uint64_t chunks;                    //indexed
+    uint64_t analysed_chunks;           //merged into stats
+    uint64_t backlog_max;               //most chunks published and not analysed yet
+    uint64_t transcode_failures;
+    uint64_t reads;
+    uint64_t receive_ns;                //the receive thread spent handling what it read
+    uint64_t receive_max_ns;            //longest it took for one read
+    uint64_t acks;
+    uint64_t skipped_lines;             //lines that were not link messages
+    uint64_t elapsed_ns;
+    trng_stream_stats stats;            //of the chunks analysed, whole pieces of qualify.chunk_len get verdicts
+    trng_link_rx link;                  //counters of the framed transport
+} capture_result;
+
+typedef struct {
+    const char *path;                   //capture file, the index goes to path + ".idx"
+    int format;                         //CAPTURE_RAW or CAPTURE_LINK
+    uint32_t chunk_len;                 //bytes per index entry, a multiple of qualify.chunk_len
+    uint64_t max_bytes;                 //address space reserved for the capture
+    uint64_t limit;                     //stop after this many bytes, 0 - at the end of the input
+    pipeline_config qualify;            //analysis of every chunk, on qualify.threads threads
+    trng_nist *nist;                    //started by the caller and fed in order, NULL - no battery
+    const std::atomic<int> *stop;       //the capture ends when it is set, may be NULL
+    uint32_t progress_ms;               //interval of progress calls, 0 - none
+    void (*progress)(const capture_result *res, void *ctx);
+    void *progress_ctx;
+} capture_config;
+
+typedef struct {
+    int format;
+    uint64_t bytes;                     //sent in all
+    uint32_t write_max;                 //writes take 1 to write_max bytes at random
+    uint32_t frame_len;                 //framed transport
+    uint32_t window;
+    uint32_t seed;
+    int (*fill)(void *ctx, uint8_t *buf, size_t len);
+    void *fill_ctx;
+} capture_device_config;
+
+/*Capture from in_fd until it ends, limit is reached or stop is set. ACKs of the framed transport
+  go to ack_fd (-1 - none). Returns 0 or a CAPTURE_ERR_ code, res holds what was captured either
+  way*/
+int capture_run(int in_fd, int ack_fd, const capture_config *cfg, capture_result *res);
+
+/*Send cfg->bytes of fill output to fd as a board would, reading ACKs from fd. The fd is left
+  open. Returns 0, -1 if a write or read failed, or a TRNG_LINK_ERR_ code*/
+int capture_device(int fd, const capture_device_config *cfg, trng_link_tx_stats *stats);
+
+#endif
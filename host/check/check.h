@@ -0,0 +1,76 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Host checks of the test core that the greentea test can't reach, every
+* suite is a function registered in check_main.cpp returning the number of
+* failures it found.
+*/
+
+#ifndef TRNG_CHECK_H
+#define TRNG_CHECK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "host_util.h"
+
+/*Deterministic generator for fuzzing, the same seed gives the same cases*/
+struct check_rng {
+    uint64_t state;
+};
+
+void check_rng_seed(check_rng *rng, uint64_t seed);
+uint32_t check_rng_next(check_rng *rng);
+
+/*Inputs of the compression and statistics suites: random bytes, bytes biased towards 0
+  and a pattern of a random period with a byte in 64 off by one*/
+enum {
+    CHECK_FILL_RANDOM,
+    CHECK_FILL_BIASED,
+    CHECK_FILL_PERIODIC,
+    CHECK_FILL_KINDS
+};
+
+void check_rng_fill(check_rng *rng, uint8_t *data, size_t len, int kind);
+
+/*A length below max, below 8 for one case in 4 so the edges are hit often*/
+size_t check_rng_len(check_rng *rng, size_t max);
+
+/*Report a failed case, returns 1 so failures can be summed*/
+int check_fail(const char *suite, const char *fmt, ...);
+
+/*Check suites*/
+int check_lzfctx(int argc, char **argv);
+int check_lzfmatch(int argc, char **argv);
+int check_lzfscreen(int argc, char **argv);
+int check_base64(int argc, char **argv);
+int check_nist(int argc, char **argv);
+int check_entropy(int argc, char **argv);
+int check_health(int argc, char **argv);
+int check_pool(int argc, char **argv);
+int check_drbg(int argc, char **argv);
+int check_parallel(int argc, char **argv);
+int check_fingerprint(int argc, char **argv);
+int check_snapshot(int argc, char **argv);
+int check_link(int argc, char **argv);
+int check_capture(int argc, char **argv);
+int check_lzfstream(int argc, char **argv);
+int check_lzfvariant(int argc, char **argv);
+int check_model(int argc, char **argv);
+int check_trace(int argc, char **argv);
+int check_async(int argc, char **argv);
+
+#endif
@@ -0,0 +1,340 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The asynchronous front end of trng_async.h over a replayed source: random
+* requests, with and without a stage of random size and with partial reads,
+* must come back in order of submission holding the source byte for byte,
+* in as many driver calls as the batching promises. Requests submitted from
+* several threads, and again from their callbacks, to a draining thread
+* woken by the submits must together hold the source in order of
+* completion. A failing source must fail every request that asks for bytes.
+*/
+
+#include "check.h"
+#include "trng_async.h"
+#include "trng_host.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define SUBMITTERS      3
+
+struct drain_thread {
+    trng_async async;
+    std::mutex lock;
+    std::condition_variable cv;
+    bool stop;
+    std::vector<uint8_t> received;      //request data in order of completion
+};
+
+struct resubmit {
+    drain_thread *d;
+    uint8_t buf[64];
+    unsigned int left;
+};
+
+static bool busy(const trng_async_request *req)
+{
+    uint32_t state = __atomic_load_n(&req->state, __ATOMIC_ACQUIRE);
+    return state == TRNG_ASYNC_PENDING || state == TRNG_ASYNC_CALLBACK;
+}
+
+static void wake(void *ctx)
+{
+    drain_thread *d = (drain_thread *)ctx;
+    std::lock_guard<std::mutex> guard(d->lock);
+    d->cv.notify_one();
+}
+
+static void drain_loop(drain_thread *d)
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> guard(d->lock);
+            d->cv.wait(guard, [d] { return d->stop || trng_async_pending(&d->async); });
+            if (d->stop && !trng_async_pending(&d->async))
+            {
+                return;
+            }
+        }
+        trng_async_drain(&d->async);
+    }
+}
+
+static void log_data(trng_async_request *req, void *ctx)
+{
+    drain_thread *d = (drain_thread *)ctx;
+    d->received.insert(d->received.end(), req->buf, req->buf + req->len);
+}
+
+/*Submits itself again from its callback until left runs out*/
+static void log_and_resubmit(trng_async_request *req, void *ctx)
+{
+    resubmit *r = (resubmit *)ctx;
+    log_data(req, r->d);
+    unsigned int left = r->left;
+    if (left != 0)
+    {
+        __atomic_store_n(&r->left, left - 1, __ATOMIC_RELEASE);
+        trng_async_submit(&r->d->async, req, r->buf, 1 + left % sizeof(r->buf), log_and_resubmit, r);
+    }
+}
+
+static void submit_loop(drain_thread *d, uint64_t seed, unsigned int requests)
+{
+    check_rng rng;
+    check_rng_seed(&rng, seed);
+    trng_async_request req[4];
+    std::vector<uint8_t> bufs(4 * 300);
+    memset(req, 0, sizeof(req));
+
+    /*Up to 4 requests outstanding, a slot is submitted again once done*/
+    for (unsigned int n = 0; n < requests;)
+    {
+        unsigned int slot = check_rng_next(&rng) % 4;
+        if (busy(&req[slot]))
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        trng_async_submit(&d->async, &req[slot], &bufs[slot * 300], check_rng_next(&rng) % 300, log_data, d);
+        n++;
+    }
+    for (unsigned int slot = 0; slot < 4; slot++)
+    {
+        while (busy(&req[slot]))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+static bool matches_source(const std::vector<uint8_t> &data, const std::vector<uint8_t> &source)
+{
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        if (data[i] != source[i % source.size()])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+int check_async(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = 0;
+    std::vector<uint8_t> source(4096 + check_rng_next(&rng) % 4096);
+    for (size_t i = 0; i < source.size(); i++)
+    {
+        source[i] = (uint8_t)check_rng_next(&rng);
+    }
+    trng_host_use_replay(&source[0], source.size());
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        size_t requests = 1 + check_rng_next(&rng) % 64, max_chunk = check_rng_next(&rng) % 2 ? 0 : 1 + check_rng_next(&rng) % 300;
+        std::vector<uint8_t> stage(1 + check_rng_next(&rng) % 512);
+        bool staged = check_rng_next(&rng) % 4 != 0;
+        std::vector<trng_async_request> req(requests);
+        std::vector<size_t> offset(requests + 1, 0);
+        trng_async_config cfg;
+        trng_async async;
+        trng_async_stats stats;
+        trng_t trng_obj;
+
+        memset(&req[0], 0, requests * sizeof(req[0]));
+        for (size_t r = 0; r < requests; r++)
+        {
+            offset[r + 1] = offset[r] + (check_rng_next(&rng) % 8 == 0 ? 0 : check_rng_next(&rng) % 600);
+        }
+        std::vector<uint8_t> out(offset[requests] + 1);
+
+        trng_host_set_max_chunk(max_chunk);
+        trng_init(&trng_obj);
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.trng = &trng_obj;
+        cfg.stage = staged ? &stage[0] : NULL;
+        cfg.stage_len = staged ? stage.size() : 0;
+        trng_async_init(&async, &cfg);
+        for (size_t r = 0; r < requests; r++)
+        {
+            trng_async_submit(&async, &req[r], &out[offset[r]], offset[r + 1] - offset[r], NULL, NULL);
+        }
+        if (trng_async_submit(&async, &req[0], &out[0], 1, NULL, NULL) != TRNG_ASYNC_ERR_PENDING)
+        {
+            failures += check_fail("async", "a queued request was submitted again");
+        }
+        int drained = trng_async_drain(&async);
+        trng_free(&trng_obj);
+        trng_async_get_stats(&async, &stats);
+
+        /*One driver call per stage, or per request with bytes, each split by max_chunk*/
+        uint64_t reads = 0, total = offset[requests];
+        for (size_t r = 0; r < requests; r++)
+        {
+            size_t len = offset[r + 1] - offset[r];
+            failures += !trng_async_done(&req[r]) || req[r].status != 0 ?
+                        check_fail("async", "request %u of %u not done, status %d", (unsigned int)r,
+                                   (unsigned int)requests, req[r].status) : 0;
+            reads += !staged && max_chunk ? (len + max_chunk - 1) / max_chunk : !staged && len;
+        }
+        for (uint64_t pos = 0; staged && pos < total; pos += stage.size())
+        {
+            uint64_t want = total - pos < stage.size() ? total - pos : stage.size();
+            reads += max_chunk ? (want + max_chunk - 1) / max_chunk : 1;
+        }
+        out.resize(total);
+        if (drained != (int)requests || !matches_source(out, source))
+        {
+            failures += check_fail("async", "%u requests of %llu bytes (stage %u, max chunk %u): %d drained, data "
+                                   "%s", (unsigned int)requests, (unsigned long long)total,
+                                   staged ? (unsigned int)stage.size() : 0, (unsigned int)max_chunk, drained,
+                                   matches_source(out, source) ? "in order" : "out of order");
+        }
+        if (stats.drains != 1 || stats.requests != requests || stats.bytes != total || stats.reads != reads ||
+            stats.max_batch != requests || stats.errors != 0 || trng_async_drain(&async) != 0)
+        {
+            failures += check_fail("async", "%u requests of %llu bytes (stage %u, max chunk %u): %llu drains, %llu "
+                                   "bytes, %llu reads, expected %llu", (unsigned int)requests,
+                                   (unsigned long long)total, staged ? (unsigned int)stage.size() : 0,
+                                   (unsigned int)max_chunk, (unsigned long long)stats.drains,
+                                   (unsigned long long)stats.bytes, (unsigned long long)stats.reads,
+                                   (unsigned long long)reads);
+        }
+    }
+    trng_host_set_max_chunk(0);
+
+    /*Submitters on threads of their own and requests submitted again from their callbacks*/
+    for (uint64_t iter = 0; iter < iterations / 20 + 1 && failures == 0; iter++)
+    {
+        drain_thread d;
+        std::vector<uint8_t> stage(1 + check_rng_next(&rng) % 1024);
+        resubmit again;
+        trng_async_request again_req;
+        trng_async_config cfg;
+        trng_t trng_obj;
+
+        trng_init(&trng_obj);
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.trng = &trng_obj;
+        cfg.stage = iter % 2 ? &stage[0] : NULL;
+        cfg.stage_len = iter % 2 ? stage.size() : 0;
+        cfg.wake = wake;
+        cfg.wake_ctx = &d;
+        trng_async_init(&d.async, &cfg);
+        d.stop = false;
+
+        std::thread drainer(drain_loop, &d);
+        std::vector<std::thread> submitters;
+        for (unsigned int t = 0; t < SUBMITTERS; t++)
+        {
+            submitters.push_back(std::thread(submit_loop, &d, check_rng_next(&rng) | 1, 50 + check_rng_next(&rng) % 200));
+        }
+        again.d = &d;
+        again.left = check_rng_next(&rng) % 100;
+        unsigned int again_requests = again.left + 1;
+        memset(&again_req, 0, sizeof(again_req));
+        trng_async_submit(&d.async, &again_req, again.buf, sizeof(again.buf), log_and_resubmit, &again);
+        for (unsigned int t = 0; t < SUBMITTERS; t++)
+        {
+            submitters[t].join();
+        }
+        while (busy(&again_req) || __atomic_load_n(&again.left, __ATOMIC_ACQUIRE) != 0)
+        {
+            std::this_thread::yield();
+        }
+        {
+            std::lock_guard<std::mutex> guard(d.lock);
+            d.stop = true;
+            d.cv.notify_one();
+        }
+        drainer.join();
+        trng_free(&trng_obj);
+
+        trng_async_stats stats;
+        trng_async_get_stats(&d.async, &stats);
+        if (!matches_source(d.received, source) || stats.bytes != d.received.size() ||
+            stats.requests < again_requests || stats.errors != 0)
+        {
+            failures += check_fail("async", "%u submitters: %llu requests, %llu bytes received %s", SUBMITTERS,
+                                   (unsigned long long)stats.requests, (unsigned long long)d.received.size(),
+                                   matches_source(d.received, source) ? "in order" : "out of order");
+        }
+    }
+
+    /*A source that fails every call fails every request asking for bytes*/
+    trng_host_use_replay(&source[0], 0);
+    for (uint64_t iter = 0; iter < iterations / 10 + 1 && failures == 0; iter++)
+    {
+        std::vector<uint8_t> stage(1 + check_rng_next(&rng) % 64), out(64);
+        trng_async_request req[8];
+        trng_async_config cfg;
+        trng_async async;
+        trng_t trng_obj;
+        unsigned int asking = 0;
+
+        trng_init(&trng_obj);
+        memset(&cfg, 0, sizeof(cfg));
+        memset(req, 0, sizeof(req));
+        cfg.trng = &trng_obj;
+        cfg.stage = iter % 2 ? &stage[0] : NULL;
+        cfg.stage_len = iter % 2 ? stage.size() : 0;
+        trng_async_init(&async, &cfg);
+        for (unsigned int r = 0; r < 8; r++)
+        {
+            size_t len = check_rng_next(&rng) % 3 == 0 ? 0 : 1 + check_rng_next(&rng) % 8;
+            asking += len != 0;
+            trng_async_submit(&async, &req[r], &out[r * 8], len, NULL, NULL);
+        }
+        trng_async_drain(&async);
+        trng_free(&trng_obj);
+        for (unsigned int r = 0; r < 8; r++)
+        {
+            if (!trng_async_done(&req[r]) || (req[r].status != 0) != (req[r].len != 0))
+            {
+                failures += check_fail("async", "request of %u bytes from a failing source: status %d",
+                                       (unsigned int)req[r].len, req[r].status);
+            }
+        }
+        if (async.stats.errors != asking)
+        {
+            failures += check_fail("async", "%llu requests failed, %u asked for bytes",
+                                   (unsigned long long)async.stats.errors, asking);
+        }
+    }
+    trng_host_use_urandom();
+
+    trng_async_config cfg;
+    trng_async async;
+    memset(&cfg, 0, sizeof(cfg));
+    if (trng_async_init(&async, &cfg) != TRNG_ASYNC_ERR_CONFIG)
+    {
+        failures += check_fail("async", "set up without a source");
+    }
+
+    printf("async: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
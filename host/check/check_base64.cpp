@@ -0,0 +1,363 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Fuzzed round trips of base64_encode_to/b64decode_to and of every kernel
+* built into the binary against base64_encode and b64decode: random data of
+* random length is encoded, decoded back, then the encoding is corrupted
+* (characters replaced by anything, including '-', '_', '=' and bytes above
+* 0x7f, or cut short) and must still decode as b64decode decodes it. Outputs
+* are written into exactly sized buffers followed by guard bytes. The strict
+* decoder is checked against a character by character model of its rules,
+* the stream encoder and decoder are fed the same data in random slices
+* through random window sizes and must match the one shot functions.
+*/
+
+#include "check.h"
+#include "base64b.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define GUARD_LEN   16
+#define GUARD_BYTE  0xa5
+
+typedef size_t (*encode_kernel)(const unsigned char *src, size_t len, char *out);
+typedef size_t (*decode_kernel)(const void *src, size_t len, unsigned char *out);
+
+static const struct {
+    const char *name;
+    encode_kernel encode;
+    decode_kernel decode;
+} kernels[] = {
+    { "scalar", base64_encode_scalar, b64decode_scalar },
+#if BASE64_HAVE_SSSE3
+    { "ssse3",  base64_encode_ssse3,  b64decode_ssse3 },
+#endif
+#if BASE64_HAVE_AVX2
+    { "avx2",   base64_encode_avx2,   b64decode_avx2 },
+#endif
+#if BASE64_HAVE_NEON
+    { "neon",   base64_encode_neon,   b64decode_neon },
+#endif
+};
+
+static bool guard_intact(const std::vector<uint8_t> &buf, size_t len)
+{
+    for (size_t i = len; i < len + GUARD_LEN; i++)
+    {
+        if (buf[i] != GUARD_BYTE)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*Decode the len characters of text with every kernel and b64decode_to, compare with b64decode*/
+static int check_decode(const char *what, uint64_t iter, const std::string &text, size_t len)
+{
+    int failures = 0;
+    std::string expected = b64decode(text.c_str(), len);
+    size_t dec_len = b64decode_len(text.c_str(), len);
+    std::vector<uint8_t> out(dec_len + GUARD_LEN);
+
+    if (dec_len != expected.size())
+    {
+        return check_fail("base64", "%s %llu: b64decode_len %zu, b64decode gave %zu bytes",
+                          what, (unsigned long long)iter, dec_len, expected.size());
+    }
+
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+    {
+        memset(&out[0], GUARD_BYTE, out.size());
+        size_t n = kernels[k].decode(text.c_str(), len, &out[0]);
+        if (n != dec_len || memcmp(&out[0], expected.data(), n) != 0 || !guard_intact(out, dec_len))
+        {
+            failures += check_fail("base64", "%s %llu: %s decoder differs from b64decode (%zu chars)",
+                                   what, (unsigned long long)iter, kernels[k].name, len);
+        }
+    }
+
+    memset(&out[0], GUARD_BYTE, out.size());
+    if (b64decode_to(text.c_str(), len, &out[0], dec_len) != dec_len ||
+        memcmp(&out[0], expected.data(), dec_len) != 0 || !guard_intact(out, dec_len))
+    {
+        failures += check_fail("base64", "%s %llu: b64decode_to differs from b64decode", what, (unsigned long long)iter);
+    }
+    if (dec_len != 0 && b64decode_to(text.c_str(), len, &out[0], dec_len - 1) != 0)
+    {
+        failures += check_fail("base64", "%s %llu: b64decode_to wrote past out_len", what, (unsigned long long)iter);
+    }
+    return failures;
+}
+
+/*Character by character model of b64decode_strict*/
+static int strict_model(const std::string &text, size_t *decoded, size_t *error_pos)
+{
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t len = text.size();
+    size_t pad = 0;
+    if (len % 4 == 0 && len > 0 && text[len - 1] == '=')
+    {
+        pad = text[len - 2] == '=' ? 2 : 1;
+    }
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (i >= len - pad)
+        {
+            continue;
+        }
+        if (text[i] == '\0' || strchr(alphabet, text[i]) == NULL)
+        {
+            *decoded = i / 4 * 3;
+            *error_pos = i;
+            return text[i] == '=' ? BASE64_ERR_PADDING : BASE64_ERR_CHAR;
+        }
+        if (pad != 0 && i == len - pad - 1)
+        {
+            /*Last character before the padding, its low bits are not part of any byte*/
+            unsigned int v = (unsigned int)(strchr(alphabet, text[i]) - alphabet);
+            if (v & (pad == 1 ? 0x03 : 0x0f))
+            {
+                *decoded = (len - 4) / 4 * 3;
+                *error_pos = i;
+                return BASE64_ERR_PADDING;
+            }
+        }
+    }
+
+    *decoded = len / 4 * 3 - pad;
+    *error_pos = 0;
+    if (len % 4)
+    {
+        *error_pos = len;
+        return BASE64_ERR_LENGTH;
+    }
+    return BASE64_OK;
+}
+
+/*data holds what the bytes decoded before an error must be*/
+static int check_strict(const char *what, uint64_t iter, const std::string &text, const uint8_t *data)
+{
+    size_t exp_decoded = 0, exp_pos = 0, decoded = 0, pos = 0;
+    int expected = strict_model(text, &exp_decoded, &exp_pos);
+    size_t out_len = text.size() / 4 * 3;
+    std::vector<uint8_t> out(out_len + GUARD_LEN, GUARD_BYTE);
+
+    int res = b64decode_strict(text.data(), text.size(), &out[0], out_len, &decoded, &pos);
+    if (res != expected || decoded != exp_decoded || pos != exp_pos || !guard_intact(out, out_len))
+    {
+        return check_fail("base64", "%s %llu: b64decode_strict gave %d (%zu bytes, at %zu), expected %d (%zu bytes, at %zu)",
+                          what, (unsigned long long)iter, res, decoded, pos, expected, exp_decoded, exp_pos);
+    }
+    if (memcmp(&out[0], data, decoded) != 0)
+    {
+        return check_fail("base64", "%s %llu: b64decode_strict decoded other bytes", what, (unsigned long long)iter);
+    }
+    if (res == BASE64_OK && decoded != 0 &&
+        b64decode_strict(text.data(), text.size(), &out[0], decoded - 1, &decoded, &pos) != BASE64_ERR_SPACE)
+    {
+        return check_fail("base64", "%s %llu: b64decode_strict wrote past out_len", what, (unsigned long long)iter);
+    }
+    return 0;
+}
+
+static void collect_window(const void *window, size_t len, void *ctx)
+{
+    std::vector<std::string> *windows = (std::vector<std::string> *)ctx;
+    windows->push_back(std::string((const char *)window, len));
+}
+
+/*Every window but the last one must be full, returns their concatenation*/
+static bool join_windows(const std::vector<std::string> &windows, size_t window_len, std::string &joined)
+{
+    joined.clear();
+    for (size_t i = 0; i < windows.size(); i++)
+    {
+        if (windows[i].empty() || (i + 1 < windows.size() && windows[i].size() != window_len))
+        {
+            return false;
+        }
+        joined += windows[i];
+    }
+    return true;
+}
+
+/*Stream data through base64_encoder in random slices and random windows*/
+static int check_encoder(uint64_t iter, check_rng *rng, const uint8_t *data, size_t len, const std::string &expected)
+{
+    size_t window_len = 1 + check_rng_next(rng) % 200;
+    std::vector<char> window(window_len);
+    std::vector<std::string> windows;
+    base64_encoder enc;
+    base64_encoder_init(&enc, &window[0], window_len, collect_window, &windows);
+
+    for (size_t pos = 0; pos < len;)
+    {
+        size_t slice = check_rng_next(rng) % (check_rng_next(rng) % 2 ? 8 : 300);
+        slice = slice < len - pos ? slice : len - pos;
+        base64_encoder_update(&enc, data + pos, slice);
+        pos += slice;
+    }
+    base64_encoder_final(&enc);
+
+    std::string joined;
+    if (!join_windows(windows, window_len, joined) || joined != expected || enc.total != expected.size())
+    {
+        return check_fail("base64", "stream %llu: encoder differs from base64_encode (%zu bytes, window %zu)",
+                          (unsigned long long)iter, len, window_len);
+    }
+    return 0;
+}
+
+/*Stream text through base64_decoder in random slices and random windows, it must find what
+  b64decode_strict finds on the whole text. A slice_len and window_len other than 0 fix them*/
+static int check_decoder(const char *what, uint64_t iter, check_rng *rng, const std::string &text,
+                         size_t slice_len = 0, size_t window_len = 0)
+{
+    window_len = window_len != 0 ? window_len : 1 + check_rng_next(rng) % 200;
+    std::vector<unsigned char> window(window_len);
+    std::vector<std::string> windows;
+    base64_decoder dec;
+    base64_decoder_init(&dec, &window[0], window_len, collect_window, &windows);
+
+    int res = BASE64_OK;
+    for (size_t pos = 0; pos < text.size();)
+    {
+        size_t slice = slice_len != 0 ? slice_len : check_rng_next(rng) % (check_rng_next(rng) % 2 ? 8 : 300);
+        slice = slice < text.size() - pos ? slice : text.size() - pos;
+        res = base64_decoder_update(&dec, text.data() + pos, slice);
+        pos += slice;
+    }
+    int final_res = base64_decoder_final(&dec);
+
+    std::vector<uint8_t> out(text.size() / 4 * 3 + 3);
+    size_t decoded = 0, error_pos = 0;
+    int expected = b64decode_strict(text.data(), text.size(), &out[0], out.size(), &decoded, &error_pos);
+
+    std::string joined;
+    if (final_res != expected || (res != BASE64_OK && res != final_res) ||
+        (expected != BASE64_OK && dec.error_pos != error_pos) ||
+        !join_windows(windows, window_len, joined) || joined.size() != decoded ||
+        memcmp(joined.data(), &out[0], decoded) != 0)
+    {
+        return check_fail("base64", "%s %llu: decoder gave %d at %llu with %zu bytes, b64decode_strict %d at %zu with %zu",
+                          what, (unsigned long long)iter, final_res, (unsigned long long)dec.error_pos, joined.size(),
+                          expected, error_pos, decoded);
+    }
+    return 0;
+}
+
+int check_base64(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 20000);
+    size_t max_len = (size_t)host_size_arg(argc, argv, "max", 4096);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = 0;
+
+    static const char special[] = "-_=,.+/ \r\n";
+
+    /*Padding in the middle of one update ends the text there, as it does one character at a time*/
+    static const char *const padded[] = { "Q0NDQQ==QQ==RERE", "Q0NDQQ==RERERERE", "Q0NDQ0M=RERERERE" };
+    for (size_t i = 0; i < sizeof(padded) / sizeof(padded[0]); i++)
+    {
+        std::string text = padded[i];
+        failures += check_decoder("padded whole", i, &rng, text, text.size(), 64);
+        failures += check_decoder("padded bytes", i, &rng, text, 1, 64);
+    }
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        /*Mostly short inputs, every few cases one up to max_len*/
+        size_t len = check_rng_next(&rng) % (iter % 8 == 0 ? max_len + 1 : 200);
+        std::vector<uint8_t> data(len + 1);
+        for (size_t i = 0; i < len; i++)
+        {
+            data[i] = (uint8_t)check_rng_next(&rng);
+        }
+
+        std::string expected = base64_encode(&data[0], len);
+        size_t enc_len = base64_encoded_len(len);
+        std::vector<uint8_t> out(enc_len + GUARD_LEN);
+
+        if (enc_len != expected.size())
+        {
+            failures += check_fail("base64", "encode %llu: base64_encoded_len %zu, base64_encode gave %zu chars",
+                                   (unsigned long long)iter, enc_len, expected.size());
+            continue;
+        }
+
+        for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+        {
+            memset(&out[0], GUARD_BYTE, out.size());
+            size_t n = kernels[k].encode(&data[0], len, (char *)&out[0]);
+            if (n != enc_len || memcmp(&out[0], expected.data(), n) != 0 || !guard_intact(out, enc_len))
+            {
+                failures += check_fail("base64", "encode %llu: %s encoder differs from base64_encode (%zu bytes)",
+                                       (unsigned long long)iter, kernels[k].name, len);
+            }
+        }
+        memset(&out[0], GUARD_BYTE, out.size());
+        if (base64_encode_to(&data[0], len, (char *)&out[0], enc_len) != enc_len ||
+            memcmp(&out[0], expected.data(), enc_len) != 0 || !guard_intact(out, enc_len))
+        {
+            failures += check_fail("base64", "encode %llu: base64_encode_to differs from base64_encode", (unsigned long long)iter);
+        }
+        if (enc_len != 0 && base64_encode_to(&data[0], len, (char *)&out[0], enc_len - 1) != 0)
+        {
+            failures += check_fail("base64", "encode %llu: base64_encode_to wrote past out_len", (unsigned long long)iter);
+        }
+
+        /*Round trip*/
+        failures += check_decode("round trip", iter, expected, expected.size());
+        std::vector<uint8_t> back(len + GUARD_LEN);
+        if (b64decode_to(expected.c_str(), expected.size(), &back[0], len) != len || memcmp(&back[0], &data[0], len) != 0)
+        {
+            failures += check_fail("base64", "round trip %llu: %zu bytes did not come back", (unsigned long long)iter, len);
+        }
+
+        failures += check_strict("strict", iter, expected, &data[0]);
+        failures += check_encoder(iter, &rng, &data[0], len, expected);
+        failures += check_decoder("stream", iter, &rng, expected);
+        failures += check_decoder("stream joined", iter, &rng, expected + "QQ==QQ==", expected.size() + 8);
+
+        /*Corrupted and cut short, compared with the lenient b64decode and the strict model*/
+        std::string text = expected;
+        size_t changes = text.empty() ? 0 : 1 + check_rng_next(&rng) % 4;
+        for (size_t c = 0; c < changes; c++)
+        {
+            uint32_t r = check_rng_next(&rng);
+            text[r % text.size()] = (r >> 16) & 1 ? (char)(r >> 24) : special[(r >> 24) % (sizeof(special) - 1)];
+        }
+        size_t cut = text.empty() ? 0 : check_rng_next(&rng) % (text.size() + 1);
+        failures += check_decode("corrupted", iter, text, text.size());
+        failures += check_decode("cut", iter, text.substr(0, cut), cut);
+        std::string lenient = b64decode(text.c_str(), text.size());
+        failures += check_strict("strict corrupted", iter, text, (const uint8_t *)lenient.data());
+        lenient = b64decode(text.substr(0, cut).c_str(), cut);
+        failures += check_strict("strict cut", iter, text.substr(0, cut), (const uint8_t *)lenient.data());
+        failures += check_decoder("stream corrupted", iter, &rng, text);
+        failures += check_decoder("stream cut", iter, &rng, text.substr(0, cut));
+    }
+
+    printf("base64: %llu cases, %zu kernels\n", (unsigned long long)iterations, sizeof(kernels) / sizeof(kernels[0]));
+    return failures;
+}
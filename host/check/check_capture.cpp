@@ -0,0 +1,406 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The capture server against a board stand-in on a thread: raw streams through
+* pipes and pseudo terminals and the framed transport through pseudo
+* terminals, in writes of random length, with random chunk and screen sizes
+* and analysis thread counts. The capture file must hold what was sent, the
+* index must cover it chunk by chunk in order, and the stats must be those of
+* a serial pass over the data. The SP 800-22 battery fed chunk by chunk must
+* give the p-values of the whole, and stop, limit and max_bytes must end the
+* capture where they say.
+*/
+
+#include "check.h"
+#include "capture_server.h"
+#include "trng_core.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "lzf.h"
+}
+
+struct board_data {
+    const uint8_t *data;
+    size_t pos;
+};
+
+static int board_fill(void *ctx, uint8_t *buf, size_t len)
+{
+    board_data *b = (board_data *)ctx;
+    memcpy(buf, b->data + b->pos, len);
+    b->pos += len;
+    return 0;
+}
+
+/*A raw pseudo terminal, the board on board_fd and the server on host_fd*/
+static int open_pty(int *board_fd, int *host_fd)
+{
+    struct termios tio;
+    *board_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (*board_fd < 0 || grantpt(*board_fd) != 0 || unlockpt(*board_fd) != 0)
+    {
+        return -1;
+    }
+    *host_fd = open(ptsname(*board_fd), O_RDWR | O_NOCTTY);
+    if (*host_fd < 0 || tcgetattr(*host_fd, &tio) != 0)
+    {
+        return -1;
+    }
+    cfmakeraw(&tio);
+    return tcsetattr(*host_fd, TCSANOW, &tio);
+}
+
+static std::vector<uint8_t> read_file(const char *path)
+{
+    std::vector<uint8_t> out;
+    FILE *f = fopen(path, "rb");
+    uint8_t buf[65536];
+    size_t n;
+    while (f != NULL && (n = fread(buf, 1, sizeof(buf), f)) > 0)
+    {
+        out.insert(out.end(), buf, buf + n);
+    }
+    if (f != NULL)
+    {
+        fclose(f);
+    }
+    return out;
+}
+
+/*Stats of a serial pass over the captured bytes, as the server splits them*/
+static trng_stream_stats serial_stats(const uint8_t *data, size_t len, const capture_config *cfg)
+{
+    unsigned int screen = cfg->qualify.chunk_len;
+    unsigned int out_len = trng_core_threshold(screen, cfg->qualify.percentage);
+    std::vector<const uint8_t *> htab(1 << 14);
+    std::vector<uint8_t> comp(out_len + 1);
+    trng_stream_stats stats;
+    trng_stream_stats_init(&stats);
+
+    for (size_t chunk = 0; chunk < len; chunk += cfg->chunk_len)
+    {
+        size_t end = chunk + cfg->chunk_len < len ? chunk + cfg->chunk_len : len;
+        size_t pos = chunk;
+        for (; pos + screen <= end; pos += screen)
+        {
+            memset(&htab[0], 0, htab.size() * sizeof(htab[0]));
+            unsigned int res = lzf_compress(data + pos, screen, &comp[0], out_len, (unsigned char **)&htab[0]);
+            stats.compressible_chunks += res != 0;
+            stats.compressed_bytes += res != 0 ? res : screen;
+            stats.chunks++;
+        }
+        trng_stream_stats_update(&stats, data + chunk, end - chunk);
+    }
+    return stats;
+}
+
+static bool same_stats(const trng_stream_stats *a, const trng_stream_stats *b)
+{
+    return a->bytes == b->bytes && a->chunks == b->chunks && a->compressible_chunks == b->compressible_chunks &&
+           a->compressed_bytes == b->compressed_bytes && a->ones == b->ones && a->sum == b->sum &&
+           a->sum_sq == b->sum_sq && a->sum_lag == b->sum_lag && a->first == b->first && a->last == b->last &&
+           memcmp(a->histogram, b->histogram, sizeof(a->histogram)) == 0;
+}
+
+/*Capture and index files hold the first want bytes of data*/
+static int check_files(const char *path, const capture_config *cfg, const uint8_t *data, size_t want,
+                       const capture_result *res, const char *what)
+{
+    int failures = 0;
+    std::vector<uint8_t> got = read_file(path);
+    if (res->bytes != want || got.size() != want || (want != 0 && memcmp(&got[0], data, want) != 0))
+    {
+        failures += check_fail("capture", "%s: %zu bytes in the file, %llu captured, %zu sent", what, got.size(),
+                               (unsigned long long)res->bytes, want);
+    }
+
+    std::string index_path = std::string(path) + ".idx";
+    std::vector<uint8_t> index = read_file(index_path.c_str());
+    size_t entries = index.size() / sizeof(capture_index_entry);
+    size_t want_entries = (want + cfg->chunk_len - 1) / cfg->chunk_len;
+    if (index.size() % sizeof(capture_index_entry) != 0 || entries != want_entries || res->chunks != want_entries)
+    {
+        return failures + check_fail("capture", "%s: %zu index bytes, %zu entries wanted", what, index.size(), want_entries);
+    }
+    uint64_t last_time = 0;
+    for (size_t i = 0; i < entries; i++)
+    {
+        capture_index_entry e;
+        memcpy(&e, &index[i * sizeof(e)], sizeof(e));
+        size_t length = want - i * cfg->chunk_len < cfg->chunk_len ? want - i * cfg->chunk_len : cfg->chunk_len;
+        if (e.offset != i * (uint64_t)cfg->chunk_len || e.length != length || e.time_ns < last_time)
+        {
+            failures += check_fail("capture", "%s: index entry %zu is %llu+%u at %llu ns", what, i,
+                                   (unsigned long long)e.offset, e.length, (unsigned long long)e.time_ns);
+            break;
+        }
+        last_time = e.time_ns;
+    }
+
+    trng_stream_stats want_stats = serial_stats(data, want, cfg);
+    if (res->analysed_chunks != want_entries || !same_stats(&res->stats, &want_stats))
+    {
+        failures += check_fail("capture", "%s: %llu of %zu chunks analysed, %llu/%llu compressible", what,
+                               (unsigned long long)res->analysed_chunks, want_entries,
+                               (unsigned long long)res->stats.compressible_chunks,
+                               (unsigned long long)want_stats.compressible_chunks);
+    }
+    return failures;
+}
+
+static void default_config(capture_config *cfg, const char *path)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->path = path;
+    cfg->format = CAPTURE_RAW;
+    cfg->chunk_len = 4096;
+    cfg->max_bytes = 64 << 20;
+    cfg->qualify.chunk_len = 512;
+    cfg->qualify.percentage = 99;
+    cfg->qualify.threads = 2;
+}
+
+static int check_streams(check_rng *rng, uint64_t iterations, const char *path)
+{
+    static const unsigned int screens[3] = { 64, 512, 4096 };
+    int failures = 0;
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        /*raw through a pipe, raw through a pseudo terminal, framed through a pseudo terminal*/
+        int mode = (int)(iter % 3);
+        capture_config cfg;
+        default_config(&cfg, path);
+        cfg.format = mode == 2 ? CAPTURE_LINK : CAPTURE_RAW;
+        cfg.qualify.chunk_len = screens[check_rng_next(rng) % 3];
+        cfg.chunk_len = cfg.qualify.chunk_len * (1 + check_rng_next(rng) % 16);
+        cfg.qualify.percentage = 90 + check_rng_next(rng) % 11;
+        cfg.qualify.threads = 1 + check_rng_next(rng) % 4;
+        cfg.qualify.transcode = check_rng_next(rng) % 2;
+
+        std::vector<uint8_t> data(check_rng_next(rng) % (mode == 2 ? 100000 : 400000));
+        check_rng_fill(rng, data.data(), data.size(), (int)(check_rng_next(rng) % CHECK_FILL_KINDS));
+        board_data board = { data.data(), 0 };
+        capture_device_config dev;
+        dev.format = cfg.format;
+        dev.bytes = data.size();
+        dev.write_max = 1 + check_rng_next(rng) % 8192;
+        dev.frame_len = 1 + check_rng_next(rng) % 2048;
+        dev.window = 1 + check_rng_next(rng) % 8;
+        dev.seed = check_rng_next(rng);
+        dev.fill = board_fill;
+        dev.fill_ctx = &board;
+
+        int board_fd, host_fd;
+        if (mode == 0)
+        {
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                return failures + check_fail("capture", "no pipe");
+            }
+            host_fd = fds[0];
+            board_fd = fds[1];
+        }
+        else if (open_pty(&board_fd, &host_fd) != 0)
+        {
+            return failures + check_fail("capture", "no pseudo terminal");
+        }
+        /*A pseudo terminal has no end of stream, raw captures stop at the byte count*/
+        cfg.limit = mode == 1 ? data.size() : 0;
+
+        int board_res = 0;
+        std::thread board_thread([&] {
+            board_res = capture_device(board_fd, &dev, NULL);
+            if (mode == 0)
+            {
+                close(board_fd);
+            }
+        });
+        capture_result res;
+        int err = mode == 1 && data.empty() ? 0 : capture_run(host_fd, mode == 2 ? host_fd : -1, &cfg, &res);
+        board_thread.join();
+        close(host_fd);
+        if (mode != 0)
+        {
+            close(board_fd);
+        }
+        if (mode == 1 && data.empty())
+        {
+            continue;
+        }
+
+        char what[128];
+        snprintf(what, sizeof(what), "case %llu (%s, %zu bytes, chunks of %u, screen %u, %u threads)",
+                 (unsigned long long)iter, mode == 0 ? "pipe" : mode == 1 ? "pty" : "link", data.size(),
+                 cfg.chunk_len, cfg.qualify.chunk_len, cfg.qualify.threads);
+        if (err != 0 || board_res != 0 || res.transcode_failures != 0)
+        {
+            failures += check_fail("capture", "%s: server %d, board %d, %llu transcode failures", what, err, board_res,
+                                   (unsigned long long)res.transcode_failures);
+            continue;
+        }
+        failures += check_files(path, &cfg, data.data(), data.size(), &res, what);
+        if (mode == 2 && (res.link.damaged != 0 || res.link.out_of_sequence != 0 || (res.acks == 0 && !data.empty())))
+        {
+            failures += check_fail("capture", "%s: %llu frames damaged, %llu out of sequence, %llu acks", what,
+                                   (unsigned long long)res.link.damaged, (unsigned long long)res.link.out_of_sequence,
+                                   (unsigned long long)res.acks);
+        }
+    }
+    return failures;
+}
+
+/*Pipe capture of data with cfg, the board writes all of it first*/
+static int capture_pipe(const std::vector<uint8_t> &data, const capture_config *cfg, capture_result *res)
+{
+    int fds[2];
+    if (pipe(fds) != 0)
+    {
+        return -100;
+    }
+    std::thread board_thread([&] {
+        for (size_t pos = 0; pos < data.size();)
+        {
+            ssize_t n = write(fds[1], &data[pos], data.size() - pos);
+            if (n <= 0)
+            {
+                break;
+            }
+            pos += (size_t)n;
+        }
+        close(fds[1]);
+    });
+    int err = capture_run(fds[0], -1, cfg, res);
+    close(fds[0]);
+    board_thread.join();
+    return err;
+}
+
+static int check_ends(check_rng *rng, const char *path)
+{
+    int failures = 0;
+    std::vector<uint8_t> data(300000);
+    check_rng_fill(rng, data.data(), data.size(), CHECK_FILL_RANDOM);
+
+    /*limit in the middle of a read*/
+    capture_config cfg;
+    capture_result res;
+    default_config(&cfg, path);
+    cfg.limit = 123457;
+    int err = capture_pipe(data, &cfg, &res);
+    failures += err != 0 ? check_fail("capture", "limit: error %d", err) : check_files(path, &cfg, data.data(), 123457, &res, "limit");
+
+    /*More than max_bytes, what fit is kept*/
+    default_config(&cfg, path);
+    cfg.max_bytes = 200000;
+    err = capture_pipe(data, &cfg, &res);
+    if (err != CAPTURE_ERR_FULL || res.bytes > cfg.max_bytes)
+    {
+        failures += check_fail("capture", "max_bytes: error %d after %llu bytes", err, (unsigned long long)res.bytes);
+    }
+    else
+    {
+        failures += check_files(path, &cfg, data.data(), (size_t)res.bytes, &res, "max_bytes");
+    }
+
+    /*stop on a quiet line*/
+    int fds[2];
+    std::atomic<int> stop(0);
+    default_config(&cfg, path);
+    cfg.stop = &stop;
+    if (pipe(fds) != 0)
+    {
+        return failures + check_fail("capture", "no pipe");
+    }
+    std::thread stopper([&] {
+        usleep(50000);
+        stop = 1;
+    });
+    err = capture_run(fds[0], -1, &cfg, &res);
+    stopper.join();
+    close(fds[0]);
+    close(fds[1]);
+    if (err != 0 || res.bytes != 0 || res.chunks != 0)
+    {
+        failures += check_fail("capture", "stop: error %d, %llu bytes", err, (unsigned long long)res.bytes);
+    }
+
+    /*SP 800-22 chunk by chunk against the whole*/
+    trng_nist_config nist_cfg;
+    trng_nist_config_default(&nist_cfg);
+    std::vector<double> arena(trng_nist_state_size(&nist_cfg) / sizeof(double) + 1);
+    trng_nist nist;
+    trng_nist_result want, got;
+    trng_nist_init(&nist, &nist_cfg, &arena[0], arena.size() * sizeof(double));
+    trng_nist_update(&nist, &data[0], data.size());
+    trng_nist_final(&nist, &want);
+    trng_nist_init(&nist, &nist_cfg, &arena[0], arena.size() * sizeof(double));
+    default_config(&cfg, path);
+    cfg.chunk_len = 3072;
+    cfg.nist = &nist;
+    err = capture_pipe(data, &cfg, &res);
+    trng_nist_final(&nist, &got);
+    if (err != 0 || memcmp(want.p, got.p, sizeof(want.p)) != 0)
+    {
+        failures += check_fail("capture", "sp 800-22: error %d or p-values differ", err);
+    }
+
+    default_config(&cfg, path);
+    cfg.chunk_len = 1000;
+    failures += capture_pipe(data, &cfg, &res) != CAPTURE_ERR_CONFIG ? check_fail("capture", "chunk not a multiple of screen taken") : 0;
+    return failures;
+}
+
+int check_capture(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 60);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+
+    char path[] = "/tmp/trng_capture_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+    {
+        return check_fail("capture", "no temporary file");
+    }
+    close(fd);
+
+    /*Captures that end early leave the board writing into a closed pipe*/
+    signal(SIGPIPE, SIG_IGN);
+    int failures = check_streams(&rng, iterations, path);
+    failures += check_ends(&rng, path);
+
+    std::string index_path = std::string(path) + ".idx";
+    unlink(path);
+    unlink(index_path.c_str());
+    printf("capture: %llu cases\n", (unsigned long long)iterations + 5);
+    return failures;
+}
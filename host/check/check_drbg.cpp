@@ -0,0 +1,699 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The DRBGs: AES-256, SHA-256 and HMAC-SHA256 against the answers of
+* FIPS 197, FIPS 180-4 and RFC 4231, the AES counter kernels against each
+* other, CTR_DRBG and HMAC_DRBG against a transcription of the SP 800-90A
+* pseudocode (the derivation function over a materialized S, one block at a
+* time) through random generate and reseed sequences, the reseed policy and
+* a failing source. Instances of several threads seeded from one entropy
+* pool must draw exactly the entropy they asked for, and output of
+* instances seeded from all zero input must pass the compression screening
+* and the SP 800-22 battery, the gate trng_qualify --drbg applies on the
+* device source.
+*/
+
+#include "check.h"
+#include "trng_drbg.h"
+#include "trng_stream.h"
+#include "trng_host.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+typedef std::vector<uint8_t> bytes;
+
+static bytes hex(const char *s)
+{
+    bytes out;
+    for (; s[0] && s[1]; s += 2)
+    {
+        unsigned int v;
+        sscanf(s, "%2x", &v);
+        out.push_back((uint8_t)v);
+    }
+    return out;
+}
+
+static bytes cat(const bytes &a, const bytes &b)
+{
+    bytes out(a);
+    out.insert(out.end(), b.begin(), b.end());
+    return out;
+}
+
+static bytes sha256(const bytes &data)
+{
+    trng_sha256 sha;
+    bytes out(32);
+    trng_sha256_init(&sha);
+    trng_sha256_update(&sha, data.empty() ? NULL : &data[0], data.size());
+    trng_sha256_final(&sha, &out[0]);
+    return out;
+}
+
+/*HMAC of RFC 2104 without the precomputed pads*/
+static bytes hmac(const bytes &key, const bytes &msg)
+{
+    bytes k0 = key.size() > 64 ? sha256(key) : key;
+    k0.resize(64, 0);
+    bytes ipad(64), opad(64);
+    for (int i = 0; i < 64; i++)
+    {
+        ipad[i] = k0[i] ^ 0x36;
+        opad[i] = k0[i] ^ 0x5c;
+    }
+    return sha256(cat(opad, sha256(cat(ipad, msg))));
+}
+
+static bytes hmac_fast(const bytes &key, const bytes &msg)
+{
+    trng_hmac_sha256 h;
+    bytes out(32);
+    const uint8_t *data = msg.empty() ? NULL : &msg[0];
+    size_t len = msg.size();
+    trng_hmac_sha256_init(&h, key.empty() ? NULL : &key[0], key.size());
+    trng_hmac_sha256_mac(&h, &data, &len, 1, &out[0]);
+    return out;
+}
+
+static int check_primitives(void)
+{
+    int failures = 0;
+
+    bytes key = hex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+    bytes pt = hex("00112233445566778899aabbccddeeff"), ct(16);
+    trng_aes256 aes;
+    trng_aes256_init(&aes, &key[0]);
+    trng_aes256_encrypt(&aes, &pt[0], &ct[0]);
+    failures += ct != hex("8ea2b7ca516745bfeafc49904b496089") ? check_fail("drbg", "AES-256 FIPS 197 C.3") : 0;
+
+    /*The counter kernels encrypt v + 1*/
+    bytes v = hex("00112233445566778899aabbccddeefe");
+    trng_aes256_ctr_scalar(&aes, &v[0], &ct[0], 16);
+    failures += ct != hex("8ea2b7ca516745bfeafc49904b496089") || v != pt ? check_fail("drbg", "scalar AES-256 CTR") : 0;
+
+    const char *sha_msgs[3] = { "", "abc", "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq" };
+    const char *sha_digests[3] = {
+        "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855",
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+        "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1",
+    };
+    for (int i = 0; i < 3; i++)
+    {
+        bytes msg(sha_msgs[i], sha_msgs[i] + strlen(sha_msgs[i]));
+        failures += sha256(msg) != hex(sha_digests[i]) ? check_fail("drbg", "SHA-256 of \"%s\"", sha_msgs[i]) : 0;
+    }
+
+    /*A million 'a' in uneven slices, exercising the buffered path*/
+    trng_sha256 sha;
+    bytes a(1000, 'a'), digest(32);
+    trng_sha256_init(&sha);
+    for (size_t done = 0, n = 1; done < 1000000; done += n, n = n % 997 + 1)
+    {
+        n = n < 1000000 - done ? n : 1000000 - done;
+        trng_sha256_update(&sha, &a[0], n);
+    }
+    trng_sha256_final(&sha, &digest[0]);
+    failures += digest != hex("cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0") ?
+                check_fail("drbg", "SHA-256 of a million 'a'") : 0;
+
+    /*RFC 4231 cases 1, 2 and 6*/
+    const char *text[3] = { "Hi There", "what do ya want for nothing?", "Test Using Larger Than Block-Size Key - Hash Key First" };
+    bytes keys[3] = { bytes(20, 0x0b), hex("4a656665"), bytes(131, 0xaa) };
+    const char *macs[3] = {
+        "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7",
+        "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843",
+        "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+    };
+    for (int i = 0; i < 3; i++)
+    {
+        bytes msg(text[i], text[i] + strlen(text[i]));
+        if (hmac(keys[i], msg) != hex(macs[i]) || hmac_fast(keys[i], msg) != hex(macs[i]))
+        {
+            failures += check_fail("drbg", "HMAC-SHA256 RFC 4231 \"%s\"", text[i]);
+        }
+    }
+    return failures;
+}
+
+static int check_kernels(check_rng *rng, uint64_t iterations)
+{
+    int failures = 0;
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        uint8_t key[32], v[16];
+        for (int i = 0; i < 32; i++)
+        {
+            key[i] = (uint8_t)check_rng_next(rng);
+        }
+        for (int i = 0; i < 16; i++)
+        {
+            /*Counters close to a carry into the high half and to wrapping around*/
+            v[i] = i >= 8 || iter % 4 == 0 ? 0xff : (uint8_t)check_rng_next(rng);
+            v[i] = i < 15 || iter % 3 ? v[i] : (uint8_t)(0xff - check_rng_next(rng) % 12);
+        }
+        size_t len = check_rng_next(rng) % 400;
+        trng_aes256 aes;
+        trng_aes256_init(&aes, key);
+
+        bytes want(len + 1, 0x5a);
+        uint8_t want_v[16];
+        memcpy(want_v, v, 16);
+        trng_aes256_ctr_scalar(&aes, want_v, &want[0], len);
+
+        const char *names[2] = { "aesni", "armv8" };
+        const bool built[2] = {
+#if TRNG_AES_HAVE_AESNI
+            true,
+#else
+            false,
+#endif
+#if TRNG_AES_HAVE_ARMV8
+            true,
+#else
+            false,
+#endif
+        };
+        for (int k = 0; k < 2; k++)
+        {
+            bytes got(len + 1, 0x5a);
+            uint8_t got_v[16];
+            memcpy(got_v, v, 16);
+#if TRNG_AES_HAVE_AESNI
+            if (k == 0)
+            {
+                trng_aes256_ctr_aesni(&aes, got_v, &got[0], len);
+            }
+#endif
+#if TRNG_AES_HAVE_ARMV8
+            if (k == 1)
+            {
+                trng_aes256_ctr_armv8(&aes, got_v, &got[0], len);
+            }
+#endif
+            if (built[k] && (got != want || memcmp(got_v, want_v, 16) != 0))
+            {
+                failures += check_fail("drbg", "case %llu: %s counter kernel differs on %zu bytes",
+                                       (unsigned long long)iter, names[k], len);
+            }
+        }
+    }
+    return failures;
+}
+
+/*
+* SP 800-90A, one step of the pseudocode at a time
+*/
+
+static bytes aes_block(const bytes &key, const bytes &in)
+{
+    trng_aes256 aes;
+    bytes out(16);
+    trng_aes256_init(&aes, &key[0]);
+    trng_aes256_encrypt(&aes, &in[0], &out[0]);
+    return out;
+}
+
+static void increment(bytes &v)
+{
+    for (int i = (int)v.size() - 1; i >= 0 && ++v[i] == 0; i--)
+    {
+    }
+}
+
+static bytes be32(uint32_t v)
+{
+    bytes out(4);
+    out[0] = (uint8_t)(v >> 24);
+    out[1] = (uint8_t)(v >> 16);
+    out[2] = (uint8_t)(v >> 8);
+    out[3] = (uint8_t)v;
+    return out;
+}
+
+/*10.3.3 BCC and 10.3.2 Block_Cipher_df for 384 bits*/
+static bytes bcc(const bytes &key, const bytes &data)
+{
+    bytes chaining(16, 0);
+    for (size_t i = 0; i < data.size(); i += 16)
+    {
+        for (int j = 0; j < 16; j++)
+        {
+            chaining[j] ^= data[i + j];
+        }
+        chaining = aes_block(key, chaining);
+    }
+    return chaining;
+}
+
+static bytes block_cipher_df(const bytes &input)
+{
+    bytes s = cat(cat(be32((uint32_t)input.size()), be32(48)), input);
+    s.push_back(0x80);
+    while (s.size() % 16 != 0)
+    {
+        s.push_back(0);
+    }
+    bytes k, temp;
+    for (int i = 0; i < 32; i++)
+    {
+        k.push_back((uint8_t)i);
+    }
+    for (uint32_t i = 0; temp.size() < 48; i++)
+    {
+        bytes iv = be32(i);
+        iv.resize(16, 0);
+        temp = cat(temp, bcc(k, cat(iv, s)));
+    }
+    k.assign(temp.begin(), temp.begin() + 32);
+    bytes x(temp.begin() + 32, temp.end()), out;
+    while (out.size() < 48)
+    {
+        x = aes_block(k, x);
+        out = cat(out, x);
+    }
+    return out;
+}
+
+struct ref_drbg {
+    int mechanism;
+    bytes key, v;
+    uint64_t reseed_counter;
+    uint64_t reseeds;
+};
+
+/*10.2.1.2 and 10.1.2.2*/
+static void ref_update(ref_drbg *d, const bytes &provided)
+{
+    if (d->mechanism == TRNG_DRBG_CTR)
+    {
+        bytes temp;
+        while (temp.size() < 48)
+        {
+            increment(d->v);
+            temp = cat(temp, aes_block(d->key, d->v));
+        }
+        for (int i = 0; i < 48; i++)
+        {
+            temp[i] ^= provided[i];
+        }
+        d->key.assign(temp.begin(), temp.begin() + 32);
+        d->v.assign(temp.begin() + 32, temp.end());
+        return;
+    }
+    d->key = hmac(d->key, cat(cat(d->v, bytes(1, 0x00)), provided));
+    d->v = hmac(d->key, d->v);
+    if (provided.empty())
+    {
+        return;
+    }
+    d->key = hmac(d->key, cat(cat(d->v, bytes(1, 0x01)), provided));
+    d->v = hmac(d->key, d->v);
+}
+
+static void ref_seed(ref_drbg *d, const bytes &seed_material, bool instantiate)
+{
+    if (instantiate)
+    {
+        d->key.assign(32, 0);
+        d->v.assign(d->mechanism == TRNG_DRBG_CTR ? 16 : 32, d->mechanism == TRNG_DRBG_CTR ? 0 : 1);
+    }
+    ref_update(d, d->mechanism == TRNG_DRBG_CTR ? block_cipher_df(seed_material) : seed_material);
+    d->reseed_counter = 1;
+    d->reseeds++;
+}
+
+static bytes ref_generate(ref_drbg *d, size_t len, const bytes &additional)
+{
+    bytes addl = additional, out;
+    if (d->mechanism == TRNG_DRBG_CTR)
+    {
+        addl = addl.empty() ? bytes(48, 0) : block_cipher_df(addl);
+        if (!additional.empty())
+        {
+            ref_update(d, addl);
+        }
+        while (out.size() < len)
+        {
+            increment(d->v);
+            out = cat(out, aes_block(d->key, d->v));
+        }
+    }
+    else
+    {
+        if (!addl.empty())
+        {
+            ref_update(d, addl);
+        }
+        while (out.size() < len)
+        {
+            d->v = hmac(d->key, d->v);
+            out = cat(out, d->v);
+        }
+    }
+    out.resize(len);
+    ref_update(d, addl);
+    d->reseed_counter++;
+    return out;
+}
+
+/*Deterministic entropy source, fails while fail is set*/
+struct stream_source {
+    check_rng rng;
+    bool fail;
+    uint64_t calls;
+    uint64_t bytes;
+};
+
+static int stream_entropy(void *ctx, uint8_t *buf, size_t len)
+{
+    stream_source *src = (stream_source *)ctx;
+    if (src->fail)
+    {
+        return -1;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        buf[i] = (uint8_t)check_rng_next(&src->rng);
+    }
+    src->calls++;
+    src->bytes += len;
+    return 0;
+}
+
+static bytes take(stream_source *src, size_t len)
+{
+    bytes out(len);
+    stream_entropy(src, &out[0], len);
+    return out;
+}
+
+static bytes random_bytes(check_rng *rng, size_t len)
+{
+    bytes out(len);
+    for (size_t i = 0; i < len; i++)
+    {
+        out[i] = (uint8_t)check_rng_next(rng);
+    }
+    return out;
+}
+
+static int check_reference(check_rng *rng, uint64_t iterations)
+{
+    int failures = 0;
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        stream_source src, ref_src;
+        uint64_t seed = check_rng_next(rng);
+        check_rng_seed(&src.rng, seed);
+        check_rng_seed(&ref_src.rng, seed);
+        src.fail = ref_src.fail = false;
+        src.calls = ref_src.calls = src.bytes = ref_src.bytes = 0;
+
+        trng_drbg_config cfg;
+        trng_drbg_config_default(&cfg, iter % 2 ? TRNG_DRBG_HMAC : TRNG_DRBG_CTR, stream_entropy, &src);
+        cfg.entropy_per_byte = 1 + check_rng_next(rng) % 8;
+        cfg.reseed_interval = 1 + check_rng_next(rng) % 5;
+        cfg.prediction_resistance = check_rng_next(rng) % 4 == 0;
+        size_t entropy_len = (256 + cfg.entropy_per_byte - 1) / cfg.entropy_per_byte;
+        size_t nonce_len = (128 + cfg.entropy_per_byte - 1) / cfg.entropy_per_byte;
+        bytes pers = random_bytes(rng, check_rng_next(rng) % 3 ? check_rng_next(rng) % 100 : 0);
+
+        trng_drbg drbg;
+        if (trng_drbg_init(&drbg, &cfg, pers.empty() ? NULL : &pers[0], pers.size()) != 0)
+        {
+            failures += check_fail("drbg", "case %llu: trng_drbg_init failed", (unsigned long long)iter);
+            continue;
+        }
+        ref_drbg ref;
+        ref.mechanism = cfg.mechanism;
+        ref.reseeds = 0;
+        bytes input = take(&ref_src, entropy_len + nonce_len);
+        ref_seed(&ref, cat(input, pers), true);
+
+        for (int op = 0; op < 8; op++)
+        {
+            bytes addl = random_bytes(rng, check_rng_next(rng) % 2 ? check_rng_next(rng) % 80 : 0);
+            const uint8_t *addl_p = addl.empty() ? NULL : &addl[0];
+            if (check_rng_next(rng) % 6 == 0)
+            {
+                trng_drbg_reseed(&drbg, addl_p, addl.size());
+                ref_seed(&ref, cat(take(&ref_src, entropy_len), addl), false);
+                continue;
+            }
+
+            size_t len = check_rng_next(rng) % 16 == 0 ? 70000 + check_rng_next(rng) % 70000 : check_rng_next(rng) % 300;
+            bytes got(len + 1, 0xa5), want;
+            trng_drbg_generate(&drbg, &got[0], len, addl_p, addl.size());
+            size_t pos = 0;
+            do
+            {
+                size_t n = len - pos < TRNG_DRBG_MAX_REQUEST ? len - pos : TRNG_DRBG_MAX_REQUEST;
+                bytes request_addl = addl;
+                if (cfg.prediction_resistance || ref.reseed_counter > cfg.reseed_interval)
+                {
+                    ref_seed(&ref, cat(take(&ref_src, entropy_len), addl), false);
+                    request_addl.clear();
+                }
+                want = cat(want, ref_generate(&ref, n, request_addl));
+                pos += n;
+            }
+            while (pos < len);
+            want.push_back(0xa5);
+
+            if (got != want)
+            {
+                failures += check_fail("drbg", "case %llu: %s output differs from the reference on %zu bytes (op %d)",
+                                       (unsigned long long)iter, cfg.mechanism == TRNG_DRBG_CTR ? "CTR" : "HMAC", len, op);
+                break;
+            }
+        }
+        if (drbg.reseeds != ref.reseeds || drbg.reseed_counter != ref.reseed_counter || src.bytes != ref_src.bytes)
+        {
+            failures += check_fail("drbg", "case %llu: %llu reseeds, %llu entropy bytes, reference %llu and %llu",
+                                   (unsigned long long)iter, (unsigned long long)drbg.reseeds,
+                                   (unsigned long long)src.bytes, (unsigned long long)ref.reseeds,
+                                   (unsigned long long)ref_src.bytes);
+        }
+        trng_drbg_free(&drbg);
+    }
+    return failures;
+}
+
+static int check_policy(void)
+{
+    int failures = 0;
+    for (int mechanism = TRNG_DRBG_CTR; mechanism <= TRNG_DRBG_HMAC; mechanism++)
+    {
+        stream_source src;
+        check_rng_seed(&src.rng, 5);
+        src.fail = false;
+        src.calls = src.bytes = 0;
+        trng_drbg_config cfg;
+        trng_drbg drbg;
+        uint8_t out[64];
+
+        /*Instantiation and a reseed before requests 4, 7 and 10, the split of a long call counts*/
+        trng_drbg_config_default(&cfg, mechanism, stream_entropy, &src);
+        cfg.reseed_interval = 3;
+        trng_drbg_init(&drbg, &cfg, NULL, 0);
+        for (int i = 0; i < 9; i++)
+        {
+            trng_drbg_generate(&drbg, out, sizeof(out), NULL, 0);
+        }
+        std::vector<uint8_t> big(3 * TRNG_DRBG_MAX_REQUEST);
+        trng_drbg_generate(&drbg, &big[0], big.size(), NULL, 0);
+        failures += src.calls != 4 ? check_fail("drbg", "interval 3: %llu source calls for 12 requests", (unsigned long long)src.calls) : 0;
+
+        /*A failing source stops the requests needing a reseed and leaves the output alone*/
+        memset(out, 0x33, sizeof(out));
+        src.fail = true;
+        int res = trng_drbg_generate(&drbg, out, sizeof(out), NULL, 0);
+        if (res != TRNG_DRBG_ERR_SOURCE || out[0] != 0x33 || out[63] != 0x33)
+        {
+            failures += check_fail("drbg", "failing source: generate returned %d", res);
+        }
+        src.fail = false;
+        failures += trng_drbg_generate(&drbg, out, sizeof(out), NULL, 0) != 0 ? check_fail("drbg", "source recovered, generate still fails") : 0;
+        trng_drbg_free(&drbg);
+
+        /*Prediction resistance reseeds for every request*/
+        src.calls = 0;
+        cfg.prediction_resistance = 1;
+        cfg.reseed_interval = TRNG_DRBG_RESEED_INTERVAL;
+        trng_drbg_init(&drbg, &cfg, NULL, 0);
+        for (int i = 0; i < 10; i++)
+        {
+            trng_drbg_generate(&drbg, out, sizeof(out), NULL, 0);
+        }
+        failures += src.calls != 11 ? check_fail("drbg", "prediction resistance: %llu source calls for 10 requests", (unsigned long long)src.calls) : 0;
+        trng_drbg_free(&drbg);
+
+        src.fail = true;
+        res = trng_drbg_init(&drbg, &cfg, NULL, 0);
+        if (res != TRNG_DRBG_ERR_SOURCE || trng_drbg_generate(&drbg, out, sizeof(out), NULL, 0) != TRNG_DRBG_ERR_SOURCE)
+        {
+            failures += check_fail("drbg", "failing source: init returned %d", res);
+        }
+        cfg.entropy_per_byte = 9;
+        failures += trng_drbg_init(&drbg, &cfg, NULL, 0) != TRNG_DRBG_ERR_CONFIG ? check_fail("drbg", "9 bits per byte accepted") : 0;
+    }
+    return failures;
+}
+
+/*One instance per thread, all seeded from a pool the main thread refills*/
+static int check_threads(void)
+{
+    std::vector<uint8_t> ring(1 << 12);
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    trng_pool pool;
+    trng_pool_config pool_cfg = { (uint32_t)ring.size(), 256, &trng_obj, NULL, NULL };
+    trng_pool_init(&pool, &pool_cfg, &ring[0]);
+
+    const unsigned int threads = 4;
+    std::vector<std::vector<uint8_t> > out(threads, std::vector<uint8_t>(4096));
+    std::vector<uint64_t> reseeds(threads);
+    std::vector<int> results(threads);
+    std::atomic<bool> done(false);
+    std::vector<std::thread> workers;
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        workers.push_back(std::thread([&, t]() {
+            trng_drbg_pool_source src = { &pool, std::this_thread::yield };
+            trng_drbg_config cfg;
+            trng_drbg_config_default(&cfg, t % 2 ? TRNG_DRBG_HMAC : TRNG_DRBG_CTR, trng_drbg_entropy_pool, &src);
+            cfg.reseed_interval = 2;
+            trng_drbg drbg;
+            results[t] = trng_drbg_init(&drbg, &cfg, NULL, 0);
+            for (size_t pos = 0; pos < out[t].size() && results[t] == 0; pos += 256)
+            {
+                results[t] = trng_drbg_generate(&drbg, &out[t][pos], 256, NULL, 0);
+            }
+            reseeds[t] = drbg.reseeds;
+            trng_drbg_free(&drbg);
+        }));
+    }
+    std::thread refill([&]() {
+        while (!done)
+        {
+            if (trng_pool_refill(&pool) <= 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        workers[t].join();
+    }
+    done = true;
+    refill.join();
+    trng_free(&trng_obj);
+
+    int failures = 0;
+    uint64_t drawn = 0;
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        failures += results[t] != 0 ? check_fail("drbg", "thread %u: error %d", t, results[t]) : 0;
+        drawn += 64 + 32 + (reseeds[t] - 1) * 64;
+        for (unsigned int u = 0; u < t; u++)
+        {
+            failures += memcmp(&out[t][0], &out[u][0], 32) == 0 ? check_fail("drbg", "threads %u and %u generate the same", u, t) : 0;
+        }
+    }
+    trng_pool_stats stats;
+    trng_pool_get_stats(&pool, &stats);
+    if (stats.bytes_served != drawn)
+    {
+        failures += check_fail("drbg", "%u threads drew %lu pool bytes for %llu bytes of entropy input", threads,
+                               stats.bytes_served, (unsigned long long)drawn);
+    }
+    return failures;
+}
+
+/*The screening and the SP 800-22 battery on output seeded from zeros: the conditioning, not the source, must pass*/
+static int check_gate(uint64_t len)
+{
+    std::vector<uint8_t> zeros(4096, 0), chunk(4096);
+    trng_host_use_replay(&zeros[0], zeros.size());
+    int failures = 0;
+
+    for (int mechanism = TRNG_DRBG_CTR; mechanism <= TRNG_DRBG_HMAC; mechanism++)
+    {
+        trng_t trng_obj;
+        trng_init(&trng_obj);
+        trng_drbg drbg;
+        trng_drbg_config cfg;
+        trng_drbg_config_default(&cfg, mechanism, trng_drbg_entropy_trng, &trng_obj);
+        trng_drbg_init(&drbg, &cfg, NULL, 0);
+
+        trng_nist_config nist_cfg;
+        trng_nist_config_default(&nist_cfg);
+        std::vector<double> arena(trng_nist_state_size(&nist_cfg) / sizeof(double) + 1);
+        trng_nist nist;
+        trng_nist_init(&nist, &nist_cfg, &arena[0], arena.size() * sizeof(double));
+        std::vector<uint8_t> lzf_arena(lzf_ctx_state_size(12));
+        lzf_ctx lzf;
+        lzf_ctx_init(&lzf, 12, &lzf_arena[0], lzf_arena.size());
+
+        trng_stream_config cfg_stream;
+        memset(&cfg_stream, 0, sizeof(cfg_stream));
+        cfg_stream.total_bytes = len;
+        cfg_stream.chunk_len = (unsigned int)chunk.size();
+        cfg_stream.percentage = 99;
+        cfg_stream.nist = &nist;
+        cfg_stream.fill = trng_drbg_fill;
+        cfg_stream.fill_ctx = &drbg;
+        trng_stream_stats stats;
+        int res = trng_stream_qualify(NULL, &cfg_stream, &chunk[0], NULL, &lzf, &stats);
+        trng_nist_result nist_res;
+        trng_nist_final(&nist, &nist_res);
+        trng_drbg_free(&drbg);
+        trng_free(&trng_obj);
+
+        if (res != 0 || stats.compressible_chunks != 0 || trng_nist_failures(&nist_res, 0.0001) != 0)
+        {
+            failures += check_fail("drbg", "%s output: error %d, %llu compressible chunks, %u SP 800-22 failures",
+                                   mechanism == TRNG_DRBG_CTR ? "CTR" : "HMAC", res,
+                                   (unsigned long long)stats.compressible_chunks, trng_nist_failures(&nist_res, 0.0001));
+        }
+    }
+    trng_host_use_urandom();
+    return failures;
+}
+
+int check_drbg(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+
+    int failures = check_primitives();
+    failures += check_kernels(&rng, iterations * 10);
+    failures += check_reference(&rng, iterations);
+    failures += check_policy();
+    failures += check_threads();
+    failures += check_gate(4 << 20);
+
+    printf("drbg: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
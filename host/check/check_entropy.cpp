@@ -0,0 +1,574 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The SP 800-90B estimators against references written from the text of the
+* standard: tuples counted for every length in a map, the collision and
+* compression equations solved in the form they are given there, the
+* predictor dictionaries as maps and the windows counted afresh for every
+* prediction. Samples of 1 to 8 bits are random, biased or repeated from a
+* few samples before, short enough for the quadratic references.
+*/
+
+#include "check.h"
+#include "trng_entropy.h"
+
+#include <map>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define H_TOLERANCE     1e-6
+
+typedef std::vector<uint8_t> sample_vector;
+
+static double bound_entropy(double p, double n)
+{
+    double pu = p + 2.576 * sqrt(p * (1.0 - p) / (n - 1.0));
+    return -log2(pu < 1.0 ? pu : 1.0);
+}
+
+static double ref_mcv(const sample_vector &s)
+{
+    std::map<int, double> counts;
+    double max = 0.0;
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        double c = counts[s[i]] += 1.0;
+        max = c > max ? c : max;
+    }
+    return bound_entropy(max / s.size(), (double)s.size());
+}
+
+/*6.3.2 step 7, the expected collision time of bits with bias p, F(q) = 2q^3 + 2q^2 + q for binary samples*/
+static double collision_mean(double p)
+{
+    double q = 1.0 - p, f = 2.0 * q * q * q + 2.0 * q * q + q;
+    return p / (q * q) * (1.0 + 0.5 * (1.0 / p - 1.0 / q)) * f - p / q * 0.5 * (1.0 / p - 1.0 / q);
+}
+
+static double ref_collision(const sample_vector &s)
+{
+    std::vector<double> t;
+    size_t i = 0;
+    while (i + 1 < s.size())
+    {
+        if (s[i] == s[i + 1])
+        {
+            t.push_back(2.0);
+            i += 2;
+        }
+        else if (i + 2 < s.size())
+        {
+            t.push_back(3.0);
+            i += 3;
+        }
+        else
+        {
+            break;
+        }
+    }
+    if (t.size() < 2)
+    {
+        return TRNG_ENTROPY_NA;
+    }
+    double v = (double)t.size(), mean = 0.0, var = 0.0;
+    for (size_t j = 0; j < t.size(); j++)
+    {
+        mean += t[j] / v;
+    }
+    for (size_t j = 0; j < t.size(); j++)
+    {
+        var += (t[j] - mean) * (t[j] - mean) / (v - 1.0);
+    }
+    double bound = mean - 2.576 * sqrt(var) / sqrt(v);
+    if (bound >= collision_mean(0.5))
+    {
+        return 1.0;
+    }
+    double lo = 0.5, hi = 1.0 - 1e-12;
+    if (bound <= collision_mean(hi))
+    {
+        return 0.0;
+    }
+    for (int k = 0; k < 100; k++)
+    {
+        double p = 0.5 * (lo + hi);
+        if (collision_mean(p) > bound)
+        {
+            lo = p;
+        }
+        else
+        {
+            hi = p;
+        }
+    }
+    return -log2(0.5 * (lo + hi));
+}
+
+static double ref_markov(const sample_vector &s)
+{
+    double c[2][2] = { { 0, 0 }, { 0, 0 } }, ones = 0.0;
+    for (size_t i = 0; i < s.size(); i++)
+    {
+        ones += s[i];
+        if (i + 1 < s.size())
+        {
+            c[s[i]][s[i + 1]] += 1.0;
+        }
+    }
+    double p1 = ones / s.size(), p0 = 1.0 - p1;
+    double p00 = c[0][0] + c[0][1] > 0 ? c[0][0] / (c[0][0] + c[0][1]) : 0.0;
+    double p01 = c[0][0] + c[0][1] > 0 ? c[0][1] / (c[0][0] + c[0][1]) : 0.0;
+    double p10 = c[1][0] + c[1][1] > 0 ? c[1][0] / (c[1][0] + c[1][1]) : 0.0;
+    double p11 = c[1][0] + c[1][1] > 0 ? c[1][1] / (c[1][0] + c[1][1]) : 0.0;
+    double seq[6] = {
+        p0 * pow(p00, 127),
+        p0 * pow(p01, 64) * pow(p10, 63),
+        p0 * p01 * pow(p11, 126),
+        p1 * p10 * pow(p00, 126),
+        p1 * pow(p10, 64) * pow(p01, 63),
+        p1 * pow(p11, 127),
+    };
+    double pmax = 0.0;
+    for (int i = 0; i < 6; i++)
+    {
+        pmax = seq[i] > pmax ? seq[i] : pmax;
+    }
+    double h = -log2(pmax) / 128.0;
+    return h < 1.0 ? h : 1.0;
+}
+
+/*6.3.4 step 7, the double sum as given*/
+static double compression_expectation(double z, size_t symbols)
+{
+    double sum = 0.0, d = 1000.0;
+    for (size_t t = 1001; t <= symbols; t++)
+    {
+        for (size_t u = 1; u <= t; u++)
+        {
+            double f = u < t ? z * z * pow(1.0 - z, (double)u - 1.0) : z * pow(1.0 - z, (double)t - 1.0);
+            sum += log2((double)u) * f;
+        }
+    }
+    return sum / (symbols - d);
+}
+
+static double ref_compression(const sample_vector &s)
+{
+    size_t symbols = s.size() / 6;
+    if (symbols < 1002)
+    {
+        return TRNG_ENTROPY_NA;
+    }
+    std::vector<double> d;
+    std::map<int, size_t> last;
+    for (size_t i = 1; i <= symbols; i++)
+    {
+        int v = 0;
+        for (size_t b = 0; b < 6; b++)
+        {
+            v = v * 2 + s[(i - 1) * 6 + b];
+        }
+        if (i > 1000)
+        {
+            d.push_back(log2((double)(last.count(v) ? i - last[v] : i)));
+        }
+        last[v] = i;
+    }
+    double v = (double)d.size(), mean = 0.0, sq = 0.0;
+    for (size_t i = 0; i < d.size(); i++)
+    {
+        mean += d[i] / v;
+        sq += d[i] * d[i] / (v - 1.0);
+    }
+    double bound = mean - 2.576 * 0.5907 * sqrt(sq - mean * mean) / sqrt(v);
+    double lo = 1.0 / 64.0, hi = 1.0;
+    if (compression_expectation(lo, symbols) + 63.0 * compression_expectation((1.0 - lo) / 63.0, symbols) <= bound)
+    {
+        return 1.0;
+    }
+    for (int k = 0; k < 40; k++)
+    {
+        double p = 0.5 * (lo + hi);
+        if (compression_expectation(p, symbols) + 63.0 * compression_expectation((1.0 - p) / 63.0, symbols) > bound)
+        {
+            lo = p;
+        }
+        else
+        {
+            hi = p;
+        }
+    }
+    return -log2(0.5 * (lo + hi)) / 6.0;
+}
+
+/*6.3.5 and 6.3.6, every W-tuple counted in a map*/
+static void ref_tuples(const sample_vector &s, double *t_tuple, double *lrs)
+{
+    std::string str(s.begin(), s.end());
+    double n = (double)s.size(), pmax_t = 0.0, pmax_lrs = 0.0;
+    size_t t = 0;
+    bool repeats = true, lrs_done = false;
+    *t_tuple = TRNG_ENTROPY_NA;
+    *lrs = TRNG_ENTROPY_NA;
+    for (size_t w = 1; w < s.size() && repeats; w++)
+    {
+        std::map<std::string, double> counts;
+        double max = 0.0, pairs = 0.0;
+        for (size_t i = 0; i + w <= s.size(); i++)
+        {
+            double c = counts[str.substr(i, w)] += 1.0;
+            max = c > max ? c : max;
+        }
+        for (std::map<std::string, double>::iterator it = counts.begin(); it != counts.end(); ++it)
+        {
+            pairs += it->second * (it->second - 1.0) / 2.0;
+        }
+        repeats = max >= 2.0;
+        double m = n - w + 1.0;
+        if (max >= 35.0 && t == w - 1)
+        {
+            t = w;
+            double p = pow(max / m, 1.0 / w);
+            pmax_t = p > pmax_t ? p : pmax_t;
+        }
+        else if (repeats)
+        {
+            double p = pow(pairs / (m * (m - 1.0) / 2.0), 1.0 / w);
+            pmax_lrs = p > pmax_lrs ? p : pmax_lrs;
+            lrs_done = true;
+        }
+    }
+    if (t > 0)
+    {
+        *t_tuple = bound_entropy(pmax_t, n);
+    }
+    if (lrs_done)
+    {
+        *lrs = bound_entropy(pmax_lrs, n);
+    }
+}
+
+/*6.3.7 steps 4 to 6 with the probabilities as written*/
+static double ref_predictor(const std::vector<int> &correct, unsigned int bits)
+{
+    double n = (double)correct.size(), c = 0.0;
+    size_t run = 0, longest = 0;
+    if (correct.size() < 2)
+    {
+        return TRNG_ENTROPY_NA;
+    }
+    for (size_t i = 0; i < correct.size(); i++)
+    {
+        c += correct[i];
+        run = correct[i] ? run + 1 : 0;
+        longest = run > longest ? run : longest;
+    }
+    double global;
+    if (c == 0.0)
+    {
+        global = 1.0 - pow(0.01, 1.0 / n);
+    }
+    else
+    {
+        double p = c / n;
+        global = p + 2.576 * sqrt(p * (1.0 - p) / (n - 1.0));
+        global = global < 1.0 ? global : 1.0;
+    }
+    double r = (double)longest + 1.0, lo = 0.0, hi = 1.0;
+    for (int k = 0; k < 64; k++)
+    {
+        double p = 0.5 * (lo + hi), q = 1.0 - p, x = 1.0;
+        for (int j = 0; j < 10; j++)
+        {
+            x = 1.0 + q * pow(p, r) * pow(x, r + 1.0);
+        }
+        double prob = (1.0 - p * x) / ((r + 1.0 - r * x) * q) / pow(x, n + 1.0);
+        if (prob > 0.99)
+        {
+            lo = p;
+        }
+        else
+        {
+            hi = p;
+        }
+    }
+    double local = 0.5 * (lo + hi), pmax = global > local ? global : local;
+    pmax = pmax > ldexp(1.0, -(int)bits) ? pmax : ldexp(1.0, -(int)bits);
+    return -log2(pmax);
+}
+
+/*Winner of the scoreboard makes the prediction, then every subpredictor is scored*/
+static int ref_score(std::vector<int> &scores, size_t &winner, const std::vector<int> &predictions, int sample)
+{
+    int correct = predictions[winner] == sample;
+    for (size_t j = 0; j < predictions.size(); j++)
+    {
+        if (predictions[j] == sample)
+        {
+            scores[j]++;
+        }
+        if (scores[j] >= scores[winner])
+        {
+            winner = j;
+        }
+    }
+    return correct;
+}
+
+static double ref_multi_mcw(const sample_vector &s, unsigned int bits)
+{
+    static const size_t windows[4] = { 63, 255, 1023, 4095 };
+    std::vector<int> scores(4), correct;
+    size_t winner = 0;
+    for (size_t i = 63; i < s.size(); i++)
+    {
+        std::vector<int> predictions(4, -1);
+        for (size_t j = 0; j < 4; j++)
+        {
+            if (i < windows[j])
+            {
+                continue;
+            }
+            /*Most common in the window, ties to the one seen last*/
+            std::map<int, size_t> counts, last;
+            for (size_t k = i - windows[j]; k < i; k++)
+            {
+                counts[s[k]]++;
+                last[s[k]] = k;
+            }
+            size_t best = 0;
+            for (std::map<int, size_t>::iterator it = counts.begin(); it != counts.end(); ++it)
+            {
+                if (it->second > best || (it->second == best && last[it->first] > last[predictions[j]]))
+                {
+                    best = it->second;
+                    predictions[j] = it->first;
+                }
+            }
+        }
+        correct.push_back(ref_score(scores, winner, predictions, s[i]));
+    }
+    return ref_predictor(correct, bits);
+}
+
+static double ref_lag(const sample_vector &s, unsigned int bits)
+{
+    std::vector<int> scores(128), correct;
+    size_t winner = 0;
+    for (size_t i = 1; i < s.size(); i++)
+    {
+        std::vector<int> predictions(128, -1);
+        for (size_t d = 1; d <= 128 && d <= i; d++)
+        {
+            predictions[d - 1] = s[i - d];
+        }
+        correct.push_back(ref_score(scores, winner, predictions, s[i]));
+    }
+    return ref_predictor(correct, bits);
+}
+
+typedef std::map<std::string, std::map<int, int> > dictionary;
+
+/*Most common successor, ties to the greater value*/
+static int ref_successor(const std::map<int, int> &next, int *count)
+{
+    int best = -1;
+    *count = 0;
+    for (std::map<int, int>::const_iterator it = next.begin(); it != next.end(); ++it)
+    {
+        if (it->second >= *count)
+        {
+            best = it->first;
+            *count = it->second;
+        }
+    }
+    return best;
+}
+
+static double ref_multi_mmc(const sample_vector &s, unsigned int bits)
+{
+    std::string str(s.begin(), s.end());
+    std::vector<dictionary> m(17);
+    std::vector<int> scores(16), correct;
+    size_t winner = 0;
+    for (size_t i = 2; i < s.size(); i++)
+    {
+        for (size_t d = 1; d <= 16 && d < i; d++)
+        {
+            m[d][str.substr(i - 1 - d, d)][s[i - 1]]++;
+        }
+        std::vector<int> predictions(16, -1);
+        for (size_t d = 1; d <= 16 && d <= i; d++)
+        {
+            dictionary::iterator it = m[d].find(str.substr(i - d, d));
+            int count;
+            predictions[d - 1] = it != m[d].end() ? ref_successor(it->second, &count) : -1;
+        }
+        correct.push_back(ref_score(scores, winner, predictions, s[i]));
+    }
+    return ref_predictor(correct, bits);
+}
+
+static double ref_lz78y(const sample_vector &s, unsigned int bits)
+{
+    std::string str(s.begin(), s.end());
+    dictionary dict;
+    std::vector<int> correct;
+    for (size_t i = 17; i < s.size(); i++)
+    {
+        for (size_t j = 16; j >= 1; j--)
+        {
+            std::string ctx = str.substr(i - 1 - j, j);
+            if (dict.count(ctx) || dict.size() < 65536)
+            {
+                dict[ctx][s[i - 1]]++;
+            }
+        }
+        int prediction = -1, max = 0;
+        for (size_t j = 16; j >= 1; j--)
+        {
+            dictionary::iterator it = dict.find(str.substr(i - j, j));
+            int count, y = it != dict.end() ? ref_successor(it->second, &count) : -1;
+            if (y >= 0 && count > max)
+            {
+                prediction = y;
+                max = count;
+            }
+        }
+        correct.push_back(prediction == s[i]);
+    }
+    return ref_predictor(correct, bits);
+}
+
+static double reference(int estimator, const sample_vector &s, unsigned int bits)
+{
+    double t_tuple, lrs;
+    switch (estimator)
+    {
+    case TRNG_ENTROPY_MCV:
+        return ref_mcv(s);
+    case TRNG_ENTROPY_COLLISION:
+        return bits == 1 ? ref_collision(s) : TRNG_ENTROPY_NA;
+    case TRNG_ENTROPY_MARKOV:
+        return bits == 1 ? ref_markov(s) : TRNG_ENTROPY_NA;
+    case TRNG_ENTROPY_COMPRESSION:
+        return bits == 1 ? ref_compression(s) : TRNG_ENTROPY_NA;
+    case TRNG_ENTROPY_TTUPLE:
+    case TRNG_ENTROPY_LRS:
+        ref_tuples(s, &t_tuple, &lrs);
+        return estimator == TRNG_ENTROPY_TTUPLE ? t_tuple : lrs;
+    case TRNG_ENTROPY_MULTI_MCW:
+        return ref_multi_mcw(s, bits);
+    case TRNG_ENTROPY_LAG:
+        return ref_lag(s, bits);
+    case TRNG_ENTROPY_MULTI_MMC:
+        return ref_multi_mmc(s, bits);
+    default:
+        return ref_lz78y(s, bits);
+    }
+}
+
+static double run_estimator(int estimator, const sample_vector &s, unsigned int bits)
+{
+    std::vector<uint64_t> work(trng_entropy_work_size(estimator, s.size(), bits) / sizeof(uint64_t) + 1);
+    return trng_entropy_estimate(estimator, &s[0], s.size(), bits, &work[0], work.size() * sizeof(uint64_t));
+}
+
+/*Random, biased to the low values or repeated from a few samples before*/
+static sample_vector make_samples(check_rng *rng, size_t len, unsigned int bits, uint32_t kind)
+{
+    sample_vector s(len);
+    uint8_t mask = (uint8_t)((1U << bits) - 1);
+    for (size_t i = 0; i < len; i++)
+    {
+        uint32_t r = check_rng_next(rng);
+        s[i] = kind == 0 ? (uint8_t)(r & mask) :
+               kind == 1 ? (uint8_t)(r & (r >> 8) & (r >> 16) & mask) :
+               i >= 4 && (r & 3) != 0 ? s[i - 1 - (r >> 8) % 4] : (uint8_t)((r >> 16) & mask);
+    }
+    return s;
+}
+
+int check_entropy(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 60);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = 0;
+
+    static const unsigned int sizes[] = { 1, 2, 4, 8 };
+    static const char *const kinds[] = { "random", "biased", "repeated" };
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        unsigned int bits = sizes[check_rng_next(&rng) % 4];
+        uint32_t kind = check_rng_next(&rng) % 3;
+        /*Compression needs more than 6000 bits, MultiMCW's longest window 4095 samples*/
+        size_t len = iter % 8 == 0 ? 6000 + check_rng_next(&rng) % 2000 : 2 + check_rng_next(&rng) % 1500;
+        if (bits == 1 && kind == 2)
+        {
+            /*Repeated bits make repeats as long as the data, too long for the map of every length*/
+            kind = check_rng_next(&rng) % 2;
+        }
+        sample_vector s = make_samples(&rng, len, bits, kind);
+
+        for (int e = 0; e < TRNG_ENTROPY_ESTIMATORS; e++)
+        {
+            double got = run_estimator(e, s, bits);
+            double expected = reference(e, s, bits);
+            if (fabs(got - expected) > H_TOLERANCE)
+            {
+                failures += check_fail("entropy", "case %llu: %s of %zu %s %u bit samples = %.9f, reference %.9f",
+                                       (unsigned long long)iter, trng_entropy_name(e), len, kinds[kind], bits,
+                                       got, expected);
+            }
+        }
+    }
+
+    /*Suffix counting on one value, where every length repeats*/
+    sample_vector constant(3000, 1);
+    double t_tuple, lrs;
+    ref_tuples(constant, &t_tuple, &lrs);
+    std::vector<uint64_t> work(trng_entropy_work_size(TRNG_ENTROPY_TTUPLE, constant.size(), 1) / sizeof(uint64_t) + 1);
+    double got_t, got_lrs;
+    trng_entropy_tuples(&constant[0], constant.size(), 1, &work[0], work.size() * sizeof(uint64_t), &got_t, &got_lrs);
+    if (fabs(got_t - t_tuple) > H_TOLERANCE || fabs(got_lrs - lrs) > H_TOLERANCE)
+    {
+        failures += check_fail("entropy", "constant: t-tuple %.9f lrs %.9f, reference %.9f %.9f", got_t, got_lrs, t_tuple, lrs);
+    }
+
+    /*Bit strings and rejected arguments*/
+    uint8_t samples[3] = { 0x5, 0x2, 0x7 }, out[9];
+    static const uint8_t expected_bits[9] = { 1, 0, 1, 0, 1, 0, 1, 1, 1 };
+    if (trng_entropy_bitstring(samples, 3, 3, out, 9) != 9 || memcmp(out, expected_bits, 9) != 0 ||
+        trng_entropy_bitstring(samples, 3, 3, out, 4) != 4)
+    {
+        failures += check_fail("entropy", "bit string of 3 bit samples");
+    }
+    if (trng_entropy_estimate(TRNG_ENTROPY_MARKOV, samples, 3, 3, NULL, 0) != TRNG_ENTROPY_NA ||
+        trng_entropy_estimate(TRNG_ENTROPY_MCV, samples, 3, 9, NULL, 0) != TRNG_ENTROPY_NA ||
+        trng_entropy_estimate(TRNG_ENTROPY_LZ78Y, samples, 3, 3, NULL, 0) != TRNG_ENTROPY_NA)
+    {
+        failures += check_fail("entropy", "invalid arguments accepted");
+    }
+
+    printf("entropy: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
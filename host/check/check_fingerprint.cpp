@@ -0,0 +1,259 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The fingerprint index against a model that keeps the windows recorded from
+* every boot in a set and replays the generation rotation: a window of a
+* remembered boot must always be found (a Bloom filter has no false
+* negatives), so must any run of window + stride - 1 bytes copied from one,
+* the rolling lookup must agree with looking windows up one at a time, and
+* the false positive rate must stay near trng_fingerprint_false_positive.
+* Images are reopened to check they keep the index and are formatted when
+* the config changes.
+*/
+
+#include "check.h"
+#include "trng_fingerprint.h"
+
+#include <deque>
+#include <math.h>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+typedef std::set<std::string> window_set;
+
+struct model {
+    trng_fingerprint_config cfg;
+    std::deque<std::vector<uint8_t> > boots[2];
+    unsigned int active;
+};
+
+static void model_add(model *m, const std::vector<uint8_t> &boot)
+{
+    if (m->boots[m->active].size() == m->cfg.generation_boots)
+    {
+        m->active ^= 1;
+        m->boots[m->active].clear();
+    }
+    m->boots[m->active].push_back(boot);
+}
+
+static window_set model_windows(const model *m)
+{
+    window_set windows;
+    for (int g = 0; g < 2; g++)
+    {
+        for (size_t b = 0; b < m->boots[g].size(); b++)
+        {
+            const std::vector<uint8_t> &boot = m->boots[g][b];
+            for (size_t pos = 0; pos + m->cfg.window <= boot.size(); pos += m->cfg.stride)
+            {
+                windows.insert(std::string((const char *)&boot[pos], m->cfg.window));
+            }
+        }
+    }
+    return windows;
+}
+
+/*Random bytes with runs copied from remembered and forgotten boots*/
+static std::vector<uint8_t> make_boot(check_rng *rng, const std::vector<std::vector<uint8_t> > &history)
+{
+    std::vector<uint8_t> boot(check_rng_next(rng) % 256);
+    for (size_t i = 0; i < boot.size(); i++)
+    {
+        boot[i] = (uint8_t)check_rng_next(rng);
+    }
+    for (int splice = check_rng_next(rng) % 3; splice > 0 && !history.empty() && !boot.empty(); splice--)
+    {
+        const std::vector<uint8_t> &from = history[history.size() - 1 - check_rng_next(rng) % history.size()];
+        if (from.empty())
+        {
+            continue;
+        }
+        size_t len = 1 + check_rng_next(rng) % from.size();
+        len = len < boot.size() ? len : boot.size();
+        size_t src = check_rng_next(rng) % (from.size() - len + 1), dst = check_rng_next(rng) % (boot.size() - len + 1);
+        memcpy(&boot[dst], &from[src], len);
+    }
+    return boot;
+}
+
+static int check_against_model(check_rng *rng, uint64_t iterations)
+{
+    int failures = 0;
+    double positives = 0, expected = 0, lookups = 0;
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        model m;
+        m.cfg.window = 4 + check_rng_next(rng) % 29;
+        m.cfg.stride = 1 + check_rng_next(rng) % m.cfg.window;
+        m.cfg.log2_bits = 8 + check_rng_next(rng) % 7;
+        m.cfg.hashes = 1 + check_rng_next(rng) % 16;
+        m.cfg.generation_boots = 1 + check_rng_next(rng) % 8;
+        m.active = 0;
+
+        std::vector<uint32_t> image(trng_fingerprint_size(&m.cfg) / 4 + 1, 0xffffffffU);
+        trng_fingerprint fp;
+        if (trng_fingerprint_open(&fp, &m.cfg, &image[0], image.size() * 4) != 0)
+        {
+            failures += check_fail("fingerprint", "case %llu: an erased image was not formatted", (unsigned long long)iter);
+            continue;
+        }
+
+        std::vector<std::vector<uint8_t> > history;
+        for (int b = 0; b < 24 && failures < 16; b++)
+        {
+            std::vector<uint8_t> boot = make_boot(rng, history);
+            window_set seen = model_windows(&m);
+            const uint8_t *data = boot.empty() ? NULL : &boot[0];
+
+            size_t first = 0, want_first = boot.size();
+            uint32_t matches = trng_fingerprint_check(&fp, data, boot.size(), &first), want = 0;
+            for (size_t pos = 0; pos + m.cfg.window <= boot.size(); pos++)
+            {
+                uint32_t one = trng_fingerprint_check(&fp, data + pos, m.cfg.window, NULL);
+                bool exact = seen.count(std::string((const char *)data + pos, m.cfg.window)) != 0;
+                if (exact && one != 1)
+                {
+                    failures += check_fail("fingerprint", "case %llu boot %d: recorded window at %zu not found",
+                                           (unsigned long long)iter, b, pos);
+                    break;
+                }
+                if (!exact && !seen.empty())
+                {
+                    positives += one;
+                    lookups++;
+                    expected += trng_fingerprint_false_positive(&m.cfg, 255) ;
+                }
+                want_first = one && want == 0 ? pos : want_first;
+                want += one;
+            }
+            if (matches != want || first != want_first)
+            {
+                failures += check_fail("fingerprint", "case %llu boot %d: %u windows found at %zu, one at a time %u at %zu",
+                                       (unsigned long long)iter, b, matches, first, want, want_first);
+            }
+
+            trng_fingerprint_add(&fp, data, boot.size());
+            model_add(&m, boot);
+            history.push_back(boot);
+
+            /*A copy of the image is the same index, another config formats it*/
+            std::vector<uint32_t> copy(image);
+            trng_fingerprint reopened;
+            if (trng_fingerprint_open(&reopened, &m.cfg, &copy[0], copy.size() * 4) != TRNG_FINGERPRINT_LOADED ||
+                trng_fingerprint_check(&reopened, data, boot.size(), NULL) != trng_fingerprint_check(&fp, data, boot.size(), NULL))
+            {
+                failures += check_fail("fingerprint", "case %llu boot %d: reopened image differs", (unsigned long long)iter, b);
+            }
+            trng_fingerprint_config other = m.cfg;
+            other.hashes = other.hashes % 16 + 1;
+            if (trng_fingerprint_open(&reopened, &other, &copy[0], copy.size() * 4) != 0 ||
+                trng_fingerprint_check(&reopened, data, boot.size(), NULL) != 0)
+            {
+                failures += check_fail("fingerprint", "case %llu boot %d: image of another config was kept", (unsigned long long)iter, b);
+            }
+        }
+    }
+
+    /*The estimate is for full filters of the longest boots, an upper bound on average*/
+    if (lookups > 0 && positives > 2.0 * expected + 10.0 * sqrt(expected) + 10.0)
+    {
+        failures += check_fail("fingerprint", "%.0f false positives in %.0f lookups, %.1f expected at most",
+                               positives, lookups, expected);
+    }
+    return failures;
+}
+
+/*Every run of window + stride - 1 bytes out of the last generation_boots + 1 boots is found*/
+static int check_repeats(check_rng *rng, uint64_t iterations)
+{
+    int failures = 0;
+    trng_fingerprint_config cfg;
+    trng_fingerprint_config_default(&cfg);
+    std::vector<uint32_t> image(trng_fingerprint_size(&cfg) / 4);
+    trng_fingerprint fp;
+    trng_fingerprint_open(&fp, &cfg, &image[0], image.size() * 4);
+
+    std::vector<std::vector<uint8_t> > boots;
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        std::vector<uint8_t> boot(64);
+        for (size_t i = 0; i < boot.size(); i++)
+        {
+            boot[i] = (uint8_t)check_rng_next(rng);
+        }
+        if (trng_fingerprint_check(&fp, &boot[0], boot.size(), NULL) != 0)
+        {
+            failures += check_fail("fingerprint", "boot %llu: random output reported as seen", (unsigned long long)iter);
+        }
+
+        if (!boots.empty())
+        {
+            size_t back = 1 + check_rng_next(rng) % (boots.size() < cfg.generation_boots + 1 ? boots.size() : cfg.generation_boots + 1);
+            const std::vector<uint8_t> &from = boots[boots.size() - back];
+            size_t len = cfg.window + cfg.stride - 1 + check_rng_next(rng) % (64 - cfg.window - cfg.stride + 2);
+            std::vector<uint8_t> repeat(boot);
+            memcpy(&repeat[check_rng_next(rng) % (65 - len)], &from[check_rng_next(rng) % (65 - len)], len);
+            if (trng_fingerprint_check(&fp, &repeat[0], repeat.size(), NULL) == 0)
+            {
+                failures += check_fail("fingerprint", "boot %llu: %zu bytes of the boot %zu back not found",
+                                       (unsigned long long)iter, len, back);
+            }
+        }
+        trng_fingerprint_add(&fp, &boot[0], boot.size());
+        boots.push_back(boot);
+    }
+    return failures;
+}
+
+static int check_open(void)
+{
+    int failures = 0;
+    trng_fingerprint_config cfg;
+    trng_fingerprint fp;
+    uint32_t image[64];
+
+    trng_fingerprint_config_default(&cfg);
+    cfg.log2_bits = 9;
+    failures += trng_fingerprint_open(&fp, &cfg, image, trng_fingerprint_size(&cfg) - 1) != -1 ?
+                check_fail("fingerprint", "short image accepted") : 0;
+    cfg.stride = cfg.window + 1;
+    failures += trng_fingerprint_open(&fp, &cfg, image, sizeof(image)) != -1 ?
+                check_fail("fingerprint", "stride longer than the window accepted") : 0;
+    cfg.stride = 8;
+    cfg.log2_bits = 25;
+    failures += trng_fingerprint_size(&cfg) != 0 ? check_fail("fingerprint", "filters of 2^25 bits accepted") : 0;
+    return failures;
+}
+
+int check_fingerprint(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+
+    int failures = check_open();
+    failures += check_against_model(&rng, iterations / 4);
+    failures += check_repeats(&rng, iterations * 10);
+
+    printf("fingerprint: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
@@ -0,0 +1,227 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The SP 800-90B health tests against a model that recounts the run and the
+* window behind every sample: data with planted runs and over represented
+* values is fed in random slices and every failure must be reported at the
+* same byte, with the same counters. Cutoffs are checked against the tables
+* of 90B and the start up tests against stuck and healthy replayed sources.
+*/
+
+#include "check.h"
+#include "trng_health.h"
+#include "trng_host.h"
+
+#include <stdio.h>
+#include <vector>
+
+struct failure_log {
+    std::vector<uint64_t> rct;          //byte count at every failure
+    std::vector<uint64_t> apt;
+};
+
+static void log_failure(int test, const trng_health_counters *counters, void *ctx)
+{
+    failure_log *log = (failure_log *)ctx;
+    (test == TRNG_HEALTH_RCT ? log->rct : log->apt).push_back(counters->bytes);
+}
+
+/*Failures found by recounting from scratch at every sample*/
+static void model(const std::vector<uint8_t> &data, const trng_health_config *cfg, failure_log *log,
+                  uint32_t *longest, uint32_t *highest)
+{
+    *longest = 0;
+    *highest = 0;
+    for (size_t i = 0; i < data.size(); i++)
+    {
+        uint32_t run = 1;
+        while (run <= i && data[i - run] == data[i])
+        {
+            run++;
+        }
+        if (run == cfg->rct_cutoff)
+        {
+            log->rct.push_back(i + 1);
+        }
+        *longest = run > *longest ? run : *longest;
+
+        size_t first = i - i % cfg->apt_window;
+        uint32_t count = 0;
+        for (size_t j = first; j <= i; j++)
+        {
+            count += data[j] == data[first];
+        }
+        if (count == cfg->apt_cutoff && data[i] == data[first] && i != first)
+        {
+            log->apt.push_back(i + 1);
+        }
+        *highest = count > *highest ? count : *highest;
+    }
+}
+
+static int compare(const char *what, uint64_t iter, const std::vector<uint64_t> &got, const std::vector<uint64_t> &expected)
+{
+    if (got == expected)
+    {
+        return 0;
+    }
+    return check_fail("health", "case %llu: %zu %s failures, model %zu (first at %llu, model %llu)",
+                      (unsigned long long)iter, got.size(), what, expected.size(),
+                      (unsigned long long)(got.empty() ? 0 : got[0]),
+                      (unsigned long long)(expected.empty() ? 0 : expected[0]));
+}
+
+static int check_cutoffs(void)
+{
+    /*90B table 2, alpha 2^-20*/
+    static const double h[] = { 0.5, 1, 2, 4, 8 };
+    static const uint32_t window_512[] = { 410, 311, 177, 62, 13 };
+    int failures = 0;
+
+    for (size_t i = 0; i < sizeof(h) / sizeof(h[0]); i++)
+    {
+        uint32_t c = trng_health_apt_cutoff(512, h[i], 20);
+        failures += c != window_512[i] ? check_fail("health", "apt cutoff for h %g is %u, expected %u", h[i], c, window_512[i]) : 0;
+    }
+    uint32_t c = trng_health_apt_cutoff(1024, 1.0, 20);
+    failures += c != 589 ? check_fail("health", "binary apt cutoff for h 1 is %u, expected 589", c) : 0;
+
+    /*90B 4.4.1 example, h 2 and alpha 2^-20 give 11*/
+    trng_health_config cfg;
+    trng_health_config_default(&cfg, 2.0, 20);
+    failures += cfg.rct_cutoff != 11 ? check_fail("health", "rct cutoff for h 2 is %u, expected 11", cfg.rct_cutoff) : 0;
+    return failures;
+}
+
+static int check_startup(void)
+{
+    std::vector<uint8_t> stuck(4096, 0x5a), noise(1 << 16);
+    check_rng rng;
+    check_rng_seed(&rng, 3);
+    for (size_t i = 0; i < noise.size(); i++)
+    {
+        noise[i] = (uint8_t)check_rng_next(&rng);
+    }
+
+    trng_health_config cfg;
+    trng_health_config_default(&cfg, 4.0, 30);
+    failure_log log;
+    cfg.on_failure = log_failure;
+    cfg.ctx = &log;
+    trng_health h;
+    int failures = 0;
+
+    trng_host_set_max_chunk(7);
+    trng_host_use_replay(&stuck[0], stuck.size());
+    int res = trng_health_init(&h, &cfg);
+    trng_health_free(&h);
+    if (res != TRNG_HEALTH_FAILED || log.rct.empty() || log.apt.empty() || h.counters.bytes != TRNG_HEALTH_STARTUP_BYTES)
+    {
+        failures += check_fail("health", "stuck source passed the start up tests (%d, %zu/%zu failures)",
+                               res, log.rct.size(), log.apt.size());
+    }
+
+    log.rct.clear();
+    log.apt.clear();
+    trng_host_use_replay(&noise[0], noise.size());
+    res = trng_health_init(&h, &cfg);
+    uint8_t buf[1000];
+    for (int i = 0; i < 50 && res == 0; i++)
+    {
+        res = trng_health_fill(&h, buf, sizeof(buf));
+    }
+    trng_health_free(&h);
+    if (res != 0 || !log.rct.empty() || !log.apt.empty() || h.counters.bytes != TRNG_HEALTH_STARTUP_BYTES + 50000)
+    {
+        failures += check_fail("health", "random source failed the health tests (%d after %llu bytes)",
+                               res, (unsigned long long)h.counters.bytes);
+    }
+
+    trng_host_set_max_chunk(0);
+    trng_host_use_urandom();
+    return failures;
+}
+
+int check_health(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = check_cutoffs() + check_startup();
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        trng_health_config cfg;
+        trng_health_config_default(&cfg, 0.5 + (check_rng_next(&rng) % 15) * 0.5, 8 + check_rng_next(&rng) % 24);
+        cfg.apt_window = 16 + check_rng_next(&rng) % 600;
+        cfg.apt_cutoff = 2 + check_rng_next(&rng) % (cfg.apt_window / 4);
+        cfg.rct_cutoff = 2 + check_rng_next(&rng) % 12;
+
+        /*Random bytes from a few values, with runs and over represented values planted*/
+        size_t len = 1 + check_rng_next(&rng) % 5000;
+        uint32_t values = 1 + check_rng_next(&rng) % 255;
+        std::vector<uint8_t> data(len);
+        for (size_t i = 0; i < len; i++)
+        {
+            uint32_t r = check_rng_next(&rng);
+            data[i] = (uint8_t)(r % values);
+            if (i > 0 && (r >> 24) < 8)
+            {
+                size_t run = 1 + (r >> 8) % 20;
+                for (; run > 0 && i < len; run--, i++)
+                {
+                    data[i] = data[i - 1];
+                }
+            }
+        }
+
+        failure_log got, expected;
+        uint32_t longest, highest;
+        cfg.on_failure = log_failure;
+        cfg.ctx = &got;
+        trng_health h;
+        trng_health_start(&h, &cfg);
+        int res = 0;
+        for (size_t pos = 0; pos < len;)
+        {
+            size_t slice = 1 + check_rng_next(&rng) % 300;
+            slice = slice < len - pos ? slice : len - pos;
+            res |= trng_health_feed(&h, &data[pos], slice);
+            pos += slice;
+        }
+        model(data, &cfg, &expected, &longest, &highest);
+
+        failures += compare("rct", iter, got.rct, expected.rct);
+        failures += compare("apt", iter, got.apt, expected.apt);
+        bool any = !expected.rct.empty() || !expected.apt.empty();
+        if ((res == TRNG_HEALTH_FAILED) != any || h.counters.rct_failures != expected.rct.size() ||
+            h.counters.apt_failures != expected.apt.size() || h.counters.bytes != len ||
+            h.counters.longest_run != longest || h.counters.highest_count != highest ||
+            h.counters.apt_windows != (len + cfg.apt_window - 1) / cfg.apt_window)
+        {
+            failures += check_fail("health", "case %llu: counters %llu/%llu bytes %llu run %u count %u windows %llu, "
+                                   "model %zu/%zu bytes %zu run %u count %u", (unsigned long long)iter,
+                                   (unsigned long long)h.counters.rct_failures, (unsigned long long)h.counters.apt_failures,
+                                   (unsigned long long)h.counters.bytes, h.counters.longest_run, h.counters.highest_count,
+                                   (unsigned long long)h.counters.apt_windows, expected.rct.size(), expected.apt.size(),
+                                   len, longest, highest);
+        }
+    }
+
+    printf("health: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
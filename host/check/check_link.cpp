@@ -0,0 +1,235 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The framed transport over a loopback that drops, corrupts and truncates
+* frames and ACKs at random: whatever the frame length, window and losses,
+* the receiver must deliver the data written to the sender exactly once and
+* in order, the sender must never have more than a window of frames in
+* flight, and every frame it resends must be one the receiver did not take.
+*/
+
+#include "check.h"
+#include "trng_link.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct loopback {
+    check_rng *rng;
+    trng_link_rx rx;
+    std::vector<uint8_t> received;
+    uint32_t loss;                      //chance of a frame being damaged, in 1/1024
+    uint64_t max_in_flight;
+    trng_link_tx *tx;
+    bool fail_send;
+};
+
+/*Damage a frame by dropping it, flipping a byte or cutting it short*/
+static bool damage(check_rng *rng, std::vector<uint8_t> &frame, uint32_t loss)
+{
+    if (loss == 0 || check_rng_next(rng) % 1024 >= loss)
+    {
+        return false;
+    }
+    switch (check_rng_next(rng) % 3)
+    {
+        case 0:
+            frame.clear();
+            break;
+        case 1:
+            frame[check_rng_next(rng) % frame.size()] ^= (uint8_t)(1 + check_rng_next(rng) % 255);
+            break;
+        default:
+            frame.resize(check_rng_next(rng) % frame.size());
+            break;
+    }
+    return true;
+}
+
+static int loop_send(void *ctx, const uint8_t *frame, size_t len)
+{
+    loopback *lb = (loopback *)ctx;
+    if (lb->fail_send)
+    {
+        return -1;
+    }
+    uint32_t in_flight = trng_link_tx_in_flight(lb->tx);
+    lb->max_in_flight = in_flight > lb->max_in_flight ? in_flight : lb->max_in_flight;
+
+    std::vector<uint8_t> copy(frame, frame + len);
+    if (damage(lb->rng, copy, lb->loss) && copy.empty())
+    {
+        return 0;
+    }
+    trng_link_rx_frame(&lb->rx, copy.empty() ? NULL : &copy[0], copy.size());
+    return 0;
+}
+
+static void loop_deliver(void *ctx, const uint8_t *data, size_t len)
+{
+    loopback *lb = (loopback *)ctx;
+    lb->received.insert(lb->received.end(), data, data + len);
+}
+
+/*Sync until an ACK gets through undamaged, returns the trng_link_tx_ack result*/
+static int loop_sync(loopback *lb)
+{
+    for (;;)
+    {
+        std::vector<uint8_t> ack(TRNG_LINK_HEADER);
+        trng_link_rx_ack(&lb->rx, &ack[0]);
+        damage(lb->rng, ack, lb->loss);
+        int res = trng_link_tx_ack(lb->tx, ack.empty() ? NULL : &ack[0], ack.size());
+        if (res != TRNG_LINK_ERR_FRAME)
+        {
+            return res;
+        }
+    }
+}
+
+static int check_loopback(check_rng *rng, uint64_t iterations)
+{
+    int failures = 0;
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        trng_link_tx_config cfg;
+        cfg.frame_len = 1 + check_rng_next(rng) % (check_rng_next(rng) % 2 ? 16 : 600);
+        cfg.window = 1 + check_rng_next(rng) % 8;
+        cfg.send = loop_send;
+
+        loopback lb;
+        lb.rng = rng;
+        lb.loss = check_rng_next(rng) % 3 == 0 ? 0 : check_rng_next(rng) % 400;
+        lb.max_in_flight = 0;
+        lb.fail_send = false;
+        cfg.ctx = &lb;
+        trng_link_rx_init(&lb.rx, loop_deliver, &lb);
+
+        trng_link_tx tx;
+        std::vector<uint8_t> frames(TRNG_LINK_TX_SIZE(cfg.window, cfg.frame_len));
+        lb.tx = &tx;
+        if (trng_link_tx_init(&tx, &cfg, &frames[0], frames.size()) != 0)
+        {
+            failures += check_fail("link", "case %llu: frames of %u in a window of %u rejected",
+                                   (unsigned long long)iter, cfg.frame_len, cfg.window);
+            continue;
+        }
+
+        std::vector<uint8_t> data(check_rng_next(rng) % 20000);
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = (uint8_t)check_rng_next(rng);
+        }
+
+        int res = 0;
+        for (size_t pos = 0; pos < data.size() && res >= 0;)
+        {
+            size_t n = 1 + check_rng_next(rng) % 1000;
+            n = n < data.size() - pos ? n : data.size() - pos;
+            res = trng_link_tx_write(&tx, &data[pos], n);
+            pos += res > 0 ? (size_t)res : 0;
+            while (res >= 0 && trng_link_tx_window_full(&tx))
+            {
+                /*What the receiver lacks of what was sent is exactly what gets resent*/
+                uint64_t lacking = tx.next - lb.rx.expected;
+                res = loop_sync(&lb);
+                res = res >= 0 && (uint64_t)res != lacking ? -100 : res;
+            }
+        }
+        res = res >= 0 ? trng_link_tx_flush(&tx) : res;
+        while (res >= 0 && trng_link_tx_in_flight(&tx) != 0)
+        {
+            uint64_t lacking = tx.next - lb.rx.expected;
+            res = loop_sync(&lb);
+            res = res >= 0 && (uint64_t)res != lacking ? -100 : res;
+        }
+
+        if (res < 0 || lb.received != data || tx.stats.bytes != data.size() || lb.max_in_flight > cfg.window ||
+            (lb.loss == 0 && tx.stats.resent != 0) || lb.rx.bytes != data.size())
+        {
+            failures += check_fail("link", "case %llu: %zu bytes in frames of %u, window %u, loss %u/1024: "
+                                   "result %d, %zu bytes received, %llu acknowledged, %llu in flight at most, %llu resent",
+                                   (unsigned long long)iter, data.size(), cfg.frame_len, cfg.window, lb.loss, res,
+                                   lb.received.size(), (unsigned long long)tx.stats.bytes,
+                                   (unsigned long long)lb.max_in_flight, (unsigned long long)tx.stats.resent);
+        }
+    }
+    return failures;
+}
+
+static int check_api(void)
+{
+    int failures = 0;
+    loopback lb;
+    trng_link_tx tx;
+    trng_link_tx_config cfg;
+    uint8_t frames[4 * (TRNG_LINK_HEADER + 32)], ack[TRNG_LINK_HEADER], data[100] = { 0 };
+
+    cfg.frame_len = 32;
+    cfg.window = 4;
+    cfg.send = loop_send;
+    cfg.ctx = &lb;
+    lb.rng = NULL;
+    lb.tx = &tx;
+    lb.loss = 0;
+    lb.max_in_flight = 0;
+    lb.fail_send = false;
+    trng_link_rx_init(&lb.rx, loop_deliver, &lb);
+
+    failures += trng_link_tx_init(&tx, &cfg, frames, sizeof(frames) - 1) != TRNG_LINK_ERR_CONFIG ?
+                check_fail("link", "short frame buffer accepted") : 0;
+    cfg.frame_len = 0x10000;
+    failures += trng_link_tx_init(&tx, &cfg, frames, sizeof(frames)) != TRNG_LINK_ERR_CONFIG ?
+                check_fail("link", "frames of 64 KB accepted") : 0;
+    cfg.frame_len = 32;
+    trng_link_tx_init(&tx, &cfg, frames, sizeof(frames));
+
+    /*An ACK ahead of what was sent, and one of a receiver gone back*/
+    trng_link_tx_write(&tx, data, 40);
+    trng_link_rx rx;
+    trng_link_rx_init(&rx, NULL, NULL);
+    rx.expected = 2;
+    trng_link_rx_ack(&rx, ack);
+    failures += trng_link_tx_ack(&tx, ack, sizeof(ack)) != TRNG_LINK_ERR_ACK ?
+                check_fail("link", "ACK of a frame never sent accepted") : 0;
+    rx.expected = 1;
+    trng_link_rx_ack(&rx, ack);
+    trng_link_tx_ack(&tx, ack, sizeof(ack));
+    rx.expected = 0;
+    trng_link_rx_ack(&rx, ack);
+    failures += trng_link_tx_ack(&tx, ack, sizeof(ack)) != TRNG_LINK_ERR_ACK ?
+                check_fail("link", "ACK behind the acknowledged frames accepted") : 0;
+
+    lb.fail_send = true;
+    failures += trng_link_tx_write(&tx, data, sizeof(data)) != TRNG_LINK_ERR_SEND ?
+                check_fail("link", "failed send not reported") : 0;
+    return failures;
+}
+
+int check_link(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+
+    int failures = check_api();
+    failures += check_loopback(&rng, iterations);
+
+    printf("link: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
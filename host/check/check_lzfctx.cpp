@@ -0,0 +1,153 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The hash table modes of lzf_ctx.h: random, biased and repetitive inputs
+* of random length go through one LZF_CTX_TAGGED and one LZF_CTX_CLEAR
+* context per table size, kept across calls, and both must write what
+* lzf_compress_hlog writes from a zeroed table, byte for byte, and screen
+* as lzf_screen_hlog does. Now and then a tagged context is set up again,
+* used once, and its generation moved up to the wrap, so slots left by
+* generation 1 are still in the table when the counter comes back to it.
+* A stale slot seldom changes the output (the current call has usually
+* stored a nearer position of the same bytes), so the table is read back
+* too: every slot tagged with the generation of a call must point into
+* the input of that call.
+*/
+
+#include "check.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "lzfP.h"
+#include "lzf_ctx.h"
+}
+
+#define LZFCTX_HLOGS            4
+
+static const unsigned int hlogs[LZFCTX_HLOGS] = { LZF_CTX_HLOG_MIN, 8, 12, 14 };
+
+/*Slots tagged with the generation of the last call must point into its len bytes*/
+static int check_slots(uint64_t iter, const lzf_ctx *tagged, size_t len)
+{
+    const LZF_TSLOT *slots = (const LZF_TSLOT *)tagged->htab;
+    for (size_t i = 0; i < (size_t)1 << tagged->hlog; i++)
+    {
+        if (slots[i].gen == tagged->gen && slots[i].off >= len)
+        {
+            return check_fail("lzfctx", "case %llu: hlog %u slot %zu of generation %u points to %u of %zu bytes",
+                              (unsigned long long)iter, tagged->hlog, i, tagged->gen, slots[i].off, len);
+        }
+    }
+    return 0;
+}
+
+/*Compress and screen in through both contexts and a zeroed table, returns the failures*/
+static int check_case(uint64_t iter, const uint8_t *in, size_t len, unsigned int out_len,
+                      lzf_ctx *tagged, lzf_ctx *clear, std::vector<uint8_t> &fresh)
+{
+    std::vector<uint8_t> ref(out_len + 1), out(out_len + 1);
+    lzf_screen_stats want, got;
+    int failures = 0;
+
+    memset(&fresh[0], 0, fresh.size());
+    unsigned int want_len = lzf_compress_hlog(in, (unsigned int)len, &ref[0], out_len, &fresh[0], tagged->hlog);
+    memset(&fresh[0], 0, fresh.size());
+    int want_fit = lzf_screen_hlog(in, (unsigned int)len, out_len, &want, &fresh[0], tagged->hlog);
+
+    lzf_ctx *ctx[2] = { tagged, clear };
+    for (int c = 0; c < 2; c++)
+    {
+        unsigned int res = lzf_ctx_compress(ctx[c], in, (unsigned int)len, &out[0], out_len);
+        if (res != want_len || memcmp(&out[0], &ref[0], res) != 0)
+        {
+            failures += check_fail("lzfctx", "case %llu: %s hlog %u generation %u put %zu bytes into %u, got %u, "
+                                   "zeroed table %u", (unsigned long long)iter, c == 0 ? "tagged" : "clear",
+                                   ctx[c]->hlog, ctx[c]->gen, len, out_len, res, want_len);
+        }
+
+        failures += c == 0 ? check_slots(iter, tagged, len) : 0;
+
+        int fit = lzf_ctx_screen(ctx[c], in, (unsigned int)len, out_len, &got);
+        if (fit != want_fit || memcmp(&got, &want, sizeof(got)) != 0)
+        {
+            failures += check_fail("lzfctx", "case %llu: %s hlog %u screened %zu bytes into %u to %d, bound %u, "
+                                   "zeroed table %d, bound %u", (unsigned long long)iter, c == 0 ? "tagged" : "clear",
+                                   ctx[c]->hlog, len, out_len, fit, got.bound, want_fit, want.bound);
+        }
+        failures += c == 0 ? check_slots(iter, tagged, len) : 0;
+    }
+    return failures;
+}
+
+int check_lzfctx(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = 0;
+    unsigned int wraps = 0;
+
+    std::vector<std::vector<uint8_t> > tagged_arena(LZFCTX_HLOGS), clear_arena(LZFCTX_HLOGS);
+    lzf_ctx tagged[LZFCTX_HLOGS], clear[LZFCTX_HLOGS];
+    for (int h = 0; h < LZFCTX_HLOGS; h++)
+    {
+        tagged_arena[h].resize(lzf_ctx_state_size_mode(hlogs[h], LZF_CTX_TAGGED));
+        clear_arena[h].resize(lzf_ctx_state_size_mode(hlogs[h], LZF_CTX_CLEAR));
+        if (lzf_ctx_init_mode(&tagged[h], hlogs[h], LZF_CTX_TAGGED, &tagged_arena[h][0], tagged_arena[h].size()) != 0 ||
+            lzf_ctx_init_mode(&clear[h], hlogs[h], LZF_CTX_CLEAR, &clear_arena[h][0], clear_arena[h].size()) != 0)
+        {
+            return check_fail("lzfctx", "cannot set up hlog %u", hlogs[h]);
+        }
+    }
+    std::vector<uint8_t> fresh(lzf_ctx_state_size(hlogs[LZFCTX_HLOGS - 1]));
+    std::vector<uint8_t> fill(8192), fill_out(LZF_COMPRESS_BOUND(fill.size()));
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        int h = (int)(check_rng_next(&rng) % LZFCTX_HLOGS);
+        size_t len = check_rng_len(&rng, 6000);
+        std::vector<uint8_t> in(len + 1);
+        check_rng_fill(&rng, &in[0], len, (int)(check_rng_next(&rng) % CHECK_FILL_KINDS));
+        unsigned int out_len = check_rng_next(&rng) % 2 ? LZF_COMPRESS_BOUND(len) : (unsigned int)(len * (50 + check_rng_next(&rng) % 51) / 100);
+
+        /*Generation 1 fills the table from an input longer than any case, the next calls run up to
+          the wrap and back to 1*/
+        if (check_rng_next(&rng) % 16 == 0)
+        {
+            check_rng_fill(&rng, &fill[0], fill.size(), CHECK_FILL_RANDOM);
+            lzf_ctx_init_mode(&tagged[h], hlogs[h], LZF_CTX_TAGGED, &tagged_arena[h][0], tagged_arena[h].size());
+            lzf_ctx_compress(&tagged[h], &fill[0], (unsigned int)fill.size(), &fill_out[0], (unsigned int)fill_out.size());
+            tagged[h].gen = UINT_MAX - check_rng_next(&rng) % 4;
+        }
+
+        unsigned int gen = tagged[h].gen;
+        failures += check_case(iter, &in[0], len, out_len, &tagged[h], &clear[h], fresh);
+        wraps += tagged[h].gen < gen;
+    }
+
+    failures += lzf_ctx_state_size_mode(LZF_CTX_HLOG_MIN - 1, LZF_CTX_TAGGED) != 0 ||
+                lzf_ctx_state_size_mode(LZF_CTX_HLOG_MAX + 1, LZF_CTX_CLEAR) != 0 ||
+                lzf_ctx_state_size_mode(LZF_CTX_HLOG_MIN, 3) != 0 ||
+                lzf_ctx_init_mode(&tagged[0], hlogs[0], LZF_CTX_TAGGED, &tagged_arena[0][0], tagged_arena[0].size() - 1) != -1
+                ? check_fail("lzfctx", "out of range table sizes and modes are not refused") : 0;
+    printf("lzfctx: %llu cases, %u generation wraps\n", (unsigned long long)iterations, wraps);
+    return failures;
+}
@@ -0,0 +1,131 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The match extension kernels of lzf_match.h: every kernel built in gets
+* matches of random offset (overlapping ones included), length and maxlen,
+* maxlen drawn around the 3, 16 to 19, vector width and longest match
+* edges and the match ending before, at and past the limit, and must
+* return what a byte loop over the rule of lzf_match.h returns. The input
+* ends right at the limit in a buffer of its own, so a kernel reading past
+* it trips the address sanitizer (make ... OPT="-O1 -fsanitize=address").
+*/
+
+#include "check.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "lzf_match.h"
+}
+
+#define MATCH_MAX_REF           ((1 << 8) + (1 << 3))
+
+typedef unsigned int (*match_kernel)(const unsigned char *ref, const unsigned char *ip, unsigned int maxlen);
+
+static const struct {
+    const char *name;
+    match_kernel kernel;
+} kernels[] = {
+    { "unrolled", lzf_match_len_unrolled },
+#if LZF_MATCH_HAVE_WORD
+    { "word",     lzf_match_len_word },
+#endif
+#if LZF_MATCH_HAVE_SSE2
+    { "sse2",     lzf_match_len_sse2 },
+#endif
+#if LZF_MATCH_HAVE_AVX2
+    { "avx2",     lzf_match_len_avx2 },
+#endif
+#if LZF_MATCH_HAVE_NEON
+    { "neon",     lzf_match_len_neon },
+#endif
+};
+
+/*The first k >= 3 with ref[k] != ip[k], no more than the limit of maxlen*/
+static unsigned int match_len_bytes(const uint8_t *ref, const uint8_t *ip, unsigned int maxlen)
+{
+    unsigned int limit = maxlen > 16 ? (maxlen > 19 ? maxlen : 19) : (maxlen > 3 ? maxlen : 3);
+    unsigned int k = 3;
+    while (k < limit && ref[k] == ip[k])
+    {
+        k++;
+    }
+    return k;
+}
+
+/*Half of the time within 2 of an edge of the kernels, the rest anywhere up to the longest match*/
+static unsigned int draw_maxlen(check_rng *rng)
+{
+    static const int edges[] = { 1, 3, 16, 19, 32, 35, MATCH_MAX_REF };
+    uint32_t r = check_rng_next(rng);
+    if (r % 2 == 0)
+    {
+        int maxlen = edges[r / 2 % (sizeof(edges) / sizeof(edges[0]))] + (int)(r / 64 % 5) - 2;
+        return maxlen < 1 ? 1 : maxlen > MATCH_MAX_REF ? MATCH_MAX_REF : (unsigned int)maxlen;
+    }
+    return 1 + r / 2 % MATCH_MAX_REF;
+}
+
+int check_lzfmatch(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200) * 50;
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = 0;
+    size_t nkernels = sizeof(kernels) / sizeof(kernels[0]);
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        unsigned int maxlen = draw_maxlen(&rng);
+        unsigned int limit = lzf_match_limit(maxlen);
+        unsigned int off = 1 + (unsigned int)check_rng_len(&rng, 1024);
+        size_t pos = off + check_rng_next(&rng) % 16;
+
+        /*Matches of 3 bytes to past the limit, copied forward so the short offsets repeat*/
+        std::vector<uint8_t> data(pos + limit);
+        for (size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = (uint8_t)check_rng_next(&rng);
+        }
+        unsigned int want = 3 + check_rng_next(&rng) % (limit + 4);
+        for (size_t k = 0; k < limit && k < want; k++)
+        {
+            data[pos + k] = data[pos - off + k];
+        }
+        if (want < limit)
+        {
+            data[pos + want] = (uint8_t)(data[pos - off + want] + 1 + check_rng_next(&rng) % 255);
+        }
+
+        const uint8_t *ip = &data[pos], *ref = ip - off;
+        unsigned int expected = match_len_bytes(ref, ip, maxlen);
+        for (size_t k = 0; k < nkernels; k++)
+        {
+            unsigned int got = kernels[k].kernel(ref, ip, maxlen);
+            if (got != expected)
+            {
+                failures += check_fail("lzfmatch", "case %llu: %s extended a match at offset %u with maxlen %u to %u, "
+                                       "not %u", (unsigned long long)iter, kernels[k].name, off, maxlen, got, expected);
+            }
+        }
+    }
+
+    printf("lzfmatch: %llu cases, %zu kernels\n", (unsigned long long)iterations, nkernels);
+    return failures;
+}
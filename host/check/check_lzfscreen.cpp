@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Screening against compressing: random, biased and repetitive inputs of
+* random length, mostly with out_len close to what they compress to, are
+* screened with lzf_ctx_screen and compressed with lzf_ctx_compress from
+* cleared tables. The verdict must be the compressor's. A chunk that fits
+* must compress into no more than the bound, which is exact when the
+* whole input was scanned, and stays below out_len when the search
+* stopped early. The stats must add up: literals and match bytes cover
+* the bytes scanned. trng_core_screen must give the same bound.
+*/
+
+#include "check.h"
+#include "trng_core.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+int check_lzfscreen(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = 0;
+    unsigned int early = 0, fits = 0;
+
+    unsigned int hlog = 13;
+    std::vector<uint8_t> screen_arena(lzf_ctx_state_size_mode(hlog, LZF_CTX_CLEAR));
+    std::vector<uint8_t> comp_arena(lzf_ctx_state_size_mode(hlog, LZF_CTX_CLEAR));
+    lzf_ctx screen_ctx, comp_ctx;
+    lzf_ctx_init_mode(&screen_ctx, hlog, LZF_CTX_CLEAR, &screen_arena[0], screen_arena.size());
+    lzf_ctx_init_mode(&comp_ctx, hlog, LZF_CTX_CLEAR, &comp_arena[0], comp_arena.size());
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        size_t len = check_rng_len(&rng, 6000);
+        std::vector<uint8_t> in(len + 1), out(LZF_COMPRESS_BOUND(len) + 1);
+        check_rng_fill(&rng, &in[0], len, (int)(check_rng_next(&rng) % CHECK_FILL_KINDS));
+
+        /*Mostly within a few bytes of the compressed size, where the verdict turns*/
+        unsigned int full = lzf_ctx_compress(&comp_ctx, &in[0], (unsigned int)len, &out[0], (unsigned int)out.size() - 1);
+        unsigned int out_len = check_rng_next(&rng) % 4 != 0 ? full + 8 - check_rng_next(&rng) % 17
+                                                             : (unsigned int)(len * (check_rng_next(&rng) % 120) / 100);
+        out_len = out_len > LZF_COMPRESS_BOUND(len) ? (unsigned int)LZF_COMPRESS_BOUND(len) : out_len;
+
+        lzf_screen_stats stats;
+        int fit = lzf_ctx_screen(&screen_ctx, &in[0], (unsigned int)len, out_len, &stats);
+        unsigned int comp = lzf_ctx_compress(&comp_ctx, &in[0], (unsigned int)len, &out[0], out_len);
+        bool whole = stats.scanned == len;
+        early += !whole;
+        fits += fit;
+
+        if (fit != (comp != 0) || (fit && (comp > stats.bound || (whole ? stats.bound != comp : stats.bound >= out_len))) ||
+            (!fit && stats.bound != 0) || stats.scanned > len || stats.literals + stats.match_bytes != stats.scanned)
+        {
+            failures += check_fail("lzfscreen", "case %llu: %zu bytes into %u screened to %d, bound %u, %u of them "
+                                   "scanned, %u literals, %u match bytes, compressed to %u", (unsigned long long)iter,
+                                   len, out_len, fit, stats.bound, stats.scanned, stats.literals, stats.match_bytes, comp);
+        }
+
+        unsigned int bound = trng_core_screen(&in[0], (unsigned int)len, out_len, &screen_ctx, NULL);
+        if (bound != stats.bound)
+        {
+            failures += check_fail("lzfscreen", "case %llu: trng_core_screen gave %u, lzf_ctx_screen %u",
+                                   (unsigned long long)iter, bound, stats.bound);
+        }
+    }
+
+    printf("lzfscreen: %llu cases, %u fit, %u stopped early\n", (unsigned long long)iterations, fits, early);
+    return failures;
+}
@@ -0,0 +1,193 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The streaming compressor: random, biased and repetitive chunks of random
+* length, some of them copies of recent ones, go through a stream with
+* random table and ring sizes. Every chunk must come back out of a decoder
+* fed the same way, the size without output must equal the size written and
+* a chunk must be refused exactly when that size is over out_len. A copy of
+* a random chunk still in the ring must shrink to a few references.
+* Damaged output must be refused or decode within the buffer.
+*/
+
+#include "check.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "lzf.h"
+#include "lzf_ctx.h"
+#include "lzf_stream.h"
+}
+
+static int check_round_trip(check_rng *rng, uint64_t iterations)
+{
+    int failures = 0;
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        unsigned int hlog = 6 + check_rng_next(rng) % 9;
+        unsigned int wlog = LZF_STREAM_WLOG_MIN + check_rng_next(rng) % (LZF_STREAM_WLOG_MAX - LZF_STREAM_WLOG_MIN + 1);
+        unsigned int dec_wlog = wlog + check_rng_next(rng) % (LZF_STREAM_WLOG_MAX - wlog + 1);
+        std::vector<unsigned int> arena(3 * LZF_STREAM_STATE_SIZE(hlog, wlog) / sizeof(unsigned int));
+        std::vector<uint8_t> dec_arena(LZF_STREAM_DECODER_SIZE(dec_wlog));
+        size_t part = LZF_STREAM_STATE_SIZE(hlog, wlog) / sizeof(unsigned int);
+
+        /*The same stream three times: with output, size only and without a limit*/
+        lzf_stream s, sized, full;
+        lzf_stream_decoder d;
+        lzf_stream_init(&s, hlog, wlog, &arena[0], part * sizeof(unsigned int));
+        lzf_stream_init(&sized, hlog, wlog, &arena[part], part * sizeof(unsigned int));
+        lzf_stream_init(&full, hlog, wlog, &arena[2 * part], part * sizeof(unsigned int));
+        lzf_stream_decoder_init(&d, dec_wlog, &dec_arena[0], dec_arena.size());
+
+        std::vector<uint8_t> history;
+        unsigned int chunks = 1 + check_rng_next(rng) % 40;
+        for (unsigned int c = 0; c < chunks && failures < 16; c++)
+        {
+            size_t len = check_rng_len(rng, 3000);
+            std::vector<uint8_t> chunk(len + 1);
+            size_t back = history.empty() ? 0 : 1 + check_rng_next(rng) % history.size();
+            if (check_rng_next(rng) % 4 == 0 && back != 0 && back >= len)
+            {
+                memcpy(&chunk[0], &history[history.size() - back], len);
+            }
+            else
+            {
+                check_rng_fill(rng, &chunk[0], len, (int)(check_rng_next(rng) % CHECK_FILL_KINDS));
+            }
+
+            unsigned int out_len = check_rng_next(rng) % 2 ? LZF_COMPRESS_BOUND(len) : (unsigned int)(len * (90 + check_rng_next(rng) % 11) / 100);
+            std::vector<uint8_t> out(LZF_COMPRESS_BOUND(len) + 1), back_out(len + 1);
+            unsigned int res = lzf_stream_compress(&s, &chunk[0], (unsigned int)len, &out[0], out_len);
+            unsigned int res_sized = lzf_stream_compress(&sized, &chunk[0], (unsigned int)len, NULL, out_len);
+            unsigned int res_full = lzf_stream_compress(&full, &chunk[0], (unsigned int)len, NULL, 0xffffffffU);
+
+            bool refused = len != 0 && res_full > out_len;
+            if (res != res_sized || (res == 0) != (refused || len == 0) || (res != 0 && res != res_full) ||
+                res_full > LZF_COMPRESS_BOUND(len))
+            {
+                failures += check_fail("lzfstream", "case %llu chunk %u: %zu bytes into %u: %u written, %u sized, %u in full",
+                                       (unsigned long long)iter, c, len, out_len, res, res_sized, res_full);
+                break;
+            }
+
+            if (res != 0)
+            {
+                unsigned int got = lzf_stream_decompress(&d, &out[0], res, &back_out[0], (unsigned int)len);
+                if (got != len || memcmp(&back_out[0], &chunk[0], len) != 0)
+                {
+                    failures += check_fail("lzfstream", "case %llu chunk %u: %zu bytes decompressed to %u",
+                                           (unsigned long long)iter, c, len, got);
+                    break;
+                }
+                /*The first chunk has nothing to refer back to, it is plain lzf*/
+                if (c == 0 && lzf_decompress(&out[0], res, &back_out[0], (unsigned int)len) != len)
+                {
+                    failures += check_fail("lzfstream", "case %llu: first chunk is not plain lzf", (unsigned long long)iter);
+                }
+            }
+            else
+            {
+                lzf_stream_decoder_take(&d, &chunk[0], (unsigned int)len);
+            }
+            history.insert(history.end(), chunk.begin(), chunk.begin() + len);
+        }
+    }
+    return failures;
+}
+
+/*A random chunk again after random ones, all within the ring, on a table of 16K slots*/
+static int check_repeat(check_rng *rng, uint64_t iterations)
+{
+    int failures = 0;
+    std::vector<unsigned int> arena(LZF_STREAM_STATE_SIZE(14, 13) / sizeof(unsigned int));
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        lzf_stream s;
+        lzf_stream_init(&s, 14, 13, &arena[0], arena.size() * sizeof(unsigned int));
+        std::vector<uint8_t> chunk(64 + check_rng_next(rng) % 4000), filler(check_rng_next(rng) % (8192 - chunk.size()));
+        check_rng_fill(rng, &chunk[0], chunk.size(), CHECK_FILL_RANDOM);
+        check_rng_fill(rng, filler.empty() ? NULL : &filler[0], filler.size(), CHECK_FILL_RANDOM);
+
+        lzf_stream_compress(&s, &chunk[0], (unsigned int)chunk.size(), NULL, 0);
+        for (size_t pos = 0; pos < filler.size();)
+        {
+            size_t n = 1 + check_rng_next(rng) % 1000;
+            n = n < filler.size() - pos ? n : filler.size() - pos;
+            lzf_stream_compress(&s, &filler[pos], (unsigned int)n, NULL, 0);
+            pos += n;
+        }
+        unsigned int res = lzf_stream_compress(&s, &chunk[0], (unsigned int)chunk.size(), NULL, 0xffffffffU);
+        if (res > chunk.size() / 8 + 4)
+        {
+            failures += check_fail("lzfstream", "repeat case %llu: %zu bytes again after %zu took %u",
+                                   (unsigned long long)iter, chunk.size(), filler.size(), res);
+        }
+    }
+    return failures;
+}
+
+static int check_damage(check_rng *rng, uint64_t iterations)
+{
+    int failures = 0;
+    std::vector<unsigned int> arena(LZF_STREAM_STATE_SIZE(10, 13) / sizeof(unsigned int));
+    std::vector<uint8_t> dec_arena(LZF_STREAM_DECODER_SIZE(13));
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        lzf_stream s;
+        lzf_stream_decoder d;
+        lzf_stream_init(&s, 10, 13, &arena[0], arena.size() * sizeof(unsigned int));
+        lzf_stream_decoder_init(&d, 13, &dec_arena[0], dec_arena.size());
+
+        std::vector<uint8_t> chunk(1 + check_rng_next(rng) % 2000), out(LZF_COMPRESS_BOUND(chunk.size()));
+        check_rng_fill(rng, &chunk[0], chunk.size(), CHECK_FILL_PERIODIC);
+        lzf_stream_decoder_take(&d, &chunk[0], (unsigned int)chunk.size());
+        lzf_stream_compress(&s, &chunk[0], (unsigned int)chunk.size(), NULL, 0);
+        check_rng_fill(rng, &chunk[0], chunk.size(), CHECK_FILL_PERIODIC);
+        unsigned int res = lzf_stream_compress(&s, &chunk[0], (unsigned int)chunk.size(), &out[0], (unsigned int)out.size());
+
+        /*Flipped and cut output, decoded into a buffer that ends where the chunk does*/
+        for (int flips = 1 + check_rng_next(rng) % 4; flips > 0 && res != 0; flips--)
+        {
+            out[check_rng_next(rng) % res] ^= (uint8_t)(1 + check_rng_next(rng) % 255);
+        }
+        res = check_rng_next(rng) % 4 == 0 && res != 0 ? check_rng_next(rng) % res : res;
+        std::vector<uint8_t> back(chunk.size());
+        unsigned int got = lzf_stream_decompress(&d, &out[0], res, &back[0], (unsigned int)back.size());
+        failures += got > back.size() ? check_fail("lzfstream", "damage case %llu: decoded %u into %zu", (unsigned long long)iter,
+                                                   got, back.size()) : 0;
+    }
+    return failures;
+}
+
+int check_lzfstream(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+
+    int failures = check_round_trip(&rng, iterations);
+    failures += check_repeat(&rng, iterations);
+    failures += check_damage(&rng, iterations);
+    printf("lzfstream: %llu cases\n", (unsigned long long)iterations * 3);
+    return failures;
+}
@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The compressor variants of trng_lzf.h: random, biased and repetitive
+* inputs of random length go through every variant, one table per variant
+* kept across calls. Output must fit out_len and come back through
+* lzf_decompress. The default variant must write what lzf_compress writes,
+* byte for byte, when both start from a cleared table.
+*/
+
+#include "check.h"
+#include "trng_lzf.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "lzf.h"
+#include "lzfP.h"
+#include "lzf_ctx.h"
+}
+
+int check_lzfvariant(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = 0;
+
+    std::vector<std::vector<uint32_t> > tables(TRNG_LZF_VARIANTS);
+    for (int id = 0; id < TRNG_LZF_VARIANTS; id++)
+    {
+        tables[id].assign(trng_lzf_variant_info(id)->state_size / sizeof(uint32_t), 0);
+    }
+    std::vector<uint32_t> fresh(trng_lzf_variant_info(TRNG_LZF_DEFAULT)->state_size / sizeof(uint32_t));
+    LZF_STATE htab;
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        size_t len = check_rng_len(&rng, 6000);
+        std::vector<uint8_t> in(len + 1), out(LZF_COMPRESS_BOUND(len) + 1), ref(LZF_COMPRESS_BOUND(len) + 1), back(len + 1);
+        check_rng_fill(&rng, &in[0], len, (int)(check_rng_next(&rng) % CHECK_FILL_KINDS));
+        unsigned int out_len = check_rng_next(&rng) % 2 ? LZF_COMPRESS_BOUND(len) : (unsigned int)(len * (50 + check_rng_next(&rng) % 51) / 100);
+
+        for (int id = 0; id < TRNG_LZF_VARIANTS; id++)
+        {
+            unsigned int res = trng_lzf_compress(id, &in[0], (unsigned int)len, &out[0], out_len, &tables[id][0]);
+            if (res > out_len || (res == 0 && len != 0 && out_len == LZF_COMPRESS_BOUND(len)) ||
+                (res != 0 && (lzf_decompress(&out[0], res, &back[0], (unsigned int)len) != len ||
+                              memcmp(&back[0], &in[0], len) != 0)))
+            {
+                failures += check_fail("lzfvariant", "case %llu: %s put %zu bytes into %u, got %u",
+                                       (unsigned long long)iter, trng_lzf_variant_info(id)->name, len, out_len, res);
+            }
+        }
+
+        memset(htab, 0, sizeof(htab));
+        memset(&fresh[0], 0, fresh.size() * sizeof(uint32_t));
+        unsigned int want = lzf_compress(&in[0], (unsigned int)len, &ref[0], out_len, (unsigned char **)htab);
+        unsigned int res = trng_lzf_compress(TRNG_LZF_DEFAULT, &in[0], (unsigned int)len, &out[0], out_len, &fresh[0]);
+        if (res != want || memcmp(&out[0], &ref[0], res) != 0)
+        {
+            failures += check_fail("lzfvariant", "case %llu: default put %zu bytes into %u, lzf_compress %u",
+                                   (unsigned long long)iter, len, res, want);
+        }
+    }
+
+    failures += trng_lzf_compress(TRNG_LZF_VARIANTS, NULL, 0, NULL, 0, NULL) != 0 ||
+                trng_lzf_variant_find("ratio") != TRNG_LZF_RATIO || trng_lzf_variant_find("none") != -1
+                ? check_fail("lzfvariant", "unknown variants are not refused") : 0;
+    printf("lzfvariant: %llu cases, %d variants\n", (unsigned long long)iterations, TRNG_LZF_VARIANTS);
+    return failures;
+}
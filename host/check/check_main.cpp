@@ -0,0 +1,129 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "check.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+struct check_suite {
+    const char *name;
+    const char *help;
+    int (*run)(int argc, char **argv);
+};
+
+static const check_suite suites[] = {
+    { "lzfctx",   "tagged and cleared tables across calls and wraps against a zeroed table", check_lzfctx },
+    { "lzfmatch", "match extension kernels at the edges of maxlen against a byte loop", check_lzfmatch },
+    { "lzfscreen", "screening verdicts, bounds and stats against compressing near the threshold", check_lzfscreen },
+    { "base64", "encode/decode into caller buffers against base64_encode and b64decode", check_base64 },
+    { "nist",   "SP 800-22 battery in random slices against a bit at a time reference", check_nist },
+    { "entropy", "SP 800-90B estimators against the quadratic algorithms of the standard", check_entropy },
+    { "health",  "SP 800-90B health tests in random slices against a recounting model", check_health },
+    { "pool",    "entropy pool with random refills and reads, and from several threads", check_pool },
+    { "drbg",    "CTR_DRBG and HMAC_DRBG against SP 800-90A, reseeding and output screening", check_drbg },
+    { "parallel", "qualification pipeline and stats merging against a serial pass", check_parallel },
+    { "fingerprint", "fingerprint index of previous boots against the set of windows recorded", check_fingerprint },
+    { "snapshot", "snapshot ring through resets and damaged records against the records appended", check_snapshot },
+    { "link",     "framed transport over a lossy loopback against the data written", check_link },
+    { "capture",  "capture server fed through pipes and pseudo terminals against the data sent", check_capture },
+    { "lzfstream", "streaming lzf through random chunks against a decoder and the size alone", check_lzfstream },
+    { "lzfvariant", "compressor variants round tripped, the default one against lzf_compress", check_lzfvariant },
+    { "model",    "entropy coding estimators and rANS against direct pricing and round trips", check_model },
+    { "trace",    "trace counters of several threads, buckets, records and the reads of a fill", check_trace },
+    { "async",    "asynchronous requests in order, batched, from several threads and failing", check_async },
+};
+
+void check_rng_seed(check_rng *rng, uint64_t seed)
+{
+    rng->state = seed ? seed : 0x9e3779b97f4a7c15ull;
+}
+
+uint32_t check_rng_next(check_rng *rng)
+{
+    /*xorshift64*/
+    rng->state ^= rng->state << 13;
+    rng->state ^= rng->state >> 7;
+    rng->state ^= rng->state << 17;
+    return (uint32_t)(rng->state >> 32);
+}
+
+void check_rng_fill(check_rng *rng, uint8_t *data, size_t len, int kind)
+{
+    uint32_t period = 1 + check_rng_next(rng) % 300;
+    for (size_t i = 0; i < len; i++)
+    {
+        uint32_t r = check_rng_next(rng);
+        data[i] = kind == CHECK_FILL_RANDOM ? (uint8_t)r :
+                  kind == CHECK_FILL_BIASED ? (uint8_t)(r & r >> 8 & r >> 16) :
+                  (uint8_t)(i % period * 7 + (r % 64 == 0));
+    }
+}
+
+size_t check_rng_len(check_rng *rng, size_t max)
+{
+    return check_rng_next(rng) % 4 == 0 ? check_rng_next(rng) % 8 : check_rng_next(rng) % max;
+}
+
+int check_fail(const char *suite, const char *fmt, ...)
+{
+    va_list ap;
+    fprintf(stderr, "%s: ", suite);
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fprintf(stderr, "\n");
+    return 1;
+}
+
+static void usage(const char *prog)
+{
+    printf("usage: %s <suite|all> [--seed N] [--iterations N] [suite options]\n", prog);
+    for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++)
+    {
+        printf("  %-10s %s\n", suites[i].name, suites[i].help);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    bool all = strcmp(argv[1], "all") == 0;
+    bool found = false;
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(suites) / sizeof(suites[0]); i++)
+    {
+        if (all || strcmp(argv[1], suites[i].name) == 0)
+        {
+            found = true;
+            int res = suites[i].run(argc, argv);
+            printf("%-10s %s\n", suites[i].name, res == 0 ? "ok" : "FAILED");
+            failures += res;
+        }
+    }
+    if (!found)
+    {
+        usage(argv[0]);
+        return 2;
+    }
+    return failures != 0 ? 1 : 0;
+}
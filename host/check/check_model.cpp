@@ -0,0 +1,166 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The entropy coding estimators of trng_model.h: the histogram against a
+* byte by byte count, the order-0 price against the Krichevsky-Trofimov
+* probabilities multiplied out byte by byte, the context model against the
+* same model priced in floating point, and the rANS coder through round
+* trips, against the entropy of the frequencies it coded with and through
+* damaged input. Inputs are random, biased and repetitive.
+*/
+
+#include "check.h"
+#include "trng_model.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+/*TRNG_MODEL_ORDERK with the cost of every bit taken by log2*/
+static double orderk_bits(const uint8_t *in, size_t len, unsigned int order, unsigned int hlog)
+{
+    static const double one = 65536.0;
+    std::vector<uint32_t> p(1U << hlog, 32768), n(1U << hlog, 0);
+    uint32_t mask = order >= 4 ? 0xffffffffU : (1U << (8 * order)) - 1, history = 0;
+    double bits = 0;
+
+    for (size_t i = 0; i < len; i++)
+    {
+        uint32_t base = hlog > 8 ? (((history & mask) * 0x9e3779b1U) >> (32 - (hlog - 8))) << 8 : 0;
+        uint32_t node = 1;
+        for (int b = 7; b >= 0; b--)
+        {
+            uint32_t bit = (in[i] >> b) & 1, k = base | node;
+            uint32_t rate = (uint32_t)(65536.0 / (n[k] + 1.5) + 0.5);
+            bits -= log2((bit ? p[k] : one - p[k]) / one);
+            p[k] = bit ? p[k] + (((65535 - p[k]) * rate) >> 16) : p[k] - ((p[k] * rate) >> 16);
+            n[k] += n[k] < 127;
+            node = node * 2 + bit;
+        }
+        history = (history << 8) | in[i];
+    }
+    return bits;
+}
+
+int check_model(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = 0;
+    std::vector<uint32_t> arena(trng_model_state_size(TRNG_MODEL_ORDERK, 16, 0) / sizeof(uint32_t));
+    std::vector<uint32_t> lanes(4 * 256);
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        size_t len = check_rng_next(&rng) % 4 == 0 ? check_rng_next(&rng) % 16 : check_rng_next(&rng) % 6000;
+        std::vector<uint8_t> in(len + 1), out(TRNG_RANS_BOUND(len)), back(len + 1);
+        check_rng_fill(&rng, &in[0], len, (int)(check_rng_next(&rng) % CHECK_FILL_KINDS));
+
+        uint32_t hist[256], count[256] = {0};
+        trng_model_histogram(&in[0], len, &lanes[0], hist);
+        for (size_t i = 0; i < len; i++)
+        {
+            count[in[i]]++;
+        }
+        if (memcmp(hist, count, sizeof(hist)) != 0)
+        {
+            failures += check_fail("model", "case %llu: histogram of %zu bytes", (unsigned long long)iter, len);
+        }
+
+        /*Every byte priced with the counts of the bytes before it*/
+        double kt = 0;
+        uint32_t seen[256] = {0};
+        for (size_t i = 0; i < len; i++)
+        {
+            kt -= log2((seen[in[i]] + 0.5) / (i + 128.0));
+            seen[in[i]]++;
+        }
+        double order0 = trng_model_order0_bits(hist, len);
+        if (fabs(order0 - kt) > 1e-6 * kt + 1e-6)
+        {
+            failures += check_fail("model", "case %llu: order-0 price %.3f bits, byte by byte %.3f",
+                                   (unsigned long long)iter, order0, kt);
+        }
+
+        /*The context model, its threshold taken exactly at the estimate and a byte below. The table
+          of log2 is off by up to 0.0005 bits a bit, len / 2000 bytes in all*/
+        trng_model model;
+        unsigned int order = check_rng_next(&rng) % (TRNG_MODEL_ORDER_MAX + 1);
+        unsigned int hlog = TRNG_MODEL_HLOG_MIN + check_rng_next(&rng) % 9;
+        trng_model_init(&model, TRNG_MODEL_ORDERK, order, hlog, 0, &arena[0], arena.size() * sizeof(uint32_t));
+        double ref = orderk_bits(&in[0], len, order, hlog);
+        unsigned int est = trng_model_screen(&model, &in[0], (unsigned int)len, 0xffffffffU);
+        if (len != 0 && (fabs(est - TRNG_MODEL_FLUSH - ref / 8) > 1e-3 * ref / 8 + len / 2000.0 + 1 ||
+                         trng_model_screen(&model, &in[0], (unsigned int)len, est) != est ||
+                         trng_model_screen(&model, &in[0], (unsigned int)len, est - 1) != 0))
+        {
+            failures += check_fail("model", "case %llu: order %u hlog %u estimate %u for %.1f bits",
+                                   (unsigned long long)iter, order, hlog, est, ref);
+        }
+
+        /*rANS, in full and into a random part of its output*/
+        unsigned int res = trng_rans_encode(&in[0], (unsigned int)len, &out[0], (unsigned int)out.size());
+        if (len != 0 && (res == 0 || trng_rans_decode(&out[0], res, &back[0], (unsigned int)len) != len ||
+                         memcmp(&back[0], &in[0], len) != 0))
+        {
+            failures += check_fail("model", "case %llu: rANS round trip of %zu bytes, %u written", (unsigned long long)iter, len, res);
+            continue;
+        }
+        if (len != 0)
+        {
+            /*Within 0.1% and a few bytes of what the frequencies it coded with allow*/
+            unsigned int table = 32;
+            double payload = 0;
+            for (int s = 0; s < 256; s++)
+            {
+                if (out[s >> 3] >> (s & 7) & 1)
+                {
+                    uint32_t v = out[table++];
+                    v = v & 0x80 ? (v & 0x7f) | (uint32_t)out[table++] << 7 : v;
+                    payload += count[s] * log2(4096.0 / (v + 1));
+                }
+            }
+            if (res > table + payload / 8 * 1.001 + TRNG_MODEL_FLUSH + 2)
+            {
+                failures += check_fail("model", "case %llu: rANS wrote %u for %u of table and %.1f of payload",
+                                       (unsigned long long)iter, res, table, payload / 8);
+            }
+
+            unsigned int cut = check_rng_next(&rng) % (res + 1);
+            unsigned int part = trng_rans_encode(&in[0], (unsigned int)len, &out[0], cut);
+            if ((part != 0) != (cut >= res) || (part != 0 && part != res))
+            {
+                failures += check_fail("model", "case %llu: rANS into %u of %u gave %u", (unsigned long long)iter, cut, res, part);
+            }
+        }
+
+        /*Damaged output decodes to nothing or to the length asked for, within the buffer*/
+        res = trng_rans_encode(&in[0], (unsigned int)len, &out[0], (unsigned int)out.size());
+        for (int flips = 1 + check_rng_next(&rng) % 4; flips > 0 && res != 0; flips--)
+        {
+            out[check_rng_next(&rng) % res] ^= (uint8_t)(1 + check_rng_next(&rng) % 255);
+        }
+        res = check_rng_next(&rng) % 4 == 0 && res != 0 ? check_rng_next(&rng) % res : res;
+        unsigned int got = trng_rans_decode(&out[0], res, &back[0], (unsigned int)len);
+        failures += got != 0 && got != len ? check_fail("model", "case %llu: damaged rANS decoded to %u", (unsigned long long)iter, got) : 0;
+    }
+
+    printf("model: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
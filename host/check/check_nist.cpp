@@ -0,0 +1,371 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The SP 800-22 battery against a bit at a time reference written from the
+* text of the standard: every test is computed over a vector of bits (the
+* patterns of the serial and approximate entropy tests counted for every
+* order separately, the DFT by its definition), the same data is fed to
+* trng_nist_update in random slices and the p-values must agree. Data is
+* random, biased or made of short repeated runs with random configurations,
+* followed by the worked examples of the standard and identities of the
+* incomplete gamma function.
+*/
+
+#include "check.h"
+#include "trng_nist.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define P_TOLERANCE     1e-9
+
+typedef std::vector<uint8_t> bit_vector;
+
+static double normal_cdf(double x)
+{
+    return 0.5 * erfc(-x / sqrt(2.0));
+}
+
+static double cusum_p(double z, double n)
+{
+    double sum1 = 0.0, sum2 = 0.0;
+    long nz = (long)(n / z);
+    for (long k = (-nz + 1) / 4; k <= (nz - 1) / 4; k++)
+    {
+        sum1 += normal_cdf((4 * k + 1) * z / sqrt(n)) - normal_cdf((4 * k - 1) * z / sqrt(n));
+    }
+    for (long k = (-nz - 3) / 4; k <= (nz - 1) / 4; k++)
+    {
+        sum2 += normal_cdf((4 * k + 3) * z / sqrt(n)) - normal_cdf((4 * k + 1) * z / sqrt(n));
+    }
+    return 1.0 - sum1 + sum2;
+}
+
+/*Counts of the overlapping m bit patterns of the cyclic sequence*/
+static std::vector<double> pattern_counts(const bit_vector &e, unsigned int m)
+{
+    std::vector<double> counts((size_t)1 << m);
+    for (size_t i = 0; i < e.size(); i++)
+    {
+        size_t p = 0;
+        for (unsigned int j = 0; j < m; j++)
+        {
+            p = (p << 1) | e[(i + j) % e.size()];
+        }
+        counts[p] += 1.0;
+    }
+    return counts;
+}
+
+static double psi_sq(const bit_vector &e, unsigned int m)
+{
+    double n = (double)e.size(), sum = 0.0;
+    std::vector<double> counts = pattern_counts(e, m);
+    for (size_t p = 0; p < counts.size(); p++)
+    {
+        sum += counts[p] * counts[p];
+    }
+    return sum * ldexp(1.0, m) / n - n;
+}
+
+static double phi(const bit_vector &e, unsigned int m)
+{
+    double n = (double)e.size(), sum = 0.0;
+    std::vector<double> counts = pattern_counts(e, m);
+    for (size_t p = 0; p < counts.size(); p++)
+    {
+        if (counts[p] > 0.0)
+        {
+            sum += counts[p] / n * log(counts[p] / n);
+        }
+    }
+    return sum;
+}
+
+static void reference(const bit_vector &e, const trng_nist_config *cfg, trng_nist_result *res)
+{
+    double n = (double)e.size();
+
+    for (int i = 0; i < TRNG_NIST_TESTS; i++)
+    {
+        res->p[i] = -1.0;
+    }
+
+    if (e.size() >= 100)
+    {
+        double s = 0.0, ones = 0.0, v = 1.0;
+        double walk = 0.0, z_fwd = 0.0, z_bwd = 0.0;
+        for (size_t i = 0; i < e.size(); i++)
+        {
+            s += e[i] ? 1.0 : -1.0;
+            ones += e[i];
+            v += i + 1 < e.size() && e[i] != e[i + 1];
+            z_fwd = fabs(s) > z_fwd ? fabs(s) : z_fwd;
+        }
+        for (size_t i = e.size(); i-- > 0;)
+        {
+            walk += e[i] ? 1.0 : -1.0;
+            z_bwd = fabs(walk) > z_bwd ? fabs(walk) : z_bwd;
+        }
+
+        res->p[TRNG_NIST_MONOBIT] = erfc(fabs(s) / sqrt(n) / sqrt(2.0));
+        double pi = ones / n;
+        res->p[TRNG_NIST_RUNS] = fabs(pi - 0.5) >= 2.0 / sqrt(n) ? 0.0 :
+            erfc(fabs(v - 2.0 * n * pi * (1.0 - pi)) / (2.0 * sqrt(2.0 * n) * pi * (1.0 - pi)));
+        res->p[TRNG_NIST_CUSUM_FORWARD] = cusum_p(z_fwd, n);
+        res->p[TRNG_NIST_CUSUM_BACKWARD] = cusum_p(z_bwd, n);
+    }
+
+    size_t m = cfg->block_frequency_bits, blocks = e.size() / m;
+    if (blocks != 0)
+    {
+        double chi = 0.0;
+        for (size_t b = 0; b < blocks; b++)
+        {
+            double ones = 0.0;
+            for (size_t i = 0; i < m; i++)
+            {
+                ones += e[b * m + i];
+            }
+            chi += 4.0 * m * (ones / m - 0.5) * (ones / m - 0.5);
+        }
+        res->p[TRNG_NIST_BLOCK_FREQUENCY] = trng_nist_igamc(blocks / 2.0, chi / 2.0);
+    }
+
+    /*Longest run, SP 800-22 table of 2.4.2*/
+    static const double pi_8[] = { 0.2148, 0.3672, 0.2305, 0.1875 };
+    static const double pi_128[] = { 0.1174, 0.2430, 0.2493, 0.1752, 0.1027, 0.1124 };
+    static const double pi_10000[] = { 0.0882, 0.2092, 0.2483, 0.1933, 0.1208, 0.0675, 0.0727 };
+    m = cfg->longest_run_bits;
+    blocks = e.size() / m;
+    unsigned int classes = m == 8 ? 4 : m == 128 ? 6 : 7, low = m == 8 ? 1 : m == 128 ? 4 : 10;
+    const double *lr_pi = m == 8 ? pi_8 : m == 128 ? pi_128 : pi_10000;
+    if (blocks != 0)
+    {
+        std::vector<double> count(classes);
+        for (size_t b = 0; b < blocks; b++)
+        {
+            unsigned int run = 0, best = 0;
+            for (size_t i = 0; i < m; i++)
+            {
+                run = e[b * m + i] ? run + 1 : 0;
+                best = run > best ? run : best;
+            }
+            unsigned int c = best <= low ? 0 : best - low >= classes - 1 ? classes - 1 : best - low;
+            count[c] += 1.0;
+        }
+        double chi = 0.0;
+        for (unsigned int c = 0; c < classes; c++)
+        {
+            chi += (count[c] - blocks * lr_pi[c]) * (count[c] - blocks * lr_pi[c]) / (blocks * lr_pi[c]);
+        }
+        res->p[TRNG_NIST_LONGEST_RUN] = trng_nist_igamc((classes - 1) / 2.0, chi / 2.0);
+    }
+
+    unsigned int sm = cfg->serial_m, am = cfg->apen_m;
+    if (e.size() >= (sm > am + 1 ? sm : am + 1))
+    {
+        double d1 = psi_sq(e, sm) - psi_sq(e, sm - 1);
+        double d2 = psi_sq(e, sm) - 2.0 * psi_sq(e, sm - 1) + psi_sq(e, sm - 2);
+        res->p[TRNG_NIST_SERIAL_1] = trng_nist_igamc(ldexp(1.0, sm - 2), d1 / 2.0);
+        res->p[TRNG_NIST_SERIAL_2] = trng_nist_igamc(ldexp(1.0, (int)sm - 3), d2 / 2.0);
+        double apen = phi(e, am) - phi(e, am + 1);
+        res->p[TRNG_NIST_APPROXIMATE_ENTROPY] = trng_nist_igamc(ldexp(1.0, am - 1), n * (log(2.0) - apen));
+    }
+
+    /*DFT of every block by its definition, peaks of the first halves pooled*/
+    m = cfg->dft_block_bits;
+    blocks = m ? e.size() / m : 0;
+    if (blocks != 0)
+    {
+        double below = 0.0, threshold = sqrt(log(1.0 / 0.05) * m);
+        for (size_t b = 0; b < blocks; b++)
+        {
+            for (size_t j = 0; j < m / 2; j++)
+            {
+                double re = 0.0, im = 0.0;
+                for (size_t k = 0; k < m; k++)
+                {
+                    double x = e[b * m + k] ? 1.0 : -1.0;
+                    re += x * cos(2.0 * M_PI * j * k / m);
+                    im -= x * sin(2.0 * M_PI * j * k / m);
+                }
+                below += sqrt(re * re + im * im) < threshold;
+            }
+        }
+        double total = (double)(blocks * m);
+        double d = (below - 0.95 * total / 2.0) / sqrt(total * 0.95 * 0.05 / 4.0);
+        res->p[TRNG_NIST_DFT] = erfc(fabs(d) / sqrt(2.0));
+    }
+}
+
+static bit_vector to_bits(const std::vector<uint8_t> &data)
+{
+    bit_vector e(data.size() * 8);
+    for (size_t i = 0; i < e.size(); i++)
+    {
+        e[i] = (data[i / 8] >> (7 - i % 8)) & 1;
+    }
+    return e;
+}
+
+/*Run data through the engine in random slices, returns 0 or -1 if cfg is rejected*/
+static int run_engine(check_rng *rng, const std::vector<uint8_t> &data, const trng_nist_config *cfg,
+                      trng_nist_result *res)
+{
+    std::vector<double> arena(trng_nist_state_size(cfg) / sizeof(double) + 1);
+    trng_nist t;
+    if (trng_nist_init(&t, cfg, &arena[0], arena.size() * sizeof(double)) != 0)
+    {
+        return -1;
+    }
+    for (size_t pos = 0; pos < data.size();)
+    {
+        size_t slice = 1 + check_rng_next(rng) % (check_rng_next(rng) & 1 ? 40 : 700);
+        slice = slice < data.size() - pos ? slice : data.size() - pos;
+        trng_nist_update(&t, &data[pos], slice);
+        pos += slice;
+    }
+    trng_nist_final(&t, res);
+    return 0;
+}
+
+static int compare(const char *what, uint64_t iter, const trng_nist_result *got, const trng_nist_result *expected,
+                   const trng_nist_config *cfg, size_t bytes)
+{
+    int failures = 0;
+    for (int i = 0; i < TRNG_NIST_TESTS; i++)
+    {
+        if (fabs(got->p[i] - expected->p[i]) > P_TOLERANCE)
+        {
+            failures += check_fail("nist", "%s %llu: %s p = %.12f, reference %.12f (%zu bytes, M %u/%u, m %u/%u, dft %u)",
+                                   what, (unsigned long long)iter, trng_nist_test_name(i), got->p[i], expected->p[i],
+                                   bytes, cfg->block_frequency_bits, cfg->longest_run_bits, cfg->serial_m,
+                                   cfg->apen_m, cfg->dft_block_bits);
+        }
+    }
+    return failures;
+}
+
+/*Worked examples of SP 800-22 that fit whole bytes, and identities of Q(a, x)*/
+static int check_examples(void)
+{
+    int failures = 0;
+
+    /*2.4.8, 128 bits in blocks of 8. The counts (4, 9, 3, 0) give chi square 4.882605 as printed
+      there, whose p-value is 0.180598, the 0.180609 printed next to it belongs to 4.882457*/
+    static const char lr_example[] =
+        "11001100000101010110110001001100111000000000001001001101010100010001"
+        "001111010110100000001101011111001100111001101101100010110010";
+    std::vector<uint8_t> data(16);
+    for (size_t i = 0; i < 128; i++)
+    {
+        data[i / 8] |= (lr_example[i] - '0') << (7 - i % 8);
+    }
+    trng_nist_config cfg;
+    trng_nist_config_default(&cfg);
+    cfg.longest_run_bits = 8;
+    cfg.serial_m = 2;
+    cfg.apen_m = 1;
+    cfg.dft_block_bits = 0;
+    check_rng rng;
+    check_rng_seed(&rng, 1);
+    trng_nist_result res;
+    run_engine(&rng, data, &cfg, &res);
+    if (fabs(res.p[TRNG_NIST_LONGEST_RUN] - 0.180598) > 1e-6)
+    {
+        failures += check_fail("nist", "longest run example: p = %.6f, expected 0.180598", res.p[TRNG_NIST_LONGEST_RUN]);
+    }
+
+    static const double x[] = { 1e-3, 0.5, 1.0, 3.0, 10.0, 50.0, 300.0 };
+    for (size_t i = 0; i < sizeof(x) / sizeof(x[0]); i++)
+    {
+        double q1 = trng_nist_igamc(1.0, x[i]), q05 = trng_nist_igamc(0.5, x[i]);
+        double q2 = trng_nist_igamc(2.0, x[i]);
+        if (fabs(q1 - exp(-x[i])) > 1e-12 * (1.0 + exp(-x[i])) * 10 ||
+            fabs(q05 - erfc(sqrt(x[i]))) > 1e-12 ||
+            fabs(q2 - (1.0 + x[i]) * exp(-x[i])) > 1e-12)
+        {
+            failures += check_fail("nist", "igamc(a, %g) = %.15g/%.15g/%.15g", x[i], q05, q1, q2);
+        }
+    }
+    if (trng_nist_igamc(128.0, 0.0) != 1.0 || trng_nist_igamc(4.0, 1e4) != 0.0)
+    {
+        failures += check_fail("nist", "igamc out of range");
+    }
+    return failures;
+}
+
+int check_nist(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 300);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = check_examples();
+
+    static const unsigned int bf_sizes[] = { 8, 16, 24, 128 };
+    static const unsigned int lr_sizes[] = { 8, 128, 10000 };
+    static const unsigned int dft_sizes[] = { 0, 64, 128 };
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        size_t len = 1 + check_rng_next(&rng) % (iter % 16 == 0 ? 3000 : 600);
+        std::vector<uint8_t> data(len);
+        uint32_t kind = check_rng_next(&rng) % 3;
+        for (size_t i = 0; i < len; i++)
+        {
+            uint32_t r = check_rng_next(&rng);
+            /*Random, every bit set with probability 5/8, or bytes repeated from a few before*/
+            data[i] = kind == 0 ? (uint8_t)r :
+                      kind == 1 ? (uint8_t)(r | (r >> 8 & r >> 16)) :
+                      i >= 4 && (r & 3) != 0 ? data[i - 1 - (r >> 8) % 4] : (uint8_t)(r >> 16);
+        }
+
+        trng_nist_config cfg;
+        cfg.block_frequency_bits = bf_sizes[check_rng_next(&rng) % 4];
+        cfg.longest_run_bits = lr_sizes[check_rng_next(&rng) % 3];
+        cfg.serial_m = 2 + check_rng_next(&rng) % 9;
+        cfg.apen_m = 1 + check_rng_next(&rng) % 8;
+        cfg.dft_block_bits = dft_sizes[check_rng_next(&rng) % 3];
+
+        trng_nist_result got, expected;
+        if (run_engine(&rng, data, &cfg, &got) != 0)
+        {
+            failures += check_fail("nist", "case %llu: configuration rejected", (unsigned long long)iter);
+            continue;
+        }
+        reference(to_bits(data), &cfg, &expected);
+        failures += compare(kind == 0 ? "random" : kind == 1 ? "biased" : "repeated", iter, &got, &expected, &cfg, len);
+    }
+
+    /*Configurations that must be rejected*/
+    trng_nist_config bad;
+    trng_nist_config_default(&bad);
+    bad.dft_block_bits = 96;
+    failures += trng_nist_state_size(&bad) != 0 ? check_fail("nist", "dft block 96 accepted") : 0;
+    trng_nist_config_default(&bad);
+    bad.longest_run_bits = 64;
+    failures += trng_nist_state_size(&bad) != 0 ? check_fail("nist", "longest run block 64 accepted") : 0;
+    trng_nist_config_default(&bad);
+    bad.serial_m = TRNG_NIST_MAX_PATTERN_BITS + 1;
+    failures += trng_nist_state_size(&bad) != 0 ? check_fail("nist", "serial m %u accepted", bad.serial_m) : 0;
+
+    printf("nist: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
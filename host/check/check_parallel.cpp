@@ -0,0 +1,199 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The parallel qualification pipeline: trng_stream_stats_merge of the stats
+* of random pieces, grouped at random, must equal the stats of the whole,
+* and pipeline_qualify on 1 to 8 threads with random chunk and task sizes
+* must give the statistics of a serial pass and the lzf_compress verdict of
+* every chunk on a clean table, on random, biased and repetitive captures.
+* The work stealing scheduler must run every index exactly once.
+*/
+
+#include "check.h"
+#include "qualify_pipeline.h"
+#include "trng_core.h"
+
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+extern "C" {
+#include "lzf.h"
+}
+
+static bool same_stats(const trng_stream_stats *a, const trng_stream_stats *b)
+{
+    return a->bytes == b->bytes && a->chunks == b->chunks && a->compressible_chunks == b->compressible_chunks &&
+           a->compressed_bytes == b->compressed_bytes && a->ones == b->ones && a->sum == b->sum &&
+           a->sum_sq == b->sum_sq && a->sum_lag == b->sum_lag && a->first == b->first && a->last == b->last &&
+           memcmp(a->histogram, b->histogram, sizeof(a->histogram)) == 0;
+}
+
+/*Merging stats of consecutive pieces in a random tree*/
+static trng_stream_stats merge_range(const std::vector<trng_stream_stats> &pieces, size_t lo, size_t hi, check_rng *rng)
+{
+    trng_stream_stats out;
+    trng_stream_stats_init(&out);
+    if (hi - lo == 1)
+    {
+        return pieces[lo];
+    }
+    if (hi > lo)
+    {
+        size_t mid = lo + 1 + check_rng_next(rng) % (hi - lo - 1);
+        trng_stream_stats right = merge_range(pieces, mid, hi, rng);
+        out = merge_range(pieces, lo, mid, rng);
+        trng_stream_stats_merge(&out, &right);
+    }
+    return out;
+}
+
+static int check_merge(check_rng *rng, uint64_t iterations)
+{
+    int failures = 0;
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        std::vector<uint8_t> data(1 + check_rng_next(rng) % 5000);
+        check_rng_fill(rng, data.data(), data.size(), (int)(iter % CHECK_FILL_KINDS));
+
+        trng_stream_stats whole;
+        trng_stream_stats_init(&whole);
+        trng_stream_stats_update(&whole, &data[0], data.size());
+
+        /*Empty pieces included*/
+        std::vector<trng_stream_stats> pieces;
+        for (size_t pos = 0; pos < data.size();)
+        {
+            size_t n = check_rng_next(rng) % 4 == 0 ? 0 : 1 + check_rng_next(rng) % 700;
+            n = n < data.size() - pos ? n : data.size() - pos;
+            trng_stream_stats piece;
+            trng_stream_stats_init(&piece);
+            trng_stream_stats_update(&piece, &data[pos], n);
+            pieces.push_back(piece);
+            pos += n;
+        }
+        trng_stream_stats merged = merge_range(pieces, 0, pieces.size(), rng);
+        if (!same_stats(&merged, &whole))
+        {
+            failures += check_fail("parallel", "case %llu: %zu pieces of %zu bytes merge to different stats",
+                                   (unsigned long long)iter, pieces.size(), data.size());
+        }
+    }
+    return failures;
+}
+
+static void count_index(void *ctx, size_t index, unsigned int thread)
+{
+    std::atomic<uint32_t> *counts = (std::atomic<uint32_t> *)ctx;
+    counts[index]++;
+}
+
+static int check_scheduler(check_rng *rng)
+{
+    int failures = 0;
+    for (int iter = 0; iter < 40 && failures < 16; iter++)
+    {
+        unsigned int threads = 1 + check_rng_next(rng) % 8;
+        size_t count = check_rng_next(rng) % 3 == 0 ? check_rng_next(rng) % 8 : check_rng_next(rng) % 20000;
+        std::vector<std::atomic<uint32_t> > counts(count + 1);
+        std::vector<work_thread_stats> stats(threads);
+        for (size_t i = 0; i <= count; i++)
+        {
+            counts[i] = 0;
+        }
+        work_run(threads, count, count_index, counts.empty() ? NULL : &counts[0], &stats[0]);
+
+        uint64_t tasks = 0;
+        for (unsigned int t = 0; t < threads; t++)
+        {
+            tasks += stats[t].tasks;
+        }
+        for (size_t i = 0; i <= count; i++)
+        {
+            if (counts[i] != (i < count ? 1U : 0U))
+            {
+                failures += check_fail("parallel", "%u threads, %zu indexes: index %zu ran %u times", threads, count, i,
+                                       (unsigned int)counts[i]);
+                break;
+            }
+        }
+        failures += tasks != count ? check_fail("parallel", "%u threads ran %llu of %zu tasks", threads,
+                                                (unsigned long long)tasks, count) : 0;
+    }
+    return failures;
+}
+
+static int check_pipeline(check_rng *rng, uint64_t iterations)
+{
+    static const unsigned int chunk_lens[4] = { 64, 100, 512, 4096 };
+    std::vector<const uint8_t *> htab(1 << 14);
+    int failures = 0;
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        pipeline_config cfg;
+        cfg.chunk_len = chunk_lens[check_rng_next(rng) % 4];
+        cfg.percentage = 90 + check_rng_next(rng) % 11;
+        cfg.threads = 1 + check_rng_next(rng) % 8;
+        cfg.task_chunks = check_rng_next(rng) % 2 ? 0 : 1 + check_rng_next(rng) % 9;
+        cfg.transcode = check_rng_next(rng) % 2;
+        std::vector<uint8_t> data(check_rng_next(rng) % (cfg.chunk_len * 300));
+        check_rng_fill(rng, data.data(), data.size(), (int)(iter % CHECK_FILL_KINDS));
+
+        /*Serial pass*/
+        trng_stream_stats want;
+        trng_stream_stats_init(&want);
+        unsigned int out_len = trng_core_threshold(cfg.chunk_len, cfg.percentage);
+        std::vector<uint8_t> comp(out_len + 1);
+        for (size_t pos = 0; pos + cfg.chunk_len <= data.size(); pos += cfg.chunk_len)
+        {
+            memset(&htab[0], 0, htab.size() * sizeof(htab[0]));
+            unsigned int res = lzf_compress(&data[pos], cfg.chunk_len, &comp[0], out_len, (unsigned char **)&htab[0]);
+            want.compressible_chunks += res != 0;
+            want.compressed_bytes += res != 0 ? res : cfg.chunk_len;
+            want.chunks++;
+            trng_stream_stats_update(&want, &data[pos], cfg.chunk_len);
+        }
+
+        pipeline_result got;
+        if (pipeline_qualify(data.empty() ? NULL : &data[0], data.size(), &cfg, &got) != 0 ||
+            !same_stats(&got.stats, &want) || got.transcode_failures != 0)
+        {
+            failures += check_fail("parallel", "case %llu: %u threads, %zu bytes in chunks of %u: %llu/%llu compressible, "
+                                   "%llu transcode failures", (unsigned long long)iter, cfg.threads, data.size(),
+                                   cfg.chunk_len, (unsigned long long)got.stats.compressible_chunks,
+                                   (unsigned long long)want.compressible_chunks,
+                                   (unsigned long long)got.transcode_failures);
+        }
+    }
+    return failures;
+}
+
+int check_parallel(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+
+    int failures = check_merge(&rng, iterations);
+    failures += check_scheduler(&rng);
+    failures += check_pipeline(&rng, iterations / 2);
+
+    printf("parallel: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
@@ -0,0 +1,280 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The entropy pool: a single consumer must get the source back byte for byte
+* through random refills and reads on small rings, and with a refilling
+* thread and several consumer threads the bytes served (words of a counting
+* sequence, read in multiples of 4 so they stay aligned) must be every word
+* the producer published, each exactly once.
+*/
+
+#include "check.h"
+#include "trng_pool.h"
+#include "trng_host.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+static std::vector<uint8_t> counting_words(size_t words)
+{
+    std::vector<uint8_t> data(words * 4);
+    for (size_t i = 0; i < words; i++)
+    {
+        uint32_t v = (uint32_t)i;
+        memcpy(&data[i * 4], &v, 4);
+    }
+    return data;
+}
+
+static int check_sequential(check_rng *rng, uint64_t iterations)
+{
+    std::vector<uint8_t> source(1 << 16);
+    for (size_t i = 0; i < source.size(); i++)
+    {
+        source[i] = (uint8_t)check_rng_next(rng);
+    }
+    int failures = 0;
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        trng_pool_config cfg;
+        cfg.capacity = 1U << (1 + check_rng_next(rng) % 10);
+        cfg.batch = 1 + check_rng_next(rng) % cfg.capacity;
+        cfg.health = NULL;
+        cfg.now_ns = host_now_ns;
+        trng_host_use_replay(&source[0], source.size());
+        trng_host_set_max_chunk(check_rng_next(rng) % 2 ? 0 : 1 + check_rng_next(rng) % 40);
+
+        trng_t trng_obj;
+        trng_init(&trng_obj);
+        cfg.trng = &trng_obj;
+        std::vector<uint8_t> ring(cfg.capacity), served;
+        trng_pool pool;
+        trng_pool_init(&pool, &cfg, &ring[0]);
+
+        unsigned long reads = 0, hits = 0, added = 0;
+        while (served.size() < 8192)
+        {
+            if (check_rng_next(rng) % 3 == 0)
+            {
+                uint32_t level = trng_pool_level(&pool);
+                int res = trng_pool_refill(&pool);
+                if (res < 0 || (res == 0) != (cfg.capacity - level < cfg.batch))
+                {
+                    failures += check_fail("pool", "case %llu: refill of %u/%u returned %d", (unsigned long long)iter,
+                                           level, cfg.capacity, res);
+                    break;
+                }
+                added += res;
+                continue;
+            }
+            uint8_t out[64];
+            size_t len = check_rng_next(rng) % sizeof(out), level = trng_pool_level(&pool);
+            size_t got = trng_pool_read(&pool, out, len);
+            served.insert(served.end(), out, out + got);
+            reads++;
+            hits += got == len;
+            if (got != (len < level ? len : level))
+            {
+                failures += check_fail("pool", "case %llu: read of %zu at level %zu got %zu", (unsigned long long)iter,
+                                       len, level, got);
+                break;
+            }
+        }
+        trng_free(&trng_obj);
+
+        trng_pool_stats stats;
+        trng_pool_get_stats(&pool, &stats);
+        if (memcmp(&served[0], &source[0], served.size()) != 0)
+        {
+            failures += check_fail("pool", "case %llu: bytes served differ from the source (capacity %u, batch %u)",
+                                   (unsigned long long)iter, cfg.capacity, cfg.batch);
+        }
+        if (stats.reads != reads || stats.hits != hits || stats.short_reads != reads - hits ||
+            stats.bytes_served != served.size() || stats.refill_bytes != added ||
+            stats.level != added - served.size() || stats.refill_errors != 0)
+        {
+            failures += check_fail("pool", "case %llu: statistics %lu/%lu/%lu reads, %lu served, %llu added, level %u",
+                                   (unsigned long long)iter, stats.reads, stats.hits, stats.short_reads,
+                                   stats.bytes_served, (unsigned long long)stats.refill_bytes, stats.level);
+        }
+    }
+
+    trng_host_set_max_chunk(0);
+    return failures;
+}
+
+static int check_threads(unsigned int consumers, size_t words, uint32_t capacity, uint32_t batch)
+{
+    std::vector<uint8_t> source = counting_words(words * 2);
+    trng_host_use_replay(&source[0], source.size());
+    /*Calls of whole words keep head on a word boundary*/
+    trng_host_set_max_chunk((batch / 3) & ~3U);
+
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    trng_pool_config cfg;
+    cfg.capacity = capacity;
+    cfg.batch = batch;
+    cfg.trng = &trng_obj;
+    cfg.health = NULL;
+    cfg.now_ns = host_now_ns;
+    std::vector<uint8_t> ring(capacity);
+    trng_pool pool;
+    trng_pool_init(&pool, &cfg, &ring[0]);
+
+    /*The producer stops once words have been published, the consumers once they are served*/
+    std::atomic<size_t> served(0);
+    std::thread producer([&]() {
+        uint64_t published = 0;
+        while (published < words * 4)
+        {
+            int res = trng_pool_refill(&pool);
+            published += res > 0 ? res : 0;
+            if (res == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::vector<std::vector<uint32_t> > got(consumers);
+    std::vector<std::thread> pool_threads;
+    for (unsigned int c = 0; c < consumers; c++)
+    {
+        pool_threads.push_back(std::thread([&, c]() {
+            check_rng rng;
+            check_rng_seed(&rng, 77 + c);
+            uint8_t out[64];
+            while (served.load() < words * 4)
+            {
+                size_t len = 4 * (1 + check_rng_next(&rng) % 16);
+                size_t n = trng_pool_read(&pool, out, len);
+                if (n % 4 != 0)
+                {
+                    got[c].push_back(UINT32_MAX);
+                }
+                for (size_t i = 0; i + 4 <= n; i += 4)
+                {
+                    uint32_t v;
+                    memcpy(&v, out + i, 4);
+                    got[c].push_back(v);
+                }
+                served += n;
+                if (n == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }));
+    }
+    producer.join();
+    for (size_t c = 0; c < pool_threads.size(); c++)
+    {
+        pool_threads[c].join();
+    }
+    trng_free(&trng_obj);
+    trng_host_set_max_chunk(0);
+
+    std::vector<uint32_t> all;
+    for (unsigned int c = 0; c < consumers; c++)
+    {
+        /*Every consumer sees increasing words*/
+        if (!std::is_sorted(got[c].begin(), got[c].end()))
+        {
+            return check_fail("pool", "%u consumers: consumer %u got words out of order", consumers, c);
+        }
+        all.insert(all.end(), got[c].begin(), got[c].end());
+    }
+    std::sort(all.begin(), all.end());
+    for (size_t i = 0; i < all.size(); i++)
+    {
+        if (all[i] != i)
+        {
+            return check_fail("pool", "%u consumers: word %zu of %zu served is %u", consumers, i, all.size(), all[i]);
+        }
+    }
+
+    trng_pool_stats stats;
+    trng_pool_get_stats(&pool, &stats);
+    if (stats.bytes_served != all.size() * 4 || stats.refill_bytes != stats.bytes_served + stats.level ||
+        stats.hits + stats.short_reads != stats.reads)
+    {
+        return check_fail("pool", "%u consumers: %lu bytes served, %llu published, level %u", consumers,
+                          stats.bytes_served, (unsigned long long)stats.refill_bytes, stats.level);
+    }
+    return 0;
+}
+
+static int check_rejects(void)
+{
+    uint8_t ring[64];
+    std::vector<uint8_t> stuck(256, 0);
+    int failures = 0;
+    trng_pool pool;
+    trng_pool_config cfg;
+    cfg.capacity = 48;
+    cfg.batch = 16;
+    cfg.trng = NULL;
+    cfg.health = NULL;
+    cfg.now_ns = NULL;
+    failures += trng_pool_init(&pool, &cfg, ring) == 0 ? check_fail("pool", "capacity 48 accepted") : 0;
+    cfg.capacity = 64;
+    cfg.batch = 65;
+    failures += trng_pool_init(&pool, &cfg, ring) == 0 ? check_fail("pool", "batch 65 of 64 accepted") : 0;
+
+    /*A refill the health tests reject is not published*/
+    trng_host_use_replay(&stuck[0], stuck.size());
+    trng_health health;
+    trng_health_config health_cfg;
+    trng_health_config_default(&health_cfg, 4.0, 20);
+    health_cfg.startup_bytes = 0;
+    trng_health_init(&health, &health_cfg);
+    cfg.batch = 32;
+    cfg.health = &health;
+    trng_pool_init(&pool, &cfg, ring);
+    int res = trng_pool_refill(&pool);
+    trng_health_free(&health);
+    trng_pool_stats stats;
+    trng_pool_get_stats(&pool, &stats);
+    if (res != TRNG_HEALTH_FAILED || stats.level != 0 || stats.refill_errors != 1 || stats.refills != 1)
+    {
+        failures += check_fail("pool", "stuck source refill returned %d, level %u", res, stats.level);
+    }
+    return failures;
+}
+
+int check_pool(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = check_rejects() + check_sequential(&rng, iterations);
+
+    for (unsigned int consumers = 1; consumers <= 4 && failures == 0; consumers++)
+    {
+        failures += check_threads(consumers, 1 << 18, 1024, 256);
+        failures += check_threads(consumers, 1 << 16, 64, 64);
+    }
+
+    trng_host_use_urandom();
+    printf("pool: %llu cases, 1 to 4 consumer threads\n", (unsigned long long)iterations);
+    return failures;
+}
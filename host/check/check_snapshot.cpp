@@ -0,0 +1,291 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The snapshot ring over an in memory key store: after every append the ring
+* is opened again, as after a reset, and must read back the last slots
+* records in order with their samples and metadata, having written one key
+* per append. Stored records are torn, corrupted, deleted or left from a
+* ring of another size at random, and those must be skipped without losing
+* the others. The CRC is checked against the standard check value.
+*/
+
+#include "check.h"
+#include "trng_core.h"
+#include "trng_snapshot.h"
+
+#include <deque>
+#include <map>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+struct mem_store {
+    std::map<uint16_t, std::vector<uint8_t> > keys;
+    uint64_t sets;
+    bool fail_sets;
+};
+
+static int mem_get(void *ctx, uint16_t key, uint16_t buf_size, void *buf, uint16_t *actual)
+{
+    mem_store *store = (mem_store *)ctx;
+    std::map<uint16_t, std::vector<uint8_t> >::const_iterator it = store->keys.find(key);
+    if (it == store->keys.end() || it->second.size() > buf_size)
+    {
+        return -1;
+    }
+    memcpy(buf, it->second.data(), it->second.size());
+    *actual = (uint16_t)it->second.size();
+    return 0;
+}
+
+static int mem_set(void *ctx, uint16_t key, uint16_t size, const void *buf)
+{
+    mem_store *store = (mem_store *)ctx;
+    if (store->fail_sets)
+    {
+        return -1;
+    }
+    store->sets++;
+    store->keys[key].assign((const uint8_t *)buf, (const uint8_t *)buf + size);
+    return 0;
+}
+
+struct entry {
+    uint32_t seq;
+    std::vector<uint8_t> sample, meta;
+};
+
+struct read_ctx {
+    std::vector<entry> got;
+    uint64_t compressed;
+};
+
+static int collect(const trng_snapshot_record *record, void *ctx)
+{
+    read_ctx *rc = (read_ctx *)ctx;
+    entry e;
+    e.seq = record->seq;
+    e.sample.assign(record->sample, record->sample + record->sample_len);
+    e.meta.assign(record->meta, record->meta + record->meta_len);
+    rc->got.push_back(e);
+    rc->compressed += (record->flags & TRNG_SNAPSHOT_META_LZF) != 0;
+    return 0;
+}
+
+static std::vector<uint8_t> random_bytes(check_rng *rng, size_t len, bool text)
+{
+    static const char words[] = "boot step verdict compressible random seed ";
+    std::vector<uint8_t> out(len);
+    for (size_t i = 0; i < len; i++)
+    {
+        out[i] = text ? (uint8_t)words[(i + check_rng_next(rng) % 4 / 3) % (sizeof(words) - 1)]
+                      : (uint8_t)check_rng_next(rng);
+    }
+    return out;
+}
+
+static int check_ring(check_rng *rng, uint64_t iterations)
+{
+    std::vector<uint8_t> arena(lzf_ctx_state_size(10));
+    lzf_ctx lzf;
+    lzf_ctx_init(&lzf, 10, &arena[0], arena.size());
+    int failures = 0;
+    uint64_t compressed = 0;
+
+    for (uint64_t iter = 0; iter < iterations && failures < 16; iter++)
+    {
+        mem_store store;
+        store.sets = 0;
+        store.fail_sets = false;
+        trng_snapshot_config cfg;
+        cfg.first_key = (uint16_t)(check_rng_next(rng) % 8);
+        cfg.slots = (uint16_t)(1 + check_rng_next(rng) % 12);
+        cfg.max_record = (uint16_t)(TRNG_SNAPSHOT_HEADER + 1 + check_rng_next(rng) % 300);
+        cfg.store.get = mem_get;
+        cfg.store.set = mem_set;
+        cfg.store.ctx = &store;
+
+        /*A key below the ring must be left alone*/
+        std::vector<uint8_t> other(5, 0xa5);
+        store.keys[(uint16_t)(cfg.first_key + cfg.slots)] = other;
+
+        std::vector<uint8_t> work(TRNG_SNAPSHOT_WORK_SIZE(cfg.max_record));
+        std::deque<entry> model;
+        uint32_t next_seq = 1;
+        for (int boot = 0; boot < 40 && failures < 16; boot++)
+        {
+            trng_snapshot snap;
+            if (trng_snapshot_open(&snap, &cfg, &work[0], work.size()) != 0 || snap.next_seq != next_seq)
+            {
+                failures += check_fail("snapshot", "case %llu boot %d: next sequence number %u, expected %u",
+                                       (unsigned long long)iter, boot, snap.next_seq, next_seq);
+                break;
+            }
+
+            entry e;
+            e.seq = next_seq;
+            e.sample = random_bytes(rng, check_rng_next(rng) % (cfg.max_record - TRNG_SNAPSHOT_HEADER + 8), false);
+            e.meta = random_bytes(rng, check_rng_next(rng) % 4 ? check_rng_next(rng) % (cfg.max_record + 8) : 0,
+                                  check_rng_next(rng) % 2 != 0);
+            bool use_lzf = check_rng_next(rng) % 4 != 0;
+            uint64_t sets = store.sets;
+            int res = trng_snapshot_append(&snap, e.sample.empty() ? NULL : &e.sample[0], (uint16_t)e.sample.size(),
+                                           e.meta.empty() ? NULL : &e.meta[0], (uint16_t)e.meta.size(),
+                                           use_lzf ? &lzf : NULL);
+
+            /*Fits raw, or fits compressed (which is only known by trying)*/
+            bool fits_raw = TRNG_SNAPSHOT_HEADER + e.sample.size() + e.meta.size() <= cfg.max_record;
+            if (res == 0)
+            {
+                model.push_back(e);
+                next_seq++;
+            }
+            if ((res == 0 && store.sets != sets + 1) || (res != 0 && store.sets != sets) ||
+                (fits_raw && res != 0) || (!fits_raw && !use_lzf && res != TRNG_SNAPSHOT_ERR_SIZE))
+            {
+                failures += check_fail("snapshot", "case %llu boot %d: append of %zu + %zu bytes into %u returned %d after %llu sets",
+                                       (unsigned long long)iter, boot, e.sample.size(), e.meta.size(), cfg.max_record, res,
+                                       (unsigned long long)(store.sets - sets));
+            }
+            while (!model.empty() && model.front().seq + cfg.slots < next_seq)
+            {
+                model.pop_front();
+            }
+
+            /*Damage a record now and then: it must disappear and nothing else*/
+            if (!model.empty() && check_rng_next(rng) % 8 == 0)
+            {
+                size_t victim = check_rng_next(rng) % model.size();
+                std::vector<uint8_t> &stored = store.keys[(uint16_t)(cfg.first_key + model[victim].seq % cfg.slots)];
+                switch (check_rng_next(rng) % 4)
+                {
+                    case 0:
+                        stored[check_rng_next(rng) % stored.size()] ^= (uint8_t)(1 + check_rng_next(rng) % 255);
+                        break;
+                    case 1:
+                        stored.resize(check_rng_next(rng) % stored.size());
+                        break;
+                    case 2:
+                        store.keys.erase((uint16_t)(cfg.first_key + model[victim].seq % cfg.slots));
+                        break;
+                    default:
+                        /*A valid record of the wrong slot, as left by a ring of another size*/
+                        stored = store.keys[(uint16_t)(cfg.first_key + model[(victim + 1) % model.size()].seq % cfg.slots)];
+                        if (model.size() == 1)
+                        {
+                            continue;
+                        }
+                        break;
+                }
+                model.erase(model.begin() + victim);
+
+                /*Without the newest record the ring continues from the newest one left*/
+                next_seq = model.empty() ? 1 : model.back().seq + 1;
+            }
+
+            trng_snapshot reader;
+            trng_snapshot_open(&reader, &cfg, &work[0], work.size());
+            read_ctx rc;
+            rc.compressed = 0;
+            uint64_t sets_before = store.sets;
+            uint32_t passed = trng_snapshot_read(&reader, collect, &rc);
+            bool same = passed == model.size() && rc.got.size() == model.size() && store.sets == sets_before;
+            for (size_t i = 0; same && i < model.size(); i++)
+            {
+                same = rc.got[i].seq == model[i].seq && rc.got[i].sample == model[i].sample && rc.got[i].meta == model[i].meta;
+            }
+            if (!same)
+            {
+                failures += check_fail("snapshot", "case %llu boot %d: read %u records of %zu expected",
+                                       (unsigned long long)iter, boot, passed, model.size());
+            }
+            compressed += rc.compressed;
+        }
+        if (store.keys[(uint16_t)(cfg.first_key + cfg.slots)] != other)
+        {
+            failures += check_fail("snapshot", "case %llu: a key outside the ring was written", (unsigned long long)iter);
+        }
+    }
+    if (compressed == 0)
+    {
+        failures += check_fail("snapshot", "no metadata was ever stored compressed");
+    }
+    return failures;
+}
+
+static int stop_after_two(const trng_snapshot_record *record, void *ctx)
+{
+    return ++*(int *)ctx == 2;
+}
+
+static int check_api(void)
+{
+    int failures = 0;
+    const uint8_t check_string[] = "123456789";
+    if (trng_core_crc32(0, check_string, 9) != 0xcbf43926 ||
+        trng_core_crc32(trng_core_crc32(0, check_string, 4), check_string + 4, 5) != 0xcbf43926)
+    {
+        failures += check_fail("snapshot", "CRC-32 of \"123456789\" is not cbf43926");
+    }
+
+    mem_store store;
+    store.sets = 0;
+    store.fail_sets = false;
+    trng_snapshot_config cfg;
+    cfg.first_key = 3;
+    cfg.slots = 4;
+    cfg.max_record = 100;
+    cfg.store.get = mem_get;
+    cfg.store.set = mem_set;
+    cfg.store.ctx = &store;
+    uint8_t work[200], sample[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+    trng_snapshot snap;
+
+    failures += trng_snapshot_open(&snap, &cfg, work, sizeof(work) - 1) != TRNG_SNAPSHOT_ERR_CONFIG ?
+                check_fail("snapshot", "short work buffer accepted") : 0;
+    cfg.first_key = 0xfffe;
+    failures += trng_snapshot_open(&snap, &cfg, work, sizeof(work)) != TRNG_SNAPSHOT_ERR_CONFIG ?
+                check_fail("snapshot", "ring past the last key accepted") : 0;
+    cfg.first_key = 3;
+
+    trng_snapshot_open(&snap, &cfg, work, sizeof(work));
+    store.fail_sets = true;
+    failures += trng_snapshot_append(&snap, sample, sizeof(sample), NULL, 0, NULL) != TRNG_SNAPSHOT_ERR_STORE ||
+                snap.next_seq != 1 ? check_fail("snapshot", "failed set not reported") : 0;
+    store.fail_sets = false;
+    for (int i = 0; i < 6; i++)
+    {
+        trng_snapshot_append(&snap, sample, sizeof(sample), NULL, 0, NULL);
+    }
+    int calls = 0;
+    failures += trng_snapshot_read(&snap, stop_after_two, &calls) != 2 || calls != 2 ?
+                check_fail("snapshot", "read did not stop when the callback asked") : 0;
+    return failures;
+}
+
+int check_snapshot(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+
+    int failures = check_api();
+    failures += check_ring(&rng, iterations);
+
+    printf("snapshot: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
@@ -0,0 +1,240 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* The trace counters of trng_trace.h: buckets against a bit by bit count,
+* random calls recorded from several threads at once against totals kept
+* by each thread, packed records through round trips and damage, and, in a
+* TRNG_TRACE build, the reads trng_core_fill counts against a stand-in
+* returning a random number of bytes per call.
+*/
+
+#include "check.h"
+#include "trng_trace.h"
+#include "trng_core.h"
+#include "trng_host.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#define THREADS     4
+
+struct thread_calls {
+    uint64_t seed;
+    uint64_t calls;
+    trng_trace expected;
+};
+
+static unsigned int count_bucket(uint32_t ticks)
+{
+    unsigned int b = 0;
+    while (ticks != 0 && b < TRNG_TRACE_BUCKETS - 1)
+    {
+        ticks >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static uint32_t fake_ticks = 0;
+
+static uint32_t fake_now(void)
+{
+    return fake_ticks += 5;
+}
+
+static void record_calls(thread_calls *t)
+{
+    check_rng rng;
+    check_rng_seed(&rng, t->seed);
+    for (uint64_t i = 0; i < t->calls; i++)
+    {
+        unsigned int site = check_rng_next(&rng) % TRNG_TRACE_SITES;
+        uint32_t ticks = check_rng_next(&rng) >> (check_rng_next(&rng) % 32);
+        uint32_t units = check_rng_next(&rng) % 4096;
+        trng_trace_site *s = &t->expected.site[site];
+        trng_trace_record(site, ticks, units);
+        s->calls++;
+        s->units += units;
+        s->ticks += ticks;
+        s->max = ticks > s->max ? ticks : s->max;
+        s->buckets[count_bucket(ticks)]++;
+    }
+}
+
+static int compare(const trng_trace *got, const trng_trace *expected, const char *what)
+{
+    for (unsigned int site = 0; site < TRNG_TRACE_SITES; site++)
+    {
+        const trng_trace_site *g = &got->site[site], *e = &expected->site[site];
+        if (g->calls != e->calls || g->units != e->units || g->ticks != e->ticks || g->max != e->max ||
+            memcmp(g->buckets, e->buckets, sizeof(g->buckets)) != 0)
+        {
+            return check_fail("trace", "%s: site %s counted %u calls, %u units, %llu ticks, max %u, expected "
+                              "%u, %u, %llu, %u", what, trng_trace_site_name(site), g->calls, g->units,
+                              (unsigned long long)g->ticks, g->max, e->calls, e->units,
+                              (unsigned long long)e->ticks, e->max);
+        }
+    }
+    return 0;
+}
+
+int check_trace(int argc, char **argv)
+{
+    uint64_t iterations = host_size_arg(argc, argv, "iterations", 200);
+    check_rng rng;
+    check_rng_seed(&rng, host_size_arg(argc, argv, "seed", 1));
+    int failures = 0;
+
+    for (uint64_t iter = 0; iter < iterations * 100 && failures == 0; iter++)
+    {
+        uint32_t ticks = check_rng_next(&rng) >> (check_rng_next(&rng) % 33 & 31);
+        ticks = iter < 33 ? (iter ? 1U << (iter - 1) : 0) : ticks;
+        if (trng_trace_bucket(ticks) != count_bucket(ticks))
+        {
+            failures += check_fail("trace", "%u ticks in bucket %u, expected %u", ticks, trng_trace_bucket(ticks),
+                                   count_bucket(ticks));
+        }
+    }
+
+    /*Every thread records into a block of its own, the snapshot adds them up*/
+    for (uint64_t iter = 0; iter < iterations / 20 + 1 && failures == 0; iter++)
+    {
+        std::vector<thread_calls> calls(THREADS);
+        std::vector<std::thread> threads;
+        trng_trace expected, got;
+
+        trng_trace_reset();
+        for (unsigned int t = 0; t < THREADS; t++)
+        {
+            memset(&calls[t].expected, 0, sizeof(calls[t].expected));
+            calls[t].seed = check_rng_next(&rng) | (uint64_t)check_rng_next(&rng) << 32;
+            calls[t].calls = check_rng_next(&rng) % 20000;
+            threads.push_back(std::thread(record_calls, &calls[t]));
+        }
+        for (unsigned int t = 0; t < THREADS; t++)
+        {
+            /*Snapshots taken while the threads record only have to be consistent at the end*/
+            trng_trace_snapshot(&got);
+            threads[t].join();
+        }
+
+        memset(&expected, 0, sizeof(expected));
+        for (unsigned int t = 0; t < THREADS; t++)
+        {
+            for (unsigned int site = 0; site < TRNG_TRACE_SITES; site++)
+            {
+                trng_trace_site *e = &expected.site[site], *c = &calls[t].expected.site[site];
+                e->calls += c->calls;
+                e->units += c->units;
+                e->ticks += c->ticks;
+                e->max = c->max > e->max ? c->max : e->max;
+                for (unsigned int b = 0; b < TRNG_TRACE_BUCKETS; b++)
+                {
+                    e->buckets[b] += c->buckets[b];
+                }
+            }
+        }
+        trng_trace_snapshot(&got);
+        expected.hz = got.hz;
+        failures += compare(&got, &expected, "threads");
+
+        /*Every site through a record and back*/
+        trng_trace unpacked;
+        uint8_t record[TRNG_TRACE_RECORD + 1];
+        memset(&unpacked, 0, sizeof(unpacked));
+        got.hz = check_rng_next(&rng);
+        for (unsigned int site = 0; site < TRNG_TRACE_SITES && failures == 0; site++)
+        {
+            size_t len = trng_trace_pack(&got, site, record, sizeof(record));
+            if (len != TRNG_TRACE_RECORD || trng_trace_unpack(record, len, &unpacked) != (int)site)
+            {
+                failures += check_fail("trace", "site %u packed into %u bytes did not unpack", site, (unsigned int)len);
+            }
+            if (trng_trace_pack(&got, site, record, TRNG_TRACE_RECORD - 1) != 0 ||
+                trng_trace_unpack(record, len - 1, &unpacked) != -1)
+            {
+                failures += check_fail("trace", "site %u packed into or unpacked from a short record", site);
+            }
+
+            /*Magic or bucket count, a damaged site may well be another site*/
+            size_t pos = check_rng_next(&rng) % 3;
+            pos += pos == 2;
+            record[pos] ^= (uint8_t)(1 + check_rng_next(&rng) % 255);
+            if (trng_trace_unpack(record, len, &unpacked) != -1)
+            {
+                failures += check_fail("trace", "site %u unpacked with byte %u of the header damaged", site,
+                                       (unsigned int)pos);
+            }
+        }
+        if (failures == 0 && unpacked.hz != got.hz)
+        {
+            failures += check_fail("trace", "clock of %u Hz unpacked as %u Hz", got.hz, unpacked.hz);
+        }
+        failures += failures == 0 ? compare(&unpacked, &got, "records") : 0;
+        if (trng_trace_pack(&got, TRNG_TRACE_SITES, record, sizeof(record)) != 0)
+        {
+            failures += check_fail("trace", "a site past TRNG_TRACE_SITES packed");
+        }
+    }
+
+    /*Latencies come from the clock, a site between two readings takes a step of it*/
+    trng_trace_reset();
+    trng_trace_clock(fake_now, 1000);
+    uint32_t start = trng_trace_now();
+    trng_trace_record(TRNG_TRACE_LZF, trng_trace_now() - start, 64);
+    trng_trace snapshot;
+    trng_trace_snapshot(&snapshot);
+    if (snapshot.hz != 1000 || snapshot.site[TRNG_TRACE_LZF].ticks != 5 || snapshot.site[TRNG_TRACE_LZF].buckets[3] != 1)
+    {
+        failures += check_fail("trace", "a step of 5 ticks of a 1000 Hz clock counted as %llu ticks of %u Hz",
+                               (unsigned long long)snapshot.site[TRNG_TRACE_LZF].ticks, snapshot.hz);
+    }
+    trng_trace_clock(NULL, 0);
+
+#if TRNG_TRACE
+    /*Every partial read is a trng_get_bytes call of its own*/
+    for (uint64_t iter = 0; iter < iterations && failures == 0; iter++)
+    {
+        size_t len = 1 + check_rng_next(&rng) % 4096, max_chunk = 1 + check_rng_next(&rng) % 512;
+        std::vector<uint8_t> buf(len);
+        trng_t trng_obj;
+
+        trng_trace_reset();
+        trng_host_set_max_chunk(max_chunk);
+        trng_init(&trng_obj);
+        int res = trng_core_fill(&trng_obj, &buf[0], len);
+        trng_free(&trng_obj);
+        trng_host_set_max_chunk(0);
+
+        trng_trace_snapshot(&snapshot);
+        uint32_t reads = (uint32_t)((len + max_chunk - 1) / max_chunk);
+        const trng_trace_site *get = &snapshot.site[TRNG_TRACE_GET_BYTES], *fill = &snapshot.site[TRNG_TRACE_FILL];
+        if (res != 0 || get->calls != reads || get->units != len || fill->calls != 1 || fill->units != reads)
+        {
+            failures += check_fail("trace", "fill of %u bytes %u at a time: %u reads of %u bytes, fill of %u "
+                                   "reads, expected %u", (unsigned int)len, (unsigned int)max_chunk, get->calls,
+                                   get->units, fill->units, reads);
+        }
+    }
+#endif
+    trng_trace_reset();
+
+    printf("trace: %llu cases\n", (unsigned long long)iterations);
+    return failures;
+}
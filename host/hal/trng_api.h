@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Host stand-in for mbed-os hal/trng_api.h, the functions are implemented in
+* trng_host.cpp on top of a file, /dev/urandom or an in memory replay buffer.
+*/
+
+#ifndef MBED_TRNG_API_H
+#define MBED_TRNG_API_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct trng_s {
+    int fd;                     //file descriptor of the file or /dev/urandom backend, -1 for replay
+    size_t replay_pos;          //read position in the replay buffer
+};
+
+typedef struct trng_s trng_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void trng_init(trng_t *obj);
+
+void trng_free(trng_t *obj);
+
+int trng_get_bytes(trng_t *obj, uint8_t *output, size_t length, size_t *output_length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,128 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "host_util.h"
+#include "trng_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+uint64_t host_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t host_now_us(void)
+{
+    return host_now_ns() / 1000;
+}
+
+uint32_t host_trace_now(void)
+{
+    return (uint32_t)(host_now_ns() >> 6);
+}
+
+void host_trace_start(void)
+{
+    trng_trace_clock(host_trace_now, 1000000000 >> 6);
+}
+
+void host_trace_print(const trng_trace *trace)
+{
+    double ns = trace->hz ? 1e9 / trace->hz : 0.0;
+
+    for (unsigned int site = 0; site < TRNG_TRACE_SITES; site++)
+    {
+        const trng_trace_site *s = &trace->site[site];
+        if (s->calls == 0)
+        {
+            continue;
+        }
+        printf("trace %-14s %u calls, %u units", trng_trace_site_name(site), s->calls, s->units);
+        if (trace->hz == 0)
+        {
+            printf("\n");
+            continue;
+        }
+        printf(", mean %.0f ns, max %.0f ns\n  latency", (double)s->ticks * ns / s->calls, s->max * ns);
+        for (unsigned int b = 0; b < TRNG_TRACE_BUCKETS; b++)
+        {
+            if (s->buckets[b] == 0)
+            {
+                continue;
+            }
+            if (b + 1 < TRNG_TRACE_BUCKETS)
+            {
+                printf(" <%.0f:%u", (double)(1u << b) * ns, s->buckets[b]);
+            }
+            else
+            {
+                printf(" >=%.0f:%u", (double)(1u << (b - 1)) * ns, s->buckets[b]);
+            }
+        }
+        printf(" ns\n");
+    }
+}
+
+const char *host_arg(int argc, char **argv, const char *name, const char *def)
+{
+    for (int i = 0; i + 1 < argc; i++)
+    {
+        if (strncmp(argv[i], "--", 2) == 0 && strcmp(argv[i] + 2, name) == 0)
+        {
+            return argv[i + 1];
+        }
+    }
+    return def;
+}
+
+uint64_t host_size_arg(int argc, char **argv, const char *name, uint64_t def)
+{
+    const char *value = host_arg(argc, argv, name, NULL);
+    if (value == NULL)
+    {
+        return def;
+    }
+
+    char *end = NULL;
+    uint64_t size = strtoull(value, &end, 0);
+    switch (*end)
+    {
+        case 'k': case 'K': size <<= 10; break;
+        case 'm': case 'M': size <<= 20; break;
+        case 'g': case 'G': size <<= 30; break;
+        default: break;
+    }
+    return size;
+}
+
+int host_select_source(int argc, char **argv)
+{
+    const char *spec = host_arg(argc, argv, "source", "urandom");
+    if (trng_host_use_source(spec) != 0)
+    {
+        fprintf(stderr, "cannot use trng source '%s'\n", spec);
+        return -1;
+    }
+    trng_host_set_max_chunk((size_t)host_size_arg(argc, argv, "max-chunk", 0));
+    trng_host_set_delay((uint32_t)host_size_arg(argc, argv, "call-delay", 0),
+                        (uint32_t)host_size_arg(argc, argv, "byte-delay", 0));
+    return 0;
+}
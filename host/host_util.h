@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Command line and timing helpers shared by the host tools.
+*/
+
+#ifndef TRNG_HOST_UTIL_H
+#define TRNG_HOST_UTIL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "trng_trace.h"
+
+/*Monotonic time stamp in nanoseconds*/
+uint64_t host_now_ns(void);
+
+/*Monotonic time stamp in microseconds, matches the trng_stream_config time source*/
+uint64_t host_now_us(void);
+
+/*Clock of the trace sites (trng_trace.h) in ticks of 64 ns, so the buckets span 64 ns to 1 ms*/
+uint32_t host_trace_now(void);
+
+/*Time the trace sites from now on with host_trace_now*/
+void host_trace_start(void);
+
+/*Print the sites of trace that were called, with their latency buckets*/
+void host_trace_print(const trng_trace *trace);
+
+/*Value of "--name value" or def if the option is not given*/
+const char *host_arg(int argc, char **argv, const char *name, const char *def);
+
+/*Same as host_arg for sizes, accepts K, M and G suffixes*/
+uint64_t host_size_arg(int argc, char **argv, const char *name, uint64_t def);
+
+/*Select the trng stand-in source from "--source", "--max-chunk" and "--call-delay" and
+  "--byte-delay" (ns), returns 0 on success*/
+int host_select_source(int argc, char **argv);
+
+#endif
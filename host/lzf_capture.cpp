@@ -0,0 +1,141 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "lzf_capture.h"
+#include "trng_core.h"
+
+extern "C" {
+#include "lzf.h"
+}
+
+#include <string.h>
+
+static const char capture_magic[4] = { 'T', 'L', 'Z', 'F' };
+
+static int write_u32(FILE *f, uint32_t v)
+{
+    uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+    return fwrite(b, 1, 4, f) == 4 ? 0 : -1;
+}
+
+static int read_u32(FILE *f, uint32_t *v)
+{
+    uint8_t b[4];
+    if (fread(b, 1, 4, f) != 4)
+    {
+        return -1;
+    }
+    *v = (uint32_t)b[0] | ((uint32_t)b[1] << 8) | ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+    return 0;
+}
+
+int lzf_capture_pack(FILE *in, FILE *out, size_t block_len)
+{
+    unsigned int hlog = lzf_ctx_hlog_for((unsigned int)block_len, 16);
+    std::vector<uint8_t> arena(lzf_ctx_state_size_mode(hlog, LZF_CTX_TAGGED));
+    std::vector<uint8_t> raw(block_len), comp(block_len), scratch(block_len);
+    lzf_ctx lzf;
+
+    if (block_len == 0 || lzf_ctx_init_mode(&lzf, hlog, LZF_CTX_TAGGED, &arena[0], arena.size()) != 0)
+    {
+        return -1;
+    }
+
+    if (fwrite(capture_magic, 1, 4, out) != 4 ||
+        write_u32(out, LZF_CAPTURE_VERSION) != 0 ||
+        write_u32(out, (uint32_t)block_len) != 0)
+    {
+        return -1;
+    }
+
+    size_t n = 0;
+    while ((n = fread(&raw[0], 1, block_len, in)) > 0)
+    {
+        /*Only keep the compressed form if it saves space and round trips*/
+        unsigned int comp_len = trng_core_compress(&raw[0], (unsigned int)n, &comp[0], (unsigned int)n - 1, &lzf);
+        if (comp_len != 0 && trng_core_verify(&comp[0], comp_len, &raw[0], (unsigned int)n, &scratch[0]) != 0)
+        {
+            return -1;
+        }
+
+        const uint8_t *data = comp_len ? &comp[0] : &raw[0];
+        size_t data_len = comp_len ? comp_len : n;
+        if (write_u32(out, (uint32_t)n) != 0 || write_u32(out, comp_len) != 0 ||
+            fwrite(data, 1, data_len, out) != data_len)
+        {
+            return -1;
+        }
+    }
+
+    return ferror(in) ? -1 : 0;
+}
+
+int lzf_capture_unpack(FILE *in, std::vector<uint8_t> &data)
+{
+    char magic[4];
+    uint32_t version = 0, block_len = 0;
+
+    if (fread(magic, 1, 4, in) != 4 || memcmp(magic, capture_magic, 4) != 0 ||
+        read_u32(in, &version) != 0 || version != LZF_CAPTURE_VERSION ||
+        read_u32(in, &block_len) != 0 || block_len == 0)
+    {
+        return -1;
+    }
+
+    std::vector<uint8_t> comp(block_len);
+    uint32_t raw_len = 0, comp_len = 0;
+    data.clear();
+
+    while (read_u32(in, &raw_len) == 0)
+    {
+        if (read_u32(in, &comp_len) != 0 || raw_len == 0 || raw_len > block_len || comp_len >= raw_len)
+        {
+            return -1;
+        }
+
+        size_t pos = data.size();
+        data.resize(pos + raw_len);
+
+        if (comp_len == 0)
+        {
+            if (fread(&data[pos], 1, raw_len, in) != raw_len)
+            {
+                return -1;
+            }
+            continue;
+        }
+
+        if (fread(&comp[0], 1, comp_len, in) != comp_len ||
+            lzf_decompress(&comp[0], comp_len, &data[pos], raw_len) != raw_len)
+        {
+            return -1;
+        }
+    }
+
+    return ferror(in) ? -1 : 0;
+}
+
+int lzf_capture_load(const char *path, std::vector<uint8_t> &data)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return -1;
+    }
+    int res = lzf_capture_unpack(f, data);
+    fclose(f);
+    return res;
+}
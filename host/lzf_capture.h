@@ -0,0 +1,47 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Compressed capture files: trng captures stored as a sequence of lzf
+* compressed blocks so they can be kept on disk and replayed later.
+*
+*   "TLZF" u32 version u32 block_len
+*   { u32 raw_len u32 comp_len data[comp_len ? comp_len : raw_len] } ...
+*
+* Integers are little endian, comp_len 0 means the block is stored raw.
+* Every compressed block is decompressed and compared before it is written.
+*/
+
+#ifndef TRNG_LZF_CAPTURE_H
+#define TRNG_LZF_CAPTURE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#define LZF_CAPTURE_VERSION     1
+
+/*Compress everything read from in into out, returns 0 on success*/
+int lzf_capture_pack(FILE *in, FILE *out, size_t block_len);
+
+/*Decompress a capture file into data, returns 0 on success*/
+int lzf_capture_unpack(FILE *in, std::vector<uint8_t> &data);
+
+/*Same as lzf_capture_unpack for a path*/
+int lzf_capture_load(const char *path, std::vector<uint8_t> &data);
+
+#endif
@@ -0,0 +1,167 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "qualify_pipeline.h"
+#include "host_util.h"
+#include "base64b.h"
+
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+extern "C" {
+#include "lzf.h"
+#include "lzfP.h"
+}
+
+/*Buffers of one thread, lzf_compress searches a table of its own*/
+struct pipeline_thread {
+    LZF_STATE htab;
+    pipeline_config cfg;
+    unsigned int out_len;
+    std::vector<uint8_t> comp;
+    std::vector<char> encoded;
+    std::vector<uint8_t> decoded;
+};
+
+struct pipeline_job {
+    const uint8_t *data;
+    size_t chunks;
+    size_t task_chunks;
+    std::vector<trng_stream_stats> *task_stats;
+    std::vector<pipeline_thread *> *threads;
+    std::vector<uint64_t> *transcode_failures;
+};
+
+pipeline_thread *pipeline_thread_new(const pipeline_config *cfg)
+{
+    if (cfg->chunk_len == 0 || cfg->percentage == 0 || cfg->percentage > 100)
+    {
+        return NULL;
+    }
+
+    pipeline_thread *t = new pipeline_thread;
+    t->cfg = *cfg;
+    t->out_len = trng_core_threshold(cfg->chunk_len, cfg->percentage);
+    t->comp.resize(t->out_len + 1);
+    if (cfg->transcode)
+    {
+        t->encoded.resize(base64_encoded_len(cfg->chunk_len));
+        t->decoded.resize(cfg->chunk_len);
+    }
+    return t;
+}
+
+void pipeline_thread_delete(pipeline_thread *t)
+{
+    delete t;
+}
+
+uint64_t pipeline_chunks(pipeline_thread *t, const uint8_t *data, size_t chunks, trng_stream_stats *stats)
+{
+    unsigned int chunk_len = t->cfg.chunk_len;
+    uint64_t transcode_failures = 0;
+
+    for (size_t c = 0; c < chunks; c++)
+    {
+        const uint8_t *chunk = data + c * chunk_len;
+
+        /*A clean table makes the verdict independent of the chunks the thread ran before, 0 means
+          the chunk does not fit below the threshold, the data is random*/
+        memset(t->htab, 0, sizeof(t->htab));
+        unsigned int comp_res = lzf_compress(chunk, chunk_len, &t->comp[0], t->out_len, (unsigned char **)t->htab);
+        stats->compressible_chunks += comp_res != 0;
+        stats->compressed_bytes += comp_res != 0 ? comp_res : chunk_len;
+        stats->chunks++;
+        trng_stream_stats_update(stats, chunk, chunk_len);
+
+        if (t->cfg.transcode)
+        {
+            size_t enc_len = base64_encode_to(chunk, chunk_len, &t->encoded[0], t->encoded.size());
+            size_t decoded = 0, error_pos = 0;
+            int b64_res = b64decode_strict(&t->encoded[0], enc_len, &t->decoded[0], t->decoded.size(),
+                                           &decoded, &error_pos);
+            if (b64_res != BASE64_OK || decoded != chunk_len || memcmp(&t->decoded[0], chunk, chunk_len) != 0)
+            {
+                transcode_failures++;
+            }
+        }
+    }
+    return transcode_failures;
+}
+
+static void pipeline_task(void *ctx, size_t index, unsigned int thread)
+{
+    pipeline_job *job = (pipeline_job *)ctx;
+    pipeline_thread *t = (*job->threads)[thread];
+    trng_stream_stats *stats = &(*job->task_stats)[index];
+    size_t first = index * job->task_chunks;
+    size_t end = first + job->task_chunks < job->chunks ? first + job->task_chunks : job->chunks;
+
+    trng_stream_stats_init(stats);
+    (*job->transcode_failures)[thread] += pipeline_chunks(t, job->data + first * t->cfg.chunk_len, end - first, stats);
+}
+
+int pipeline_qualify(const uint8_t *data, size_t len, const pipeline_config *cfg, pipeline_result *res)
+{
+    unsigned int threads = cfg->threads ? cfg->threads : 1;
+    if (cfg->chunk_len == 0 || cfg->percentage == 0 || cfg->percentage > 100)
+    {
+        return -1;
+    }
+
+    pipeline_job job;
+    job.data = data;
+    job.chunks = len / cfg->chunk_len;
+    job.task_chunks = cfg->task_chunks ? cfg->task_chunks : job.chunks / (64 * threads);
+    job.task_chunks = job.task_chunks ? job.task_chunks : 1;
+    size_t tasks = (job.chunks + job.task_chunks - 1) / job.task_chunks;
+    if (tasks > 0xffffffffU)
+    {
+        return -1;
+    }
+
+    std::vector<trng_stream_stats> task_stats(tasks);
+    std::vector<pipeline_thread *> thread_state(threads);
+    std::vector<uint64_t> transcode_failures(threads, 0);
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        thread_state[t] = pipeline_thread_new(cfg);
+    }
+    job.task_stats = &task_stats;
+    job.threads = &thread_state;
+    job.transcode_failures = &transcode_failures;
+
+    res->threads.assign(threads, work_thread_stats());
+    uint64_t start = host_now_ns();
+    work_run(threads, tasks, pipeline_task, &job, &res->threads[0]);
+
+    trng_stream_stats_init(&res->stats);
+    for (size_t i = 0; i < tasks; i++)
+    {
+        trng_stream_stats_merge(&res->stats, &task_stats[i]);
+    }
+    res->elapsed_ns = host_now_ns() - start;
+    res->stats.elapsed_us = res->elapsed_ns / 1000;
+    res->tasks = tasks;
+    res->transcode_failures = 0;
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        res->transcode_failures += transcode_failures[t];
+        pipeline_thread_delete(thread_state[t]);
+    }
+    return 0;
+}
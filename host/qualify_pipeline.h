@@ -0,0 +1,68 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Parallel qualification of a capture held in memory: the capture is split
+* into chunks, runs of chunks are handed to the work stealing scheduler
+* (work_pool.h) and every chunk goes through the compression check with
+* lzf_compress on a table of its thread (an LZF_STATE each, cleared for
+* every chunk), optionally a base64 round trip as the device transfer does
+* it, and the running statistics of trng_stream.h. Every task keeps the
+* statistics of its own run of chunks, they are merged in capture order at
+* the end, so the result does not depend on the number of threads and the
+* statistics are the ones trng_stream_qualify gets from the same data.
+*/
+
+#ifndef TRNG_QUALIFY_PIPELINE_H
+#define TRNG_QUALIFY_PIPELINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "trng_stream.h"
+#include "work_pool.h"
+
+typedef struct {
+    unsigned int chunk_len;             //bytes per chunk, a partial last chunk is left out
+    unsigned int percentage;            //compression threshold, as COMPRESS_TEST_PERCENTAGE
+    unsigned int threads;
+    unsigned int task_chunks;           //chunks per task, 0 - enough tasks for 64 per thread
+    int transcode;                      //round trip every chunk through base64_encode_to and b64decode_strict
+} pipeline_config;
+
+typedef struct {
+    trng_stream_stats stats;            //statistics of the whole capture
+    uint64_t transcode_failures;        //chunks the base64 round trip did not reproduce
+    uint64_t tasks;
+    uint64_t elapsed_ns;
+    std::vector<work_thread_stats> threads;
+} pipeline_result;
+
+/*Buffers of a thread qualifying chunks, for callers scheduling chunks on their own*/
+struct pipeline_thread;
+
+/*Buffers for chunks of cfg, NULL if the configuration is unusable*/
+pipeline_thread *pipeline_thread_new(const pipeline_config *cfg);
+void pipeline_thread_delete(pipeline_thread *t);
+
+/*Qualify the chunks chunks at data into stats, as pipeline_qualify does every chunk. Returns
+  the number of chunks the base64 round trip did not reproduce*/
+uint64_t pipeline_chunks(pipeline_thread *t, const uint8_t *data, size_t chunks, trng_stream_stats *stats);
+
+/*Qualify the len bytes of data. Returns 0, or -1 if the configuration is unusable*/
+int pipeline_qualify(const uint8_t *data, size_t len, const pipeline_config *cfg, pipeline_result *res);
+
+#endif
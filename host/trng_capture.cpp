@@ -0,0 +1,321 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Capture server for a continuous trng stream from the board, see capture_server.h.
+*
+*   trng_capture [--device PATH] [--baud N] [--format raw|link] [--out capture.bin]
+*                [--chunk 64K] [--screen 4096] [--percentage 99] [--threads N] [--transcode]
+*                [--nist] [--max-bytes 16G] [--limit N] [--progress 1000]
+*                [--stand-in pty|pipe] [--source ...] [--bytes 64M] [--write-max 4096]
+*                [--frame 1024] [--window 4]
+*
+* The stream is read from --device, a serial line (set raw, and to --baud if given),
+* a pseudo terminal or a fifo, or from stdin when it is "-" or not given. The capture
+* goes to --out and its chunk index to --out.idx. Analysis runs on --threads threads
+* (the number of cores by default), every chunk is screened in pieces of --screen
+* bytes. Progress goes to stderr every --progress ms, ^C ends the capture.
+*
+* --stand-in feeds the server from a board stand-in on a thread of its own through a
+* pseudo terminal or a pipe: --bytes of the --source output, in writes of 1 to
+* --write-max bytes, in the --format the server reads.
+*
+* Exits with 1 if any piece compressed below the threshold, with 3 if a base64 round
+* trip failed and with 4 if an SP 800-22 p-value is below NIST_REJECT.
+*/
+
+#include "host_util.h"
+#include "capture_server.h"
+#include "trng_core.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define NIST_ALPHA          0.01                //significance level of SP 800-22
+#define NIST_REJECT         0.0001              //p-value that fails the run, one in 100 tests is below alpha by chance
+
+/*Lock free, so the signal handler may set it*/
+static std::atomic<int> stop_capture(0);
+
+static void on_interrupt(int sig)
+{
+    stop_capture = 1;
+}
+
+static speed_t baud_of(uint64_t baud)
+{
+    static const struct { uint64_t baud; speed_t speed; } speeds[] = {
+        { 9600, B9600 }, { 19200, B19200 }, { 38400, B38400 }, { 57600, B57600 }, { 115200, B115200 },
+        { 230400, B230400 }, { 460800, B460800 }, { 921600, B921600 },
+    };
+    for (size_t i = 0; i < sizeof(speeds) / sizeof(speeds[0]); i++)
+    {
+        if (speeds[i].baud == baud)
+        {
+            return speeds[i].speed;
+        }
+    }
+    return B0;
+}
+
+/*Raw mode, so line discipline neither echoes ACKs back nor rewrites bytes*/
+static int set_raw(int fd, uint64_t baud)
+{
+    struct termios tio;
+    if (tcgetattr(fd, &tio) != 0)
+    {
+        return -1;
+    }
+    cfmakeraw(&tio);
+    if (baud != 0 && (baud_of(baud) == B0 || cfsetspeed(&tio, baud_of(baud)) != 0))
+    {
+        return -1;
+    }
+    return tcsetattr(fd, TCSANOW, &tio);
+}
+
+static int fill_source(void *ctx, uint8_t *buf, size_t len)
+{
+    return trng_core_fill((trng_t *)ctx, buf, len);
+}
+
+static void progress(const capture_result *res, void *ctx)
+{
+    double secs = (double)res->elapsed_ns / 1e9;
+    fprintf(stderr, "%8.1f s  %llu bytes (%.2f MB/s), %llu chunks, %llu analysed, %llu compressible\n", secs,
+            (unsigned long long)res->bytes, secs > 0 ? (double)res->bytes / (1024.0 * 1024.0) / secs : 0.0,
+            (unsigned long long)res->chunks, (unsigned long long)res->analysed_chunks,
+            (unsigned long long)res->stats.compressible_chunks);
+}
+
+int main(int argc, char **argv)
+{
+    const char *device = host_arg(argc, argv, "device", "-");
+    const char *format = host_arg(argc, argv, "format", "raw");
+    const char *stand_in = host_arg(argc, argv, "stand-in", NULL);
+    uint64_t baud = host_size_arg(argc, argv, "baud", 0);
+    bool nist = false;
+
+    capture_config cfg;
+    cfg.path = host_arg(argc, argv, "out", "capture.bin");
+    cfg.format = strcmp(format, "link") == 0 ? CAPTURE_LINK : strcmp(format, "raw") == 0 ? CAPTURE_RAW : -1;
+    cfg.chunk_len = (uint32_t)host_size_arg(argc, argv, "chunk", 64 << 10);
+    cfg.max_bytes = host_size_arg(argc, argv, "max-bytes", 16ull << 30);
+    cfg.limit = host_size_arg(argc, argv, "limit", 0);
+    cfg.qualify.chunk_len = (unsigned int)host_size_arg(argc, argv, "screen", 4096);
+    cfg.qualify.percentage = (unsigned int)host_size_arg(argc, argv, "percentage", 99);
+    cfg.qualify.threads = (unsigned int)host_size_arg(argc, argv, "threads", std::thread::hardware_concurrency());
+    cfg.qualify.task_chunks = 0;
+    cfg.qualify.transcode = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        cfg.qualify.transcode |= strcmp(argv[i], "--transcode") == 0;
+        nist |= strcmp(argv[i], "--nist") == 0;
+    }
+    cfg.nist = NULL;
+    cfg.stop = &stop_capture;
+    cfg.progress_ms = (uint32_t)host_size_arg(argc, argv, "progress", 1000);
+    cfg.progress = progress;
+    cfg.progress_ctx = NULL;
+
+    trng_nist_config nist_cfg;
+    trng_nist_config_default(&nist_cfg);
+    std::vector<double> nist_arena(trng_nist_state_size(&nist_cfg) / sizeof(double) + 1);
+    trng_nist nist_state;
+    if (nist)
+    {
+        trng_nist_init(&nist_state, &nist_cfg, &nist_arena[0], nist_arena.size() * sizeof(double));
+        cfg.nist = &nist_state;
+    }
+    if (cfg.format < 0)
+    {
+        fprintf(stderr, "--format must be raw or link\n");
+        return 2;
+    }
+
+    /*The server reads in_fd and answers on ack_fd, a stand-in board sits on the other ends*/
+    int in_fd = 0, ack_fd = -1, board_fd = -1;
+    if (stand_in != NULL && strcmp(stand_in, "pty") == 0)
+    {
+        board_fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (board_fd < 0 || grantpt(board_fd) != 0 || unlockpt(board_fd) != 0 ||
+            (in_fd = open(ptsname(board_fd), O_RDWR | O_NOCTTY)) < 0 || set_raw(in_fd, 0) != 0)
+        {
+            perror("pseudo terminal");
+            return 2;
+        }
+        ack_fd = in_fd;
+    }
+    else if (stand_in != NULL && strcmp(stand_in, "pipe") == 0)
+    {
+        /*A pipe carries one direction, the framed transport needs ACKs the other way*/
+        int fds[2];
+        if (cfg.format == CAPTURE_LINK || pipe(fds) != 0)
+        {
+            fprintf(stderr, "--stand-in pipe carries raw streams only\n");
+            return 2;
+        }
+        in_fd = fds[0];
+        board_fd = fds[1];
+    }
+    else if (stand_in != NULL)
+    {
+        fprintf(stderr, "--stand-in must be pty or pipe\n");
+        return 2;
+    }
+    else if (strcmp(device, "-") != 0)
+    {
+        in_fd = open(device, O_RDWR | O_NOCTTY);
+        if (in_fd < 0 || (isatty(in_fd) && set_raw(in_fd, baud) != 0))
+        {
+            fprintf(stderr, "cannot open %s%s\n", device, in_fd >= 0 ? " at that --baud" : "");
+            return 2;
+        }
+        ack_fd = in_fd;
+    }
+
+    std::thread board;
+    trng_t trng_obj;
+    trng_link_tx_stats board_stats;
+    int board_res = 0;
+    capture_device_config dev;
+    if (board_fd >= 0)
+    {
+        if (host_select_source(argc, argv) != 0)
+        {
+            return 2;
+        }
+        trng_init(&trng_obj);
+        dev.format = cfg.format;
+        dev.bytes = host_size_arg(argc, argv, "bytes", 64 << 20);
+        dev.write_max = (uint32_t)host_size_arg(argc, argv, "write-max", 4096);
+        dev.frame_len = (uint32_t)host_size_arg(argc, argv, "frame", 1024);
+        dev.window = (uint32_t)host_size_arg(argc, argv, "window", 4);
+        dev.seed = 1;
+        dev.fill = fill_source;
+        dev.fill_ctx = &trng_obj;
+        memset(&board_stats, 0, sizeof(board_stats));
+
+        /*Raw over a pseudo terminal has no end of stream, the server stops at the byte count*/
+        if (cfg.format == CAPTURE_RAW && (cfg.limit == 0 || cfg.limit > dev.bytes))
+        {
+            cfg.limit = dev.bytes;
+        }
+        board = std::thread([&] {
+            board_res = capture_device(board_fd, &dev, &board_stats);
+            if (ack_fd < 0)
+            {
+                close(board_fd);        //end of the pipe, the server sees the end of the stream
+            }
+        });
+    }
+
+    signal(SIGINT, on_interrupt);
+    signal(SIGPIPE, SIG_IGN);
+    capture_result res;
+    int err = capture_run(in_fd, ack_fd, &cfg, &res);
+    if (board.joinable())
+    {
+        board.join();
+        trng_free(&trng_obj);
+        if (ack_fd >= 0)
+        {
+            close(board_fd);
+        }
+    }
+    if (err == CAPTURE_ERR_CONFIG)
+    {
+        fprintf(stderr, "--chunk must be a multiple of --screen, --screen not 0, --percentage 1 to 100 "
+                "and --max-bytes not 0\n");
+        return 2;
+    }
+
+    trng_stream_summary summary;
+    trng_stream_summarize(&res.stats, &summary);
+    double secs = (double)res.elapsed_ns / 1e9;
+    printf("capture             %llu bytes to %s, %llu chunks indexed in %s.idx\n", (unsigned long long)res.bytes,
+           cfg.path, (unsigned long long)res.chunks, cfg.path);
+    printf("throughput          %.2f MB/s in %.2f s, %u analysis threads, %llu chunks backlog at most\n",
+           secs > 0 ? (double)res.bytes / (1024.0 * 1024.0) / secs : 0.0, secs, cfg.qualify.threads,
+           (unsigned long long)res.backlog_max);
+    printf("receive path        %llu reads, %.1f us each on average, %.1f us at most\n", (unsigned long long)res.reads,
+           res.reads ? (double)res.receive_ns / 1e3 / (double)res.reads : 0.0, (double)res.receive_max_ns / 1e3);
+    if (cfg.format == CAPTURE_LINK)
+    {
+        printf("link                %llu frames, %llu damaged, %llu out of sequence, %llu acks, %llu other lines\n",
+               (unsigned long long)res.link.frames, (unsigned long long)res.link.damaged,
+               (unsigned long long)res.link.out_of_sequence, (unsigned long long)res.acks,
+               (unsigned long long)res.skipped_lines);
+    }
+    if (board_fd >= 0 && board_res != 0)
+    {
+        printf("stand-in            failed with %d\n", board_res);
+    }
+    printf("compressible chunks %llu of %llu (threshold %u%%)\n", (unsigned long long)res.stats.compressible_chunks,
+           (unsigned long long)res.stats.chunks, cfg.qualify.percentage);
+    printf("compression ratio   %.4f\n", summary.compression_ratio);
+    if (cfg.qualify.transcode)
+    {
+        printf("base64 round trips  %llu failed\n", (unsigned long long)res.transcode_failures);
+    }
+    printf("mean                %.4f (127.5)\n", summary.mean);
+    printf("bit bias            %.6f (0.5)\n", summary.bit_bias);
+    printf("chi square          %.2f (255 degrees of freedom)\n", summary.chi_square);
+    printf("entropy             %.6f bits/byte\n", summary.entropy);
+    printf("serial correlation  %.6f (0.0)\n", summary.serial_correlation);
+
+    unsigned int nist_rejects = 0;
+    if (nist)
+    {
+        trng_nist_result nist_res;
+        trng_nist_final(&nist_state, &nist_res);
+        printf("sp 800-22           %u of %d tests below %.2f\n", trng_nist_failures(&nist_res, NIST_ALPHA),
+               TRNG_NIST_TESTS, NIST_ALPHA);
+        for (unsigned int i = 0; i < TRNG_NIST_TESTS; i++)
+        {
+            if (nist_res.p[i] < 0.0)
+            {
+                printf("  %-19s not enough data\n", trng_nist_test_name(i));
+                continue;
+            }
+            printf("  %-19s p = %.6f%s\n", trng_nist_test_name(i), nist_res.p[i], nist_res.p[i] < NIST_ALPHA ? " *" : "");
+        }
+        nist_rejects = trng_nist_failures(&nist_res, NIST_REJECT);
+    }
+
+    if (err != 0)
+    {
+        fprintf(stderr, "capture ended with error %d\n", err);
+        return 2;
+    }
+    if (res.transcode_failures != 0)
+    {
+        return 3;
+    }
+    if (nist_rejects != 0)
+    {
+        return 4;
+    }
+    return res.stats.compressible_chunks != 0 ? 1 : 0;
+}
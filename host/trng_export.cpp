@@ -0,0 +1,204 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Export of trng output through the framed transport of trng_link.h over a
+* loopback stand-in of the greentea serial line, for trying frame sizes,
+* windows and line errors without hardware.
+*
+*   trng_export [--source ...] [--bytes 1M] [--frame 1024] [--window 4] [--baud 9600]
+*               [--loss N] [--seed N] [--out path]
+*
+* Frames travel base64 encoded in {{link_frame;...}} lines and ACKs in
+* {{link_ack;...}} lines, as between the device test and trng_reset.py, and
+* --loss N of every 10000 lines in either direction is damaged. The time the
+* exchange takes at --baud (8N1, one direction at a time) is computed from
+* the bytes of the lines, nothing waits. --out writes what the receiving end
+* got. Exits with 3 if that differs from what was sent.
+*/
+
+#include "host_util.h"
+#include "trng_core.h"
+#include "trng_link.h"
+#include "base64b.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+struct line {
+    trng_link_tx *tx;
+    trng_link_rx rx;
+    std::vector<uint8_t> received;
+    uint32_t loss;                      //lines damaged per 10000
+    uint64_t device_bytes;              //line bytes from the device
+    uint64_t host_bytes;                //line bytes from the host
+    uint64_t lines;
+    uint64_t damaged;
+};
+
+/*Carry a message across the line as greentea does, damaging it at the loss rate. Returns
+  the bytes decoded from the value, or an empty buffer if it did not arrive whole*/
+static std::vector<uint8_t> carry(line *ln, const char *key, const uint8_t *data, size_t len, uint64_t *wire)
+{
+    std::string value(base64_encoded_len(len), '\0');
+    value.resize(base64_encode_to(data, len, &value[0], value.size()));
+    *wire += strlen(key) + value.size() + 6;
+    ln->lines++;
+
+    if ((uint32_t)(rand() % 10000) < ln->loss)
+    {
+        value[rand() % value.size()] ^= (char)(1 + rand() % 127);
+        ln->damaged++;
+    }
+
+    std::vector<uint8_t> out(len);
+    size_t decoded = 0, error_pos = 0;
+    if (b64decode_strict(value.c_str(), value.size(), &out[0], out.size(), &decoded, &error_pos) != BASE64_OK)
+    {
+        out.clear();
+    }
+    out.resize(decoded < out.size() ? decoded : out.size());
+    return out;
+}
+
+static int line_send(void *ctx, const uint8_t *frame, size_t len)
+{
+    line *ln = (line *)ctx;
+    std::vector<uint8_t> got = carry(ln, "link_frame", frame, len, &ln->device_bytes);
+    trng_link_rx_frame(&ln->rx, got.empty() ? NULL : &got[0], got.size());
+    return 0;
+}
+
+static void line_deliver(void *ctx, const uint8_t *data, size_t len)
+{
+    line *ln = (line *)ctx;
+    ln->received.insert(ln->received.end(), data, data + len);
+}
+
+/*{{link_sync;0}} out, {{link_ack;...}} back, again until an ACK arrives whole*/
+static int line_sync(line *ln)
+{
+    for (;;)
+    {
+        ln->device_bytes += strlen("{{link_sync;0}}\n");
+        uint8_t ack[TRNG_LINK_HEADER];
+        trng_link_rx_ack(&ln->rx, ack);
+        std::vector<uint8_t> got = carry(ln, "link_ack", ack, sizeof(ack), &ln->host_bytes);
+        int res = trng_link_tx_ack(ln->tx, got.empty() ? NULL : &got[0], got.size());
+        if (res != TRNG_LINK_ERR_FRAME)
+        {
+            return res;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (host_select_source(argc, argv) != 0)
+    {
+        return 2;
+    }
+
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 1 << 20);
+    uint64_t baud = host_size_arg(argc, argv, "baud", 9600);
+    const char *out_path = host_arg(argc, argv, "out", NULL);
+    trng_link_tx_config cfg;
+    cfg.frame_len = (uint32_t)host_size_arg(argc, argv, "frame", 1024);
+    cfg.window = (uint32_t)host_size_arg(argc, argv, "window", 4);
+    cfg.send = line_send;
+
+    line ln;
+    trng_link_tx tx;
+    ln.tx = &tx;
+    ln.loss = (uint32_t)host_size_arg(argc, argv, "loss", 0);
+    ln.device_bytes = ln.host_bytes = ln.lines = ln.damaged = 0;
+    cfg.ctx = &ln;
+    srand((unsigned int)host_size_arg(argc, argv, "seed", 1));
+    trng_link_rx_init(&ln.rx, line_deliver, &ln);
+
+    std::vector<uint8_t> frames(TRNG_LINK_TX_SIZE(cfg.window, cfg.frame_len));
+    if (baud == 0 || ln.loss >= 10000 || trng_link_tx_init(&tx, &cfg, frames.data(), frames.size()) != 0)
+    {
+        fprintf(stderr, "--frame must be 1 to 65535, --window at least 1, --baud not 0 and --loss below 10000\n");
+        return 2;
+    }
+
+    std::vector<uint8_t> sent;
+    sent.reserve(len);
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    uint8_t chunk[4096];
+    uint64_t start = host_now_ns();
+    int res = 0;
+    while (sent.size() < len && res >= 0)
+    {
+        size_t n = len - sent.size() < sizeof(chunk) ? len - sent.size() : sizeof(chunk);
+        if (trng_core_fill(&trng_obj, chunk, n) != 0)
+        {
+            break;
+        }
+        sent.insert(sent.end(), chunk, chunk + n);
+        for (size_t pos = 0; pos < n && res >= 0;)
+        {
+            res = trng_link_tx_write(&tx, chunk + pos, n - pos);
+            pos += res > 0 ? (size_t)res : 0;
+            while (res >= 0 && trng_link_tx_window_full(&tx))
+            {
+                res = line_sync(&ln);
+            }
+        }
+    }
+    trng_free(&trng_obj);
+    res = res >= 0 ? trng_link_tx_flush(&tx) : res;
+    while (res >= 0 && trng_link_tx_in_flight(&tx) != 0)
+    {
+        res = line_sync(&ln);
+    }
+    uint64_t cpu_ns = host_now_ns() - start;
+    ln.device_bytes += strlen("{{link_end;0}}\n");
+    ln.host_bytes += strlen("{{link_done;1048576 00000000}}\n");
+
+    if (out_path != NULL)
+    {
+        FILE *f = fopen(out_path, "wb");
+        if (f == NULL || fwrite(ln.received.data(), 1, ln.received.size(), f) != ln.received.size())
+        {
+            fprintf(stderr, "cannot write %s\n", out_path);
+            return 2;
+        }
+        fclose(f);
+    }
+
+    /*8N1 takes 10 bit times a byte, the device waits for every ACK*/
+    uint64_t wire = ln.device_bytes + ln.host_bytes;
+    double line_secs = (double)wire * 10.0 / (double)baud;
+    printf("payload             %zu bytes sent, %zu received, CRC-32 %08x\n", sent.size(), ln.received.size(),
+           trng_core_crc32(0, ln.received.data(), ln.received.size()));
+    printf("frames              %llu sent, %llu resent, %llu acks, %llu of %llu lines damaged\n",
+           (unsigned long long)tx.stats.frames, (unsigned long long)tx.stats.resent, (unsigned long long)tx.stats.acks,
+           (unsigned long long)ln.damaged, (unsigned long long)ln.lines);
+    printf("line                %llu bytes from the device, %llu from the host\n",
+           (unsigned long long)ln.device_bytes, (unsigned long long)ln.host_bytes);
+    printf("line time           %.1f s at %llu baud, %.0f B/s of payload, %.1f%% of the line rate\n", line_secs,
+           (unsigned long long)baud, line_secs > 0 ? (double)ln.received.size() / line_secs : 0.0,
+           wire ? 100.0 * (double)ln.received.size() / (double)wire : 0.0);
+    printf("host time           %.3f s\n", (double)cpu_ns / 1e9);
+
+    return res < 0 || ln.received != sent ? 3 : 0;
+}
@@ -0,0 +1,225 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "hal/trng_api.h"
+#include "trng_host.h"
+#include "lzf_capture.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+enum trng_host_source {
+    TRNG_HOST_URANDOM,
+    TRNG_HOST_FILE,
+    TRNG_HOST_REPLAY
+};
+
+static trng_host_source source = TRNG_HOST_URANDOM;
+static std::string file_path;
+static std::vector<uint8_t> replay_storage;
+static const uint8_t *replay_buf = NULL;
+static size_t replay_len = 0;
+static size_t max_chunk = 0;
+static uint32_t delay_call_ns = 0;
+static uint32_t delay_byte_ns = 0;
+
+void trng_host_use_urandom(void)
+{
+    source = TRNG_HOST_URANDOM;
+}
+
+int trng_host_use_file(const char *path)
+{
+    if (access(path, R_OK) != 0)
+    {
+        return -1;
+    }
+    file_path = path;
+    source = TRNG_HOST_FILE;
+    return 0;
+}
+
+void trng_host_use_replay(const uint8_t *buf, size_t len)
+{
+    replay_buf = buf;
+    replay_len = len;
+    source = TRNG_HOST_REPLAY;
+}
+
+int trng_host_use_replay_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        return -1;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t chunk[4096];
+    size_t n = 0;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+    {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    fclose(f);
+
+    if (data.empty())
+    {
+        return -1;
+    }
+
+    replay_storage.swap(data);
+    trng_host_use_replay(&replay_storage[0], replay_storage.size());
+    return 0;
+}
+
+int trng_host_use_lzf_file(const char *path)
+{
+    std::vector<uint8_t> data;
+    if (lzf_capture_load(path, data) != 0 || data.empty())
+    {
+        return -1;
+    }
+
+    replay_storage.swap(data);
+    trng_host_use_replay(&replay_storage[0], replay_storage.size());
+    return 0;
+}
+
+int trng_host_use_source(const char *spec)
+{
+    if (strcmp(spec, "urandom") == 0)
+    {
+        trng_host_use_urandom();
+        return 0;
+    }
+    if (strncmp(spec, "file:", 5) == 0)
+    {
+        return trng_host_use_file(spec + 5);
+    }
+    if (strncmp(spec, "replay:", 7) == 0)
+    {
+        return trng_host_use_replay_file(spec + 7);
+    }
+    if (strncmp(spec, "lzf:", 4) == 0)
+    {
+        return trng_host_use_lzf_file(spec + 4);
+    }
+    return -1;
+}
+
+void trng_host_set_max_chunk(size_t chunk)
+{
+    max_chunk = chunk;
+}
+
+void trng_host_set_delay(uint32_t call_ns, uint32_t byte_ns)
+{
+    delay_call_ns = call_ns;
+    delay_byte_ns = byte_ns;
+}
+
+static void delay(size_t length)
+{
+    uint64_t ns = delay_call_ns + (uint64_t)delay_byte_ns * length;
+    struct timespec ts;
+    ts.tv_sec = (time_t)(ns / 1000000000u);
+    ts.tv_nsec = (long)(ns % 1000000000u);
+    while (ns != 0 && nanosleep(&ts, &ts) != 0 && errno == EINTR)
+    {
+    }
+}
+
+void trng_init(trng_t *obj)
+{
+    obj->fd = -1;
+    obj->replay_pos = 0;
+
+    if (source == TRNG_HOST_URANDOM)
+    {
+        obj->fd = open("/dev/urandom", O_RDONLY);
+    }
+    else if (source == TRNG_HOST_FILE)
+    {
+        obj->fd = open(file_path.c_str(), O_RDONLY);
+    }
+}
+
+void trng_free(trng_t *obj)
+{
+    if (obj->fd >= 0)
+    {
+        close(obj->fd);
+    }
+    obj->fd = -1;
+}
+
+int trng_get_bytes(trng_t *obj, uint8_t *output, size_t length, size_t *output_length)
+{
+    *output_length = 0;
+
+    if (max_chunk != 0 && length > max_chunk)
+    {
+        length = max_chunk;
+    }
+    delay(length);
+
+    if (source == TRNG_HOST_REPLAY)
+    {
+        if (replay_len == 0)
+        {
+            return -1;
+        }
+        while (*output_length < length)
+        {
+            size_t n = replay_len - obj->replay_pos;
+            if (n > length - *output_length)
+            {
+                n = length - *output_length;
+            }
+            memcpy(output + *output_length, replay_buf + obj->replay_pos, n);
+            *output_length += n;
+            obj->replay_pos = (obj->replay_pos + n) % replay_len;
+        }
+        return 0;
+    }
+
+    if (obj->fd < 0)
+    {
+        return -1;
+    }
+
+    ssize_t res = 0;
+    do
+    {
+        res = read(obj->fd, output, length);
+    } while (res < 0 && errno == EINTR);
+
+    /*A drained capture file is reported as a driver error, never as an empty read*/
+    if (res <= 0)
+    {
+        return -1;
+    }
+
+    *output_length = (size_t)res;
+    return 0;
+}
@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Selects the source behind the host trng_api stand-in, the selection applies
+* to every trng_t initialized after the call.
+*/
+
+#ifndef TRNG_HOST_H
+#define TRNG_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*Read from /dev/urandom (default)*/
+void trng_host_use_urandom(void);
+
+/*Read a capture file sequentially, trng_get_bytes fails once the file is exhausted*/
+int trng_host_use_file(const char *path);
+
+/*Replay buf cyclically, buf must outlive every trng_t using it*/
+void trng_host_use_replay(const uint8_t *buf, size_t len);
+
+/*Load path into memory and replay it cyclically*/
+int trng_host_use_replay_file(const char *path);
+
+/*Decompress an lzf capture file (see lzf_capture.h) into memory and replay it cyclically*/
+int trng_host_use_lzf_file(const char *path);
+
+/*Parse "urandom", "file:<path>", "replay:<path>" or "lzf:<path>" and select that source*/
+int trng_host_use_source(const char *spec);
+
+/*Return at most max_chunk bytes per trng_get_bytes call (0 - no limit), used to
+  exercise the partial read path of the callers*/
+void trng_host_set_max_chunk(size_t max_chunk);
+
+/*Make every trng_get_bytes call take call_ns plus byte_ns per byte asked for (0, 0 - no delay),
+  slept so other threads run meanwhile, like a driver waiting for the hardware to gather entropy*/
+void trng_host_set_delay(uint32_t call_ns, uint32_t byte_ns);
+
+#endif
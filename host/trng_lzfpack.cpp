@@ -0,0 +1,83 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Packs raw trng captures into lzf compressed capture files (see
+* lzf_capture.h) and back:
+*
+*   trng_lzfpack <raw> <packed> [--block 64K]
+*   trng_lzfpack -d <packed> <raw>
+*
+* Packed files are replayed by the host tools with --source lzf:<path>.
+*/
+
+#include "host_util.h"
+#include "lzf_capture.h"
+
+#include <stdio.h>
+#include <string.h>
+
+int main(int argc, char **argv)
+{
+    bool unpack = argc > 1 && strcmp(argv[1], "-d") == 0;
+    int first = unpack ? 2 : 1;
+
+    if (argc < first + 2)
+    {
+        fprintf(stderr, "usage: %s <raw> <packed> [--block N] | -d <packed> <raw>\n", argv[0]);
+        return 2;
+    }
+
+    FILE *in = fopen(argv[first], "rb");
+    FILE *out = in != NULL ? fopen(argv[first + 1], "wb") : NULL;
+    if (out == NULL)
+    {
+        fprintf(stderr, "cannot open %s\n", in == NULL ? argv[first] : argv[first + 1]);
+        if (in != NULL)
+        {
+            fclose(in);
+        }
+        return 2;
+    }
+
+    int res = 0;
+    if (unpack)
+    {
+        std::vector<uint8_t> data;
+        res = lzf_capture_unpack(in, data);
+        if (res == 0 && !data.empty() && fwrite(&data[0], 1, data.size(), out) != data.size())
+        {
+            res = -1;
+        }
+    }
+    else
+    {
+        res = lzf_capture_pack(in, out, (size_t)host_size_arg(argc, argv, "block", 64 << 10));
+    }
+
+    fclose(in);
+    if (fclose(out) != 0)
+    {
+        res = -1;
+    }
+
+    if (res != 0)
+    {
+        fprintf(stderr, "%s failed\n", unpack ? "unpack" : "pack");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* SP 800-90B min-entropy of the trng stand-in source, see trng_entropy.h.
+*
+*   trng_minentropy [--source ...] [--bytes 1M] [--bits 8] [--threads N] [--bitstring-max 1M]
+*
+* Reads --bytes samples through trng_get_bytes, keeps the low --bits bits of
+* each and runs every estimator on them, and for samples of more than a bit
+* on the bit string of the first --bitstring-max bits as well. Estimators run
+* in parallel on --threads threads (the number of cores by default). The
+* result is the smallest estimate per sample, with the estimates per bit
+* multiplied by the sample size.
+*/
+
+#include "host_util.h"
+#include "trng_entropy.h"
+#include "hal/trng_api.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+struct entropy_task {
+    int estimator;
+    bool binary;                        //on the bit string
+    double estimate;
+    double lrs;                         //LRS for the tuple task
+    uint64_t ns;
+};
+
+struct entropy_run {
+    const std::vector<uint8_t> *samples;
+    const std::vector<uint8_t> *bitstring;
+    unsigned int bits;
+    std::vector<entropy_task> tasks;
+    std::atomic<size_t> next;
+};
+
+static void run_tasks(entropy_run *run)
+{
+    for (size_t i = run->next++; i < run->tasks.size(); i = run->next++)
+    {
+        entropy_task *task = &run->tasks[i];
+        const std::vector<uint8_t> &s = task->binary ? *run->bitstring : *run->samples;
+        unsigned int bits = task->binary ? 1 : run->bits;
+        std::vector<uint64_t> work(trng_entropy_work_size(task->estimator, s.size(), bits) / sizeof(uint64_t) + 1);
+        size_t work_len = work.size() * sizeof(uint64_t);
+
+        uint64_t start = host_now_ns();
+        if (task->estimator == TRNG_ENTROPY_TTUPLE)
+        {
+            trng_entropy_tuples(&s[0], s.size(), bits, &work[0], work_len, &task->estimate, &task->lrs);
+        }
+        else
+        {
+            task->estimate = trng_entropy_estimate(task->estimator, &s[0], s.size(), bits, &work[0], work_len);
+        }
+        task->ns = host_now_ns() - start;
+    }
+}
+
+static bool report_order(const entropy_task &a, const entropy_task &b)
+{
+    return a.binary != b.binary ? b.binary : a.estimator < b.estimator;
+}
+
+static int acquire(uint8_t *buf, size_t len)
+{
+    trng_t trng_obj;
+    size_t pos = 0;
+
+    trng_init(&trng_obj);
+    while (pos < len)
+    {
+        size_t got = 0;
+        if (trng_get_bytes(&trng_obj, buf + pos, len - pos, &got) != 0 || got == 0)
+        {
+            break;
+        }
+        pos += got;
+    }
+    trng_free(&trng_obj);
+    return pos == len ? 0 : -1;
+}
+
+static void print_estimate(const char *name, const char *on, double h, double scale, uint64_t ns)
+{
+    if (h == TRNG_ENTROPY_NA)
+    {
+        printf("%-18s %-10s        n/a %9.1f ms\n", name, on, ns / 1e6);
+    }
+    else
+    {
+        printf("%-18s %-10s %10.6f %9.1f ms\n", name, on, h * scale, ns / 1e6);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (host_select_source(argc, argv) != 0)
+    {
+        return 2;
+    }
+
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 1 << 20);
+    unsigned int bits = (unsigned int)host_size_arg(argc, argv, "bits", 8);
+    unsigned int threads = (unsigned int)host_size_arg(argc, argv, "threads", std::thread::hardware_concurrency());
+    size_t bitstring_max = (size_t)host_size_arg(argc, argv, "bitstring-max", 1 << 20);
+
+    if (len < 2 || len >= 0xffffffffUL || bits < 1 || bits > 8 || bitstring_max < 2)
+    {
+        fprintf(stderr, "--bytes must be 2 to 4G - 1, --bits 1 to 8 and --bitstring-max at least 2\n");
+        return 2;
+    }
+    threads = threads ? threads : 1;
+
+    std::vector<uint8_t> samples(len), bitstring;
+    if (acquire(&samples[0], len) != 0)
+    {
+        fprintf(stderr, "cannot acquire %zu bytes\n", len);
+        return 1;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        samples[i] &= (uint8_t)((1U << bits) - 1);
+    }
+    if (bits > 1)
+    {
+        bitstring.resize(len * bits < bitstring_max ? len * bits : bitstring_max);
+        trng_entropy_bitstring(&samples[0], len, bits, &bitstring[0], bitstring.size());
+    }
+
+    entropy_run run;
+    run.samples = &samples;
+    run.bitstring = &bitstring;
+    run.bits = bits;
+    run.next = 0;
+    for (int pass = 0; pass < (bits > 1 ? 2 : 1); pass++)
+    {
+        for (int e = 0; e < TRNG_ENTROPY_ESTIMATORS; e++)
+        {
+            /*LRS comes with the t-tuple estimate, the binary estimators only run on bits*/
+            if (e == TRNG_ENTROPY_LRS || (pass == 0 && bits > 1 && trng_entropy_binary_only(e)))
+            {
+                continue;
+            }
+            entropy_task task = { e, pass == 1 || bits == 1, TRNG_ENTROPY_NA, TRNG_ENTROPY_NA, 0 };
+            run.tasks.push_back(task);
+        }
+    }
+
+    /*Slowest first, so the long predictors don't start last*/
+    for (size_t i = 0, j = run.tasks.size(); i < j; i++)
+    {
+        int e = run.tasks[i].estimator;
+        if (e == TRNG_ENTROPY_LZ78Y || e == TRNG_ENTROPY_MULTI_MMC || e == TRNG_ENTROPY_TTUPLE)
+        {
+            entropy_task task = run.tasks[i];
+            run.tasks.erase(run.tasks.begin() + i);
+            run.tasks.insert(run.tasks.begin(), task);
+        }
+    }
+
+    uint64_t start = host_now_ns();
+    std::vector<std::thread> pool;
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        pool.push_back(std::thread(run_tasks, &run));
+    }
+    run_tasks(&run);
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+        pool[i].join();
+    }
+    uint64_t elapsed = host_now_ns() - start;
+    std::sort(run.tasks.begin(), run.tasks.end(), report_order);
+
+    printf("samples            %zu of %u bits, bit string of %zu\n", len, bits, bitstring.size());
+    printf("%-18s %-10s %10s %12s\n", "estimator", "on", "bits", "time");
+    double h = bits;
+    for (size_t i = 0; i < run.tasks.size(); i++)
+    {
+        const entropy_task *task = &run.tasks[i];
+        double scale = task->binary ? bits : 1.0;
+        const char *on = task->binary && bits > 1 ? "bit string" : "samples";
+        for (int j = 0; j < (task->estimator == TRNG_ENTROPY_TTUPLE ? 2 : 1); j++)
+        {
+            double estimate = j ? task->lrs : task->estimate;
+            print_estimate(trng_entropy_name(task->estimator + j), on, estimate, scale, task->ns);
+            if (estimate != TRNG_ENTROPY_NA && estimate * scale < h)
+            {
+                h = estimate * scale;
+            }
+        }
+    }
+    printf("min-entropy        %.6f bits per sample\n", h);
+    printf("elapsed            %.1f ms on %u threads\n", elapsed / 1e6, threads);
+    return 0;
+}
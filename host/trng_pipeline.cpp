@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Parallel qualification of a capture, see qualify_pipeline.h.
+*
+*   trng_pipeline [--source ...] [--bytes 256M] [--chunk 4096] [--percentage 99] [--threads N]
+*                 [--task-chunks N] [--no-transcode]
+*
+* The capture is read from the source into memory first (--bytes of it, or all of a
+* file source), then qualified on --threads threads (the number of cores by default).
+* Exits with 1 if any chunk compressed below the threshold and with 3 if a base64
+* round trip failed.
+*/
+
+#include "host_util.h"
+#include "qualify_pipeline.h"
+#include "trng_core.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+int main(int argc, char **argv)
+{
+    if (host_select_source(argc, argv) != 0)
+    {
+        return 2;
+    }
+
+    pipeline_config cfg;
+    size_t len = (size_t)host_size_arg(argc, argv, "bytes", 256 << 20);
+    cfg.chunk_len = (unsigned int)host_size_arg(argc, argv, "chunk", 4096);
+    cfg.percentage = (unsigned int)host_size_arg(argc, argv, "percentage", 99);
+    cfg.threads = (unsigned int)host_size_arg(argc, argv, "threads", std::thread::hardware_concurrency());
+    cfg.task_chunks = (unsigned int)host_size_arg(argc, argv, "task-chunks", 0);
+    cfg.transcode = 1;
+    for (int i = 1; i < argc; i++)
+    {
+        cfg.transcode &= strcmp(argv[i], "--no-transcode") != 0;
+    }
+
+    /*A file source ends early, what was read is the capture*/
+    std::vector<uint8_t> capture(len);
+    trng_t trng_obj;
+    trng_init(&trng_obj);
+    size_t got = 0;
+    uint64_t start = host_now_ns();
+    while (got < len)
+    {
+        size_t n = 0;
+        if (trng_get_bytes(&trng_obj, &capture[got], len - got, &n) != 0 || n == 0)
+        {
+            break;
+        }
+        got += n;
+    }
+    uint64_t load_ns = host_now_ns() - start;
+    trng_free(&trng_obj);
+
+    pipeline_result res;
+    if (pipeline_qualify(&capture[0], got, &cfg, &res) != 0)
+    {
+        fprintf(stderr, "--chunk must not be 0 and --percentage must be 1 to 100\n");
+        return 2;
+    }
+
+    trng_stream_summary summary;
+    trng_stream_summarize(&res.stats, &summary);
+    double secs = (double)res.elapsed_ns / 1e9;
+    printf("bytes               %llu in %llu chunks of %u (read in %.2f s)\n", (unsigned long long)res.stats.bytes,
+           (unsigned long long)res.stats.chunks, cfg.chunk_len, (double)load_ns / 1e9);
+    printf("throughput          %.2f MB/s on %u threads, %llu tasks\n",
+           secs > 0 ? (double)res.stats.bytes / (1024.0 * 1024.0) / secs : 0.0, (unsigned int)res.threads.size(),
+           (unsigned long long)res.tasks);
+    for (size_t t = 0; t < res.threads.size(); t++)
+    {
+        printf("  thread %-3zu        %llu tasks, %llu steals\n", t, (unsigned long long)res.threads[t].tasks,
+               (unsigned long long)res.threads[t].steals);
+    }
+    printf("compressible chunks %llu (threshold %u%%)\n", (unsigned long long)res.stats.compressible_chunks, cfg.percentage);
+    printf("compression ratio   %.4f\n", summary.compression_ratio);
+    if (cfg.transcode)
+    {
+        printf("base64 round trips  %llu failed\n", (unsigned long long)res.transcode_failures);
+    }
+    printf("mean                %.4f (127.5)\n", summary.mean);
+    printf("bit bias            %.6f (0.5)\n", summary.bit_bias);
+    printf("chi square          %.2f (255 degrees of freedom)\n", summary.chi_square);
+    printf("entropy             %.6f bits/byte\n", summary.entropy);
+    printf("serial correlation  %.6f (0.0)\n", summary.serial_correlation);
+
+    if (res.transcode_failures != 0)
+    {
+        return 3;
+    }
+    return res.stats.compressible_chunks != 0 ? 1 : 0;
+}
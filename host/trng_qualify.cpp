@@ -0,0 +1,296 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Streaming qualification of the trng stand-in source, see trng_stream.h.
+*
+*   trng_qualify [--source ...] [--bytes 1G] [--chunk 4096] [--percentage 99] [--progress 64M] [--hlog N] [--verify]
+*                [--stream] [--wlog 13] [--model order0|orderk|rans] [--order 1] [--model-hlog 16] [--nist] [--serial-m 16] [--apen-m 10] [--dft-block 4096]
+*                [--drbg ctr|hmac] [--reseed-interval 10000] [--prediction-resistance] [--trace]
+*
+* Exits with 1 if any chunk compressed below the threshold, with --verify every chunk
+* is compressed in full and decompressed back, a failed round trip exits with 3. With
+* --stream the chunks are screened in one lzf stream (lzf_stream.h) with a history of
+* 1 << --wlog bytes, so repetition across chunks counts as well (not with --verify). With --model every chunk is
+* also priced by an entropy coding model (trng_model.h) against the threshold, a chunk below it
+* exits with 1 as well. With
+* --nist the data also goes through the SP 800-22 battery (trng_nist.h), p-values are
+* reported against 0.01 and any one below NIST_REJECT exits with 4. With --drbg the
+* data is the output of a CTR_DRBG or HMAC_DRBG (trng_drbg.h) seeded from the source.
+* With --trace the calls and latencies of the trace sites (trng_trace.h) are reported,
+* of a build with TRNG_TRACE=1 (the host default).
+*/
+
+#include "host_util.h"
+#include "trng_stream.h"
+#include "trng_drbg.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#define NIST_ALPHA          0.01                //significance level of SP 800-22
+#define NIST_REJECT         0.0001              //p-value that fails the run, one in 100 tests is below alpha by chance
+
+static void print_progress(const trng_stream_stats *stats, void *ctx)
+{
+    const trng_stream_config *cfg = (const trng_stream_config *)ctx;
+    double mb = (double)stats->bytes / (1024.0 * 1024.0);
+    double secs = (double)stats->elapsed_us / 1e6;
+
+    fprintf(stderr, "%10.1f MB %5.1f%% %8.2f MB/s, %llu compressible chunks\n",
+            mb, 100.0 * (double)stats->bytes / (double)cfg->total_bytes,
+            secs > 0 ? mb / secs : 0.0, (unsigned long long)stats->compressible_chunks);
+}
+
+int main(int argc, char **argv)
+{
+    if (host_select_source(argc, argv) != 0)
+    {
+        return 2;
+    }
+
+    trng_stream_config cfg;
+    cfg.total_bytes = host_size_arg(argc, argv, "bytes", 64 << 20);
+    cfg.chunk_len = (unsigned int)host_size_arg(argc, argv, "chunk", 4096);
+    cfg.percentage = (unsigned int)host_size_arg(argc, argv, "percentage", 99);
+    cfg.progress_interval = host_size_arg(argc, argv, "progress", 64 << 20);
+    cfg.progress = print_progress;
+    cfg.progress_ctx = &cfg;
+    cfg.now_us = host_now_us;
+    cfg.verify_buf = NULL;
+    cfg.fill = NULL;
+    cfg.fill_ctx = NULL;
+    cfg.stream = NULL;
+    cfg.model = NULL;
+
+    if (cfg.chunk_len == 0)
+    {
+        fprintf(stderr, "--chunk must not be 0\n");
+        return 2;
+    }
+
+    unsigned int hlog = (unsigned int)host_size_arg(argc, argv, "hlog", lzf_ctx_hlog_for(cfg.chunk_len, 14));
+    std::vector<uint8_t> arena(lzf_ctx_state_size(hlog));
+    lzf_ctx lzf;
+    if (lzf_ctx_init(&lzf, hlog, arena.data(), arena.size()) != 0)
+    {
+        fprintf(stderr, "unsupported --hlog %u\n", hlog);
+        return 2;
+    }
+
+    bool verify = false, stream = false, nist = false, prediction_resistance = false, trace = false;
+    for (int i = 1; i < argc; i++)
+    {
+        verify |= strcmp(argv[i], "--verify") == 0;
+        stream |= strcmp(argv[i], "--stream") == 0;
+        nist |= strcmp(argv[i], "--nist") == 0;
+        prediction_resistance |= strcmp(argv[i], "--prediction-resistance") == 0;
+        trace |= strcmp(argv[i], "--trace") == 0;
+    }
+
+    if (stream && verify)
+    {
+        fprintf(stderr, "--stream and --verify cannot be combined, --verify compresses every chunk on its own\n");
+        return 2;
+    }
+
+    unsigned int wlog = (unsigned int)host_size_arg(argc, argv, "wlog", LZF_STREAM_WLOG_MAX);
+    std::vector<unsigned int> stream_arena(LZF_STREAM_STATE_SIZE(hlog, wlog) / sizeof(unsigned int) + 1);
+    lzf_stream lzf_stream_state;
+    if (stream)
+    {
+        if (lzf_stream_init(&lzf_stream_state, hlog, wlog, &stream_arena[0], stream_arena.size() * sizeof(unsigned int)) != 0)
+        {
+            fprintf(stderr, "unsupported --wlog %u\n", wlog);
+            return 2;
+        }
+        cfg.stream = &lzf_stream_state;
+    }
+
+    const char *model_name = host_arg(argc, argv, "model", NULL);
+    int model_kind = -1;
+    if (model_name != NULL)
+    {
+        static const char *const kinds[TRNG_MODEL_KINDS] = { "order0", "orderk", "rans" };
+        for (int k = 0; k < TRNG_MODEL_KINDS; k++)
+        {
+            model_kind = strcmp(model_name, kinds[k]) == 0 ? k : model_kind;
+        }
+    }
+    unsigned int model_order = (unsigned int)host_size_arg(argc, argv, "order", 1);
+    unsigned int model_hlog = (unsigned int)host_size_arg(argc, argv, "model-hlog", 8 + 8 * (model_order < 2 ? model_order : 1));
+    std::vector<uint32_t> model_arena(trng_model_state_size(model_kind, model_hlog, cfg.chunk_len) / sizeof(uint32_t) + 1);
+    trng_model model;
+    if (model_name != NULL)
+    {
+        if (trng_model_init(&model, model_kind, model_order, model_hlog, cfg.chunk_len,
+                            &model_arena[0], model_arena.size() * sizeof(uint32_t)) != 0)
+        {
+            fprintf(stderr, "unsupported --model %s, --order %u or --model-hlog %u\n", model_name, model_order, model_hlog);
+            return 2;
+        }
+        cfg.model = &model;
+    }
+
+    const char *drbg_name = host_arg(argc, argv, "drbg", NULL);
+    int mechanism = TRNG_DRBG_CTR;
+    if (drbg_name != NULL && strcmp(drbg_name, "ctr") != 0)
+    {
+        if (strcmp(drbg_name, "hmac") != 0)
+        {
+            fprintf(stderr, "unsupported --drbg %s\n", drbg_name);
+            return 2;
+        }
+        mechanism = TRNG_DRBG_HMAC;
+    }
+
+    trng_nist_config nist_cfg;
+    trng_nist_config_default(&nist_cfg);
+    nist_cfg.serial_m = (unsigned int)host_size_arg(argc, argv, "serial-m", nist_cfg.serial_m);
+    nist_cfg.apen_m = (unsigned int)host_size_arg(argc, argv, "apen-m", nist_cfg.apen_m);
+    nist_cfg.dft_block_bits = (unsigned int)host_size_arg(argc, argv, "dft-block", nist_cfg.dft_block_bits);
+    std::vector<double> nist_arena;
+    trng_nist nist_state;
+    cfg.nist = NULL;
+    if (nist)
+    {
+        size_t size = trng_nist_state_size(&nist_cfg);
+        nist_arena.resize(size / sizeof(double) + 1);
+        if (size == 0 || trng_nist_init(&nist_state, &nist_cfg, &nist_arena[0], nist_arena.size() * sizeof(double)) != 0)
+        {
+            fprintf(stderr, "unsupported --serial-m, --apen-m or --dft-block\n");
+            return 2;
+        }
+        cfg.nist = &nist_state;
+    }
+
+    std::vector<uint8_t> chunk(cfg.chunk_len), comp, scratch;
+    if (verify)
+    {
+        comp.resize(LZF_COMPRESS_BOUND(cfg.chunk_len));
+        scratch.resize(cfg.chunk_len);
+        cfg.verify_buf = &scratch[0];
+    }
+    trng_stream_stats stats;
+    trng_stream_summary summary;
+    trng_t trng_obj;
+
+    trng_drbg drbg;
+    trng_drbg_config drbg_cfg;
+    trng_drbg_config_default(&drbg_cfg, mechanism, trng_drbg_entropy_trng, &trng_obj);
+    drbg_cfg.reseed_interval = (uint32_t)host_size_arg(argc, argv, "reseed-interval", drbg_cfg.reseed_interval);
+    drbg_cfg.prediction_resistance = prediction_resistance;
+
+    if (trace)
+    {
+        host_trace_start();
+    }
+    trng_init(&trng_obj);
+    int trng_res = 0;
+    if (drbg_name != NULL)
+    {
+        trng_res = trng_drbg_init(&drbg, &drbg_cfg, NULL, 0);
+        cfg.fill = trng_drbg_fill;
+        cfg.fill_ctx = &drbg;
+    }
+    if (trng_res == 0)
+    {
+        trng_res = trng_stream_qualify(&trng_obj, &cfg, &chunk[0], verify ? &comp[0] : NULL, &lzf, &stats);
+    }
+    if (drbg_name != NULL)
+    {
+        printf("drbg                %s, %llu reseeds\n", mechanism == TRNG_DRBG_CTR ? "CTR_DRBG AES-256" : "HMAC_DRBG SHA-256",
+               (unsigned long long)drbg.reseeds);
+        trng_drbg_free(&drbg);
+    }
+    trng_free(&trng_obj);
+
+    trng_stream_summarize(&stats, &summary);
+
+    printf("bytes               %llu in %llu chunks of %u\n",
+           (unsigned long long)stats.bytes, (unsigned long long)stats.chunks, cfg.chunk_len);
+    printf("throughput          %.2f MB/s\n", summary.throughput / (1024.0 * 1024.0));
+    printf("compressible chunks %llu (threshold %u%%)\n",
+           (unsigned long long)stats.compressible_chunks, cfg.percentage);
+    printf("compression ratio   %.4f\n", summary.compression_ratio);
+    if (cfg.model != NULL)
+    {
+        printf("model %-13s %llu chunks below the threshold, ratio %.4f\n", model_name,
+               (unsigned long long)stats.model_chunks, stats.bytes ? (double)stats.model_bytes / stats.bytes : 0.0);
+    }
+    if (cfg.stream != NULL)
+    {
+        printf("screened            in one stream, %u bytes of history\n", 1U << wlog);
+    }
+    else if (!verify)
+    {
+        printf("screened            %.1f%% of the input, %.1f%% in back references\n",
+               stats.bytes ? 100.0 * stats.scanned_bytes / stats.bytes : 0.0,
+               stats.bytes ? 100.0 * stats.matched_bytes / stats.bytes : 0.0);
+    }
+    if (verify)
+    {
+        printf("round trips         %llu, %llu failed\n",
+               (unsigned long long)stats.verified_chunks, (unsigned long long)stats.verify_failures);
+    }
+    printf("mean                %.4f (127.5)\n", summary.mean);
+    printf("bit bias            %.6f (0.5)\n", summary.bit_bias);
+    printf("chi square          %.2f (255 degrees of freedom)\n", summary.chi_square);
+    printf("entropy             %.6f bits/byte\n", summary.entropy);
+    printf("serial correlation  %.6f (0.0)\n", summary.serial_correlation);
+
+    unsigned int nist_rejects = 0;
+    if (nist)
+    {
+        trng_nist_result res;
+        trng_nist_final(&nist_state, &res);
+        printf("sp 800-22           %u of %d tests below %.2f\n",
+               trng_nist_failures(&res, NIST_ALPHA), TRNG_NIST_TESTS, NIST_ALPHA);
+        for (unsigned int i = 0; i < TRNG_NIST_TESTS; i++)
+        {
+            if (res.p[i] < 0.0)
+            {
+                printf("  %-19s not enough data\n", trng_nist_test_name(i));
+                continue;
+            }
+            printf("  %-19s p = %.6f%s\n", trng_nist_test_name(i), res.p[i], res.p[i] < NIST_ALPHA ? " *" : "");
+        }
+        nist_rejects = trng_nist_failures(&res, NIST_REJECT);
+    }
+
+    if (trace)
+    {
+        trng_trace snapshot;
+        trng_trace_snapshot(&snapshot);
+        host_trace_print(&snapshot);
+    }
+
+    if (trng_res != 0)
+    {
+        printf("trng_get_bytes error %d after %llu bytes\n", trng_res, (unsigned long long)stats.bytes);
+        return 2;
+    }
+    if (stats.verify_failures != 0)
+    {
+        return 3;
+    }
+    if (stats.compressible_chunks != 0 || stats.model_chunks != 0)
+    {
+        return 1;
+    }
+    return nist_rejects != 0 ? 4 : 0;
+}
@@ -0,0 +1,141 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+#include "work_pool.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*A range of indexes [begin, end), packed as begin << 32 | end. Padded to a cache line by hand so
+  ranges of different threads share no line: std::allocator ignores alignas(64) before C++17*/
+struct work_range {
+    std::atomic<uint64_t> range;
+    char pad[64 - sizeof(std::atomic<uint64_t>)];
+};
+
+struct work_job {
+    work_range *ranges;
+    unsigned int threads;
+    work_fn fn;
+    void *ctx;
+    work_thread_stats *stats;
+};
+
+static inline uint64_t pack(uint64_t begin, uint64_t end)
+{
+    return begin << 32 | end;
+}
+
+/*Take the front index of a range, false when it is empty*/
+static bool take(work_range *r, size_t *index)
+{
+    uint64_t cur = r->range.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        uint64_t begin = cur >> 32, end = cur & 0xffffffffU;
+        if (begin >= end)
+        {
+            return false;
+        }
+        if (r->range.compare_exchange_weak(cur, pack(begin + 1, end), std::memory_order_acq_rel,
+                                           std::memory_order_relaxed))
+        {
+            *index = (size_t)begin;
+            return true;
+        }
+    }
+}
+
+/*Move the back half of the largest other range into self and take its front index*/
+static bool steal(work_job *job, unsigned int self, size_t *index)
+{
+    for (;;)
+    {
+        unsigned int victim = self;
+        uint64_t most = 0, cur = 0;
+        for (unsigned int t = 0; t < job->threads; t++)
+        {
+            uint64_t r = job->ranges[t].range.load(std::memory_order_relaxed);
+            uint64_t left = (r >> 32) < (r & 0xffffffffU) ? (r & 0xffffffffU) - (r >> 32) : 0;
+            if (t != self && left > most)
+            {
+                most = left;
+                victim = t;
+                cur = r;
+            }
+        }
+        if (victim == self)
+        {
+            return false;
+        }
+
+        uint64_t begin = cur >> 32, end = cur & 0xffffffffU, mid = begin + (end - begin) / 2;
+        if (job->ranges[victim].range.compare_exchange_strong(cur, pack(begin, mid), std::memory_order_acq_rel,
+                                                             std::memory_order_relaxed))
+        {
+            /*Own range is empty, thieves leave it alone until it is refilled here*/
+            job->ranges[self].range.store(pack(mid + 1, end), std::memory_order_release);
+            *index = (size_t)mid;
+            return true;
+        }
+    }
+}
+
+static void work_thread(work_job *job, unsigned int self)
+{
+    work_thread_stats stats = { 0, 0 };
+    size_t index;
+    for (;;)
+    {
+        if (!take(&job->ranges[self], &index))
+        {
+            if (!steal(job, self, &index))
+            {
+                break;
+            }
+            stats.steals++;
+        }
+        job->fn(job->ctx, index, self);
+        stats.tasks++;
+    }
+    if (job->stats != NULL)
+    {
+        job->stats[self] = stats;
+    }
+}
+
+void work_run(unsigned int threads, size_t count, work_fn fn, void *ctx, work_thread_stats *stats)
+{
+    threads = threads ? threads : 1;
+    std::vector<work_range> ranges(threads);
+    for (unsigned int t = 0; t < threads; t++)
+    {
+        ranges[t].range.store(pack(count * t / threads, count * (t + 1) / threads), std::memory_order_relaxed);
+    }
+
+    work_job job = { &ranges[0], threads, fn, ctx, stats };
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; t++)
+    {
+        pool.push_back(std::thread(work_thread, &job, t));
+    }
+    work_thread(&job, 0);
+    for (size_t i = 0; i < pool.size(); i++)
+    {
+        pool[i].join();
+    }
+}
@@ -0,0 +1,44 @@
+/*
+* Copyright (c) 2018 ARM Limited. All rights reserved.
+* SPDX-License-Identifier: Apache-2.0
+* Licensed under the Apache License, Version 2.0 (the License); you may
+* not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an AS IS BASIS, WITHOUT
+* WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+
+/*
+* Work stealing scheduler of the host tools. The indexes 0..count-1 of a
+* job are split into one contiguous range per thread. A thread runs the
+* indexes at the front of its own range in order, and once it is empty
+* steals the back half of the largest range left. Ranges are packed in one
+* 64 bit word changed by compare and swap, so neither taking an index nor
+* stealing takes a lock, and a thread only goes looking for work when it
+* has none, so the cost of balancing is paid where the load is uneven.
+*/
+
+#ifndef TRNG_WORK_POOL_H
+#define TRNG_WORK_POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*work_fn)(void *ctx, size_t index, unsigned int thread);
+
+typedef struct {
+    uint64_t tasks;                     //indexes the thread ran
+    uint64_t steals;                    //ranges it took from other threads
+} work_thread_stats;
+
+/*Run fn(ctx, index, thread) for every index below count (at most 2^32 - 1) on threads threads,
+  the calling thread included. stats (may be NULL) receives threads entries*/
+void work_run(unsigned int threads, size_t count, work_fn fn, void *ctx, work_thread_stats *stats);
+
+#endif